@@ -2,6 +2,7 @@
 #define FBT_LVGL_BUTTON_H
 
 #include "fbt_icon_font.h"
+#include <atomic>
 #include <functional>
 #include <lvgl.h>
 #include <memory>
@@ -90,6 +91,8 @@ class FbtLvglButton {
     void SetValue(const std::string &value);
     void SetIcon(const char *icon);
     bool IsInitialized() const { return button_ != nullptr; }
+    // 坐标是否落在显示中的按钮上，不访问 LVGL 对象，可在触摸任务中调用
+    bool Contains(int32_t x, int32_t y) const;
 
     void SetOffset(const int32_t *x = nullptr, const int32_t *y = nullptr, const lv_align_t *area = nullptr);
     // 获取按钮对象（可选）
@@ -113,6 +116,10 @@ class FbtLvglButton {
     lv_obj_t *button_ = nullptr;
     lv_obj_t *label_ = nullptr;
 
+    // 显示时在 LVGL 任务中记下按钮区域，供 Contains() 使用
+    lv_area_t shown_area_ = {};
+    std::atomic<bool> shown_{false};
+
     // 点击回调
     std::function<void()> on_click_;
     std::function<void()> on_press_down_;
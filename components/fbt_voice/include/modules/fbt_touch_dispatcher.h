@@ -54,6 +54,11 @@ class FbtTouchDispatcher {
     // 触摸事件入队
     bool EnqueueTouchDown(const TouchPoint &point);
 
+    // 按下时立即回调（在触摸任务中执行，不经过事件队列），用于提前唤醒音频输入，回调中不要做耗时操作
+    void OnPress(std::function<void(const TouchPoint &)> callback) {
+        on_press_ = std::move(callback);
+    }
+
     bool EnqueueTouchUp(const TouchPoint &point);
 
     bool EnqueueTouchMove(const TouchPoint &last, const TouchPoint &current);
@@ -125,6 +130,7 @@ class FbtTouchDispatcher {
 
     // 成员变量
     std::vector<TouchListener> listeners_;
+    std::function<void(const TouchPoint &)> on_press_;
     SemaphoreHandle_t listener_mutex_ = nullptr;
     QueueHandle_t event_queue_ = nullptr;
     TaskHandle_t worker_task_ = nullptr;
@@ -27,12 +27,29 @@ class FbtAudioRepeater {
      * 播放网络流
      */
     void PlayStream(std::unique_ptr<AudioStreamPacket> packet);
+    /**
+     * 丢弃未播放的网络流并重置解码器，换了说话人时调用
+     */
+    void ResetStream();
     /**
      * 播放铃声
      */
     void PlayRingtone(std::function<bool()> callback);
 
     void EnableDeviceAec(bool enable);
+    /**
+     * 设置上行帧时长(ms)
+     */
+    void SetFrameDuration(int frame_duration_ms);
+    int GetFrameDuration() const;
+    /**
+     * 静音时不编码不发送(DTX)
+     */
+    void EnableDtx(bool enable);
+    /**
+     * 上报网络丢包率(%)，编码器据此开关 FEC
+     */
+    void ReportPacketLoss(int percent);
 
   private:
     AudioService *audio_service_ = nullptr;
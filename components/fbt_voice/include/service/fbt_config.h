@@ -17,17 +17,21 @@ namespace FbtConfig {
 
     class FbtBuilder {
       public:
-        static cJSON *buildAudioMedia() {
+        // frame_duration: 本端上行的帧时长，对端按此解码
+        static cJSON *buildAudioMedia(int frame_duration = CONFIG_USE_FBT_AUDIO_FRAME_DURATION) {
             cJSON *root = cJSON_CreateObject();
             if (!root) {
                 return nullptr;
             };
             int sample_rate = CONFIG_USE_FBT_AUDIO_SAMPLE_RATE;
-            int frame_duration = CONFIG_USE_FBT_AUDIO_FRAME_DURATION;
             cJSON_AddStringToObject(root, "format", "opus");
             cJSON_AddNumberToObject(root, "sampleRate", sample_rate);
             cJSON_AddNumberToObject(root, "frameDuration", frame_duration);
             cJSON_AddNumberToObject(root, "channels", 1);
+#if CONFIG_AUDIO_FRAMES_PER_PACKET > 1
+            // 可以多帧一包，对端在 answer 中回同样的字段才启用
+            cJSON_AddNumberToObject(root, "framesPerPacket", CONFIG_AUDIO_FRAMES_PER_PACKET);
+#endif
             return root;
         };
         static std::string getUrl(std::string url) {
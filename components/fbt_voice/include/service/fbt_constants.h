@@ -49,8 +49,11 @@ typedef enum : uint8_t {
     CONTROL = 0x00,          // 信令
     RELIABLE_CONTROL = 0x01, // 必达
     KEEPALIVE = 0x02,        // 心跳
+    RELIABLE_WINDOW = 0x03,  // 带序号的必达，见 fbt_udp.h
     ACK = 0x05,              // 确认
+    ACK_WINDOW = 0x06,       // 累计 + 位图确认，见 fbt_udp.h
     AUDIO = 0x10,            // 音频
+    AUDIO_EXT = 0x11,        // 带序号/时间戳头的音频（对讲，协商后使用）
     UNKNOWN = 0xFF           // 未知类型
 } PacketType;
 
@@ -79,6 +82,7 @@ namespace FbtCommand {
     constexpr const char *FBT_OFFER = "fbt_offer";
     constexpr const char *FBT_ANSWER = "fbt_answer";
     constexpr const char *ENTER_INTERCOM_ROOM = "enter_intercom_room";
+    constexpr const char *FBT_CAPABILITY = "fbt_capability"; // 设备能力声明（对讲音频头），见 fbt_intercom_receiver.h
 } // namespace FbtCommand
 
 namespace FbtStruct {
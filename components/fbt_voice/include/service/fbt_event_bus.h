@@ -3,6 +3,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
+#include "fbt_transport_worker.h"
 #include <esp_log.h>
 #include <functional>
 #include <memory>
@@ -49,23 +50,21 @@ class FbtEventBus {
             }
         }
     }
+    // 在低优先级的事件任务中发布，队列满时同步发布
     void PublishAsync(const std::string &event_type, const std::string &data) {
-        if (xTaskCreate(
-                [](void *param) {
-                    auto *args = static_cast<std::pair<std::string, std::string> *>(param);
-                    auto &event_bus = FbtEventBus::GetInstance();
-                    event_bus.Publish(args->first, args->second);
-                    delete args;
-                    vTaskDelete(NULL);
-                },
-                "fbt_evt_publish",
-                4096,
-                new std::pair<std::string, std::string>(event_type, data),
-                1,
-                nullptr) != pdPASS) {
-            ESP_LOGE(FBT_EVENT_BUS_TAG, "创建异步发布任务失败");
+        auto *args = new std::pair<std::string, std::string>(event_type, data);
+        bool posted = FbtTransportWorker::EventDispatcher().Post(
+            [](void *param) {
+                auto *args = static_cast<std::pair<std::string, std::string> *>(param);
+                FbtEventBus::GetInstance().Publish(args->first, args->second);
+                delete args;
+            },
+            args);
+        if (!posted) {
+            ESP_LOGW(FBT_EVENT_BUS_TAG, "事件任务队列已满: %s", event_type.c_str());
             // 降级为同步发布
             Publish(event_type, data);
+            delete args;
         }
     }
 
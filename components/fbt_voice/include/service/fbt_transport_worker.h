@@ -0,0 +1,101 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * 常驻的工作任务
+ *
+ * Instance() 是高优先级的传输任务，只做 ACK 发送和必达消息的发送/重传；EventDispatcher() 是低优先级的
+ * 事件任务，分发异步事件。事件回调会连接服务器、操作 UI、关闭通话（销毁 FbtUdp），放在传输任务里既会推迟
+ * ACK，又会在传输任务中销毁还有命令排队的对象，所以两者分开，各有自己的队列。
+ * 命令放在固定长度的队列中，只保存函数指针和参数，入队不分配内存；队列满时 Post 返回 false，由调用方决定
+ * 丢弃还是同步执行。命令按入队顺序执行
+ */
+class FbtTransportWorker {
+  public:
+    using Command = void (*)(void *arg);
+
+    struct Statistics {
+        uint32_t queue_depth;     // 当前排队的命令
+        uint32_t max_queue_depth; // 排队最多时
+        uint32_t executed;
+        uint32_t dropped;            // 队列满被拒绝的
+        uint32_t average_latency_us; // 入队到开始执行
+        uint32_t max_latency_us;
+        uint32_t max_run_us; // 单个命令最长执行时间
+    };
+
+    static FbtTransportWorker &Instance() {
+        static FbtTransportWorker instance("fbt_transport", CONFIG_FBT_TRANSPORT_WORKER_STACK_SIZE,
+                                           CONFIG_FBT_TRANSPORT_WORKER_PRIORITY, CONFIG_FBT_TRANSPORT_WORKER_QUEUE_LENGTH);
+        return instance;
+    }
+
+    static FbtTransportWorker &EventDispatcher() {
+        static FbtTransportWorker instance("fbt_events", CONFIG_FBT_EVENT_DISPATCH_STACK_SIZE,
+                                           CONFIG_FBT_EVENT_DISPATCH_PRIORITY, CONFIG_FBT_EVENT_DISPATCH_QUEUE_LENGTH);
+        return instance;
+    }
+
+    // 第一次 Post 时自动初始化
+    bool Init();
+
+    /**
+     * 把命令放入队列，不等待。可在任意任务（包括 UDP 接收回调、esp_timer 回调）中调用
+     */
+    bool Post(Command command, void *arg);
+
+    /**
+     * 等待此前入队的命令全部执行完，释放命令参数指向的对象前调用。在本任务中调用时无法等待，直接返回，
+     * 所以命令参数指向的对象不能在本任务中释放
+     */
+    void Drain();
+
+    bool InWorker() const {
+        return worker_task_ != nullptr && xTaskGetCurrentTaskHandle() == worker_task_;
+    }
+
+    Statistics GetStatistics() const;
+    void ResetStatistics();
+    void LogStatistics() const;
+
+  private:
+    FbtTransportWorker(const char *name, uint32_t stack_size, UBaseType_t priority, uint32_t queue_length)
+        : name_(name), stack_size_(stack_size), priority_(priority), queue_length_(queue_length) {}
+    ~FbtTransportWorker() {}
+
+    // 禁止拷贝
+    FbtTransportWorker(const FbtTransportWorker &) = delete;
+    FbtTransportWorker &operator=(const FbtTransportWorker &) = delete;
+
+    struct Item {
+        Command command;
+        void *arg;
+        int64_t enqueued_us;
+    };
+
+    static void worker_task(void *arg);
+    void execute(const Item &item);
+
+    const char *name_;
+    uint32_t stack_size_;
+    UBaseType_t priority_;
+    uint32_t queue_length_;
+    QueueHandle_t queue_ = nullptr;
+    TaskHandle_t worker_task_ = nullptr;
+    std::mutex init_mutex_;
+
+    std::atomic<uint32_t> max_queue_depth_{0};
+    std::atomic<uint32_t> executed_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint64_t> total_latency_us_{0};
+    std::atomic<uint32_t> max_latency_us_{0};
+    std::atomic<uint32_t> max_run_us_{0};
+};
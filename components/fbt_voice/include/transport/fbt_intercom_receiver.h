@@ -0,0 +1,114 @@
+#ifndef FBT_INTERCOM_RECEIVER_H
+#define FBT_INTERCOM_RECEIVER_H
+
+#include "protocol.h"
+
+#include <cJSON.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+/**
+ * 对讲音频头（PacketType::AUDIO_EXT），所有字段为网络字节序，后面紧跟 opus 数据。
+ *
+ * 协商按听众进行：每个设备在心跳后发 FbtCommand::FBT_CAPABILITY，在 audio.header 中声明能收的版本。
+ * 说话方在 offer 的 audio.header 中声明支持的版本，服务端只有在房间内每个成员都声明过时才在 answer
+ * 中回同样的字段，说话方这时才发 AUDIO_EXT；有成员没有声明（旧固件不认识 AUDIO_EXT，会当成未知包丢掉）
+ * 或服务端是旧版本时不回，说话方退回只有 1 字节类型的 PacketType::AUDIO。接收方两种格式都接受
+ */
+#define FBT_INTERCOM_AUDIO_VERSION 1
+/**
+ * 标志：语音开始前补发的静音（DTX preroll），已经晚了，接收方落后时可以丢掉
+ */
+#define FBT_INTERCOM_AUDIO_PREROLL_FLAG 0x02
+
+struct __attribute__((packed)) FbtIntercomAudioHeader {
+    uint8_t type;
+    uint8_t version_flags; // 高 4 位版本号，低 4 位标志（AUDIO_BUNDLE_FLAG：多帧一包，见 audio_bundle.h；FBT_INTERCOM_AUDIO_PREROLL_FLAG）
+    uint16_t talker;       // 说话人，服务端在 answer 的 talkerId 中分配，缺省由设备号生成
+    uint16_t sequence;     // 每帧加一，接收方扩展为 32 位
+    uint32_t timestamp;    // 说话方采集时间（ms）
+};
+
+/**
+ * 从 answer 的 audio 对象中取出协商的音频头版本，0 为旧格式
+ */
+int FbtIntercomHeaderVersion(const cJSON *audio);
+
+/**
+ * 每收到这么多帧，把这段时间的下行丢包率报给上行编码器（对讲没有接收方报告，下行丢包代表网络状况）
+ */
+#define FBT_VOICE_LOSS_REPORT_FRAMES 32
+
+/**
+ * 对讲下行统计，按说话人分段，参考 RFC 3550
+ */
+struct FbtVoiceReceiveStats {
+    uint32_t received = 0;
+    uint32_t lost = 0;
+    uint32_t duplicate = 0;
+    uint32_t reordered = 0;
+    int jitter_ms = 0;
+};
+
+struct FbtIntercomReceiverCallbacks {
+    // 一帧音频，带序号的交给抖动缓冲排序
+    std::function<void(std::unique_ptr<AudioStreamPacket> packet)> on_audio;
+    // 换了说话人，之前未播放的音频作废
+    std::function<void()> on_talker_changed;
+    // 最近 FBT_VOICE_LOSS_REPORT_FRAMES 帧的丢包率（%）
+    std::function<void(int loss_percent)> on_packet_loss;
+};
+
+/**
+ * 对讲下行：解析 AUDIO / AUDIO_EXT 包，把 16 位序号扩展为 32 位，去掉重复的包，统计丢包、乱序和抖动，
+ * 拆开多帧包，每帧交给 on_audio。
+ *
+ * 只在 UDP 接收回调中使用
+ */
+class FbtIntercomReceiver {
+  public:
+    explicit FbtIntercomReceiver(FbtIntercomReceiverCallbacks callbacks) : callbacks_(std::move(callbacks)) {}
+
+    void SetFormat(int sample_rate, int frame_duration);
+    /**
+     * 开始收听，下一个包按新说话人处理
+     */
+    void Reset() { started_ = false; }
+    /**
+     * 整个数据报，第一个字节是包类型，其他类型的包忽略
+     */
+    void OnPacket(std::string_view payload);
+
+    const FbtVoiceReceiveStats &stats() const { return stats_; }
+    uint16_t talker() const { return talker_; }
+    void LogStatistics() const;
+
+  private:
+    void on_audio(const uint8_t *data, size_t size, uint32_t sequence, bool preroll);
+    void on_audio_ext(std::string_view payload);
+    void on_frame(uint16_t sequence, uint32_t timestamp, const uint8_t *data, size_t size, bool preroll);
+    void reset_stream(uint16_t talker);
+    void report_loss();
+
+    FbtIntercomReceiverCallbacks callbacks_;
+    int sample_rate_ = 16000;
+    int frame_duration_ = 60;
+
+    bool started_ = false;
+    uint16_t talker_ = 0;
+    uint32_t highest_ = 0;
+    uint32_t first_ = 0;
+    // 最近 64 个序号是否已收到，bit0 对应 highest_
+    uint64_t seen_mask_ = 0;
+    int64_t last_transit_ms_ = 0;
+    int jitter_q4_ = 0;
+    FbtVoiceReceiveStats stats_;
+    // 上次上报丢包率时的统计
+    uint32_t reported_received_ = 0;
+    uint32_t reported_lost_ = 0;
+};
+
+#endif // FBT_INTERCOM_RECEIVER_H
@@ -1,6 +1,7 @@
 #ifndef FBT_PHONE_TRANSPORT_H
 #define FBT_PHONE_TRANSPORT_H
 
+#include "audio_bundle.h"
 #include "display.h"
 
 #include "fbt_audio_repeater.h"
@@ -11,12 +12,14 @@
 #include "fbt_udp.h"
 #include "fbt_ui_phone.h"
 #include "protocol.h"
+#include <cJSON.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <mbedtls/aes.h>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Udp;
@@ -54,25 +57,36 @@ class FbtPhoneTransport {
     bool send_offer();
     void send_bye();
     void close();
+    // UDP 接收回调中不能释放 udp_（回调还在它里面执行），交给事件任务关闭
+    void close_later(bool bye);
 
     // 呼出模式
     void handle_call_out();
     // 呼入模式
     void handle_call_in();
 
-    void on_udp_packet(const std::string &data);
-    void handle_json(const std::string &json_data);
-    void on_remote_audio(const std::string &data);
+    void on_udp_packet(std::string_view data);
+    void handle_json(std::string_view json_data);
+    void on_remote_audio(std::string_view data);
+    void play_remote_frame(const uint8_t *data, size_t size, uint32_t timestamp, uint32_t sequence);
+    bool send_audio_datagram(const uint8_t *payload, size_t size, uint32_t timestamp, int frames, bool bundle);
+    void flush_audio();
     void start_call();
     std::string generate_json(const std::string &type);
 
-    bool load_media(const std::string &json_data);
+    bool load_media(const cJSON *root);
 
   private:
     // 网络组件
     std::unique_ptr<FbtUdp> udp_;
     std::mutex channel_mutex_;
     mbedtls_aes_context aes_ctx_;
+    // 复用的音频发送缓冲（受 channel_mutex_ 保护），避免每帧分配
+    std::string audio_send_buffer_;
+    // 协商了多帧一包时待发送的帧（受 channel_mutex_ 保护）
+    AudioBundler bundler_;
+    // 解密后的多帧包，只在 UDP 接收回调中使用
+    std::vector<uint8_t> receive_buffer_;
 
     // 硬件组件
     Board &board_;
@@ -2,31 +2,106 @@
 #define FBT_UDP_H
 
 #include "board.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+/**
+ * 必达消息（SendMust）
+ *
+ * 带序号的格式：|RELIABLE_WINDOW 1u|sequence 2u|oldest 2u|RELIABLE_CONTROL 1u|json|
+ * 确认：        |ACK_WINDOW 1u|next 2u|mask 4u|，next 之前的都已收到，mask 第 i 位表示 next + i 已收到
+ *
+ * oldest 是发送方还在等确认的最早序号。接收方从 oldest 开始记录，之前的不再等待：第一条消息丢了时
+ * 不会被当成已收到，发送方放弃的消息也不会卡住 next
+ *
+ * 最多 CONFIG_FBT_UDP_RELIABLE_WINDOW 条消息同时等待确认，其余排队，不再互相覆盖。重传超时由 RTT 估计
+ * 得出（RFC 6298），超时后退避。对端声明支持（上层在 offer / answer 的 "reliable" 字段中看到
+ * FBT_UDP_RELIABLE_VERSION 后调用 SetPeerWindowed），或发来过带序号的消息或确认后才使用新格式，在此之前按旧格式
+ * （|RELIABLE_CONTROL|json|）一次只发一条。接收方两种格式都接受，按收到的格式回确认：旧格式回单字节 ACK，
+ * 带序号的回 ACK_WINDOW。带序号的消息去重后以旧格式交给上层
+ *
+ * 发送（ACK、必达消息、重传）都在 FbtTransportWorker 中进行，不在 UDP 接收回调或 esp_timer 任务中阻塞
+ */
+#define FBT_UDP_RELIABLE_VERSION 1
+#define FBT_UDP_INITIAL_RTO_US 1000000
+#define FBT_UDP_MIN_RTO_US 200000
+#define FBT_UDP_MAX_RTO_US 4000000
+#define FBT_UDP_WINDOW_HEADER_SIZE 5
+// 接收方记录的序号范围，超出视为对端重新开始
+#define FBT_UDP_RECEIVE_WINDOW 32
+
 class FbtUdp : public Udp {
   private:
+    struct ReliableMessage {
+        uint16_t sequence = 0;
+        // 以 RELIABLE_CONTROL 开头的消息，发送时按对端格式加头
+        std::string payload;
+        int64_t sent_us = 0;
+        int64_t deadline_us = 0;
+        int retries = 0;
+        bool retransmitted = false;
+        // 首次发送时的格式，重传沿用，否则切换格式前后各交付一次
+        bool windowed = false;
+    };
+
     std::unique_ptr<Udp> udp_;
-    std::string ack_packet_;
     int max_retries_;
-    int retries_ = 0;
-    std::string payload_;
+    std::function<void(std::string_view packet)> packet_callback_;
     esp_timer_handle_t timeout_timer_ = nullptr;
-    bool start_timeout_timer = false;
+    // 已有一次 pump 在工作任务队列中，不再重复入队
+    std::atomic<bool> pump_pending_{false};
+    // 析构开始后接收回调和定时器回调直接返回，不再把本对象放进工作任务队列；正在执行的由析构等待
+    std::atomic<bool> closing_{false};
+    std::atomic<int> active_callbacks_{0};
 
-    void resend_send();
+    struct CallbackScope {
+        explicit CallbackScope(FbtUdp *udp) : udp(udp) { udp->active_callbacks_++; }
+        ~CallbackScope() { udp->active_callbacks_--; }
+        bool closing() const { return udp->closing_; }
+        FbtUdp *udp;
+    };
 
-    void start_timer();
-    void stop_timer();
+    // 以下受 reliable_mutex_ 保护
+    std::mutex reliable_mutex_;
+    bool peer_windowed_ = false;
+    uint16_t next_sequence_ = 0;
+    std::deque<ReliableMessage> in_flight_;
+    std::deque<std::string> backlog_;
+    int64_t srtt_us_ = 0;
+    int64_t rttvar_us_ = 0;
+    int64_t rto_us_ = FBT_UDP_INITIAL_RTO_US;
+    bool remote_started_ = false;
+    uint16_t remote_next_ = 0;
+    uint32_t remote_mask_ = 0;
+
+    size_t window() const { return peer_windowed_ ? CONFIG_FBT_UDP_RELIABLE_WINDOW : 1; }
+    void pump();
+    void schedule_pump();
+    void fill_window();
+    void update_rtt(int64_t sample_us);
+    void on_ack(std::string_view data);
+    bool on_reliable_window(std::string_view data);
+    void arm_timer(int64_t now_us);
 
     void send_ack();
+    void send_window_ack();
+    void listen();
 
     static void VoiceTimeoutHandler(void *arg) {
         FbtUdp *server = static_cast<FbtUdp *>(arg);
-        server->resend_send();
+        CallbackScope scope(server);
+        if (!scope.closing()) {
+            server->schedule_pump();
+        }
     }
 
     TaskHandle_t high_priority_task_ = nullptr;
@@ -62,9 +137,17 @@ class FbtUdp : public Udp {
     int GetLastError() override;
     void OnMessage(std::function<void(const std::string &data)> callback) override;
     /**
-     * 发送必达消息
+     * 以视图接收数据包，不做拷贝，视图只在回调期间有效。与 OnMessage 二选一
+     */
+    void OnPacket(std::function<void(std::string_view packet)> callback);
+    /**
+     * 发送必达消息，窗口已满时排队
      */
     bool SendMust(const std::string &payload);
+    /**
+     * 对端声明支持带序号的必达消息，之后按窗口发送
+     */
+    void SetPeerWindowed();
 };
 
 // 创建函数
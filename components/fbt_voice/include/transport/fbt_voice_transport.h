@@ -1,21 +1,25 @@
 #ifndef FBT_VOICE_TRANSPORT_H
 #define FBT_VOICE_TRANSPORT_H
 
+#include "audio_bundle.h"
 #include "display.h"
 
 #include "fbt_audio_repeater.h"
 #include "fbt_constants.h"
+#include "fbt_intercom_receiver.h"
 #include "fbt_mqtt_server.h"
 #include "fbt_udp.h"
 #include "fbt_ui_voice.h"
 #include "protocol.h"
 
+#include <cJSON.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <mbedtls/aes.h>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum FbtVoiceOfferStatus {
@@ -42,13 +46,16 @@ class FbtVoiceTransport {
   private:
     bool open_server();
     void close_server();
-    void on_udp_packet(const std::string &payload);
-
-    void on_udp_message(const std::string &payload);
-    void on_remote_audio(const std::string &payload);
-    void handle_answer(const std::string data);
+    void on_udp_packet(std::string_view payload);
+
+    void on_udp_message(std::string_view payload);
+    void on_remote_audio(std::unique_ptr<AudioStreamPacket> packet);
+    void send_audio(const uint8_t *payload, size_t size, int64_t captured_us, int frames, uint8_t flags);
+    void flush_audio();
+    void send_capability();
+    void handle_answer(const cJSON *root);
     void start_speaking();
-    void start_tune_in(const std::string &payload);
+    void start_tune_in(const cJSON *root);
     bool start_voice();
     void end_active();
     void send_offer(FbtVoiceOfferStatus status);
@@ -56,7 +63,7 @@ class FbtVoiceTransport {
     void send_udp_message(const std::string &json_str);
     void start_on_timeout(int timeout_us);
     void close_on_timeout();
-    bool load_media(const std::string &json_data);
+    bool load_media(const cJSON *root);
 
     bool is_unavailable();
 
@@ -79,6 +86,25 @@ class FbtVoiceTransport {
 
     std::unique_ptr<FbtUdp> udp_;
     std::mutex channel_mutex_;
+    /**
+     * 复用的音频发送缓冲，避免每帧分配
+     */
+    std::string audio_send_buffer_;
+    /**
+     * 发送用的音频头版本，0 为旧格式
+     */
+    int audio_header_version_ = 0;
+    uint16_t talker_id_ = 0;
+    uint16_t local_sequence_ = 0;
+    /**
+     * 协商了多帧一包时待发送的帧（受 channel_mutex_ 保护），只在带音频头时使用
+     */
+    AudioBundler bundler_;
+
+    /**
+     * 下行，只在 UDP 接收回调中访问
+     */
+    FbtIntercomReceiver receiver_;
 
     std::string group_id_;
     std::string device_id_;
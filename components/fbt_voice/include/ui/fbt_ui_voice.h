@@ -16,6 +16,8 @@ class FbtUiVoice {
     void EnterIdle();
     void SetEnterState(bool enter);
     void SetRtcState(FbtRtcState state_);
+    // 触摸点是否在对讲键上，可在触摸任务中调用
+    bool IsOnTalkKey(int32_t x, int32_t y) const { return mic_btn_.Contains(x, y); }
 
   private:
     FbtUiVoice() = default;
@@ -11,16 +11,30 @@ void FbtLvglButton::CreateBtn(const FbtButtonParam &param) {
 }
 
 void FbtLvglButton::Show() {
-    lv_async_call([](void *btn) { lv_obj_clear_flag((lv_obj_t *)btn, LV_OBJ_FLAG_HIDDEN); }, button_);
+    lv_async_call([](void *arg) {
+        FbtLvglButton *self = static_cast<FbtLvglButton *>(arg);
+        lv_obj_clear_flag(self->button_, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_update_layout(self->button_);
+        lv_obj_get_coords(self->button_, &self->shown_area_);
+        self->shown_ = true;
+    }, this);
 }
 
 void FbtLvglButton::Hide() {
     // 不要直接调用，而是发送消息到LVGL任务
 
     // 使用LVGL的异步API或任务间通信
+    shown_ = false;
     lv_async_call([](void *btn) { lv_obj_add_flag((lv_obj_t *)btn, LV_OBJ_FLAG_HIDDEN); }, button_);
 }
 
+bool FbtLvglButton::Contains(int32_t x, int32_t y) const {
+    if (!shown_) {
+        return false;
+    }
+    return x >= shown_area_.x1 && x <= shown_area_.x2 && y >= shown_area_.y1 && y <= shown_area_.y2;
+}
+
 void FbtLvglButton::SetValue(const std::string &value) {
     if (label_) {
         lv_label_set_text(label_, value.c_str());
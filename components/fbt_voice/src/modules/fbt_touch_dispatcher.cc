@@ -54,6 +54,10 @@ bool FbtTouchDispatcher::EnqueueTouchDown(const TouchPoint &point) {
     if (!initialized_)
         return false;
 
+    // 按下可能是对讲，提前预热麦克风
+    if (on_press_)
+        on_press_(point);
+
     TouchEvent event;
     event.type = EVENT_DOWN;
     event.point1 = point;
@@ -16,7 +16,7 @@ bool FbtAudioRepeater::InterruptRingtone() {
         return false;
     if (ringtone_task_) {
         ringtone_task_ = nullptr; // 先置空，避免重复进入
-        audio_service_->FbtInterruptPlayback();
+        audio_service_->StopPrompts();
     }
     return true;
 }
@@ -27,6 +27,12 @@ void FbtAudioRepeater::PlayStream(std::unique_ptr<AudioStreamPacket> packet) {
     audio_service_->PushPacketToDecodeQueue(std::move(packet));
 }
 
+void FbtAudioRepeater::ResetStream() {
+    if (!audio_service_)
+        return;
+    audio_service_->ResetDecoder();
+}
+
 void FbtAudioRepeater::PlayRingtone(std::function<bool()> callback) {
     if (!InterruptRingtone())
         return;
@@ -47,6 +53,30 @@ void FbtAudioRepeater::EnableDeviceAec(bool enable) {
     audio_service_->EnableDeviceAec(enable);
 }
 
+void FbtAudioRepeater::SetFrameDuration(int frame_duration_ms) {
+    if (!audio_service_)
+        return;
+    audio_service_->SetFrameDuration(frame_duration_ms);
+}
+
+void FbtAudioRepeater::EnableDtx(bool enable) {
+    if (!audio_service_)
+        return;
+    audio_service_->EnableDtx(enable);
+}
+
+void FbtAudioRepeater::ReportPacketLoss(int percent) {
+    if (!audio_service_)
+        return;
+    audio_service_->ReportPacketLoss(percent);
+}
+
+int FbtAudioRepeater::GetFrameDuration() const {
+    if (!audio_service_)
+        return OPUS_FRAME_DURATION_MS;
+    return audio_service_->frame_duration();
+}
+
 void FbtAudioRepeater::RingtoneTask(void *arg) {
     std::unique_ptr<RingtoneContext> ctx(static_cast<RingtoneContext *>(arg));
     FbtAudioRepeater *self = ctx->server;
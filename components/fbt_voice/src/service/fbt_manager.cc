@@ -10,6 +10,8 @@
 #include "fbt_mcp_service.h"
 #include "fbt_mqtt_server.h"
 #include "fbt_phone_transport.h"
+#include "fbt_touch_dispatcher.h"
+#include "fbt_ui_voice.h"
 #include "fbt_voice_transport.h"
 #include <esp_log.h>
 
@@ -87,6 +89,12 @@ bool FbtManager::Start(EventGroupHandle_t event_, AudioService &audio_service) {
     mcp_server_.Init();
 
     audio_repeater_ = std::make_unique<FbtAudioRepeater>(audio_service_);
+    // 按下对讲键到开始采音之间没有预热时间，按下对讲键即让音频输入上电，其他触摸不用
+    FbtTouchDispatcher::Instance().OnPress([this](const TouchPoint &point) {
+        if (IsIntercomMode() && FbtUiVoice::GetInstance().IsOnTalkKey(point.x, point.y)) {
+            audio_service_->PrewarmInput();
+        }
+    });
     // 创建并启动MQTT服务
     fbt_mqtt_ = std::make_unique<FbtMqttServer>();
     if (!fbt_mqtt_->Start()) {
@@ -0,0 +1,124 @@
+#include "fbt_transport_worker.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "fbt_transport_worker"
+
+bool FbtTransportWorker::Init() {
+    std::lock_guard<std::mutex> lock(init_mutex_);
+    if (worker_task_)
+        return true;
+
+    // 创建命令队列
+    if (!queue_) {
+        queue_ = xQueueCreate(queue_length_, sizeof(Item));
+        if (!queue_) {
+            ESP_LOGE(TAG, "%s: failed to create command queue", name_);
+            return false;
+        }
+    }
+
+    // 创建工作线程
+    if (xTaskCreate(worker_task, name_, stack_size_, this, priority_, &worker_task_) != pdPASS) {
+        ESP_LOGE(TAG, "%s: failed to create worker task", name_);
+        worker_task_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool FbtTransportWorker::Post(Command command, void *arg) {
+    if (!worker_task_ && !Init()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Item item = {command, arg, esp_timer_get_time()};
+    if (xQueueSend(queue_, &item, 0) != pdTRUE) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t depth = uxQueueMessagesWaiting(queue_);
+    uint32_t max_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    while (depth > max_depth && !max_queue_depth_.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+void FbtTransportWorker::Drain() {
+    if (!worker_task_ || InWorker())
+        return;
+
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    if (!done)
+        return;
+    Item item = {[](void *arg) { xSemaphoreGive(static_cast<SemaphoreHandle_t>(arg)); }, done, esp_timer_get_time()};
+    // 排在此前所有命令之后，队列满时等待
+    if (xQueueSend(queue_, &item, portMAX_DELAY) == pdTRUE) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(done);
+}
+
+void FbtTransportWorker::worker_task(void *arg) {
+    FbtTransportWorker *self = static_cast<FbtTransportWorker *>(arg);
+    Item item;
+
+    while (1) {
+        if (xQueueReceive(self->queue_, &item, portMAX_DELAY) == pdTRUE) {
+            self->execute(item);
+        }
+    }
+}
+
+void FbtTransportWorker::execute(const Item &item) {
+    int64_t start_us = esp_timer_get_time();
+    uint32_t latency_us = start_us - item.enqueued_us;
+    item.command(item.arg);
+    uint32_t run_us = esp_timer_get_time() - start_us;
+
+    // 只有工作任务写入，不需要比较交换
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    total_latency_us_.fetch_add(latency_us, std::memory_order_relaxed);
+    if (latency_us > max_latency_us_.load(std::memory_order_relaxed)) {
+        max_latency_us_.store(latency_us, std::memory_order_relaxed);
+    }
+    if (run_us > max_run_us_.load(std::memory_order_relaxed)) {
+        max_run_us_.store(run_us, std::memory_order_relaxed);
+    }
+}
+
+FbtTransportWorker::Statistics FbtTransportWorker::GetStatistics() const {
+    Statistics statistics = {};
+    statistics.queue_depth = queue_ ? uxQueueMessagesWaiting(queue_) : 0;
+    statistics.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    statistics.executed = executed_.load(std::memory_order_relaxed);
+    statistics.dropped = dropped_.load(std::memory_order_relaxed);
+    if (statistics.executed > 0) {
+        statistics.average_latency_us = total_latency_us_.load(std::memory_order_relaxed) / statistics.executed;
+    }
+    statistics.max_latency_us = max_latency_us_.load(std::memory_order_relaxed);
+    statistics.max_run_us = max_run_us_.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void FbtTransportWorker::ResetStatistics() {
+    max_queue_depth_ = 0;
+    executed_ = 0;
+    dropped_ = 0;
+    total_latency_us_ = 0;
+    max_latency_us_ = 0;
+    max_run_us_ = 0;
+}
+
+void FbtTransportWorker::LogStatistics() const {
+    Statistics statistics = GetStatistics();
+    if (statistics.executed == 0 && statistics.dropped == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "%s: %lu executed, %lu dropped, queue %lu (max %lu), latency avg %lu us max %lu us, longest command %lu us",
+             name_, statistics.executed, statistics.dropped, statistics.queue_depth, statistics.max_queue_depth,
+             statistics.average_latency_us, statistics.max_latency_us, statistics.max_run_us);
+}
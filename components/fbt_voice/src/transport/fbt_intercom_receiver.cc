@@ -0,0 +1,175 @@
+#include "fbt_intercom_receiver.h"
+
+#include "audio_bundle.h"
+#include "fbt_constants.h"
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "fbt_intercom"
+
+int FbtIntercomHeaderVersion(const cJSON *audio) {
+    cJSON *header = cJSON_IsObject(audio) ? cJSON_GetObjectItem(audio, "header") : nullptr;
+    if (!cJSON_IsNumber(header) || header->valueint < FBT_INTERCOM_AUDIO_VERSION) {
+        return 0;
+    }
+    return FBT_INTERCOM_AUDIO_VERSION;
+}
+
+void FbtIntercomReceiver::SetFormat(int sample_rate, int frame_duration) {
+    sample_rate_ = sample_rate;
+    frame_duration_ = frame_duration;
+}
+
+void FbtIntercomReceiver::OnPacket(std::string_view payload) {
+    if (payload.empty()) {
+        return;
+    }
+    switch (static_cast<uint8_t>(payload[0])) {
+        case PacketType::AUDIO:
+            // 旧格式来自不带音频头的说话人，之前的带头的流到此结束
+            if (started_) {
+                reset_stream(0);
+                started_ = false;
+            }
+            on_audio(reinterpret_cast<const uint8_t *>(payload.data()) + 1, payload.size() - 1, 0, false);
+            break;
+        case PacketType::AUDIO_EXT:
+            on_audio_ext(payload);
+            break;
+        default:
+            break;
+    }
+}
+
+void FbtIntercomReceiver::on_audio(const uint8_t *data, size_t size, uint32_t sequence, bool preroll) {
+    if (size == 0 || !callbacks_.on_audio) {
+        return;
+    }
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sample_rate = sample_rate_;
+    packet->frame_duration = frame_duration_;
+    packet->timestamp = 0;
+    // 有序号时乱序和迟到的包交给 AudioService 的抖动缓冲处理
+    packet->sequence = sequence;
+    packet->preroll = preroll;
+    packet->payload.assign(data, data + size);
+    callbacks_.on_audio(std::move(packet));
+}
+
+void FbtIntercomReceiver::on_audio_ext(std::string_view payload) {
+    if (payload.size() <= sizeof(FbtIntercomAudioHeader)) {
+        return;
+    }
+    FbtIntercomAudioHeader header;
+    memcpy(&header, payload.data(), sizeof(header));
+    if ((header.version_flags >> 4) != FBT_INTERCOM_AUDIO_VERSION) {
+        ESP_LOGW(TAG, "Unsupported intercom audio version %d", header.version_flags >> 4);
+        return;
+    }
+    uint16_t talker = ntohs(header.talker);
+    uint16_t sequence = ntohs(header.sequence);
+    if (!started_ || talker != talker_) {
+        reset_stream(talker);
+        // 从 0x10000 起扩展，扩展后的序号不会是表示"无序号"的 0
+        highest_ = first_ = 0x10000 + sequence - 1;
+        seen_mask_ = 0;
+    }
+
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(payload.data()) + sizeof(header);
+    size_t size = payload.size() - sizeof(header);
+    uint32_t timestamp = ntohl(header.timestamp);
+    bool preroll = header.version_flags & FBT_INTERCOM_AUDIO_PREROLL_FLAG;
+    if (!(header.version_flags & AUDIO_BUNDLE_FLAG)) {
+        on_frame(sequence, timestamp, data, size, preroll);
+        return;
+    }
+    // 多帧包，第 i 帧的序号和时间戳顺延 i 帧
+    uint16_t index = 0;
+    bool valid = AudioBundler::Split(data, size, [&](const uint8_t *frame, size_t frame_size) {
+        on_frame(sequence + index, timestamp + index * frame_duration_, frame, frame_size, preroll);
+        index++;
+    });
+    if (!valid) {
+        ESP_LOGW(TAG, "Invalid audio bundle of %u bytes", size);
+    }
+}
+
+void FbtIntercomReceiver::on_frame(uint16_t sequence, uint32_t timestamp, const uint8_t *data, size_t size, bool preroll) {
+    // 16 位序号按离最高序号最近的方向扩展为 32 位
+    uint32_t extended = highest_ + (int16_t)(sequence - (uint16_t)highest_);
+    int32_t offset = (int32_t)(extended - highest_);
+    if (offset > 0) {
+        seen_mask_ = offset >= 64 ? 1 : (seen_mask_ << offset) | 1;
+        highest_ = extended;
+
+        // 到达间隔抖动，只看按序到达的包；preroll 是故意晚发的，不算
+        if (!preroll) {
+            int64_t transit_ms = esp_timer_get_time() / 1000 - timestamp;
+            if (stats_.received > 0) {
+                int64_t d = transit_ms - last_transit_ms_;
+                jitter_q4_ += ((d < 0 ? -d : d) * 16 - jitter_q4_) / 16;
+                stats_.jitter_ms = jitter_q4_ / 16;
+            }
+            last_transit_ms_ = transit_ms;
+        }
+    } else if (-offset < 64) {
+        uint64_t bit = 1ULL << -offset;
+        if (seen_mask_ & bit) {
+            stats_.duplicate++;
+            return;
+        }
+        seen_mask_ |= bit;
+        stats_.reordered++;
+    } else {
+        // 太旧了，抖动缓冲也不会要
+        stats_.reordered++;
+        return;
+    }
+    stats_.received++;
+    uint32_t expected = highest_ - first_;
+    stats_.lost = expected > stats_.received ? expected - stats_.received : 0;
+    if (stats_.received - reported_received_ >= FBT_VOICE_LOSS_REPORT_FRAMES) {
+        report_loss();
+    }
+
+    on_audio(data, size, extended, preroll);
+}
+
+void FbtIntercomReceiver::reset_stream(uint16_t talker) {
+    if (started_) {
+        ESP_LOGI(TAG, "Talker changed from %u to %u", talker_, talker);
+        LogStatistics();
+        // 新说话人的序号与之前无关，丢掉未播放的音频
+        if (callbacks_.on_talker_changed) {
+            callbacks_.on_talker_changed();
+        }
+    }
+    started_ = true;
+    talker_ = talker;
+    jitter_q4_ = 0;
+    stats_ = FbtVoiceReceiveStats();
+    reported_received_ = 0;
+    reported_lost_ = 0;
+}
+
+void FbtIntercomReceiver::report_loss() {
+    uint32_t received = stats_.received - reported_received_;
+    // 迟到的包会让丢包数回落，这时按没有丢包算
+    uint32_t lost = stats_.lost > reported_lost_ ? stats_.lost - reported_lost_ : 0;
+    reported_received_ = stats_.received;
+    reported_lost_ = stats_.lost;
+    if (callbacks_.on_packet_loss) {
+        callbacks_.on_packet_loss(lost * 100 / (received + lost));
+    }
+}
+
+void FbtIntercomReceiver::LogStatistics() const {
+    if (stats_.received == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "Talker %u: %lu received, %lu lost, %lu duplicate, %lu reordered, jitter %d ms", talker_,
+             stats_.received, stats_.lost, stats_.duplicate, stats_.reordered, stats_.jitter_ms);
+}
@@ -6,6 +6,7 @@
 
 #include "fbt_event_bus.h"
 #include "system_info.h"
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cJSON.h>
 #include <cinttypes>
@@ -69,40 +70,69 @@ void FbtPhoneTransport::OnAudioMicrophone(std::unique_ptr<AudioStreamPacket> pac
 
     std::lock_guard<std::mutex> lock(channel_mutex_);
 
+    if (!bundler_.enabled()) {
+        send_audio_datagram(packet->payload.data(), packet->payload.size(), packet->timestamp, 1, false);
+        return;
+    }
+    // 多帧一包：帧不连续时先把攒着的发出去
+    if (!bundler_.Continues(*packet)) {
+        flush_audio();
+    }
+    if (bundler_.Add(*packet)) {
+        flush_audio();
+    }
+}
+
+// 调用方持有 channel_mutex_
+void FbtPhoneTransport::flush_audio() {
+    if (bundler_.empty()) {
+        return;
+    }
+    if (udp_) {
+        send_audio_datagram(bundler_.payload().data(), bundler_.payload().size(), bundler_.timestamp(), bundler_.frames(), true);
+    }
+    bundler_.Clear();
+}
+
+// 调用方持有 channel_mutex_
+bool FbtPhoneTransport::send_audio_datagram(const uint8_t *payload, size_t size, uint32_t timestamp, int frames, bool bundle) {
     // 准备包头（无论是否加密都需要）
-    std::string nonce(session_.nonce);
+    uint8_t nonce[16];
+    if (session_.nonce.size() != sizeof(nonce)) {
+        return false;
+    }
+    memcpy(nonce, session_.nonce.data(), sizeof(nonce));
     nonce[0] = PacketType::AUDIO; // 音频包类型
-    *(uint16_t *)&nonce[2] = htons(packet->payload.size());
-    *(uint32_t *)&nonce[8] = htonl(packet->timestamp);
-    *(uint32_t *)&nonce[12] = htonl(++local_sequence_);
-
-    std::string full_packet;
-    full_packet.reserve(nonce.size() + packet->payload.size());
+    if (bundle) {
+        nonce[1] |= AUDIO_BUNDLE_FLAG;
+    }
+    *(uint16_t *)&nonce[2] = htons(size);
+    *(uint32_t *)&nonce[8] = htonl(timestamp);
+    // 多帧包带第一帧的序号
+    *(uint32_t *)&nonce[12] = htonl(local_sequence_ + 1);
+    local_sequence_ += frames;
 
-    full_packet.append(nonce);
+    // 包头和音频直接写入复用缓冲，加密时原地输出
+    audio_send_buffer_.resize(sizeof(nonce) + size);
+    memcpy(audio_send_buffer_.data(), nonce, sizeof(nonce));
+    uint8_t *audio_out = reinterpret_cast<uint8_t *>(audio_send_buffer_.data()) + sizeof(nonce);
 
     if (session_.key.empty()) {
-        full_packet.append(reinterpret_cast<const char *>(packet->payload.data()),
-                           packet->payload.size());
+        memcpy(audio_out, payload, size);
     } else {
-        std::string encrypted_audio;
-        encrypted_audio.resize(packet->payload.size());
-
         size_t nc_off = 0;
         uint8_t stream_block[16] = {0};
 
-        if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet->payload.size(), &nc_off,
-                                  (uint8_t *)nonce.c_str(), stream_block,
-                                  (uint8_t *)packet->payload.data(),
-                                  (uint8_t *)encrypted_audio.data()) != 0) {
+        if (mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off,
+                                  nonce, stream_block,
+                                  payload,
+                                  audio_out) != 0) {
             ESP_LOGE(TAG, "Failed to encrypt audio data");
-            return;
+            return false;
         }
-
-        full_packet.append(encrypted_audio);
     }
 
-    udp_->Send(full_packet);
+    return udp_->Send(audio_send_buffer_) > 0;
 }
 
 void FbtPhoneTransport::OnError(const std::string &service, int error_code) {
@@ -220,6 +250,11 @@ void FbtPhoneTransport::close() {
         return;
     }
     rtc_state_ = IDLE;
+    {
+        // 没攒满的帧在 session_ 和 udp_ 释放前发出去
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        flush_audio();
+    }
     session_.Clear();
     udp_.reset();
     audio_repeater_->InterruptRingtone();
@@ -232,6 +267,18 @@ void FbtPhoneTransport::close() {
     ESP_LOGI(TAG, "FBT phone stopped");
 }
 
+void FbtPhoneTransport::close_later(bool bye) {
+    FbtTransportWorker::Command command;
+    if (bye) {
+        command = [](void *arg) { static_cast<FbtPhoneTransport *>(arg)->ClosePhone(); };
+    } else {
+        command = [](void *arg) { static_cast<FbtPhoneTransport *>(arg)->close(); };
+    }
+    if (!FbtTransportWorker::EventDispatcher().Post(command, this)) {
+        ESP_LOGE(TAG, "Event task busy, phone not closed");
+    }
+}
+
 void FbtPhoneTransport::ClosePhone() {
     if (!is_running_ || rtc_state_ == IDLE) {
         return;
@@ -298,6 +345,10 @@ bool FbtPhoneTransport::parse_config(const std::string &json_message) {
     session_.server_addr = serverAddr->valuestring;
     session_.server_port = port->valueint;
     session_.nonce = FbtConfig::Helper::DecodeHexString(nonce->valuestring);
+    // nonce[1] 的多帧标志由发送方按包设置，服务端给的 nonce 自带这一位时每个单帧包都会被当成多帧包
+    if (session_.nonce.size() > 1) {
+        session_.nonce[1] &= ~AUDIO_BUNDLE_FLAG;
+    }
     if (key && cJSON_IsString(key) && key->valuestring) {
         session_.key = key->valuestring;
         std::string aes_key = FbtConfig::Helper::DecodeHexString(key->valuestring);
@@ -324,8 +375,8 @@ bool FbtPhoneTransport::connect_udp_server() {
     }
 
     // 设置数据接收回调
-    udp_->OnMessage([this](const std::string &data) {
-        on_udp_packet(data);
+    udp_->OnPacket([this](std::string_view packet) {
+        on_udp_packet(packet);
     });
 
     // 连接到服务器
@@ -389,7 +440,7 @@ void FbtPhoneTransport::handle_call_in() {
 }
 
 // 处理接收到的数据
-void FbtPhoneTransport::on_udp_packet(const std::string &payload) {
+void FbtPhoneTransport::on_udp_packet(std::string_view payload) {
     if (payload.empty()) {
         return;
     }
@@ -414,7 +465,7 @@ void FbtPhoneTransport::start_call() {
     rtc_state_ = CONNECTING;
     phone_ui_.SetRtcState(rtc_state_);
     if (!audio_repeater_->InterruptRingtone()) {
-        close();
+        close_later(false);
         return;
     }
 
@@ -434,8 +485,8 @@ void FbtPhoneTransport::start_call() {
 }
 
 // 处理控制消息
-void FbtPhoneTransport::handle_json(const std::string &json_data) {
-    cJSON *root = cJSON_Parse(json_data.c_str());
+void FbtPhoneTransport::handle_json(std::string_view json_data) {
+    cJSON *root = cJSON_ParseWithLength(json_data.data(), json_data.size());
     if (!root) {
         return;
     }
@@ -448,24 +499,29 @@ void FbtPhoneTransport::handle_json(const std::string &json_data) {
 
     const char *msg_type = type->valuestring;
 
+    cJSON *reliable = cJSON_GetObjectItem(root, "reliable");
+    if (cJSON_IsNumber(reliable) && reliable->valueint >= FBT_UDP_RELIABLE_VERSION && udp_) {
+        udp_->SetPeerWindowed();
+    }
+
     if (strcmp(msg_type, FbtCommand::FBT_ANSWER) == 0) {
-        if (!load_media(json_data)) {
+        if (!load_media(root)) {
             cJSON_Delete(root);
-            ClosePhone();
+            close_later(true);
             return;
         }
         start_call();
         ESP_LOGI(TAG, "fbt ok Audio transmission started!");
     } else if (strcmp(msg_type, FbtCommand::PHONE_BYE) == 0) {
         ESP_LOGI(TAG, "fbt Server ended session");
-        ClosePhone();
+        close_later(true);
     }
 
     cJSON_Delete(root);
 }
 
 // 处理音频包
-void FbtPhoneTransport::on_remote_audio(const std::string &data) {
+void FbtPhoneTransport::on_remote_audio(std::string_view data) {
     if (data.size() < session_.nonce.size()) {
         ESP_LOGE(TAG, "Packet too small: %zu < %zu", data.size(), session_.nonce.size());
         return;
@@ -482,10 +538,6 @@ void FbtPhoneTransport::on_remote_audio(const std::string &data) {
     uint32_t timestamp = ntohl(*(uint32_t *)&data[8]);
     uint32_t sequence = ntohl(*(uint32_t *)&data[12]);
 
-    // 检查序列号
-    if (sequence < remote_sequence_) {
-        return;
-    }
 
     // 验证包大小
     size_t expected_size = session_.nonce.size() + payload_size;
@@ -495,11 +547,44 @@ void FbtPhoneTransport::on_remote_audio(const std::string &data) {
         return;
     }
 
+    // 多帧包：整包解密一次，再按长度前缀拆成单帧
+    if ((data[1] & AUDIO_BUNDLE_FLAG) && bundler_.enabled()) {
+        const uint8_t *bundle = reinterpret_cast<const uint8_t *>(data.data()) + session_.nonce.size();
+        if (!session_.key.empty()) {
+            size_t nc_off = 0;
+            uint8_t stream_block[16] = {0};
+            uint8_t nonce[16];
+            memcpy(nonce, data.data(), sizeof(nonce));
+            receive_buffer_.resize(payload_size);
+            if (mbedtls_aes_crypt_ctr(&aes_ctx_, payload_size, &nc_off, nonce, stream_block, bundle, receive_buffer_.data()) != 0) {
+                ESP_LOGE(TAG, "Failed to decrypt audio data");
+                return;
+            }
+            bundle = receive_buffer_.data();
+        }
+        uint32_t index = 0;
+        bool valid = AudioBundler::Split(bundle, payload_size, [&](const uint8_t *frame, size_t frame_size) {
+            uint32_t frame_timestamp = timestamp > 0 ? timestamp + index * session_.frame_duration : 0;
+            play_remote_frame(frame, frame_size, frame_timestamp, sequence + index);
+            index++;
+        });
+        if (!valid) {
+            ESP_LOGE(TAG, "Invalid audio bundle of %u bytes", payload_size);
+            return;
+        }
+        if ((int32_t)(sequence + index - 1 - remote_sequence_) > 0) {
+            remote_sequence_ = sequence + index - 1;
+        }
+        return;
+    }
+
     // 创建音频包
     auto packet = std::make_unique<AudioStreamPacket>();
     packet->sample_rate = session_.sample_rate;
     packet->frame_duration = session_.frame_duration;
     packet->timestamp = timestamp;
+    // 乱序和迟到的包交给 AudioService 的抖动缓冲处理
+    packet->sequence = sequence;
     packet->payload.resize(payload_size);
 
     // 提取音频数据部分
@@ -512,8 +597,11 @@ void FbtPhoneTransport::on_remote_audio(const std::string &data) {
         // 有key，需要解密
         size_t nc_off = 0;
         uint8_t stream_block[16] = {0};
+        // 计数器会被 mbedtls 改写，包头拷到栈上，接收缓冲保持只读
+        uint8_t nonce[16];
+        memcpy(nonce, data.data(), sizeof(nonce));
 
-        int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, payload_size, &nc_off, (uint8_t *)data.data(), stream_block, audio_data, packet->payload.data());
+        int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, payload_size, &nc_off, nonce, stream_block, audio_data, packet->payload.data());
 
         if (ret != 0) {
             ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
@@ -522,11 +610,23 @@ void FbtPhoneTransport::on_remote_audio(const std::string &data) {
     }
 
     // 更新序列号
-    remote_sequence_ = sequence;
+    if ((int32_t)(sequence - remote_sequence_) > 0) {
+        remote_sequence_ = sequence;
+    }
 
     audio_repeater_->PlayStream(std::move(packet));
 }
 
+void FbtPhoneTransport::play_remote_frame(const uint8_t *data, size_t size, uint32_t timestamp, uint32_t sequence) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sample_rate = session_.sample_rate;
+    packet->frame_duration = session_.frame_duration;
+    packet->timestamp = timestamp;
+    packet->sequence = sequence;
+    packet->payload.assign(data, data + size);
+    audio_repeater_->PlayStream(std::move(packet));
+}
+
 std::string FbtPhoneTransport::generate_json(const std::string &type) {
     cJSON *root = cJSON_CreateObject();
     if (!root) {
@@ -541,6 +641,8 @@ std::string FbtPhoneTransport::generate_json(const std::string &type) {
         cJSON *audio = FbtConfig::FbtBuilder::buildAudioMedia();
         if (audio)
             cJSON_AddItemToObject(root, "audio", audio);
+        // 支持带序号的必达消息，对端在 answer 中回同样的字段后按窗口发送，见 fbt_udp.h
+        cJSON_AddNumberToObject(root, "reliable", FBT_UDP_RELIABLE_VERSION);
     }
 
     // 提取需要的信息
@@ -555,11 +657,7 @@ std::string FbtPhoneTransport::generate_json(const std::string &type) {
     return result;
 }
 
-bool FbtPhoneTransport::load_media(const std::string &json_data) {
-    cJSON *root = cJSON_Parse(json_data.c_str());
-    if (!root) {
-        return false;
-    }
+bool FbtPhoneTransport::load_media(const cJSON *root) {
     cJSON *audio_params = cJSON_GetObjectItem(root, "audio");
     if (cJSON_IsObject(audio_params)) {
         cJSON *sample_rate = cJSON_GetObjectItem(audio_params, "sampleRate");
@@ -569,6 +667,9 @@ bool FbtPhoneTransport::load_media(const std::string &json_data) {
         if (cJSON_IsNumber(frame_duration))
             session_.frame_duration = frame_duration->valueint;
     }
-    cJSON_Delete(root);
+    // 对端回了 framesPerPacket 才多帧一包
+    cJSON *frames_per_packet = cJSON_IsObject(audio_params) ? cJSON_GetObjectItem(audio_params, "framesPerPacket") : nullptr;
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    bundler_.SetFramesPerPacket(cJSON_IsNumber(frames_per_packet) ? std::min(frames_per_packet->valueint, CONFIG_AUDIO_FRAMES_PER_PACKET) : 1);
     return true;
 }
@@ -1,7 +1,10 @@
 #include "fbt_udp.h"
 
+#include <algorithm>
 #include <esp_log.h>
+#include <esp_random.h>
 #include <fbt_constants.h>
+#include <fbt_transport_worker.h>
 
 #define TAG "fbt_udp"
 
@@ -21,8 +24,14 @@ std::unique_ptr<FbtUdp> CreateFbtUdp(int connect_id, int max_retries) {
 
 FbtUdp::FbtUdp(std::unique_ptr<Udp> udp, int max_retries)
     : udp_(std::move(udp)),
-      ack_packet_(1, PacketType::ACK),
-      max_retries_(max_retries) {
+      max_retries_(max_retries),
+      next_sequence_(esp_random() & 0xFFFF) {
+    esp_timer_create_args_t timer_args = {
+        .callback = &VoiceTimeoutHandler,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "fbt_udp_timeout"};
+    esp_timer_create(&timer_args, &timeout_timer_);
     // 准备ACK包
     /* ack_packet_.push_back(static_cast<char>(0x05));
 
@@ -34,11 +43,28 @@ FbtUdp::FbtUdp(std::unique_ptr<Udp> udp, int max_retries)
 }
 
 FbtUdp::~FbtUdp() {
+    /* 先挡住接收回调和定时器回调，并等正在执行的退出（esp_timer_stop 不等待已开始的回调），
+     * 之后不会再有引用本对象的 ACK / pump 入队 */
+    closing_ = true;
+    for (int waited = 0; active_callbacks_ > 0; waited++) {
+        if (waited == 1000) {
+            // 在自己的接收回调中释放会一直等下去
+            ESP_LOGW(TAG, "Still waiting for a receive or timer callback");
+        }
+        vTaskDelay(1);
+    }
     if (timeout_timer_) {
         esp_timer_stop(timeout_timer_);
         esp_timer_delete(timeout_timer_);
         timeout_timer_ = nullptr;
     }
+    // 队列中的 ACK / pump 还引用着本对象。传输任务中无法等待，不能在那里销毁
+    if (FbtTransportWorker::Instance().InWorker()) {
+        ESP_LOGE(TAG, "Destroyed on the transport worker, queued commands may still use it");
+    }
+    FbtTransportWorker::Instance().Drain();
+    // 回调挡住后再释放底层连接，释放期间到达的数据包也会看到 closing_
+    udp_.reset();
     /* task_running_ = false;
 
     // 唤醒任务让其退出
@@ -81,22 +107,46 @@ int FbtUdp::GetLastError() {
 void FbtUdp::OnMessage(std::function<void(const std::string &data)> callback) {
     // 保存回调
     message_callback_ = std::move(callback);
+    listen();
+}
 
+void FbtUdp::OnPacket(std::function<void(std::string_view packet)> callback) {
+    packet_callback_ = std::move(callback);
+    listen();
+}
+
+void FbtUdp::listen() {
     udp_->OnMessage([this](const std::string &data) {
+        CallbackScope scope(this);
+        if (scope.closing() || data.empty()) {
+            return;
+        }
         uint8_t packet_type = static_cast<uint8_t>(data[0]);
-        if (packet_type == PacketType::ACK) {
-            stop_timer();
-            if (!payload_.empty()) {
-                payload_.clear();
+        if (packet_type == PacketType::ACK || packet_type == PacketType::ACK_WINDOW) {
+            on_ack(data);
+            return;
+        }
+        std::string_view packet(data);
+        if (packet_type == PacketType::RELIABLE_WINDOW) {
+            // 重复的消息只回确认，不再交给上层
+            if (!on_reliable_window(packet)) {
+                return;
             }
-            retries_ = 0;
-        } else {
+            packet = packet.substr(FBT_UDP_WINDOW_HEADER_SIZE);
+        }
+        // 直接把底层接收缓冲交给上层，音频只在写入解码缓冲时拷贝（或解密）一次
+        if (packet_callback_) {
+            packet_callback_(packet);
+        } else if (packet.size() == data.size()) {
+            // 不能写成条件表达式，那样每个包都会拷贝成临时 string
             if (message_callback_) {
                 message_callback_(data);
             }
-            if (packet_type == PacketType::RELIABLE_CONTROL) {
-                send_ack();
-            }
+        } else if (message_callback_) {
+            message_callback_(std::string(packet));
+        }
+        if (packet_type == PacketType::RELIABLE_CONTROL) {
+            send_ack();
         }
     });
 }
@@ -106,58 +156,264 @@ bool FbtUdp::SendMust(const std::string &payload) {
         ESP_LOGE(TAG, "SendMust failed: not connected");
         return false;
     }
+    if (payload.empty()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(reliable_mutex_);
+        backlog_.push_back(payload);
+        backlog_.back()[0] = PacketType::RELIABLE_CONTROL;
+    }
+    schedule_pump();
+    return true;
+}
+
+void FbtUdp::schedule_pump() {
+    if (pump_pending_.exchange(true)) {
+        return;
+    }
+    bool posted = FbtTransportWorker::Instance().Post([](void *arg) {
+        FbtUdp *self = static_cast<FbtUdp *>(arg);
+        self->pump_pending_ = false;
+        self->pump(); }, this);
+    if (!posted) {
+        // 队列已满，稍后由定时器再试
+        pump_pending_ = false;
+        esp_timer_stop(timeout_timer_);
+        esp_timer_start_once(timeout_timer_, 10000);
+    }
+}
+
+/**
+ * 把窗口内到期（或还没发过）的消息发出去，超过重试次数的丢弃。
+ * 只在工作任务中调用：部分模组的 Send 不能在 UDP 接收回调中执行
+ */
+void FbtUdp::pump() {
+    std::vector<std::string> outgoing;
+    {
+        std::lock_guard<std::mutex> lock(reliable_mutex_);
+        int64_t now_us = esp_timer_get_time();
+        bool timed_out = false;
+        for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+            if (it->sent_us > 0 && it->deadline_us <= now_us && it->retries >= max_retries_) {
+                ESP_LOGE(TAG, "Message %u sending failed, exceeding retry attempts", it->sequence);
+                it = in_flight_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        fill_window();
+        // 还在等确认的最早一条带序号的消息，旧格式的对端不知道它们的序号
+        uint16_t oldest = next_sequence_;
+        for (auto &message : in_flight_) {
+            if (message.sent_us == 0) {
+                message.windowed = peer_windowed_;
+            }
+            if (message.windowed) {
+                oldest = message.sequence;
+                break;
+            }
+        }
+        for (auto &message : in_flight_) {
+            if (message.deadline_us > now_us) {
+                continue;
+            }
+            if (message.sent_us > 0) {
+                message.retries++;
+                message.retransmitted = true;
+                timed_out = true;
+            } else {
+                message.windowed = peer_windowed_;
+            }
+            std::string packet;
+            if (message.windowed) {
+                packet.reserve(FBT_UDP_WINDOW_HEADER_SIZE + message.payload.size());
+                packet.push_back(PacketType::RELIABLE_WINDOW);
+                packet.push_back(message.sequence >> 8);
+                packet.push_back(message.sequence & 0xFF);
+                packet.push_back(oldest >> 8);
+                packet.push_back(oldest & 0xFF);
+                packet.append(message.payload);
+            } else {
+                packet = message.payload;
+            }
+            outgoing.push_back(std::move(packet));
+            message.sent_us = now_us;
+            message.deadline_us = now_us + rto_us_;
+        }
+        if (timed_out) {
+            // 超时退避（RFC 6298 5.5）
+            rto_us_ = std::min<int64_t>(rto_us_ * 2, FBT_UDP_MAX_RTO_US);
+        }
+        arm_timer(now_us);
+    }
+    for (auto &packet : outgoing) {
+        udp_->Send(packet);
+    }
+}
+
+void FbtUdp::fill_window() {
+    while (!backlog_.empty() && in_flight_.size() < window()) {
+        ReliableMessage message;
+        message.sequence = next_sequence_++;
+        message.payload = std::move(backlog_.front());
+        backlog_.pop_front();
+        in_flight_.push_back(std::move(message));
+    }
+}
 
-    payload_ = payload;
-    uint8_t current_type = static_cast<uint8_t>(payload_[0]);
-    if (current_type != PacketType::RELIABLE_CONTROL) {
-        payload_[0] = PacketType::RELIABLE_CONTROL;
+void FbtUdp::update_rtt(int64_t sample_us) {
+    // RFC 6298
+    if (srtt_us_ == 0) {
+        srtt_us_ = sample_us;
+        rttvar_us_ = sample_us / 2;
+    } else {
+        int64_t error = srtt_us_ - sample_us;
+        rttvar_us_ = (3 * rttvar_us_ + (error < 0 ? -error : error)) / 4;
+        srtt_us_ = (7 * srtt_us_ + sample_us) / 8;
     }
-    retries_ = 0;
-    start_timer();
-    return Send(payload_);
+    rto_us_ = std::clamp<int64_t>(srtt_us_ + 4 * rttvar_us_, FBT_UDP_MIN_RTO_US, FBT_UDP_MAX_RTO_US);
 }
 
-void FbtUdp::resend_send() {
-    if (!payload_.empty()) {
-        if (retries_ >= max_retries_) {
-            payload_.clear();
-            ESP_LOGE(TAG, "Message sending failed, exceeding retry attempts");
+void FbtUdp::on_ack(std::string_view data) {
+    std::lock_guard<std::mutex> lock(reliable_mutex_);
+    int64_t now_us = esp_timer_get_time();
+    size_t acked = 0;
+    if (data[0] == PacketType::ACK) {
+        // 旧格式不带序号，确认最早的一条（旧格式的消息一次只有一条，且早于带序号的）
+        if (!in_flight_.empty() && in_flight_.front().sent_us > 0 && !in_flight_.front().windowed) {
+            if (!in_flight_.front().retransmitted) {
+                update_rtt(now_us - in_flight_.front().sent_us);
+            }
+            in_flight_.pop_front();
+            acked++;
+        }
+    } else {
+        if (data.size() < 7) {
             return;
         }
+        peer_windowed_ = true;
+        uint16_t next = (static_cast<uint8_t>(data[1]) << 8) | static_cast<uint8_t>(data[2]);
+        uint32_t mask = (static_cast<uint8_t>(data[3]) << 24) | (static_cast<uint8_t>(data[4]) << 16) |
+                        (static_cast<uint8_t>(data[5]) << 8) | static_cast<uint8_t>(data[6]);
+        for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+            int16_t offset = it->sequence - next;
+            bool received = offset < 0 || (offset < 32 && (mask & (1u << offset)));
+            if (received && it->sent_us > 0 && it->windowed) {
+                // Karn：重传过的消息不参与 RTT 估计
+                if (!it->retransmitted) {
+                    update_rtt(now_us - it->sent_us);
+                }
+                it = in_flight_.erase(it);
+                acked++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    arm_timer(now_us);
+    if (acked > 0 && !backlog_.empty()) {
+        // 窗口空出来了，排队的消息交给工作任务发送
+        schedule_pump();
+    }
+}
 
-        Send(payload_);
-        retries_++;
-        start_timer();
+bool FbtUdp::on_reliable_window(std::string_view data) {
+    if (data.size() <= FBT_UDP_WINDOW_HEADER_SIZE) {
+        return false;
+    }
+    uint16_t sequence = (static_cast<uint8_t>(data[1]) << 8) | static_cast<uint8_t>(data[2]);
+    uint16_t oldest = (static_cast<uint8_t>(data[3]) << 8) | static_cast<uint8_t>(data[4]);
+    bool fresh;
+    {
+        std::lock_guard<std::mutex> lock(reliable_mutex_);
+        int16_t offset = sequence - remote_next_;
+        int16_t oldest_offset = oldest - remote_next_;
+        if (!remote_started_ || offset < -8 * FBT_UDP_RECEIVE_WINDOW || offset >= 8 * FBT_UDP_RECEIVE_WINDOW) {
+            // 第一条消息，或对端重新开始编号
+            remote_started_ = true;
+            remote_next_ = oldest;
+            remote_mask_ = 0;
+        } else if (oldest_offset > 0) {
+            // 发送方不再等 oldest 之前的消息
+            remote_mask_ = oldest_offset < 32 ? remote_mask_ >> oldest_offset : 0;
+            remote_next_ = oldest;
+        }
+        offset = sequence - remote_next_;
+        fresh = offset >= 0 && offset < FBT_UDP_RECEIVE_WINDOW && !(remote_mask_ & (1u << offset));
+        if (fresh) {
+            remote_mask_ |= 1u << offset;
+            while (remote_mask_ & 1) {
+                remote_mask_ >>= 1;
+                remote_next_++;
+            }
+        }
     }
+    // 对端用了带序号的格式，之后按窗口发送
+    SetPeerWindowed();
+    send_window_ack();
+    return fresh;
 }
 
-void FbtUdp::start_timer() {
-    if (!timeout_timer_) {
-        // 第一次创建
-        esp_timer_create_args_t timer_args = {
-            .callback = &VoiceTimeoutHandler,
-            .arg = this,
-            .dispatch_method = ESP_TIMER_TASK,
-            .name = "fbt_udp_timeout"};
-        esp_timer_create(&timer_args, &timeout_timer_);
+void FbtUdp::SetPeerWindowed() {
+    std::lock_guard<std::mutex> lock(reliable_mutex_);
+    if (peer_windowed_) {
+        return;
+    }
+    peer_windowed_ = true;
+    if (!backlog_.empty()) {
+        schedule_pump();
     }
-    start_timeout_timer = true;
-    // 启动定时器（如果是已经存在的就重新启动）
-    esp_timer_start_once(timeout_timer_, 2000000); // 3秒
 }
 
-void FbtUdp::stop_timer() {
-    if (timeout_timer_ && start_timeout_timer) {
-        esp_timer_stop(timeout_timer_);
+// 调用方持有 reliable_mutex_
+void FbtUdp::arm_timer(int64_t now_us) {
+    esp_timer_stop(timeout_timer_);
+    if (in_flight_.empty()) {
+        return;
     }
+    int64_t deadline_us = in_flight_.front().deadline_us;
+    for (auto &message : in_flight_) {
+        deadline_us = std::min(deadline_us, message.deadline_us);
+    }
+    esp_timer_start_once(timeout_timer_, std::max<int64_t>(deadline_us - now_us, 1000));
 }
 
+// 旧格式的确认，不带序号
 void FbtUdp::send_ack() {
-    // xSemaphoreGiveFromISR(ack_semaphore_, NULL);
-    xTaskCreate([](void *arg) {
+    bool posted = FbtTransportWorker::Instance().Post([](void *arg) {
         FbtUdp *self = static_cast<FbtUdp *>(arg);
+        static const std::string ack(1, PacketType::ACK);
         if (self->udp_) {
-            self->udp_->Send(self->ack_packet_);
+            self->udp_->Send(ack);
+        } }, this);
+    if (!posted) {
+        // 对端会重传
+        ESP_LOGW(TAG, "Transport worker busy, ACK dropped");
+    }
+}
+
+void FbtUdp::send_window_ack() {
+    bool posted = FbtTransportWorker::Instance().Post([](void *arg) {
+        FbtUdp *self = static_cast<FbtUdp *>(arg);
+        // 确认是累计的，发送时取最新的状态
+        char ack[7];
+        {
+            std::lock_guard<std::mutex> lock(self->reliable_mutex_);
+            ack[0] = PacketType::ACK_WINDOW;
+            ack[1] = self->remote_next_ >> 8;
+            ack[2] = self->remote_next_ & 0xFF;
+            ack[3] = self->remote_mask_ >> 24;
+            ack[4] = (self->remote_mask_ >> 16) & 0xFF;
+            ack[5] = (self->remote_mask_ >> 8) & 0xFF;
+            ack[6] = self->remote_mask_ & 0xFF;
         }
-        vTaskDelete(NULL); }, "ack_once", 1536, this, 1, NULL);
+        if (self->udp_) {
+            self->udp_->Send(std::string(ack, sizeof(ack)));
+        } }, this);
+    if (!posted) {
+        // 对端会重传，之后的确认也包含这一条
+        ESP_LOGW(TAG, "Transport worker busy, ACK dropped");
+    }
 }
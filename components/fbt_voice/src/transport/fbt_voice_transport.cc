@@ -3,12 +3,14 @@
 #include "audio_codec.h"
 #include "board.h"
 #include "fbt_event_bus.h"
+#include "fbt_transport_worker.h"
 
 #include "application.h"
 #include "assets/lang_config.h"
 #include "fbt_config.h"
 #include "settings.h"
 #include "system_info.h"
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cJSON.h>
 #include <cinttypes>
@@ -24,7 +26,22 @@ FbtVoiceTransport::FbtVoiceTransport(EventGroupHandle_t event_group, FbtAudioRep
       audio_repeater_(audio_repeater),
       event_group_(event_group),
       fbt_mqtt_(mqtt_server),
-      voice_ui_(FbtUiVoice::GetInstance()) {
+      voice_ui_(FbtUiVoice::GetInstance()),
+      receiver_({
+          .on_audio = [this](std::unique_ptr<AudioStreamPacket> packet) { on_remote_audio(std::move(packet)); },
+          .on_talker_changed =
+              [this]() {
+                  if (audio_repeater_) {
+                      audio_repeater_->ResetStream();
+                  }
+              },
+          .on_packet_loss =
+              [this](int loss_percent) {
+                  if (audio_repeater_) {
+                      audio_repeater_->ReportPacketLoss(loss_percent);
+                  }
+              },
+      }) {
 
     auto &event_bus = FbtEventBus::GetInstance();
     event_bus.Subscribe("fbt_voice", FbtEvents::MQTT_VOICE_PING, [this](const std::string &type, const std::string &data) {
@@ -96,8 +113,8 @@ bool FbtVoiceTransport::open_server() {
         return false;
     }
 
-    udp_->OnMessage([this](const std::string &data) {
-        on_udp_packet(data);
+    udp_->OnPacket([this](std::string_view packet) {
+        on_udp_packet(packet);
     });
 
     if (!udp_->Connect(server_addr_, server_port_)) {
@@ -127,19 +144,22 @@ void FbtVoiceTransport::close_server() {
     is_running_ = false;
 }
 
-void FbtVoiceTransport::on_udp_packet(const std::string &payload) {
+void FbtVoiceTransport::on_udp_packet(std::string_view payload) {
     if (payload.empty() || !is_running_ || rtc_state_ == kUnavailable) {
         return;
     }
     uint8_t packet_type = static_cast<uint8_t>(payload[0]);
-    std::string data = payload.substr(1);
     switch (packet_type) {
         case PacketType::CONTROL:
         case PacketType::RELIABLE_CONTROL:
-            on_udp_message(data);
+            on_udp_message(payload.substr(1));
             break;
         case PacketType::AUDIO:
-            on_remote_audio(data);
+        case PacketType::AUDIO_EXT:
+            // 音频直接从原始包中读取，不再拷贝子串
+            if (rtc_state_ == kTuneIn) {
+                receiver_.OnPacket(payload);
+            }
             break;
         default:
             ESP_LOGW(TAG, "Unknown packet type: 0x%02X", packet_type);
@@ -154,8 +174,8 @@ void FbtVoiceTransport::on_udp_packet(const std::string &payload) {
     } */
 }
 
-void FbtVoiceTransport::on_udp_message(const std::string &data) {
-    cJSON *root = cJSON_Parse(data.c_str());
+void FbtVoiceTransport::on_udp_message(std::string_view data) {
+    cJSON *root = cJSON_ParseWithLength(data.data(), data.size());
     if (!root) {
         return;
     }
@@ -169,57 +189,64 @@ void FbtVoiceTransport::on_udp_message(const std::string &data) {
     const char *msg_type = type->valuestring;
 
     if (strcmp(msg_type, FbtCommand::FBT_ANSWER) == 0) {
-        handle_answer(data);
+        handle_answer(root);
     }
 
     cJSON_Delete(root);
 }
 
-void FbtVoiceTransport::on_remote_audio(const std::string &payload) {
-    if (rtc_state_ == kUnavailable) {
-        return;
-    }
+void FbtVoiceTransport::on_remote_audio(std::unique_ptr<AudioStreamPacket> packet) {
     // 快速检查
-    if (payload.empty() || !audio_repeater_ || !is_running_ || rtc_state_ != kTuneIn) {
+    if (!audio_repeater_ || !is_running_ || rtc_state_ != kTuneIn) {
         return;
     }
     close_on_timeout();
-
-    auto packet = std::make_unique<AudioStreamPacket>();
-    packet->sample_rate = audio_sample_rate_;
-    packet->frame_duration = audio_frame_duration_;
-    packet->timestamp = 0;
-    packet->payload.assign(payload.begin(), payload.end());
-
-    // 调整payload大小并填充音频数据
-    // memcpy(packet->payload.data(), payload.data(), payload.length());
-
     audio_repeater_->PlayStream(std::move(packet));
 }
 
-void FbtVoiceTransport::handle_answer(const std::string data) {
+void FbtVoiceTransport::handle_answer(const cJSON *root) {
     // ESP_LOGI(TAG, "fbt ok Audio transmission started!");
     if (rtc_state_ == kUnavailable) {
         return;
     }
-    cJSON *root = cJSON_Parse(data.c_str());
-    if (!root) {
-        return;
-    }
 
     cJSON *status = cJSON_GetObjectItem(root, "status");
 
     if (cJSON_IsNumber(status)) {
         FbtVoiceOfferStatus voice_status = static_cast<FbtVoiceOfferStatus>(status->valueint);
         switch (voice_status) {
-            case kStartSpeaking:
+            case kStartSpeaking: {
+                // 服务端确认房间内每个成员都支持时才回 audio.header，这时才带头发送，否则发旧格式
+                cJSON *audio = cJSON_GetObjectItem(root, "audio");
+                audio_header_version_ = FbtIntercomHeaderVersion(audio);
+                cJSON *talker = cJSON_GetObjectItem(root, "talkerId");
+                if (cJSON_IsNumber(talker)) {
+                    talker_id_ = talker->valueint;
+                } else {
+                    // FNV-1a 折叠成 16 位
+                    uint32_t hash = 2166136261u;
+                    for (char c : device_id_) {
+                        hash = (hash ^ (uint8_t)c) * 16777619u;
+                    }
+                    talker_id_ = (hash >> 16) ^ (hash & 0xFFFF);
+                }
+                local_sequence_ = 0;
+                // 多帧一包只在带音频头时可用，对端回了 framesPerPacket 才启用
+                cJSON *frames_per_packet = cJSON_IsObject(audio) ? cJSON_GetObjectItem(audio, "framesPerPacket") : nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(channel_mutex_);
+                    bundler_.SetFramesPerPacket(audio_header_version_ > 0 && cJSON_IsNumber(frames_per_packet)
+                                                    ? std::min(frames_per_packet->valueint, CONFIG_AUDIO_FRAMES_PER_PACKET)
+                                                    : 1);
+                }
                 start_speaking();
                 break;
+            }
             case kEndSpeaking:
                 end_active();
                 break;
             case kStartTuneIn:
-                start_tune_in(data);
+                start_tune_in(root);
                 break;
             default:
                 end_active();
@@ -233,7 +260,6 @@ void FbtVoiceTransport::handle_answer(const std::string data) {
             display_->SetEmotion("laughing");
         }
     }
-    cJSON_Delete(root);
 }
 
 void FbtVoiceTransport::start_speaking() {
@@ -243,14 +269,16 @@ void FbtVoiceTransport::start_speaking() {
     close_on_timeout();
 }
 
-void FbtVoiceTransport::start_tune_in(const std::string &payload) {
+void FbtVoiceTransport::start_tune_in(const cJSON *root) {
     if (rtc_state_ == kSpeaking || rtc_state_ == kTuneIn) {
         return;
     };
-    if (!load_media(payload)) {
+    if (!load_media(root)) {
         end_active();
         return;
     };
+    receiver_.SetFormat(audio_sample_rate_, audio_frame_duration_);
+    receiver_.Reset();
     audio_codec_->EnableOutput(true);
     rtc_state_ = kTuneIn;
     if (!is_enter_) {
@@ -267,17 +295,72 @@ void FbtVoiceTransport::OnAudioMicrophone(std::unique_ptr<AudioStreamPacket> pac
         return;
     }
 
-    std::string payload_;
-    payload_.reserve(1 + packet->payload.size()); // 预分配空间
-    payload_.push_back(PacketType::AUDIO);
-    payload_.append(reinterpret_cast<const char *>(packet->payload.data()),
-                    packet->payload.size());
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    uint8_t flags = packet->preroll && audio_header_version_ > 0 ? FBT_INTERCOM_AUDIO_PREROLL_FLAG : 0;
+    // preroll 单独发，带标志
+    if (audio_header_version_ == 0 || !bundler_.enabled() || flags != 0) {
+        flush_audio();
+        send_audio(packet->payload.data(), packet->payload.size(), packet->origin_us, 1, flags);
+        return;
+    }
+    // 多帧一包：帧不连续时先把攒着的发出去
+    if (!bundler_.Continues(*packet)) {
+        flush_audio();
+    }
+    if (bundler_.Add(*packet)) {
+        flush_audio();
+    }
+}
+
+// 调用方持有 channel_mutex_
+void FbtVoiceTransport::send_audio(const uint8_t *payload, size_t size, int64_t captured_us, int frames, uint8_t flags) {
+    // 复用发送缓冲，容量在首帧后保持不变
+    audio_send_buffer_.clear();
+    if (audio_header_version_ > 0) {
+        FbtIntercomAudioHeader header;
+        header.type = PacketType::AUDIO_EXT;
+        header.version_flags = (audio_header_version_ << 4) | flags;
+        header.talker = htons(talker_id_);
+        // 多帧包带第一帧的序号
+        header.sequence = htons(local_sequence_ + 1);
+        local_sequence_ += frames;
+        if (captured_us <= 0) {
+            captured_us = esp_timer_get_time();
+        }
+        header.timestamp = htonl((uint32_t)(captured_us / 1000));
+        audio_send_buffer_.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    } else {
+        audio_send_buffer_.push_back(PacketType::AUDIO);
+    }
+    audio_send_buffer_.append(reinterpret_cast<const char *>(payload), size);
+
+    udp_->Send(audio_send_buffer_);
+}
 
-    udp_->Send(payload_);
+// 调用方持有 channel_mutex_
+void FbtVoiceTransport::flush_audio() {
+    if (bundler_.empty()) {
+        return;
+    }
+    if (udp_) {
+        send_audio(bundler_.payload().data(), bundler_.payload().size(), bundler_.origin_us(), bundler_.frames(), AUDIO_BUNDLE_FLAG);
+    }
+    bundler_.Clear();
 }
 void FbtVoiceTransport::OnSpeaking(const bool enable) {
     if (enable) {
         rtc_state_ = kOffer;
+        // 对讲使用短帧，降低按下说话到对端听到的延迟
+        if (audio_repeater_) {
+            audio_repeater_->SetFrameDuration(CONFIG_FBT_INTERCOM_FRAME_DURATION);
+            // 对端收到 DTX 包后自行补偿，静音时省去编码和发包
+            audio_repeater_->EnableDtx(true);
+        }
+    }
+    if (!enable) {
+        // 松开时把没攒满的帧发出去
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        flush_audio();
     }
     send_offer(enable ? kStartSpeaking : kEndSpeaking);
     if (!enable)
@@ -313,6 +396,16 @@ void FbtVoiceTransport::end_active() {
     }
     display_->SetChatMessage("system", "");
     display_->SetEmotion("neutral");
+    if (rtc_state_ == kTuneIn) {
+        receiver_.LogStatistics();
+    }
+    FbtTransportWorker::Instance().LogStatistics();
+    FbtTransportWorker::EventDispatcher().LogStatistics();
+    {
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        audio_header_version_ = 0;
+        bundler_.Clear();
+    }
     audio_codec_->EnableInput(false);
     audio_codec_->EnableOutput(false);
     if (!is_enter_) {
@@ -324,6 +417,10 @@ void FbtVoiceTransport::end_active() {
     }
 
     rtc_state_ = kIdle;
+    if (audio_repeater_) {
+        audio_repeater_->SetFrameDuration(OPUS_FRAME_DURATION_MS);
+        audio_repeater_->EnableDtx(false);
+    }
     close_on_timeout();
 }
 
@@ -353,6 +450,21 @@ void FbtVoiceTransport::send_ping() {
     packet.push_back(PacketType::KEEPALIVE);
     packet.append(device_id_.c_str());
     udp_->Send(packet);
+    send_capability();
+}
+
+// 每次心跳后声明能收的音频头，服务端据此决定说话方能否发 AUDIO_EXT，见 fbt_intercom_receiver.h
+// 调用方持有 channel_mutex_
+void FbtVoiceTransport::send_capability() {
+    std::string json_str = generate_json(FbtCommand::FBT_CAPABILITY, static_cast<FbtVoiceOfferStatus>(0));
+    if (json_str.empty()) {
+        return;
+    }
+    std::string packet;
+    packet.reserve(1 + json_str.size());
+    packet.push_back(PacketType::CONTROL);
+    packet.append(json_str);
+    udp_->Send(packet);
 }
 
 void FbtVoiceTransport::send_udp_message(const std::string &json_str) {
@@ -436,10 +548,19 @@ std::string FbtVoiceTransport::generate_json(const std::string &type, FbtVoiceOf
     if (status > 0) {
         cJSON_AddNumberToObject(root, "status", status);
     }
+    if (type == FbtCommand::FBT_CAPABILITY) {
+        cJSON *audio = cJSON_CreateObject();
+        cJSON_AddNumberToObject(audio, "header", FBT_INTERCOM_AUDIO_VERSION);
+        cJSON_AddItemToObject(root, "audio", audio);
+    }
     if (status == kStartSpeaking) {
-        cJSON *audio = FbtConfig::FbtBuilder::buildAudioMedia();
-        if (audio)
+        cJSON *audio = FbtConfig::FbtBuilder::buildAudioMedia(
+            audio_repeater_ ? audio_repeater_->GetFrameDuration() : CONFIG_USE_FBT_AUDIO_FRAME_DURATION);
+        if (audio) {
+            // 支持的对讲音频头版本，见 FbtIntercomAudioHeader
+            cJSON_AddNumberToObject(audio, "header", FBT_INTERCOM_AUDIO_VERSION);
             cJSON_AddItemToObject(root, "audio", audio);
+        }
     }
 
     char *json_str = cJSON_PrintUnformatted(root);
@@ -453,11 +574,7 @@ std::string FbtVoiceTransport::generate_json(const std::string &type, FbtVoiceOf
     return result;
 }
 
-bool FbtVoiceTransport::load_media(const std::string &json_data) {
-    cJSON *root = cJSON_Parse(json_data.c_str());
-    if (!root) {
-        return false;
-    }
+bool FbtVoiceTransport::load_media(const cJSON *root) {
     cJSON *audio_params = cJSON_GetObjectItem(root, "audio");
     if (cJSON_IsObject(audio_params)) {
         cJSON *sample_rate = cJSON_GetObjectItem(audio_params, "sampleRate");
@@ -467,7 +584,6 @@ bool FbtVoiceTransport::load_media(const std::string &json_data) {
         if (cJSON_IsNumber(frame_duration))
             audio_frame_duration_ = frame_duration->valueint;
     }
-    cJSON_Delete(root);
     return true;
 }
 
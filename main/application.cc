@@ -358,6 +358,13 @@ void Application::Start() {
     auto codec = board.GetAudioCodec();
     audio_service_.Initialize(codec);
     audio_service_.Start();
+#if CONFIG_USE_SOUND_PCM_CACHE
+    /* The cues that are played again and again, the ringtone repeats for every incoming call */
+    for (auto &sound : {Lang::Sounds::OGG_PHONE_IN, Lang::Sounds::OGG_POPUP, Lang::Sounds::OGG_SUCCESS,
+                        Lang::Sounds::OGG_EXCLAMATION, Lang::Sounds::OGG_VIBRATION, Lang::Sounds::OGG_LOW_BATTERY}) {
+        SoundPcmCache::GetInstance().Register(sound);
+    }
+#endif
 
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
@@ -651,6 +658,8 @@ void Application::OnWakeWordDetected() {
     }
 
     if (device_state_ == kDeviceStateIdle) {
+        // Listening follows, keep the input clocked so the first syllable is not lost to its warm-up
+        audio_service_.PrewarmInput();
         audio_service_.EncodeWakeWord();
 
         if (!protocol_->IsAudioChannelOpened()) {
@@ -2,6 +2,7 @@
 #include "board.h"
 #include "settings.h"
 
+#include <cmath>
 #include <cstring>
 #include <driver/i2s_common.h>
 #include <esp_log.h>
@@ -15,6 +16,9 @@ AudioCodec::~AudioCodec() {
 }
 
 void AudioCodec::OutputData(std::vector<int16_t> &data) {
+#if CONFIG_USE_AUDIO_OUTPUT_STAGE
+    output_stage_.Process(data.data(), data.size());
+#endif
     Write(data.data(), data.size());
 }
 
@@ -34,6 +38,15 @@ void AudioCodec::Start() {
         output_volume_ = 10;
     }
 
+#if CONFIG_USE_AUDIO_OUTPUT_STAGE
+#if CONFIG_AUDIO_OUTPUT_DC_BLOCK
+    output_stage_.Configure(output_sample_rate_, -CONFIG_AUDIO_OUTPUT_LIMITER_HEADROOM_DB, true);
+#else
+    output_stage_.Configure(output_sample_rate_, -CONFIG_AUDIO_OUTPUT_LIMITER_HEADROOM_DB, false);
+#endif
+    UpdateOutputGain();
+#endif
+
     if (tx_handle_ != nullptr) {
         ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
     }
@@ -47,14 +60,35 @@ void AudioCodec::Start() {
     ESP_LOGI(TAG, "Audio codec started");
 }
 
+void AudioCodec::ResetOutputStage() {
+#if CONFIG_USE_AUDIO_OUTPUT_STAGE
+    output_stage_.Reset();
+#endif
+}
+
 void AudioCodec::SetOutputVolume(int volume) {
     output_volume_ = volume;
     ESP_LOGI(TAG, "Set output volume to %d", output_volume_);
 
+#if CONFIG_USE_AUDIO_OUTPUT_STAGE
+    UpdateOutputGain();
+#endif
+
     Settings settings("audio", true);
     settings.SetInt("output_volume", output_volume_);
 }
 
+#if CONFIG_USE_AUDIO_OUTPUT_STAGE
+void AudioCodec::UpdateOutputGain() {
+    double gain = std::pow(10.0, CONFIG_AUDIO_OUTPUT_BOOST_DB / 20.0);
+    if (software_volume_) {
+        // Same curve NoAudioCodec used to apply in Write
+        gain *= std::pow(output_volume_ / 100.0, 2);
+    }
+    output_stage_.SetGain(std::lround(gain * AUDIO_OUTPUT_UNITY_GAIN));
+}
+#endif
+
 void AudioCodec::SetInputGain(float gain) {
     input_gain_ = gain;
     ESP_LOGI(TAG, "Set input gain to %.1f", input_gain_);
@@ -74,4 +108,8 @@ void AudioCodec::EnableOutput(bool enable) {
     }
     output_enabled_ = enable;
     ESP_LOGI(TAG, "Set output enable to %s", enable ? "true" : "false");
+    if (!enable) {
+        /* The tail of the last stream must not come out when the output is powered up again */
+        ResetOutputStage();
+    }
 }
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 
+#include "audio_output_stage.h"
 #include "board.h"
 
 #define AUDIO_CODEC_DMA_DESC_NUM 6
@@ -27,6 +28,8 @@ class AudioCodec {
     virtual void OutputData(std::vector<int16_t> &data);
     virtual bool InputData(std::vector<int16_t> &data);
     virtual void Start();
+    /* Playback stopped or was cut off, the next samples written start a new stream */
+    void ResetOutputStage();
 
     inline bool duplex() const { return duplex_; }
     inline bool input_reference() const { return input_reference_; }
@@ -53,6 +56,13 @@ class AudioCodec {
     int output_channels_ = 1;
     int output_volume_ = 70;
     float input_gain_ = 0.0;
+    // The volume is applied to the samples instead of by the codec chip
+    bool software_volume_ = false;
+#if CONFIG_USE_AUDIO_OUTPUT_STAGE
+    AudioOutputStage output_stage_;
+
+    void UpdateOutputGain();
+#endif
 
     virtual int Read(int16_t *dest, int samples) = 0;
     virtual int Write(const int16_t *data, int samples) = 0;
@@ -0,0 +1,67 @@
+#ifndef AUDIO_FRAME_ASSEMBLER_H
+#define AUDIO_FRAME_ASSEMBLER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Cuts a stream of processor output chunks into frames of a fixed number of samples.
+ *
+ * Chunks are copied straight into the frame being filled, a chunk that completes a frame carries
+ * its remainder over into the next one, so nothing is ever erased from the front of a buffer.
+ * A completed frame is handed to the callback by reference: the callback takes the samples by
+ * swapping the vector with a recycled buffer of its own (AudioService swaps it into a pooled
+ * AudioTask), and the assembler keeps filling whatever buffer it got back. Once the pool is warm
+ * no frame allocates or is copied again.
+ *
+ * Not thread safe, it belongs to the processor task.
+ */
+class AudioFrameAssembler {
+  public:
+    using FrameCallback = std::function<void(std::vector<int16_t> &&frame)>;
+
+    /* `frame_samples` may change between calls, a partial frame longer than the new size is cut
+     * into frames of the new size and its excess starts the next frame, no sample is dropped */
+    void Append(const int16_t *data, size_t samples, size_t frame_samples, const FrameCallback &callback) {
+        if (frame_samples == 0) {
+            return;
+        }
+        if (frame_.size() > frame_samples) {
+            // The frame duration just got shorter, the buffered samples go through again at the new size
+            carry_.swap(frame_);
+            frame_.clear();
+            Fill(carry_.data(), carry_.size(), frame_samples, callback);
+            carry_.clear();
+        }
+        Fill(data, samples, frame_samples, callback);
+    }
+
+    void Reset() { frame_.clear(); }
+
+  private:
+    std::vector<int16_t> frame_;
+    // The partial frame while it is cut at a shorter frame size, kept for its capacity
+    std::vector<int16_t> carry_;
+
+    void Fill(const int16_t *data, size_t samples, size_t frame_samples, const FrameCallback &callback) {
+        while (samples > 0 || frame_.size() == frame_samples) {
+            if (frame_.size() == frame_samples) {
+                callback(std::move(frame_));
+                frame_.clear();
+                continue;
+            }
+            if (frame_.capacity() < frame_samples) {
+                frame_.reserve(frame_samples);
+            }
+            size_t n = std::min(samples, frame_samples - frame_.size());
+            frame_.insert(frame_.end(), data, data + n);
+            data += n;
+            samples -= n;
+        }
+    }
+};
+
+#endif // AUDIO_FRAME_ASSEMBLER_H
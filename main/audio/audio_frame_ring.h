@@ -0,0 +1,112 @@
+#ifndef AUDIO_FRAME_RING_H
+#define AUDIO_FRAME_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/*
+ * Bounded single-producer / single-consumer ring of owned audio frames.
+ *
+ * TryPush() and CanPush() belong to the producer task, Pop() to the consumer task. Neither side
+ * takes a lock, so a slow consumer never blocks the producer and vice versa. Stages with more than
+ * one producer must serialize the producers themselves.
+ *
+ * Clear() may be called from any task. It only moves the drop mark up to the current head; the
+ * consumer releases the dropped frames on its next Pop(), so the caller should wake the consumer
+ * after clearing.
+ */
+template <typename T>
+class AudioFrameRing {
+  public:
+    explicit AudioFrameRing(size_t capacity)
+        : capacity_(capacity),
+          limit_(capacity) {
+        size_t slots = 1;
+        while (slots < capacity_ * 2) {
+            slots <<= 1;
+        }
+        mask_ = slots - 1;
+        slots_.reset(new std::unique_ptr<T>[slots]);
+    }
+
+    AudioFrameRing(const AudioFrameRing &) = delete;
+    AudioFrameRing &operator=(const AudioFrameRing &) = delete;
+
+    /* Producer side: `item` is only moved from when the push succeeds */
+    bool TryPush(std::unique_ptr<T> &item, bool ignore_limit = false) {
+        if (!CanPush(ignore_limit)) {
+            return false;
+        }
+        size_t head = head_.load(std::memory_order_relaxed);
+        slots_[head & mask_] = std::move(item);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool CanPush(bool ignore_limit = false) const {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail > mask_) {
+            return false;
+        }
+        if (ignore_limit) {
+            return head - LogicalTail(tail) < capacity_;
+        }
+        return head - LogicalTail(tail) < limit_.load(std::memory_order_relaxed);
+    }
+
+    /* Consumer side: returns nullptr when the ring is empty */
+    std::unique_ptr<T> Pop() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t drop = drop_.load(std::memory_order_acquire);
+        while (tail < drop && tail < head) {
+            slots_[tail & mask_].reset();
+            tail++;
+        }
+        if (tail == head) {
+            tail_.store(tail, std::memory_order_release);
+            return nullptr;
+        }
+        auto item = std::move(slots_[tail & mask_]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return item;
+    }
+
+    void Clear() {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t drop = drop_.load(std::memory_order_relaxed);
+        while (drop < head && !drop_.compare_exchange_weak(drop, head, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    size_t Size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = LogicalTail(tail_.load(std::memory_order_acquire));
+        return head > tail ? head - tail : 0;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    /* Backpressure limit used by TryPush(), never larger than the capacity */
+    void SetLimit(size_t limit) { limit_.store(std::min(std::max<size_t>(limit, 1), capacity_), std::memory_order_relaxed); }
+    size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return capacity_; }
+
+  private:
+    std::unique_ptr<std::unique_ptr<T>[]> slots_;
+    size_t mask_ = 0;
+    size_t capacity_;
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> drop_{0};
+
+    size_t LogicalTail(size_t tail) const {
+        return std::max(tail, drop_.load(std::memory_order_acquire));
+    }
+};
+
+#endif // AUDIO_FRAME_RING_H
@@ -0,0 +1,96 @@
+#include "audio_latency.h"
+
+// Upper bounds in milliseconds, the last bucket takes everything above 1s
+static const int kBucketBoundsMs[AUDIO_LATENCY_BUCKET_COUNT - 1] = {1, 2, 5, 10, 20, 40, 60, 80, 120, 160, 240, 320, 480, 640, 1000};
+
+static const char *const kStageNames[kAudioStageCount] = {
+    "codec_read",
+    "process",
+    "encode_queue",
+    "encode",
+    "send_queue",
+    "uplink",
+    "decode_queue",
+    "decode",
+    "playback_queue",
+    "codec_write",
+    "downlink",
+};
+
+void LatencyHistogram::Record(int64_t elapsed_us) {
+    if (elapsed_us < 0) {
+        elapsed_us = 0;
+    }
+    int bucket = 0;
+    while (bucket < AUDIO_LATENCY_BUCKET_COUNT - 1 && elapsed_us > kBucketBoundsMs[bucket] * 1000LL) {
+        bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_us_.fetch_add(elapsed_us, std::memory_order_relaxed);
+
+    /* Only one task records into a histogram, a plain compare is enough */
+    uint32_t us = elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us;
+    if (us > max_us_.load(std::memory_order_relaxed)) {
+        max_us_.store(us, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Reset() {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+    total_us_.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::GetPercentileMs(int percentile) const {
+    uint32_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint32_t rank = ((uint64_t)total * percentile + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < AUDIO_LATENCY_BUCKET_COUNT - 1; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return kBucketBoundsMs[i];
+        }
+    }
+    return (max_us() + 999) / 1000;
+}
+
+cJSON *LatencyHistogram::ToJson() const {
+    cJSON *json = cJSON_CreateObject();
+    uint32_t total = count();
+    cJSON_AddNumberToObject(json, "count", total);
+    cJSON_AddNumberToObject(json, "mean_ms", total > 0 ? total_us_.load(std::memory_order_relaxed) / total / 1000.0 : 0);
+    cJSON_AddNumberToObject(json, "p50_ms", GetPercentileMs(50));
+    cJSON_AddNumberToObject(json, "p90_ms", GetPercentileMs(90));
+    cJSON_AddNumberToObject(json, "p99_ms", GetPercentileMs(99));
+    cJSON_AddNumberToObject(json, "max_ms", max_us() / 1000.0);
+    cJSON *buckets = cJSON_CreateArray();
+    for (auto &bucket : buckets_) {
+        cJSON_AddItemToArray(buckets, cJSON_CreateNumber(bucket.load(std::memory_order_relaxed)));
+    }
+    cJSON_AddItemToObject(json, "buckets", buckets);
+    return json;
+}
+
+void AudioLatencyStats::Reset() {
+    for (auto &histogram : histograms_) {
+        histogram.Reset();
+    }
+}
+
+cJSON *AudioLatencyStats::ToJson() const {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddItemToObject(json, "bucket_bounds_ms", cJSON_CreateIntArray(kBucketBoundsMs, AUDIO_LATENCY_BUCKET_COUNT - 1));
+    cJSON *stages = cJSON_CreateObject();
+    for (int i = 0; i < kAudioStageCount; i++) {
+        cJSON_AddItemToObject(stages, kStageNames[i], histograms_[i].ToJson());
+    }
+    cJSON_AddItemToObject(json, "stages", stages);
+    return json;
+}
@@ -0,0 +1,65 @@
+#ifndef AUDIO_LATENCY_H
+#define AUDIO_LATENCY_H
+
+#include <atomic>
+#include <cJSON.h>
+#include <cstdint>
+
+/*
+ * Fixed-bucket latency histograms for every stage of the audio pipeline.
+ *
+ * Frames carry two monotonic stamps (esp_timer microseconds): when they entered the device (mic
+ * read or network arrival) and when they entered their current queue. Each stage boundary records
+ * the elapsed time into its histogram. Every histogram is written by a single task, the counters
+ * are atomic so the MCP tool can read them from the main task at any time.
+ *
+ * The network itself is not covered, the device only sees one end of each hop.
+ */
+
+enum AudioLatencyStage {
+    kAudioStageCodecRead,     // AudioCodec::InputData
+    kAudioStageProcess,       // mic read -> PushTaskToEncodeQueue (AFE / wake word)
+    kAudioStageEncodeQueue,   // waiting in audio_encode_queue_
+    kAudioStageEncode,        // Opus encode
+    kAudioStageSendQueue,     // waiting in audio_send_queue_ until the main loop pops it
+    kAudioStageUplink,        // mic read -> send queue pop
+    kAudioStageDecodeQueue,   // waiting in audio_decode_queue_ and the jitter buffer
+    kAudioStageDecode,        // Opus decode and resample
+    kAudioStagePlaybackQueue, // waiting in audio_playback_queue_
+    kAudioStageCodecWrite,    // AudioCodec::OutputData
+    kAudioStageDownlink,      // network arrival -> written to the codec
+    kAudioStageCount,
+};
+
+#define AUDIO_LATENCY_BUCKET_COUNT 16
+
+class LatencyHistogram {
+  public:
+    void Record(int64_t elapsed_us);
+    void Reset();
+    uint32_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint32_t max_us() const { return max_us_.load(std::memory_order_relaxed); }
+    /* Upper bound of the bucket holding the given percentile, in milliseconds */
+    int GetPercentileMs(int percentile) const;
+    cJSON *ToJson() const;
+
+  private:
+    std::atomic<uint32_t> buckets_[AUDIO_LATENCY_BUCKET_COUNT] = {};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> max_us_{0};
+    std::atomic<uint64_t> total_us_{0};
+};
+
+class AudioLatencyStats {
+  public:
+    void Record(AudioLatencyStage stage, int64_t elapsed_us) { histograms_[stage].Record(elapsed_us); }
+    const LatencyHistogram &Get(AudioLatencyStage stage) const { return histograms_[stage]; }
+    void Reset();
+    /* Caller owns the returned object */
+    cJSON *ToJson() const;
+
+  private:
+    LatencyHistogram histograms_[kAudioStageCount];
+};
+
+#endif // AUDIO_LATENCY_H
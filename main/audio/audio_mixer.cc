@@ -0,0 +1,115 @@
+#include "audio_mixer.h"
+#include "audio_service.h"
+
+#include <algorithm>
+
+static void SaturatingAdd(int16_t *dst, const int16_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t sum = dst[i] + src[i];
+        dst[i] = sum > INT16_MAX ? INT16_MAX : (sum < INT16_MIN ? INT16_MIN : sum);
+    }
+}
+
+void AudioMixer::SetSource(AudioMixerSource source, AudioFrameRing<AudioTask> *ring) {
+    sources_[source].ring = ring;
+}
+
+void AudioMixer::SetGain(AudioMixerSource source, int gain) {
+    sources_[source].user_gain = std::clamp(gain, 0, 100) * AUDIO_MIXER_UNITY_GAIN / 100;
+}
+
+void AudioMixer::Drop(AudioMixerSource source) {
+    sources_[source].drop = true;
+}
+
+bool AudioMixer::IsActive(Source &source) {
+    return source.current || (source.ring != nullptr && !source.ring->Empty());
+}
+
+void AudioMixer::Scale(Source &source, int target, int16_t *samples, size_t count) {
+    int gain = source.gain;
+    size_t i = 0;
+    for (; i < count && gain != target; i++) {
+        gain += std::clamp(target - gain, -AUDIO_MIXER_GAIN_STEP, AUDIO_MIXER_GAIN_STEP);
+        samples[i] = (samples[i] * gain) >> 15;
+    }
+    source.gain = gain;
+    if (gain == AUDIO_MIXER_UNITY_GAIN) {
+        return;
+    }
+    for (; i < count; i++) {
+        samples[i] = (samples[i] * gain) >> 15;
+    }
+}
+
+void AudioMixer::MixInto(AudioMixerSource index, int target, int16_t *out, size_t count, uint32_t &popped) {
+    auto &source = sources_[index];
+    size_t pos = 0;
+    while (pos < count) {
+        if (!source.current) {
+            if (source.ring == nullptr || !(source.current = source.ring->Pop())) {
+                break;
+            }
+            popped |= 1 << index;
+            source.offset = 0;
+        }
+
+        auto &pcm = source.current->pcm;
+        size_t n = std::min(pcm.size() - source.offset, count - pos);
+        int16_t *samples = pcm.data() + source.offset;
+        Scale(source, target, samples, n);
+        SaturatingAdd(out + pos, samples, n);
+        pos += n;
+        source.offset += n;
+        if (source.offset >= pcm.size()) {
+            source.current.reset();
+            source.offset = 0;
+        }
+    }
+}
+
+std::unique_ptr<AudioTask> AudioMixer::Mix(uint32_t &popped) {
+    popped = 0;
+    for (auto &source : sources_) {
+        if (source.drop.exchange(false)) {
+            source.current.reset();
+            source.offset = 0;
+        }
+    }
+
+    int targets[kAudioSourceCount];
+    for (int i = 0; i < kAudioSourceCount; i++) {
+        targets[i] = sources_[i].user_gain;
+    }
+    if (IsActive(sources_[kAudioSourcePrompt])) {
+        targets[kAudioSourceStream] = targets[kAudioSourceStream] * AUDIO_MIXER_DUCK_GAIN / AUDIO_MIXER_UNITY_GAIN;
+    }
+
+    /* The first source with audio waiting provides the output frame */
+    std::unique_ptr<AudioTask> out;
+    int primary = 0;
+    for (; primary < kAudioSourceCount; primary++) {
+        auto &source = sources_[primary];
+        if (source.current) {
+            out = std::move(source.current);
+            out->pcm.erase(out->pcm.begin(), out->pcm.begin() + source.offset);
+            source.offset = 0;
+            break;
+        }
+        if (source.ring != nullptr && (out = source.ring->Pop())) {
+            popped |= 1 << primary;
+            break;
+        }
+    }
+    if (!out) {
+        return nullptr;
+    }
+
+    Scale(sources_[primary], targets[primary], out->pcm.data(), out->pcm.size());
+    for (int i = 0; i < kAudioSourceCount; i++) {
+        if (i != primary) {
+            MixInto((AudioMixerSource)i, targets[i], out->pcm.data(), out->pcm.size(), popped);
+        }
+    }
+    return out;
+}
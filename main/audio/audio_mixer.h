@@ -0,0 +1,64 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "audio_frame_ring.h"
+
+struct AudioTask;
+
+/*
+ * Sums the decoded PCM of every playback source in front of AudioCodec::OutputData.
+ *
+ * Each source has its own ring of decoded frames. The first source (in enum order) with audio
+ * waiting provides the output frame, and the other sources are added into it sample by sample
+ * through a cursor, so sources with different frame sizes line up. While a prompt is playing the
+ * stream is ducked. Gains move towards their target a little every sample to avoid clicks.
+ *
+ * Mix() and the cursors belong to the output task. SetGain() and Drop() may be called from any task.
+ */
+
+enum AudioMixerSource {
+    kAudioSourceStream, // Server TTS and FBT voice / phone calls, one decoder shared by the transports
+    kAudioSourcePrompt, // PlaySound: UI cues and the ringtone
+    kAudioSourceCount,
+};
+
+#define AUDIO_MIXER_UNITY_GAIN 32768
+// The stream drops by 12dB under a prompt
+#define AUDIO_MIXER_DUCK_GAIN (AUDIO_MIXER_UNITY_GAIN / 4)
+// Largest gain change per sample, a full swing takes 512 samples (~20ms at 24kHz)
+#define AUDIO_MIXER_GAIN_STEP 64
+
+class AudioMixer {
+  public:
+    void SetSource(AudioMixerSource source, AudioFrameRing<AudioTask> *ring);
+    /* Percent of full scale for a source */
+    void SetGain(AudioMixerSource source, int gain);
+    /* Discard the partly played frame of a source, for use after clearing its ring */
+    void Drop(AudioMixerSource source);
+
+    /* Returns the next frame to play or nullptr, `popped` gets bit (1 << source) for every ring that was popped */
+    std::unique_ptr<AudioTask> Mix(uint32_t &popped);
+
+  private:
+    struct Source {
+        AudioFrameRing<AudioTask> *ring = nullptr;
+        std::unique_ptr<AudioTask> current;
+        size_t offset = 0;
+        int gain = AUDIO_MIXER_UNITY_GAIN;
+        std::atomic<int> user_gain{AUDIO_MIXER_UNITY_GAIN};
+        std::atomic<bool> drop{false};
+    };
+
+    Source sources_[kAudioSourceCount];
+
+    bool IsActive(Source &source);
+    void Scale(Source &source, int target, int16_t *samples, size_t count);
+    void MixInto(AudioMixerSource index, int target, int16_t *out, size_t count, uint32_t &popped);
+};
+
+#endif // AUDIO_MIXER_H
@@ -0,0 +1,139 @@
+#include "audio_output_stage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define UNITY_Q24 (1 << 24)
+
+void AudioOutputStage::Configure(int sample_rate, int threshold_db, bool dc_block) {
+    sample_rate_ = sample_rate;
+    dc_block_ = dc_block;
+    threshold_ = std::lround(INT16_MAX * std::pow(10.0, threshold_db / 20.0));
+    delay_.assign(std::max(sample_rate * AUDIO_OUTPUT_LIMITER_LOOKAHEAD_MS / 1000, 1), 0);
+    reset_pending_ = false;
+    ResetState();
+
+    /* The release closes 1/2^shift of the remaining gap per sample, about the release time constant */
+    int release_samples = sample_rate * AUDIO_OUTPUT_LIMITER_RELEASE_MS / 1000;
+    release_shift_ = 0;
+    while ((2 << release_shift_) <= release_samples) {
+        release_shift_++;
+    }
+}
+
+void AudioOutputStage::ResetState() {
+    dc_last_input_ = 0;
+    dc_last_output_ = 0;
+    /* Nothing is playing, so the gain can jump to where it should be */
+    gain_ = target_gain_ << 10;
+    gain_step_ = 0;
+    ramp_samples_ = 0;
+
+    std::fill(delay_.begin(), delay_.end(), 0);
+    delay_pos_ = 0;
+    limit_gain_ = limit_target_ = UNITY_Q24;
+    limit_step_ = 0;
+    limit_remaining_ = 0;
+    limit_hold_ = 0;
+}
+
+void AudioOutputStage::SetGain(int gain) {
+    target_gain_ = std::clamp(gain, 0, AUDIO_OUTPUT_MAX_GAIN);
+}
+
+void AudioOutputStage::Process(int16_t *samples, size_t count) {
+    if (sample_rate_ == 0 || count == 0) {
+        return;
+    }
+    if (reset_pending_.exchange(false)) {
+        ResetState();
+    }
+    if (dc_block_) {
+        DcBlock(samples, count);
+    }
+    scaled_.resize(count);
+    ApplyGain(samples, count, scaled_.data());
+    Limit(scaled_.data(), samples, count);
+}
+
+void AudioOutputStage::DcBlock(int16_t *samples, size_t count) {
+    int32_t last_input = dc_last_input_;
+    int32_t last_output = dc_last_output_;
+    for (size_t i = 0; i < count; i++) {
+        int32_t input = samples[i];
+        last_output = ((input - last_input) << 8) + (int32_t)(((int64_t)last_output * AUDIO_OUTPUT_DC_BLOCK_POLE) >> 15);
+        last_input = input;
+        samples[i] = std::clamp(last_output >> 8, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+    }
+    dc_last_input_ = last_input;
+    dc_last_output_ = last_output;
+}
+
+void AudioOutputStage::ApplyGain(const int16_t *samples, size_t count, int32_t *scaled) {
+    int32_t target = target_gain_ << 10;
+    if (target != gain_ && ramp_samples_ == 0) {
+        ramp_samples_ = std::max(sample_rate_ * AUDIO_OUTPUT_GAIN_RAMP_MS / 1000, 1);
+        gain_step_ = (target - gain_) / ramp_samples_;
+    }
+
+    size_t i = 0;
+    for (; i < count && ramp_samples_ > 0; i++) {
+        gain_ = --ramp_samples_ > 0 ? gain_ + gain_step_ : target;
+        scaled[i] = (samples[i] * (gain_ >> 10)) >> 14;
+    }
+
+    /* Steady gain, a plain multiply the compiler can unroll */
+    int32_t gain = gain_ >> 10;
+    if (gain == AUDIO_OUTPUT_UNITY_GAIN) {
+        for (; i < count; i++) {
+            scaled[i] = samples[i];
+        }
+    } else {
+        for (; i < count; i++) {
+            scaled[i] = (samples[i] * gain) >> 14;
+        }
+    }
+}
+
+void AudioOutputStage::Limit(const int32_t *scaled, int16_t *samples, size_t count) {
+    const int lookahead = delay_.size();
+    for (size_t i = 0; i < count; i++) {
+        /* The sample leaving the delay line, with the gain its peak asked for when it came in */
+        int32_t out = ((int64_t)delay_[delay_pos_] * limit_gain_) >> 24;
+        samples[i] = std::clamp(out, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+
+        int32_t in = scaled[i];
+        delay_[delay_pos_] = in;
+        delay_pos_ = delay_pos_ + 1 < delay_.size() ? delay_pos_ + 1 : 0;
+
+        /* A peak entering: the gain must be down to `required` by the time it leaves */
+        int32_t magnitude = std::abs(in);
+        if (magnitude > threshold_) {
+            limited_count_++;
+            limit_hold_ = lookahead;
+            int32_t required = ((int64_t)threshold_ << 24) / magnitude;
+            if (limit_remaining_ == 0 || required <= limit_target_) {
+                // A shallower peak during the release only holds the gain where it is
+                limit_target_ = std::min(required, limit_gain_);
+                limit_remaining_ = lookahead;
+                int32_t step = (limit_gain_ - limit_target_ + lookahead - 1) / lookahead;
+                limit_step_ = std::max(limit_step_, step);
+            }
+        }
+
+        if (limit_remaining_ > 0) {
+            limit_gain_ = std::max(limit_gain_ - limit_step_, limit_target_);
+            if (--limit_remaining_ == 0) {
+                limit_step_ = 0;
+            }
+        }
+        if (limit_hold_ > 0) {
+            /* No release while any peak is still in the delay line */
+            limit_hold_--;
+        } else if (limit_gain_ < UNITY_Q24) {
+            limit_gain_ += ((UNITY_Q24 - limit_gain_) >> release_shift_) + 1;
+            limit_gain_ = std::min(limit_gain_, UNITY_Q24);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef AUDIO_OUTPUT_STAGE_H
+#define AUDIO_OUTPUT_STAGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Software post-processing of the (mono) playback buffer, in place, right before the codec writes it.
+ *
+ * - DC blocker: a one pole high-pass at ~10Hz, keeps offsets from the decoders and resamplers
+ *   away from the amplifier.
+ * - Gain: the software volume of codecs without a hardware one, times the configured boost. Changes
+ *   are ramped over AUDIO_OUTPUT_GAIN_RAMP_MS so volume steps do not click.
+ * - Limiter: samples pass through a short delay line, and the gain starts to fall as soon as a peak
+ *   above the threshold enters it, so the peak leaves at the threshold instead of clipping. The gain
+ *   recovers over AUDIO_OUTPUT_LIMITER_RELEASE_MS.
+ *
+ * Everything is fixed point. While the gain is steady and nothing is limited, a block costs one
+ * multiply per sample plus the delay line copy.
+ *
+ * Process() belongs to the output task, SetGain() and Reset() may be called from any task.
+ */
+
+// Gains are Q14, 4.0 (+12dB) at most
+#define AUDIO_OUTPUT_UNITY_GAIN (1 << 14)
+#define AUDIO_OUTPUT_MAX_GAIN (4 << 14)
+#define AUDIO_OUTPUT_GAIN_RAMP_MS 20
+#define AUDIO_OUTPUT_LIMITER_LOOKAHEAD_MS 2
+#define AUDIO_OUTPUT_LIMITER_RELEASE_MS 60
+// DC blocker pole, 0.9975 in Q15
+#define AUDIO_OUTPUT_DC_BLOCK_POLE 32686
+
+class AudioOutputStage {
+  public:
+    void Configure(int sample_rate, int threshold_db, bool dc_block);
+    /* Q14 gain, applied with a ramp */
+    void SetGain(int gain);
+    /* Playback stopped: the next Process() starts from silence, without the delay line, limiter
+     * and DC blocker state of the previous stream */
+    void Reset() { reset_pending_ = true; }
+    void Process(int16_t *samples, size_t count);
+
+    /* Samples that had to be limited since the start */
+    uint32_t limited_count() const { return limited_count_; }
+
+  private:
+    int sample_rate_ = 0;
+    bool dc_block_ = false;
+    int32_t threshold_ = INT16_MAX;
+
+    std::atomic<int> target_gain_{AUDIO_OUTPUT_UNITY_GAIN};
+    std::atomic<bool> reset_pending_{false};
+    // Q24, the extra bits make the ramp steps smooth
+    int32_t gain_ = AUDIO_OUTPUT_UNITY_GAIN << 10;
+    int32_t gain_step_ = 0;
+    int ramp_samples_ = 0;
+
+    // DC blocker state, the output is kept with 8 fractional bits
+    int32_t dc_last_input_ = 0;
+    int32_t dc_last_output_ = 0;
+
+    // Limiter, gains in Q24
+    std::vector<int32_t> delay_;
+    size_t delay_pos_ = 0;
+    int32_t limit_gain_ = 1 << 24;
+    int32_t limit_target_ = 1 << 24;
+    int32_t limit_step_ = 0;
+    int limit_remaining_ = 0;
+    int limit_hold_ = 0;
+    int32_t release_shift_ = 0;
+    uint32_t limited_count_ = 0;
+    std::vector<int32_t> scaled_;
+
+    void ResetState();
+    void DcBlock(int16_t *samples, size_t count);
+    void ApplyGain(const int16_t *samples, size_t count, int32_t *scaled);
+    void Limit(const int32_t *scaled, int16_t *samples, size_t count);
+};
+
+#endif // AUDIO_OUTPUT_STAGE_H
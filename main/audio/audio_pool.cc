@@ -0,0 +1,125 @@
+#include "audio_pool.h"
+
+#include <esp_heap_caps.h>
+#include <new>
+
+static uint16_t packet_free_list[AUDIO_POOL_MAX_PACKETS];
+alignas(std::max_align_t) static uint8_t task_storage[AUDIO_POOL_MAX_TASKS * AUDIO_POOL_SLOT_SIZE];
+static uint16_t task_free_list[AUDIO_POOL_MAX_TASKS];
+
+AudioSlab::AudioSlab(uint8_t *storage, uint16_t *free_list, size_t slots)
+    : storage_(storage), free_list_(free_list), slots_(storage != nullptr ? slots : 0), free_count_(slots_) {
+    for (size_t i = 0; i < slots_; i++) {
+        free_list_[i] = slots_ - 1 - i;
+    }
+}
+
+void *AudioSlab::Allocate(size_t size) {
+    if (size > AUDIO_POOL_SLOT_SIZE) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_count_ == 0) {
+        return nullptr;
+    }
+    return storage_ + free_list_[--free_count_] * AUDIO_POOL_SLOT_SIZE;
+}
+
+bool AudioSlab::Free(void *ptr) {
+    auto p = static_cast<uint8_t *>(ptr);
+    if (p < storage_ || p >= storage_ + slots_ * AUDIO_POOL_SLOT_SIZE) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_list_[free_count_++] = (p - storage_) / AUDIO_POOL_SLOT_SIZE;
+    return true;
+}
+
+/* PSRAM is fast enough for one packet header per frame. Without PSRAM the slab is the smaller
+ * CONFIG_AUDIO_POOL_MAX_PACKETS default in internal RAM */
+uint8_t *AudioPool::AllocatePacketStorage() {
+    size_t size = AUDIO_POOL_MAX_PACKETS * AUDIO_POOL_SLOT_SIZE;
+    void *storage = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (storage == nullptr) {
+        storage = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return static_cast<uint8_t *>(storage);
+}
+
+AudioPool::AudioPool()
+    : packet_slab_(AllocatePacketStorage(), packet_free_list, AUDIO_POOL_MAX_PACKETS),
+      task_slab_(task_storage, task_free_list, AUDIO_POOL_MAX_TASKS),
+      payload_stash_(AUDIO_POOL_MAX_PAYLOAD_BUFFERS),
+      pcm_stash_(AUDIO_POOL_MAX_PCM_BUFFERS) {
+}
+
+void *AudioPool::AllocatePacket(size_t size) {
+    void *ptr = packet_slab_.Allocate(size);
+    if (ptr != nullptr) {
+        packet_hits_++;
+        return ptr;
+    }
+    packet_misses_++;
+    return ::operator new(size);
+}
+
+void AudioPool::FreePacket(void *ptr) {
+    if (ptr != nullptr && !packet_slab_.Free(ptr)) {
+        ::operator delete(ptr);
+    }
+}
+
+void *AudioPool::AllocateTask(size_t size) {
+    void *ptr = task_slab_.Allocate(size);
+    if (ptr != nullptr) {
+        task_hits_++;
+        return ptr;
+    }
+    task_misses_++;
+    return ::operator new(size);
+}
+
+void AudioPool::FreeTask(void *ptr) {
+    if (ptr != nullptr && !task_slab_.Free(ptr)) {
+        ::operator delete(ptr);
+    }
+}
+
+void AudioPool::AcquirePayload(std::vector<uint8_t> &payload) {
+    if (payload_stash_.Acquire(payload)) {
+        buffer_hits_++;
+        return;
+    }
+    buffer_misses_++;
+    payload.reserve(AUDIO_POOL_PAYLOAD_RESERVE);
+}
+
+void AudioPool::ReleasePayload(std::vector<uint8_t> &payload) {
+    payload_stash_.Release(payload);
+}
+
+void AudioPool::AcquirePcm(std::vector<int16_t> &pcm) {
+    if (pcm_stash_.Acquire(pcm)) {
+        buffer_hits_++;
+        return;
+    }
+    /* Fresh PCM buffers are sized by their first frame and keep that capacity afterwards */
+    buffer_misses_++;
+}
+
+void AudioPool::ReleasePcm(std::vector<int16_t> &pcm) {
+    pcm_stash_.Release(pcm);
+}
+
+AudioPoolStatistics AudioPool::GetStatistics() const {
+    AudioPoolStatistics statistics;
+    statistics.packet_hits = packet_hits_;
+    statistics.packet_misses = packet_misses_;
+    statistics.task_hits = task_hits_;
+    statistics.task_misses = task_misses_;
+    statistics.buffer_hits = buffer_hits_;
+    statistics.buffer_misses = buffer_misses_;
+    statistics.packets_in_use = packet_slab_.in_use();
+    statistics.tasks_in_use = task_slab_.in_use();
+    return statistics;
+}
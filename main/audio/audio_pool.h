@@ -0,0 +1,139 @@
+#ifndef AUDIO_POOL_H
+#define AUDIO_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "sdkconfig.h"
+
+/*
+ * Recycles the objects that travel through the audio pipeline once per frame.
+ *
+ * AudioStreamPacket and AudioTask are placed in fixed slabs by their class operator new, and their
+ * payload / pcm vectors are taken from a stash of buffers that keep their capacity. After the first
+ * few frames the pipeline runs without touching the heap. When a slab or stash is exhausted the
+ * pool falls back to the heap and counts a miss, so a busy stage never fails because of the pool.
+ */
+
+#define AUDIO_POOL_SLOT_SIZE 96
+// CONFIG_AUDIO_POOL_MAX_PACKETS: with PSRAM enough for the decode and send rings full of 20ms
+// frames, the jitter buffer, the prompts and a few packets between stages; without it the same at
+// 60ms frames. audio_service.cc checks these against the ring limits.
+#define AUDIO_POOL_MAX_PACKETS CONFIG_AUDIO_POOL_MAX_PACKETS
+// The encode, playback and prompt rings, the mixer's current frames and a few between stages
+#define AUDIO_POOL_MAX_TASKS 20
+// Every packet in flight returns its payload buffer, a smaller stash would reallocate in the
+// steady state whenever more packets are queued than it holds
+#define AUDIO_POOL_MAX_PAYLOAD_BUFFERS AUDIO_POOL_MAX_PACKETS
+#define AUDIO_POOL_MAX_PCM_BUFFERS 20
+// Fresh payload buffers cover a 60ms frame up to ~64kbps, larger packets grow the buffer once
+#define AUDIO_POOL_PAYLOAD_RESERVE 512
+
+struct AudioPoolStatistics {
+    uint32_t packet_hits = 0;
+    uint32_t packet_misses = 0;
+    uint32_t task_hits = 0;
+    uint32_t task_misses = 0;
+    uint32_t buffer_hits = 0;
+    uint32_t buffer_misses = 0;
+    uint32_t packets_in_use = 0;
+    uint32_t tasks_in_use = 0;
+};
+
+class AudioSlab {
+  public:
+    AudioSlab(uint8_t *storage, uint16_t *free_list, size_t slots);
+
+    void *Allocate(size_t size);
+    bool Free(void *ptr);
+    size_t in_use() const { return slots_ - free_count_; }
+
+  private:
+    std::mutex mutex_;
+    uint8_t *storage_;
+    uint16_t *free_list_;
+    size_t slots_;
+    size_t free_count_;
+};
+
+template <typename T>
+class AudioBufferStash {
+  public:
+    explicit AudioBufferStash(size_t max_buffers) : max_buffers_(max_buffers) {
+        buffers_.reserve(max_buffers);
+    }
+
+    /* Swap a recycled buffer into `buffer`, returns false if the stash was empty */
+    bool Acquire(std::vector<T> &buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffers_.empty()) {
+            return false;
+        }
+        buffer.swap(buffers_.back());
+        buffers_.pop_back();
+        return true;
+    }
+
+    void Release(std::vector<T> &buffer) {
+        if (buffer.capacity() == 0) {
+            return;
+        }
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffers_.size() < max_buffers_) {
+            buffers_.emplace_back();
+            buffers_.back().swap(buffer);
+        }
+    }
+
+  private:
+    std::mutex mutex_;
+    std::vector<std::vector<T>> buffers_;
+    size_t max_buffers_;
+};
+
+class AudioPool {
+  public:
+    static AudioPool &GetInstance() {
+        static AudioPool instance;
+        return instance;
+    }
+
+    // 删除拷贝构造函数和赋值运算符
+    AudioPool(const AudioPool &) = delete;
+    AudioPool &operator=(const AudioPool &) = delete;
+
+    void *AllocatePacket(size_t size);
+    void FreePacket(void *ptr);
+    void *AllocateTask(size_t size);
+    void FreeTask(void *ptr);
+
+    void AcquirePayload(std::vector<uint8_t> &payload);
+    void ReleasePayload(std::vector<uint8_t> &payload);
+    void AcquirePcm(std::vector<int16_t> &pcm);
+    void ReleasePcm(std::vector<int16_t> &pcm);
+
+    AudioPoolStatistics GetStatistics() const;
+
+  private:
+    AudioPool();
+
+    static uint8_t *AllocatePacketStorage();
+
+    AudioSlab packet_slab_;
+    AudioSlab task_slab_;
+    AudioBufferStash<uint8_t> payload_stash_;
+    AudioBufferStash<int16_t> pcm_stash_;
+
+    std::atomic<uint32_t> packet_hits_{0};
+    std::atomic<uint32_t> packet_misses_{0};
+    std::atomic<uint32_t> task_hits_{0};
+    std::atomic<uint32_t> task_misses_{0};
+    std::atomic<uint32_t> buffer_hits_{0};
+    std::atomic<uint32_t> buffer_misses_{0};
+};
+
+#endif // AUDIO_POOL_H
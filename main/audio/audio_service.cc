@@ -1,4 +1,6 @@
 #include "audio_service.h"
+#include "audio_pool.h"
+#include <algorithm>
 #include <cstring>
 #include <esp_log.h>
 
@@ -17,8 +19,48 @@
 
 #define TAG "AudioService"
 
-AudioService::AudioService() {
+static_assert(sizeof(AudioTask) <= AUDIO_POOL_SLOT_SIZE, "AudioTask does not fit in an audio pool slot");
+// Full rings must not spill out of the slabs onto the heap. Without PSRAM the packet slab only
+// covers the rings at the default frame duration, see CONFIG_AUDIO_POOL_MAX_PACKETS
+static_assert(AUDIO_POOL_MAX_PACKETS >= (MAX_DECODE_QUEUE_MS + MAX_SEND_QUEUE_MS) / OPUS_FRAME_DURATION_MS +
+                                            JITTER_BUFFER_CAPACITY + MAX_PROMPT_PACKETS_IN_QUEUE,
+              "AUDIO_POOL_MAX_PACKETS is smaller than the packet rings");
+static_assert(AUDIO_POOL_MAX_TASKS >= (MAX_ENCODE_QUEUE_MS + MAX_PLAYBACK_QUEUE_MS) / OPUS_MIN_FRAME_DURATION_MS +
+                                          MAX_PLAYBACK_QUEUE_MS / OPUS_FRAME_DURATION_MS,
+              "AUDIO_POOL_MAX_TASKS is smaller than the task rings");
+
+AudioTask::AudioTask() {
+    AudioPool::GetInstance().AcquirePcm(pcm);
+}
+
+AudioTask::~AudioTask() {
+    AudioPool::GetInstance().ReleasePcm(pcm);
+}
+
+void *AudioTask::operator new(size_t size) {
+    return AudioPool::GetInstance().AllocateTask(size);
+}
+
+void AudioTask::operator delete(void *ptr) {
+    AudioPool::GetInstance().FreeTask(ptr);
+}
+
+AudioService::AudioService()
+    : audio_decode_queue_(AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS),
+      audio_send_queue_(MAX_SEND_QUEUE_MS / OPUS_MIN_FRAME_DURATION_MS),
+      audio_testing_queue_(AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS),
+      audio_encode_queue_(MAX_ENCODE_QUEUE_MS / OPUS_MIN_FRAME_DURATION_MS),
+      audio_playback_queue_(MAX_PLAYBACK_QUEUE_MS / OPUS_MIN_FRAME_DURATION_MS),
+      audio_prompt_decode_queue_(MAX_PROMPT_PACKETS_IN_QUEUE),
+      audio_prompt_queue_(MAX_PLAYBACK_QUEUE_MS / OPUS_FRAME_DURATION_MS) {
     event_group_ = xEventGroupCreate();
+    mixer_.SetSource(kAudioSourceStream, &audio_playback_queue_);
+    mixer_.SetSource(kAudioSourcePrompt, &audio_prompt_queue_);
+    /* The decode queue keeps room for replaying a full audio test, but normal pushes stop at the limit */
+    audio_decode_queue_.SetLimit(MAX_DECODE_QUEUE_MS / OPUS_FRAME_DURATION_MS);
+    audio_playback_queue_.SetLimit(MAX_PLAYBACK_QUEUE_MS / OPUS_FRAME_DURATION_MS);
+    audio_encode_queue_.SetLimit(MAX_ENCODE_QUEUE_MS / OPUS_FRAME_DURATION_MS);
+    audio_send_queue_.SetLimit(MAX_SEND_QUEUE_MS / OPUS_FRAME_DURATION_MS);
 }
 
 AudioService::~AudioService() {
@@ -33,14 +75,26 @@ void AudioService::Initialize(AudioCodec *codec) {
 
     /* Setup the audio codec */
     opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    opus_encoder_ = std::make_unique<UplinkEncoder>(16000, 1);
+#if CONFIG_USE_OPUS_ENCODER_CONTROLLER
+    ApplyEncoderSettings();
+#endif
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
     }
 
+    /* Room for a feed chunk of the longest frames, the warm-up reads into the slots in place */
+    for (auto &slot : input_prewarm_) {
+        slot.reserve(OPUS_FRAME_DURATION_MS * std::max(codec->input_sample_rate(), 16000) / 1000 * codec->input_channels());
+    }
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+    // Created up front, the taps are fed from several tasks
+    audio_debugger_ = std::make_unique<AudioDebugger>();
+#endif
+
 #if CONFIG_USE_AUDIO_PROCESSOR
     audio_processor_ = std::make_unique<AfeAudioProcessor>();
 #else
@@ -48,7 +102,15 @@ void AudioService::Initialize(AudioCodec *codec) {
 #endif
 
     audio_processor_->OnOutput([this](std::vector<int16_t> &&data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugTapProcessed, data, 16000);
+#endif
+#if CONFIG_USE_UPLINK_DTX
+        if (SuppressSilentFrame(data)) {
+            return;
+        }
+#endif
+        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, data);
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -111,6 +173,24 @@ void AudioService::Start() {
                 "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
+#if CONFIG_USE_AUDIO_SPLIT_CODEC_TASKS
+    /* Start the opus decode and encode tasks */
+    xTaskCreatePinnedToCore([](void *arg) {
+        AudioService *audio_service = (AudioService *)arg;
+        audio_service->OpusDecodeTask();
+        vTaskDelete(NULL);
+    },
+                            "opus_decode", 2048 * 6, this, CONFIG_AUDIO_DECODE_TASK_PRIORITY, &opus_decode_task_handle_,
+                            CONFIG_AUDIO_DECODE_TASK_CORE < 0 ? tskNO_AFFINITY : CONFIG_AUDIO_DECODE_TASK_CORE);
+
+    xTaskCreatePinnedToCore([](void *arg) {
+        AudioService *audio_service = (AudioService *)arg;
+        audio_service->OpusEncodeTask();
+        vTaskDelete(NULL);
+    },
+                            "opus_encode", 2048 * 12, this, CONFIG_AUDIO_ENCODE_TASK_PRIORITY, &opus_encode_task_handle_,
+                            CONFIG_AUDIO_ENCODE_TASK_CORE < 0 ? tskNO_AFFINITY : CONFIG_AUDIO_ENCODE_TASK_CORE);
+#else
     /* Start the opus codec task */
     xTaskCreate([](void *arg) {
         AudioService *audio_service = (AudioService *)arg;
@@ -118,56 +198,74 @@ void AudioService::Start() {
         vTaskDelete(NULL);
     },
                 "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);
+#endif
 }
 
 void AudioService::Stop() {
     esp_timer_stop(audio_power_timer_);
     service_stopped_ = true;
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_prompt_decode_queue_.Clear();
+    audio_prompt_queue_.Clear();
+    audio_testing_queue_.Clear();
+#if CONFIG_USE_SOUND_PCM_CACHE
+    SoundPcmCache::GetInstance().AbortFill();
+#endif
+    /* Wake up every task so it can see the service is stopped */
     xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
                                          AS_EVENT_WAKE_WORD_RUNNING |
-                                         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
-
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+                                         AS_EVENT_AUDIO_PROCESSOR_RUNNING |
+                                         AS_EVENT_ALL_QUEUES);
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t> &data, int sample_rate, int samples) {
     if (!codec_->input_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableInput(true);
+        EnableInputPower();
     }
 
+    int64_t start_us = esp_timer_get_time();
+
     if (codec_->input_sample_rate() != sample_rate) {
         data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
         if (!codec_->InputData(data)) {
             return false;
         }
+        int64_t resample_start_us = esp_timer_get_time();
         if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
+            /* Split the channels in one pass, resample each one, then interleave straight into data */
+            size_t frames = data.size() / 2;
+            input_split_buffer_.resize(data.size());
+            int16_t *mic = input_split_buffer_.data();
+            int16_t *reference = mic + frames;
+            const int16_t *src = data.data();
+            for (size_t i = 0; i < frames; ++i, src += 2) {
+                mic[i] = src[0];
+                reference[i] = src[1];
             }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
+
+            size_t resampled_frames = input_resampler_.GetOutputSamples(frames);
+            input_resampled_buffer_.resize(resampled_frames * 2);
+            int16_t *resampled_mic = input_resampled_buffer_.data();
+            int16_t *resampled_reference = resampled_mic + resampled_frames;
+            input_resampler_.Process(mic, frames, resampled_mic);
+            reference_resampler_.Process(reference, frames, resampled_reference);
+
+            /* Codec rates are above 16kHz, so data already has the capacity */
+            data.resize(resampled_frames * 2);
+            int16_t *dst = data.data();
+            for (size_t i = 0; i < resampled_frames; ++i, dst += 2) {
+                dst[0] = resampled_mic[i];
+                dst[1] = resampled_reference[i];
             }
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            input_resampled_buffer_.resize(input_resampler_.GetOutputSamples(data.size()));
+            input_resampler_.Process(data.data(), data.size(), input_resampled_buffer_.data());
+            data.assign(input_resampled_buffer_.begin(), input_resampled_buffer_.end());
         }
+        uplink_cost_.Record(kUplinkCostResample, esp_timer_get_time() - resample_start_us,
+                            (int64_t)samples * 1000000 / sample_rate);
     } else {
         data.resize(samples * codec_->input_channels());
         if (!codec_->InputData(data)) {
@@ -178,13 +276,16 @@ bool AudioService::ReadAudioData(std::vector<int16_t> &data, int sample_rate, in
     /* Update the last input time */
     last_input_time_ = std::chrono::steady_clock::now();
     debug_statistics_.input_count++;
+    int64_t now_us = esp_timer_get_time();
+    latency_stats_.Record(kAudioStageCodecRead, now_us - start_us);
+    last_read_us_ = now_us;
+#if CONFIG_USE_SERVER_AEC
+    server_aec_aligner_.OnCapture(data.size() / codec_->input_channels(), sample_rate, now_us);
+#endif
 
 #if CONFIG_USE_AUDIO_DEBUGGER
     // 音频调试：发送原始音频数据
-    if (audio_debugger_ == nullptr) {
-        audio_debugger_ = std::make_unique<AudioDebugger>();
-    }
-    audio_debugger_->Feed(data);
+    audio_debugger_->Feed(kAudioDebugTapMic, data, sample_rate, codec_->input_channels());
 #endif
 
     return true;
@@ -192,21 +293,35 @@ bool AudioService::ReadAudioData(std::vector<int16_t> &data, int sample_rate, in
 
 void AudioService::AudioInputTask() {
     while (true) {
-        EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
+        EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING |
+                                                   AS_EVENT_INPUT_PREWARM,
                                                pdFALSE, pdFALSE, portMAX_DELAY);
 
         if (service_stopped_) {
             break;
         }
+        if (bits & AS_EVENT_INPUT_PREWARM) {
+            /* Posted by PrewarmInput() */
+            xEventGroupClearBits(event_group_, AS_EVENT_INPUT_PREWARM);
+            EnableInputPower();
+            if (!(bits & (AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING))) {
+                continue;
+            }
+        }
         if (audio_input_need_warmup_) {
-            audio_input_need_warmup_ = false;
-            vTaskDelay(pdMS_TO_TICKS(120));
-            continue;
+            if (!(bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING)) {
+                /* Voice processing stopped before the input was ready */
+                audio_input_need_warmup_ = false;
+                input_warmup_start_us_ = 0;
+                input_prewarm_count_ = 0;
+            } else if (WarmUpInput()) {
+                continue;
+            }
         }
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.Size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
@@ -222,18 +337,17 @@ void AudioService::AudioInputTask() {
                     }
                     data = std::move(mono_data);
                 }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, data);
                 continue;
             }
         }
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    wake_word_->Feed(data);
+                if (ReadAudioData(input_buffer_, 16000, samples)) {
+                    wake_word_->Feed(input_buffer_);
                     continue;
                 }
             }
@@ -241,11 +355,12 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    audio_processor_->Feed(std::move(data));
+                if (ReadAudioData(input_buffer_, 16000, samples)) {
+                    int64_t start_us = esp_timer_get_time();
+                    audio_processor_->Feed(std::move(input_buffer_));
+                    uplink_cost_.Record(kUplinkCostProcess, esp_timer_get_time() - start_us, samples * 1000000LL / 16000);
                     continue;
                 }
             }
@@ -258,119 +373,375 @@ void AudioService::AudioInputTask() {
     ESP_LOGW(TAG, "Audio input task stopped");
 }
 
+/*
+ * A codec input that was just powered up needs AUDIO_INPUT_WARMUP_MS before its audio is usable.
+ * Instead of sleeping through that time, keep reading and hold on to the last
+ * AUDIO_INPUT_PREWARM_MS, which the processor gets ahead of the live audio. An input that has
+ * been running long enough (wake word detection, PrewarmInput) needs no warm-up at all.
+ * Returns true while warming up.
+ */
+bool AudioService::WarmUpInput() {
+    int64_t now_us = esp_timer_get_time();
+    if (input_warmup_start_us_ == 0) {
+        input_warmup_start_us_ = now_us;
+        input_prewarm_count_ = 0;
+    }
+
+    int64_t powered_ms = codec_->input_enabled() ? (now_us - input_enabled_us_) / 1000 : 0;
+    if (powered_ms >= AUDIO_INPUT_WARMUP_MS) {
+        int kept_ms = 0;
+        for (; input_prewarm_count_ > 0; input_prewarm_count_--) {
+            auto &slot = input_prewarm_[input_prewarm_head_];
+            input_prewarm_head_ = (input_prewarm_head_ + 1) % AUDIO_INPUT_PREWARM_SLOTS;
+            kept_ms += slot.size() / codec_->input_channels() / 16;
+            /* The processor takes its chunk over, the slot keeps its buffer for the next warm-up */
+            audio_processor_->Feed(std::vector<int16_t>(slot));
+        }
+        int waited_ms = (now_us - input_warmup_start_us_) / 1000;
+        int saved_ms = std::max(AUDIO_INPUT_WARMUP_MS - std::max(waited_ms - kept_ms, 0), 0);
+        debug_statistics_.warmup_saved_ms += saved_ms;
+        ESP_LOGI(TAG, "Input warm-up: waited %d ms, kept %d ms, %d ms less clipped", waited_ms, kept_ms, saved_ms);
+        audio_input_need_warmup_ = false;
+        input_warmup_start_us_ = 0;
+        return false;
+    }
+
+    int samples = audio_processor_->GetFeedSize();
+    /* Read into the slot after the newest one. With every slot in use that is the oldest, which is
+     * only given up once the read succeeded */
+    auto &slot = input_prewarm_[(input_prewarm_head_ + input_prewarm_count_) % AUDIO_INPUT_PREWARM_SLOTS];
+    if (samples <= 0 || !ReadAudioData(slot, 16000, samples)) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        return true;
+    }
+    /* Keep the newest chunks that fit in AUDIO_INPUT_PREWARM_MS */
+    size_t kept = std::min<size_t>(input_prewarm_count_ + 1, std::clamp(AUDIO_INPUT_PREWARM_MS * 16 / samples, 1, AUDIO_INPUT_PREWARM_SLOTS));
+    input_prewarm_head_ = (input_prewarm_head_ + input_prewarm_count_ + 1 - kept) % AUDIO_INPUT_PREWARM_SLOTS;
+    input_prewarm_count_ = kept;
+    return true;
+}
+
 void AudioService::AudioOutputTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        uint32_t popped = 0;
+        auto task = mixer_.Mix(popped);
+        if (popped & (1 << kAudioSourceStream)) {
+            xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_NOT_FULL);
+        }
+        if (popped & (1 << kAudioSourcePrompt)) {
+            xEventGroupSetBits(event_group_, AS_EVENT_PROMPT_NOT_FULL);
+        }
+        if (!task) {
+            if (!audio_decode_queue_.Empty()) {
+                debug_statistics_.decode_deadline_misses++;
+            }
+            xEventGroupWaitBits(event_group_, AS_EVENT_PLAYBACK_NOT_EMPTY, pdTRUE, pdFALSE, portMAX_DELAY);
+            continue;
+        }
 
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
             codec_->EnableOutput(true);
         }
+        int64_t start_us = esp_timer_get_time();
+        latency_stats_.Record(kAudioStagePlaybackQueue, start_us - task->queued_us);
         codec_->OutputData(task->pcm);
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
         debug_statistics_.playback_count++;
+        int64_t now_us = esp_timer_get_time();
+        latency_stats_.Record(kAudioStageCodecWrite, now_us - start_us);
+        if (task->origin_us > 0) {
+            latency_stats_.Record(kAudioStageDownlink, now_us - task->origin_us);
+        }
+#if CONFIG_USE_AUDIO_DEBUGGER
+        // After the output stage, exactly what the codec got
+        audio_debugger_->Feed(kAudioDebugTapPlayback, task->pcm, codec_->output_sample_rate());
+#endif
 
 #if CONFIG_USE_SERVER_AEC
-        /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
-        }
+        /* Every written sample moves the speaker timeline, the timestamped ones can be referenced */
+        server_aec_aligner_.OnPlayback(task->timestamp, task->pcm.size(), codec_->output_sample_rate(), now_us);
 #endif
     }
 
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
+TickType_t AudioService::GetDecodeWaitTicks() {
+    /* Wake up on our own when the jitter buffer is holding frames back */
+    if (audio_playback_queue_.CanPush()) {
+        int wait_ms = jitter_buffer_.GetWaitTimeMs(esp_timer_get_time() / 1000);
+        if (wait_ms >= 0) {
+            return std::max<TickType_t>(pdMS_TO_TICKS(wait_ms), 1);
+        }
+    }
+    return portMAX_DELAY;
+}
+
 void AudioService::OpusCodecTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                   (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                   (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
+        xEventGroupWaitBits(event_group_, AS_EVENT_ENCODE_NOT_EMPTY | AS_EVENT_DECODE_NOT_EMPTY | AS_EVENT_SEND_NOT_FULL | AS_EVENT_PLAYBACK_NOT_FULL | AS_EVENT_PROMPT_NOT_FULL,
+                            pdTRUE, pdFALSE, GetDecodeWaitTicks());
+
+        /* Keep working until neither direction can make progress, then wait for the next wakeup */
+        bool busy = true;
+        while (busy && !service_stopped_) {
+            bool decoded = DecodeNextFrame();
+            bool prompt_decoded = DecodePromptFrame();
+            bool encoded = EncodeNextFrame();
+            busy = decoded || prompt_decoded || encoded;
+        }
+
         if (service_stopped_) {
             break;
         }
+    }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
-
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
+    ESP_LOGW(TAG, "Opus codec task stopped");
+}
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
-            }
-            debug_statistics_.decode_count++;
-        }
-
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
-            }
+void AudioService::OpusDecodeTask() {
+    while (true) {
+        xEventGroupWaitBits(event_group_, AS_EVENT_DECODE_NOT_EMPTY | AS_EVENT_PLAYBACK_NOT_FULL | AS_EVENT_PROMPT_NOT_FULL, pdTRUE, pdFALSE,
+                            GetDecodeWaitTicks());
+        bool busy = true;
+        while (busy && !service_stopped_) {
+            bool decoded = DecodeNextFrame();
+            bool prompt_decoded = DecodePromptFrame();
+            busy = decoded || prompt_decoded;
+        }
+        if (service_stopped_) {
+            break;
+        }
+    }
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
-                }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
+    ESP_LOGW(TAG, "Opus decode task stopped");
+}
+
+void AudioService::OpusEncodeTask() {
+    while (true) {
+        xEventGroupWaitBits(event_group_, AS_EVENT_ENCODE_NOT_EMPTY | AS_EVENT_SEND_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
+        while (!service_stopped_ && EncodeNextFrame()) {
+        }
+        if (service_stopped_) {
+            break;
+        }
+    }
+
+    ESP_LOGW(TAG, "Opus encode task stopped");
+}
+
+bool AudioService::DecodeNextFrame() {
+    if (decoder_reset_pending_.exchange(false)) {
+        opus_decoder_->ResetState();
+    }
+    if (jitter_buffer_reset_pending_.exchange(false)) {
+        jitter_buffer_.Reset();
+    }
+    if (!audio_playback_queue_.CanPush()) {
+        return false;
+    }
+
+    /* Sequenced packets wait in the jitter buffer, the others are decoded in arrival order */
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    bool progress = false;
+    std::unique_ptr<AudioStreamPacket> packet;
+    while (!jitter_buffer_.Full()) {
+        packet = audio_decode_queue_.Pop();
+        if (!packet) {
+            break;
+        }
+        xEventGroupSetBits(event_group_, AS_EVENT_DECODE_NOT_FULL);
+        progress = true;
+        if (packet->sequence == 0) {
+            break;
+        }
+        jitter_buffer_.Push(std::move(packet), now_ms);
+    }
+
+    bool conceal = false;
+    if (!packet) {
+        conceal = jitter_buffer_.Pop(now_ms, packet) == kJitterBufferConceal;
+        if (!packet && !conceal) {
+            return progress;
+        }
+    }
+
+    auto task = std::make_unique<AudioTask>();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+
+    int64_t start_us = esp_timer_get_time();
+    bool decoded;
+    if (packet) {
+        latency_stats_.Record(kAudioStageDecodeQueue, start_us - packet->queued_us);
+        task->origin_us = packet->origin_us;
+        task->timestamp = packet->timestamp;
+        SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+        decoded = opus_decoder_->Decode(std::move(packet->payload), decode_buffer_);
+        if (!decoded) {
+            ESP_LOGE(TAG, "Failed to decode audio");
+        }
+    } else {
+        /* An empty payload makes Opus synthesize the lost frame from the decoder state (PLC) */
+        std::vector<uint8_t> lost;
+        decoded = opus_decoder_->Decode(std::move(lost), decode_buffer_);
+        debug_statistics_.conceal_count++;
+    }
+
+    if (decoded) {
+        // Resample if the sample rate is different
+        if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+            task->pcm.resize(output_resampler_.GetOutputSamples(decode_buffer_.size()));
+            output_resampler_.Process(decode_buffer_.data(), decode_buffer_.size(), task->pcm.data());
+        } else {
+            task->pcm.assign(decode_buffer_.begin(), decode_buffer_.end());
+        }
+        task->queued_us = esp_timer_get_time();
+        latency_stats_.Record(kAudioStageDecode, task->queued_us - start_us);
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugTapDecoded, task->pcm, codec_->output_sample_rate());
+#endif
+
+        if (audio_playback_queue_.TryPush(task)) {
+            xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_NOT_EMPTY);
+        }
+    }
+    debug_statistics_.decode_count++;
+    return true;
+}
+
+bool AudioService::DecodePromptFrame() {
+    if (!audio_prompt_queue_.CanPush()) {
+        return false;
+    }
+    auto packet = audio_prompt_decode_queue_.Pop();
+    if (!packet) {
+        return false;
+    }
+    xEventGroupSetBits(event_group_, AS_EVENT_PROMPT_DECODE_NOT_FULL);
+
+    if (!prompt_decoder_ || prompt_decoder_->sample_rate() != packet->sample_rate || prompt_decoder_->duration_ms() != packet->frame_duration) {
+        prompt_decoder_.reset();
+        prompt_decoder_ = std::make_unique<OpusDecoderWrapper>(packet->sample_rate, 1, packet->frame_duration);
+        if (packet->sample_rate != codec_->output_sample_rate()) {
+            prompt_resampler_.Configure(packet->sample_rate, codec_->output_sample_rate());
+        }
+    }
+
+    if (!prompt_decoder_->Decode(std::move(packet->payload), prompt_decode_buffer_)) {
+        ESP_LOGE(TAG, "Failed to decode sound");
+#if CONFIG_USE_SOUND_PCM_CACHE
+        SoundPcmCache::GetInstance().AbortFill(packet->sound_id);
+#endif
+        return true;
+    }
+
+    auto task = std::make_unique<AudioTask>();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    if (prompt_decoder_->sample_rate() != codec_->output_sample_rate()) {
+        task->pcm.resize(prompt_resampler_.GetOutputSamples(prompt_decode_buffer_.size()));
+        prompt_resampler_.Process(prompt_decode_buffer_.data(), prompt_decode_buffer_.size(), task->pcm.data());
+    } else {
+        task->pcm.assign(prompt_decode_buffer_.begin(), prompt_decode_buffer_.end());
+    }
+    task->queued_us = esp_timer_get_time();
+#if CONFIG_USE_SOUND_PCM_CACHE
+    if (packet->sound_id != 0) {
+        SoundPcmCache::GetInstance().Append(packet->sound_id, packet->sound_frame, task->pcm);
+    }
+#endif
+    PushTaskToPromptQueue(task, false);
+    return true;
+}
+
+bool AudioService::PushTaskToPromptQueue(std::unique_ptr<AudioTask> &task, bool wait) {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(prompt_producer_mutex_);
+            if (audio_prompt_queue_.TryPush(task)) {
+                break;
             }
-            debug_statistics_.encode_count++;
-            lock.lock();
         }
+        /* Wait without the lock, the prompt decoder must never block on a waiting sound */
+        if (!wait || service_stopped_) {
+            return false;
+        }
+        xEventGroupWaitBits(event_group_, AS_EVENT_PROMPT_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
+    }
+    xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_NOT_EMPTY);
+    return true;
+}
+
+bool AudioService::EncodeNextFrame() {
+    if (!audio_send_queue_.CanPush()) {
+        return false;
     }
+    auto task = audio_encode_queue_.Pop();
+    if (!task) {
+        return false;
+    }
+    xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_NOT_FULL);
+    int64_t start_us = esp_timer_get_time();
+    latency_stats_.Record(kAudioStageEncodeQueue, start_us - task->queued_us);
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    /* The processor output size changes with SetFrameDuration, the encoder takes any frame size */
+    int frame_duration = task->pcm.size() * 1000 / 16000;
+
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->frame_duration = frame_duration;
+    packet->sample_rate = 16000;
+    packet->timestamp = task->timestamp;
+    packet->origin_us = task->origin_us;
+    if (task->type == kAudioTaskTypeDtxToSendQueue) {
+        /* A TOC byte without frame data (SILK wideband, mono, one frame), decoders run PLC / comfort noise for it */
+        int config = 8 + (frame_duration >= 60 ? 3 : frame_duration >= 40 ? 2 : frame_duration >= 20 ? 1 : 0);
+        packet->payload.assign(1, config << 3);
+        packet->dtx = true;
+        packet->queued_us = esp_timer_get_time();
+        uplink_cost_.RecordPacket(packet->payload.size(), frame_duration);
+        audio_send_queue_.TryPush(packet);
+        if (callbacks_.on_send_queue_available) {
+            callbacks_.on_send_queue_available();
+        }
+        return true;
+    }
+    bool to_send = task->type == kAudioTaskTypeEncodeToSendQueue || task->type == kAudioTaskTypePrerollToSendQueue;
+    packet->preroll = task->type == kAudioTaskTypePrerollToSendQueue;
+    if (!opus_encoder_->Encode(task->pcm, packet->payload)) {
+        ESP_LOGE(TAG, "Failed to encode audio");
+        debug_statistics_.encode_failures++;
+        return true;
+    }
+    packet->queued_us = esp_timer_get_time();
+    latency_stats_.Record(kAudioStageEncode, packet->queued_us - start_us);
+    uplink_cost_.Record(kUplinkCostEncode, packet->queued_us - start_us, frame_duration * 1000);
+
+#if CONFIG_USE_OPUS_ENCODER_CONTROLLER
+    if (to_send &&
+        encoder_controller_.Update(packet->queued_us - start_us, frame_duration, audio_send_queue_.Size() * frame_duration)) {
+        ApplyEncoderSettings();
+        debug_statistics_.encoder_adjustments++;
+    }
+#endif
+
+    if (to_send) {
+        uplink_cost_.RecordPacket(packet->payload.size(), frame_duration);
+        audio_send_queue_.TryPush(packet);
+        if (callbacks_.on_send_queue_available) {
+            callbacks_.on_send_queue_available();
+        }
+    } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+        audio_testing_queue_.TryPush(packet);
+    }
+    debug_statistics_.encode_count++;
+    return true;
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -378,61 +749,136 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
         return;
     }
 
+    if (opus_decoder_->duration_ms() != frame_duration) {
+        audio_decode_queue_.SetLimit(MAX_DECODE_QUEUE_MS / frame_duration);
+        audio_playback_queue_.SetLimit(MAX_PLAYBACK_QUEUE_MS / frame_duration);
+    }
     opus_decoder_.reset();
     opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
 
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
-        output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
+    if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec_->output_sample_rate());
+        output_resampler_.Configure(opus_decoder_->sample_rate(), codec_->output_sample_rate());
     }
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t> &&pcm) {
+void AudioService::ApplyEncoderSettings() {
+#if CONFIG_USE_OPUS_ENCODER_CONTROLLER
+    auto &settings = encoder_controller_.settings();
+    opus_encoder_->SetComplexity(settings.complexity);
+    opus_encoder_->SetBitrate(settings.bitrate);
+    opus_encoder_->SetInbandFec(settings.fec, settings.loss_percent);
+#endif
+}
+
+void AudioService::ReportPacketLoss(int percent) {
+#if CONFIG_USE_OPUS_ENCODER_CONTROLLER
+    encoder_controller_.ReportLoss(percent);
+#endif
+}
+
+void AudioService::SetFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration %dms", frame_duration_ms);
+        return;
+    }
+    if (frame_duration_.exchange(frame_duration_ms) == frame_duration_ms) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Frame duration set to %dms", frame_duration_ms);
+    audio_encode_queue_.SetLimit(MAX_ENCODE_QUEUE_MS / frame_duration_ms);
+    audio_send_queue_.SetLimit(MAX_SEND_QUEUE_MS / frame_duration_ms);
+    if (audio_processor_) {
+        audio_processor_->SetFrameDuration(frame_duration_ms);
+    }
+}
+
+void AudioService::EnableDtx(bool enable) {
+#if CONFIG_USE_UPLINK_DTX
+    ESP_LOGI(TAG, "%s uplink DTX", enable ? "Enabling" : "Disabling");
+    uplink_dtx_.SetEnabled(enable);
+#endif
+}
+
+#if CONFIG_USE_UPLINK_DTX
+bool AudioService::SuppressSilentFrame(std::vector<int16_t> &pcm) {
+    int64_t origin_us = last_read_us_;
+    switch (uplink_dtx_.Process(pcm, origin_us, voice_detected_, esp_timer_get_time())) {
+    case kUplinkDtxSend:
+        return false;
+    case kUplinkDtxOnset: {
+        /* Speech started, send the frames the VAD needed to notice it, oldest first. Only as many as
+         * fit in the encode ring next to this frame, so the input task does not block on them */
+        size_t queued = audio_encode_queue_.Size();
+        size_t room = audio_encode_queue_.limit() > queued + 1 ? audio_encode_queue_.limit() - queued - 1 : 0;
+        while (uplink_dtx_.PopPreroll(room, dtx_preroll_buffer_, origin_us)) {
+            PushTaskToEncodeQueue(kAudioTaskTypePrerollToSendQueue, dtx_preroll_buffer_, origin_us);
+        }
+        return false;
+    }
+    case kUplinkDtxKeepalive:
+        PushTaskToEncodeQueue(kAudioTaskTypeDtxToSendQueue, pcm);
+        return true;
+    default:
+        return true;
+    }
+}
+#endif
+
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t> &pcm, int64_t origin_us) {
     auto task = std::make_unique<AudioTask>();
     task->type = type;
-    task->pcm = std::move(pcm);
+    /* Take the samples without copying, the caller gets the task's recycled buffer to refill */
+    task->pcm.swap(pcm);
+    task->origin_us = origin_us > 0 ? origin_us : last_read_us_.load();
+    task->queued_us = esp_timer_get_time();
+    /* The preroll waited for the VAD on purpose, it would only blur the processing latency */
+    if (task->origin_us > 0 && type != kAudioTaskTypePrerollToSendQueue) {
+        latency_stats_.Record(kAudioStageProcess, task->queued_us - task->origin_us);
+    }
 
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+#if CONFIG_USE_SERVER_AEC
+    /* If the task is to send queue, tell the server what the speaker played while it was captured */
+    if (type != kAudioTaskTypeEncodeToTestingQueue) {
+        task->timestamp = server_aec_aligner_.GetTimestamp(task->pcm.size());
+    }
+#endif
 
-    /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+    /* Push the task to the encode queue, waiting for the opus codec task to make room */
+    std::lock_guard<std::mutex> lock(encode_producer_mutex_);
+    while (!audio_encode_queue_.TryPush(task)) {
+        if (service_stopped_) {
+            return;
         }
-        timestamp_queue_.pop_front();
+        xEventGroupWaitBits(event_group_, AS_EVENT_ENCODE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
     }
-
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_NOT_EMPTY);
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+    packet->origin_us = packet->queued_us = esp_timer_get_time();
+    while (!audio_decode_queue_.TryPush(packet)) {
+        if (!wait || service_stopped_) {
             return false;
         }
+        xEventGroupWaitBits(event_group_, AS_EVENT_DECODE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    xEventGroupSetBits(event_group_, AS_EVENT_DECODE_NOT_EMPTY);
     return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
-        return nullptr;
+    auto packet = audio_send_queue_.Pop();
+    if (packet) {
+        xEventGroupSetBits(event_group_, AS_EVENT_SEND_NOT_FULL);
+        int64_t now_us = esp_timer_get_time();
+        latency_stats_.Record(kAudioStageSendQueue, now_us - packet->queued_us);
+        if (packet->origin_us > 0) {
+            latency_stats_.Record(kAudioStageUplink, now_us - packet->origin_us);
+        }
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
     return packet;
 }
 
@@ -480,7 +926,7 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, frame_duration_, models_list_);
             audio_processor_initialized_ = true;
         }
 
@@ -501,17 +947,23 @@ void AudioService::EnableAudioTesting(bool enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_, the replay may exceed the normal decode limit */
+        std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+        audio_decode_queue_.Clear();
+        while (auto packet = audio_testing_queue_.Pop()) {
+            if (!audio_decode_queue_.TryPush(packet, true)) {
+                break;
+            }
+        }
+        audio_testing_queue_.Clear();
+        xEventGroupSetBits(event_group_, AS_EVENT_DECODE_NOT_EMPTY);
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, frame_duration_, models_list_);
         audio_processor_initialized_ = true;
     }
 
@@ -528,119 +980,168 @@ void AudioService::PlaySound(const std::string_view &ogg) {
         codec_->EnableOutput(true);
     }
 
-    const uint8_t *buf = reinterpret_cast<const uint8_t *>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
-
-    // 查找函数
-    auto find_page = [&](size_t start) -> size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i + 1] == 'g' && buf[i + 2] == 'g' && buf[i + 3] == 'S')
-                return i;
-        }
-        return static_cast<size_t>(-1);
-    };
-
-    bool skip_first_two = true; // 跳过前两个页面
-    int audio_packets = 0;
-
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1))
-            break;
-
-        offset = pos;
-        if (offset + 27 > size)
-            break;
-
-        const uint8_t *page = buf + offset;
-        uint8_t page_segments = page[26];
-
-        // 获取段表
-        size_t seg_table_start = offset + 27;
-        if (seg_table_start + page_segments > size)
-            break;
-
-        // 计算数据区域
-        size_t data_start = seg_table_start + page_segments;
-
-        // 逐段提取Opus包
-        size_t segment_offset = data_start;
-        for (int i = 0; i < page_segments; i++) {
-            uint8_t segment_size = page[27 + i];
-
-            if (segment_size == 0)
-                continue; // 跳过空段
-
-            if (segment_offset + segment_size > size)
-                break;
+    auto index = sound_index_cache_.Get(ogg);
+    if (!index) {
+        ESP_LOGE(TAG, "Invalid sound data");
+        return;
+    }
 
-            // 跳过前两个页面的所有包
-            if (skip_first_two) {
-                segment_offset += segment_size;
-                continue;
-            }
+    // 只有开始之后的 StopPrompts 才中断这个声音
+    uint32_t generation = prompt_generation_.load();
+    uint32_t fill_id = 0;
+#if CONFIG_USE_SOUND_PCM_CACHE
+    auto pcm = SoundPcmCache::GetInstance().Lookup(ogg, *index, codec_->output_sample_rate(), fill_id);
+    if (pcm) {
+        PlayCachedSound(*pcm, generation);
+        return;
+    }
+#endif
 
-            // 检查中断
-            if (fbt_interrupt_playback_) {
-                fbt_interrupt_playback_ = false;
-                return;
-            }
+    for (size_t i = 0; i < index->packet_count(); i++) {
+        // 检查中断
+        if (prompt_generation_ != generation) {
+#if CONFIG_USE_SOUND_PCM_CACHE
+            SoundPcmCache::GetInstance().AbortFill(fill_id);
+#endif
+            return;
+        }
 
-            // 创建Opus包
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = 16000;
-            packet->frame_duration = 60;
-            packet->payload.resize(segment_size);
-            memcpy(packet->payload.data(), buf + segment_offset, segment_size);
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->sample_rate = index->sample_rate;
+        packet->frame_duration = index->frame_duration;
+        packet->sound_id = fill_id;
+        packet->sound_frame = i;
+        index->GetPacket(ogg, i, packet->payload);
 
-            if (!PushPacketToDecodeQueue(std::move(packet), true)) {
+        std::lock_guard<std::mutex> lock(prompt_decode_producer_mutex_);
+        while (!audio_prompt_decode_queue_.TryPush(packet)) {
+            if (service_stopped_ || prompt_generation_ != generation) {
                 ESP_LOGW(TAG, "推送失败");
+#if CONFIG_USE_SOUND_PCM_CACHE
+                SoundPcmCache::GetInstance().AbortFill(fill_id);
+#endif
                 return;
             }
-
-            audio_packets++;
-            segment_offset += segment_size;
+            xEventGroupWaitBits(event_group_, AS_EVENT_PROMPT_DECODE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
         }
+        xEventGroupSetBits(event_group_, AS_EVENT_DECODE_NOT_EMPTY);
+    }
+}
 
-        // 如果这是前两个页面，标记已跳过
-        if (skip_first_two) {
-            // 检查这是第几个页面
-            static int page_count = 0;
-            page_count++;
-            if (page_count >= 2) {
-                skip_first_two = false;
-            }
+void AudioService::PlayCachedSound(const SoundPcm &pcm, uint32_t generation) {
+    for (size_t offset = 0; offset < pcm.size; offset += pcm.frame_samples) {
+        // 检查中断
+        if (prompt_generation_ != generation) {
+            return;
         }
 
-        offset = segment_offset;
+        auto task = std::make_unique<AudioTask>();
+        task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+        task->pcm.assign(pcm.samples + offset, pcm.samples + std::min(offset + pcm.frame_samples, pcm.size));
+        task->queued_us = esp_timer_get_time();
+        if (!PushTaskToPromptQueue(task, true)) {
+            return;
+        }
     }
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.Empty() && audio_decode_queue_.Empty() && jitter_buffer_.Empty() && audio_playback_queue_.Empty() &&
+           audio_prompt_decode_queue_.Empty() && audio_prompt_queue_.Empty() && audio_testing_queue_.Empty();
+}
+
+void AudioService::ClearPlaybackQueues() {
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    mixer_.Drop(kAudioSourceStream);
+    jitter_buffer_reset_pending_ = true;
+    if (codec_ != nullptr) {
+        codec_->ResetOutputStage();
+    }
+    /* Let the consumers release the dropped frames and the producers retry */
+    xEventGroupSetBits(event_group_, AS_EVENT_DECODE_NOT_EMPTY | AS_EVENT_DECODE_NOT_FULL |
+                                         AS_EVENT_PLAYBACK_NOT_EMPTY | AS_EVENT_PLAYBACK_NOT_FULL);
+}
+
+void AudioService::StopPrompts() {
+    prompt_generation_++;
+    audio_prompt_decode_queue_.Clear();
+    audio_prompt_queue_.Clear();
+    mixer_.Drop(kAudioSourcePrompt);
+#if CONFIG_USE_SOUND_PCM_CACHE
+    SoundPcmCache::GetInstance().AbortFill();
+#endif
+    xEventGroupSetBits(event_group_, AS_EVENT_DECODE_NOT_EMPTY | AS_EVENT_PROMPT_DECODE_NOT_FULL | AS_EVENT_PLAYBACK_NOT_EMPTY |
+                                         AS_EVENT_PROMPT_NOT_FULL);
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    /* The codec task resets the decoder before its next frame, it may be decoding right now */
+    decoder_reset_pending_ = true;
+    audio_testing_queue_.Clear();
+    ClearPlaybackQueues();
+}
+
+void AudioService::EnableInputPower() {
+    std::lock_guard<std::mutex> lock(input_power_mutex_);
+    if (codec_->input_enabled()) {
+        return;
+    }
+    esp_timer_stop(audio_power_timer_);
+    esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
+    codec_->EnableInput(true);
+    input_enabled_us_ = esp_timer_get_time();
+}
+
+void AudioService::PrewarmInput() {
+    if (codec_ == nullptr || service_stopped_) {
+        return;
+    }
+    /* Counts as an input read for the power timeout, so the input stays clocked until it is used */
+    input_prewarm_us_ = esp_timer_get_time();
+    /* Powering the codec up takes a few register writes, the input task does it rather than the caller */
+    if (!codec_->input_enabled()) {
+        xEventGroupSetBits(event_group_, AS_EVENT_INPUT_PREWARM);
+    }
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
     auto now = std::chrono::steady_clock::now();
     auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
     auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
-    if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
+    auto prewarm_elapsed = (esp_timer_get_time() - input_prewarm_us_) / 1000;
+    if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && prewarm_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
+        std::lock_guard<std::mutex> lock(input_power_mutex_);
         codec_->EnableInput(false);
+        ESP_LOGI(TAG, "Read %lu input frames, input warm-up saved %lu ms of clipping, %lu encode failures", debug_statistics_.input_count,
+                 debug_statistics_.warmup_saved_ms, debug_statistics_.encode_failures);
+        cJSON *cost = uplink_cost_.ToJson();
+        char *cost_json = cJSON_PrintUnformatted(cost);
+        ESP_LOGI(TAG, "Uplink cost: %s", cost_json);
+        cJSON_free(cost_json);
+        cJSON_Delete(cost);
     }
     if (output_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->output_enabled()) {
         codec_->EnableOutput(false);
+        ESP_LOGI(TAG, "Decoded %lu frames (%lu concealed), %lu deadline misses, max decode %luus, max encode %luus",
+                 debug_statistics_.decode_count, debug_statistics_.conceal_count, debug_statistics_.decode_deadline_misses,
+                 latency_stats_.Get(kAudioStageDecode).max_us(), latency_stats_.Get(kAudioStageEncode).max_us());
+#if CONFIG_USE_OPUS_ENCODER_CONTROLLER
+        auto &encoder = encoder_controller_.settings();
+        auto &controller = encoder_controller_.statistics();
+        ESP_LOGI(TAG, "Encoder: complexity %d, bitrate %d, FEC %d, %lu adjustments (%lu complexity, %lu bitrate, %lu FEC), load %d%%",
+                 encoder.complexity, encoder.bitrate, encoder.fec, debug_statistics_.encoder_adjustments, controller.complexity_changes,
+                 controller.bitrate_changes, controller.fec_changes, controller.load_percent);
+#endif
+#if CONFIG_USE_UPLINK_DTX
+        ESP_LOGI(TAG, "Encoded %lu frames, %lu silent frames suppressed by DTX", debug_statistics_.encode_count,
+                 uplink_dtx_.suppressed_count());
+#endif
+#if CONFIG_USE_SERVER_AEC
+        auto aec = server_aec_aligner_.GetStatistics();
+        ESP_LOGI(TAG, "Server AEC: %lu frames aligned, %lu without reference, input drift %d ppm, output drift %d ppm", aec.aligned,
+                 aec.unaligned, aec.input_drift_ppm, aec.output_drift_ppm);
+#endif
     }
     if (!codec_->input_enabled() && !codec_->output_enabled()) {
         esp_timer_stop(audio_power_timer_);
@@ -648,12 +1149,8 @@ void AudioService::CheckAndUpdateAudioPowerState() {
 }
 
 void AudioService::FbtInterruptPlayback() {
-    fbt_interrupt_playback_ = true;
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    timestamp_queue_.clear();
-    audio_queue_cv_.notify_all();
+    StopPrompts();
+    ClearPlaybackQueues();
 }
 
 void AudioService::SetModelsList(srmodel_list_t *models_list) {
@@ -1,8 +1,9 @@
 #ifndef AUDIO_SERVICE_H
 #define AUDIO_SERVICE_H
 
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
 #include <deque>
 #include <memory>
 #include <mutex>
@@ -18,7 +19,18 @@
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
+#include "audio_frame_ring.h"
+#include "audio_latency.h"
+#include "uplink_cost.h"
+#include "audio_mixer.h"
 #include "audio_processor.h"
+#include "encoder_controller.h"
+#include "jitter_buffer.h"
+#include "ogg_demuxer.h"
+#include "server_aec_aligner.h"
+#include "sound_pcm_cache.h"
+#include "uplink_dtx.h"
+#include "uplink_encoder.h"
 #include "processors/audio_debugger.h"
 #include "protocol.h"
 #include "wake_word.h"
@@ -29,26 +41,61 @@
  * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
  *
  * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * With CONFIG_USE_AUDIO_SPLIT_CODEC_TASKS the encoder and decoder get a task each.
  *
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  *
+ * Every queue is a lock-free single-producer / single-consumer ring. Each ring has its own
+ * NOT_EMPTY / NOT_FULL bits in the event group, so a stage only wakes up the stages it feeds.
+ *
+ * Sequenced packets pass through a jitter buffer between the Decode Queue and the decoder, which
+ * reorders them and conceals lost frames.
+ *
+ * Sounds from PlaySound have their own decode context, so a prompt can play over a stream:
+ * 3. (PlaySound) -> {Prompt Decode Queue} -> [Prompt Decoder] -> {Prompt Queue} -> [Mixer] -> (Speaker)
+ * The mixer adds the Prompt Queue into the Playback Queue and ducks the stream meanwhile. With
+ * CONFIG_USE_SOUND_PCM_CACHE, sounds that are already decoded go straight to the Prompt Queue.
  */
 
+/*
+ * The uplink frame duration is chosen per session with SetFrameDuration(), the downlink follows the
+ * frame duration of the packets. Queue depths are kept in milliseconds, so the queues hold the same
+ * amount of audio whatever the frame size. Rings are sized for the shortest frames.
+ */
 #define OPUS_FRAME_DURATION_MS 60
-#define MAX_ENCODE_TASKS_IN_QUEUE 2
-#define MAX_PLAYBACK_TASKS_IN_QUEUE 2
-#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define OPUS_MIN_FRAME_DURATION_MS 20
+#define MAX_ENCODE_QUEUE_MS 120
+#define MAX_PLAYBACK_QUEUE_MS 120
+#define MAX_DECODE_QUEUE_MS 2400
+#define MAX_SEND_QUEUE_MS 2400
+#define MAX_PROMPT_PACKETS_IN_QUEUE 8
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
-#define MAX_TIMESTAMPS_IN_QUEUE 3
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
+// Time the codec input needs after power-up before the processor gets its audio, and how much of
+// the end of that time is kept and handed to the processor once it is over
+#define AUDIO_INPUT_WARMUP_MS 120
+#define AUDIO_INPUT_PREWARM_MS 60
+// Feed chunks of the shortest frames that make up AUDIO_INPUT_PREWARM_MS
+#define AUDIO_INPUT_PREWARM_SLOTS (AUDIO_INPUT_PREWARM_MS / OPUS_MIN_FRAME_DURATION_MS)
 
 #define AS_EVENT_AUDIO_TESTING_RUNNING (1 << 0)
 #define AS_EVENT_WAKE_WORD_RUNNING (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY (1 << 3)
+#define AS_EVENT_PLAYBACK_NOT_FULL (1 << 4)
+#define AS_EVENT_ENCODE_NOT_EMPTY (1 << 5)
+#define AS_EVENT_ENCODE_NOT_FULL (1 << 6)
+#define AS_EVENT_DECODE_NOT_EMPTY (1 << 7)
+#define AS_EVENT_DECODE_NOT_FULL (1 << 8)
+#define AS_EVENT_SEND_NOT_FULL (1 << 9)
+#define AS_EVENT_PROMPT_NOT_FULL (1 << 10)
+#define AS_EVENT_PROMPT_DECODE_NOT_FULL (1 << 11)
+#define AS_EVENT_INPUT_PREWARM (1 << 12)
+#define AS_EVENT_ALL_QUEUES (AS_EVENT_PLAYBACK_NOT_EMPTY | AS_EVENT_PLAYBACK_NOT_FULL | AS_EVENT_ENCODE_NOT_EMPTY | AS_EVENT_ENCODE_NOT_FULL | \
+                             AS_EVENT_DECODE_NOT_EMPTY | AS_EVENT_DECODE_NOT_FULL | AS_EVENT_SEND_NOT_FULL | AS_EVENT_PROMPT_NOT_FULL |   \
+                             AS_EVENT_PROMPT_DECODE_NOT_FULL)
 
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
@@ -60,20 +107,43 @@ struct AudioServiceCallbacks {
 enum AudioTaskType {
     kAudioTaskTypeEncodeToSendQueue,
     kAudioTaskTypeEncodeToTestingQueue,
+    kAudioTaskTypeDtxToSendQueue,
+    // Silence from before speech onset, encoded and sent marked as preroll
+    kAudioTaskTypePrerollToSendQueue,
     kAudioTaskTypeDecodeToPlaybackQueue,
 };
 
+/* Tasks and their pcm buffers are recycled by AudioPool, see audio_pool.h */
 struct AudioTask {
+    AudioTask();
+    ~AudioTask();
+    AudioTask(const AudioTask &) = delete;
+    AudioTask &operator=(const AudioTask &) = delete;
+
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+
     AudioTaskType type;
     std::vector<int16_t> pcm;
-    uint32_t timestamp;
+    uint32_t timestamp = 0;
+    // When the frame entered the device and its current queue, see audio_latency.h
+    int64_t origin_us = 0;
+    int64_t queued_us = 0;
 };
 
 struct DebugStatistics {
     uint32_t input_count = 0;
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
+    uint32_t encode_failures = 0;
     uint32_t playback_count = 0;
+    uint32_t conceal_count = 0;
+    // The speaker ran dry while packets were still waiting in the decode queue
+    uint32_t decode_deadline_misses = 0;
+    uint32_t encoder_adjustments = 0;
+    // Silent uplink frames that were neither encoded nor sent
+    // Audio at the start of voice processing that the input warm-up no longer discards
+    uint32_t warmup_saved_ms = 0;
 };
 
 class AudioService {
@@ -95,8 +165,18 @@ class AudioService {
 
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
+    /* Speech is likely soon (wake word, push-to-talk press): have the input task power the input up
+     * and keep it clocked. Cheap enough for a touch or wake word callback */
+    void PrewarmInput();
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    /* Stop encoding and sending silent uplink frames while the VAD reports silence, for transports whose receiver conceals the gap */
+    void EnableDtx(bool enable);
+    /* Uplink loss rate reported by the transport, in percent, drives the encoder controller */
+    void ReportPacketLoss(int percent);
+    /* Uplink frame duration (20, 40 or 60ms), advertised in the hello / offer of the next session */
+    void SetFrameDuration(int frame_duration_ms);
+    int frame_duration() const { return frame_duration_; }
 
     void SetCallbacks(AudioServiceCallbacks &callbacks);
 
@@ -108,21 +188,63 @@ class AudioService {
     void SetModelsList(srmodel_list_t *models_list);
 
     void FbtInterruptPlayback();
+    /* Stop the sounds from PlaySound, the stream keeps playing */
+    void StopPrompts();
+    /* Gain of a playback source in percent, applied by the mixer */
+    void SetSourceGain(AudioMixerSource source, int gain) { mixer_.SetGain(source, gain); }
 
     bool WaitForPlayCompletion(int timeout_ms);
 
+    AudioLatencyStats &GetLatencyStats() { return latency_stats_; }
+    const DebugStatistics &GetDebugStatistics() const { return debug_statistics_; }
+    UplinkCostMeter &GetUplinkCost() { return uplink_cost_; }
+
   private:
     AudioCodec *codec_ = nullptr;
     AudioServiceCallbacks callbacks_;
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
+    std::unique_ptr<UplinkEncoder> opus_encoder_;
+    // Owned by the opus codec task like the jitter buffer, other tasks only request a reset
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    std::atomic<bool> decoder_reset_pending_{false};
+    // Decode context of PlaySound, created with the first sound
+    std::unique_ptr<OpusDecoderWrapper> prompt_decoder_;
+    OpusResampler prompt_resampler_;
+    std::vector<int16_t> prompt_decode_buffer_;
+    AudioMixer mixer_;
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
+    // Scratch buffers for ReadAudioData, they share the input resamplers' single-reader rule.
+    // Channels are stored back to back: [mic | reference]
+    std::vector<int16_t> input_split_buffer_;
+    std::vector<int16_t> input_resampled_buffer_;
+    // Owned by the input task. The processor hands it on to the encode queue, which swaps in a
+    // recycled buffer, so reading a frame does not allocate
+    std::vector<int16_t> input_buffer_;
+    // Scratch buffer owned by the opus codec task, keeps its capacity between frames
+    std::vector<int16_t> decode_buffer_;
+    // Owned by the opus codec task, other tasks only request a reset
+    JitterBuffer jitter_buffer_;
+    std::atomic<bool> jitter_buffer_reset_pending_{false};
     DebugStatistics debug_statistics_;
+    AudioLatencyStats latency_stats_;
+    UplinkCostMeter uplink_cost_;
+    // Completion time of the last mic read, the origin of the frames the processors emit
+    std::atomic<int64_t> last_read_us_{0};
+    OggOpusIndexCache sound_index_cache_;
+    std::atomic<int> frame_duration_{OPUS_FRAME_DURATION_MS};
+#if CONFIG_USE_UPLINK_DTX
+    UplinkDtx uplink_dtx_;
+    // Owned by the processor output callback, the preroll frame being pushed
+    std::vector<int16_t> dtx_preroll_buffer_;
+#endif
+#if CONFIG_USE_OPUS_ENCODER_CONTROLLER
+    // Owned by the encode task
+    EncoderController encoder_controller_;
+#endif
     srmodel_list_t *models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
@@ -131,34 +253,67 @@ class AudioService {
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
     TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
-    // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    TaskHandle_t opus_decode_task_handle_ = nullptr;
+    TaskHandle_t opus_encode_task_handle_ = nullptr;
+    AudioFrameRing<AudioStreamPacket> audio_decode_queue_;
+    AudioFrameRing<AudioStreamPacket> audio_send_queue_;
+    AudioFrameRing<AudioStreamPacket> audio_testing_queue_;
+    AudioFrameRing<AudioTask> audio_encode_queue_;
+    AudioFrameRing<AudioTask> audio_playback_queue_;
+    AudioFrameRing<AudioStreamPacket> audio_prompt_decode_queue_;
+    AudioFrameRing<AudioTask> audio_prompt_queue_;
+    // The decode and encode queues have more than one producer task
+    std::mutex decode_producer_mutex_;
+    std::mutex encode_producer_mutex_;
+    std::mutex prompt_decode_producer_mutex_;
+    // The prompt decoder and cached sounds both feed the Prompt Queue
+    std::mutex prompt_producer_mutex_;
+#if CONFIG_USE_SERVER_AEC
+    ServerAecAligner server_aec_aligner_;
+#endif
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    // Tail of the input warm-up, fed to the processor when it is over. The slots are reserved in
+    // Initialize() and read into in place, oldest at input_prewarm_head_
+    std::array<std::vector<int16_t>, AUDIO_INPUT_PREWARM_SLOTS> input_prewarm_;
+    size_t input_prewarm_head_ = 0;
+    size_t input_prewarm_count_ = 0;
+    int64_t input_warmup_start_us_ = 0;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
+    std::mutex input_power_mutex_;
+    std::atomic<int64_t> input_enabled_us_{0};
+    std::atomic<int64_t> input_prewarm_us_{0};
     std::chrono::steady_clock::time_point last_input_time_;
     std::chrono::steady_clock::time_point last_output_time_;
 
     void AudioInputTask();
     void AudioOutputTask();
     void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t> &&pcm);
+    void OpusDecodeTask();
+    void OpusEncodeTask();
+    TickType_t GetDecodeWaitTicks();
+    bool DecodeNextFrame();
+    bool DecodePromptFrame();
+    bool PushTaskToPromptQueue(std::unique_ptr<AudioTask> &task, bool wait);
+    bool EncodeNextFrame();
+    /* `origin_us` is the capture time of the frame, 0 for the last mic read */
+    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t> &pcm, int64_t origin_us = 0);
+    bool SuppressSilentFrame(std::vector<int16_t> &pcm);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    void ApplyEncoderSettings();
     void CheckAndUpdateAudioPowerState();
+    void EnableInputPower();
+    bool WarmUpInput();
+    void ClearPlaybackQueues();
+    void PlayCachedSound(const SoundPcm &pcm, uint32_t generation);
 
-    bool fbt_interrupt_playback_;
+    // StopPrompts bumps it, a PlaySound that started under an older value stops
+    std::atomic<uint32_t> prompt_generation_{0};
 };
 
 #endif
\ No newline at end of file
@@ -15,6 +15,7 @@ protected:
     virtual int Read(int16_t* dest, int samples) override;
 
 public:
+    NoAudioCodec();
     virtual ~NoAudioCodec();
 };
 
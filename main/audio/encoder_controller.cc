@@ -0,0 +1,83 @@
+#include "encoder_controller.h"
+
+#include <algorithm>
+#include <esp_log.h>
+
+#define TAG "EncoderController"
+
+/* Kconfig ranges keep these in order, a hand-edited sdkconfig may not */
+static_assert(CONFIG_OPUS_ENCODER_COMPLEXITY_MIN <= CONFIG_OPUS_ENCODER_COMPLEXITY_MAX,
+              "CONFIG_OPUS_ENCODER_COMPLEXITY_MIN is above CONFIG_OPUS_ENCODER_COMPLEXITY_MAX");
+static_assert(CONFIG_OPUS_ENCODER_BITRATE_MIN_KBPS <= CONFIG_OPUS_ENCODER_BITRATE_MAX_KBPS,
+              "CONFIG_OPUS_ENCODER_BITRATE_MIN_KBPS is above CONFIG_OPUS_ENCODER_BITRATE_MAX_KBPS");
+
+EncoderController::EncoderController() {
+    settings_.complexity = CONFIG_OPUS_ENCODER_COMPLEXITY_MIN;
+    settings_.bitrate = CONFIG_OPUS_ENCODER_BITRATE_MAX_KBPS * 1000;
+}
+
+void EncoderController::ReportLoss(int percent) {
+    reported_loss_ = std::clamp(percent, 0, 100);
+}
+
+bool EncoderController::Update(int encode_us, int frame_duration_ms, int backlog_ms) {
+    encode_us_ += encode_us;
+    elapsed_ms_ += frame_duration_ms;
+    max_backlog_ms_ = std::max(max_backlog_ms_, backlog_ms);
+    if (elapsed_ms_ < ENCODER_CONTROLLER_INTERVAL_MS) {
+        return false;
+    }
+
+    int load = encode_us_ / (elapsed_ms_ * 10);
+    int backlog = max_backlog_ms_;
+    encode_us_ = 0;
+    elapsed_ms_ = 0;
+    max_backlog_ms_ = 0;
+
+    /* Without a fresh report the last loss rate fades out */
+    int reported = reported_loss_.exchange(-1);
+    loss_percent_ = reported >= 0 ? reported : loss_percent_ / 2;
+    bool congested = backlog >= ENCODER_CONTROLLER_BACKLOG_MS || loss_percent_ >= ENCODER_CONTROLLER_HIGH_LOSS;
+
+    EncoderSettings settings = settings_;
+    if (load > ENCODER_CONTROLLER_LOAD_HIGH) {
+        settings.complexity = std::max(settings.complexity - 1, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN);
+    } else if (load < ENCODER_CONTROLLER_LOAD_LOW && !congested) {
+        settings.complexity = std::min(settings.complexity + 1, CONFIG_OPUS_ENCODER_COMPLEXITY_MAX);
+    }
+
+    if (congested) {
+        settings.bitrate = std::max(settings.bitrate * 3 / 4, CONFIG_OPUS_ENCODER_BITRATE_MIN_KBPS * 1000);
+    } else if (backlog <= frame_duration_ms && loss_percent_ < ENCODER_CONTROLLER_FEC_LOSS) {
+        settings.bitrate = std::min(settings.bitrate + ENCODER_CONTROLLER_BITRATE_STEP, CONFIG_OPUS_ENCODER_BITRATE_MAX_KBPS * 1000);
+    }
+
+#if CONFIG_OPUS_ENCODER_ENABLE_FEC
+    settings.fec = loss_percent_ >= ENCODER_CONTROLLER_FEC_LOSS || (settings.fec && loss_percent_ > 0);
+    settings.loss_percent = loss_percent_;
+#endif
+
+    statistics_.load_percent = load;
+    statistics_.backlog_ms = backlog;
+    statistics_.loss_percent = loss_percent_;
+    bool changed = false;
+    if (settings.complexity != settings_.complexity) {
+        statistics_.complexity_changes++;
+        changed = true;
+    }
+    if (settings.bitrate != settings_.bitrate) {
+        statistics_.bitrate_changes++;
+        changed = true;
+    }
+    if (settings.fec != settings_.fec) {
+        statistics_.fec_changes++;
+        changed = true;
+    }
+    changed = changed || settings.loss_percent != settings_.loss_percent;
+    if (changed) {
+        ESP_LOGI(TAG, "Complexity %d, bitrate %d, FEC %d (load %d%%, backlog %dms, loss %d%%)", settings.complexity, settings.bitrate,
+                 settings.fec, load, backlog, loss_percent_);
+    }
+    settings_ = settings;
+    return changed;
+}
@@ -0,0 +1,71 @@
+#ifndef ENCODER_CONTROLLER_H
+#define ENCODER_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Picks the uplink Opus complexity, bitrate and in-band FEC from what the encode task observes.
+ *
+ * Every frame reports its encode time and the send queue backlog. Once per interval:
+ * - complexity steps down when encoding takes too large a share of the frame time, and back up when
+ *   the CPU is idle and the network keeps up;
+ * - bitrate backs off multiplicatively while the send queue backs up or the transport reports heavy
+ *   loss, and grows additively while the queue stays drained;
+ * - FEC is turned on while the transport reports loss, and the loss rate is passed to the encoder.
+ * All values stay within the CONFIG_OPUS_ENCODER_* bounds.
+ *
+ * Update() belongs to the encode task. ReportLoss() may be called from any task.
+ */
+
+#define ENCODER_CONTROLLER_INTERVAL_MS 1000
+// Share of the frame time spent encoding (percent) above / below which complexity moves
+#define ENCODER_CONTROLLER_LOAD_HIGH 40
+#define ENCODER_CONTROLLER_LOAD_LOW 15
+// A send queue holding more audio than this means the network does not keep up
+#define ENCODER_CONTROLLER_BACKLOG_MS 240
+#define ENCODER_CONTROLLER_FEC_LOSS 2
+#define ENCODER_CONTROLLER_HIGH_LOSS 10
+#define ENCODER_CONTROLLER_BITRATE_STEP 2000
+
+struct EncoderSettings {
+    int complexity = 0;
+    int bitrate = 0;
+    bool fec = false;
+    int loss_percent = 0;
+};
+
+struct EncoderControllerStatistics {
+    int load_percent = 0;
+    int backlog_ms = 0;
+    int loss_percent = 0;
+    uint32_t complexity_changes = 0;
+    uint32_t bitrate_changes = 0;
+    uint32_t fec_changes = 0;
+};
+
+class EncoderController {
+  public:
+    EncoderController();
+
+    /* Loss rate seen by the receiver, in percent */
+    void ReportLoss(int percent);
+    /* Returns true when settings() changed and must be applied to the encoder */
+    bool Update(int encode_us, int frame_duration_ms, int backlog_ms);
+
+    const EncoderSettings &settings() const { return settings_; }
+    const EncoderControllerStatistics &statistics() const { return statistics_; }
+
+  private:
+    EncoderSettings settings_;
+    EncoderControllerStatistics statistics_;
+    std::atomic<int> reported_loss_{-1};
+    int loss_percent_ = 0;
+
+    // The current interval
+    int64_t encode_us_ = 0;
+    int elapsed_ms_ = 0;
+    int max_backlog_ms_ = 0;
+};
+
+#endif // ENCODER_CONTROLLER_H
@@ -0,0 +1,194 @@
+#include "jitter_buffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <esp_log.h>
+
+#define TAG "JitterBuffer"
+
+JitterBuffer::JitterBuffer() {
+    statistics_.target_depth = target_depth_;
+}
+
+void JitterBuffer::Flush() {
+    for (auto &slot : slots_) {
+        slot.reset();
+    }
+    count_ = 0;
+    started_ = false;
+    playing_ = false;
+    consecutive_concealed_ = 0;
+    gap_start_ms_ = -1;
+    has_transit_ = false;
+}
+
+void JitterBuffer::Reset() {
+    if (statistics_.received > 0) {
+        ESP_LOGI(TAG, "received: %lu, late: %lu, duplicate: %lu, reordered: %lu, concealed: %lu, skipped: %lu, compressed: %lu, underruns: %lu, jitter: %dms, depth: %d",
+                 statistics_.received, statistics_.late, statistics_.duplicate, statistics_.reordered, statistics_.concealed,
+                 statistics_.skipped, statistics_.compressed, statistics_.underruns, statistics_.jitter_ms, statistics_.target_depth);
+    }
+    Flush();
+    jitter_q4_ = 0;
+    target_depth_ = JITTER_BUFFER_MIN_DEPTH;
+    statistics_ = JitterBufferStatistics();
+    statistics_.target_depth = target_depth_;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t sequence, int64_t now_ms) {
+    /* Sequence numbers are frame indexes, so the expected send time is sequence * frame duration */
+    int64_t transit = now_ms - (int64_t)sequence * frame_duration_;
+    if (has_transit_) {
+        int d = (int)std::min<int64_t>(std::llabs(transit - last_transit_ms_), 1000);
+        jitter_q4_ += d - (jitter_q4_ + 8) / 16;
+    }
+    last_transit_ms_ = transit;
+    has_transit_ = true;
+
+    int jitter_ms = jitter_q4_ / 16;
+    int depth = 1 + (2 * jitter_ms + frame_duration_ - 1) / frame_duration_;
+    target_depth_ = std::clamp(depth, JITTER_BUFFER_MIN_DEPTH, JITTER_BUFFER_MAX_DEPTH);
+    statistics_.jitter_ms = jitter_ms;
+    statistics_.target_depth = target_depth_;
+}
+
+bool JitterBuffer::Push(std::unique_ptr<AudioStreamPacket> packet, int64_t now_ms) {
+    uint32_t sequence = packet->sequence;
+    if (packet->frame_duration > 0) {
+        frame_duration_ = packet->frame_duration;
+    }
+    statistics_.received++;
+
+    if (!started_) {
+        started_ = true;
+        next_sequence_ = sequence;
+        highest_sequence_ = sequence;
+    }
+
+    int32_t offset = (int32_t)(sequence - next_sequence_);
+    if (offset < 0 && offset > -JITTER_BUFFER_CAPACITY) {
+        /* Before playback starts an earlier packet simply moves the start back */
+        if (!playing_ && (int32_t)(highest_sequence_ - sequence) < JITTER_BUFFER_CAPACITY) {
+            next_sequence_ = sequence;
+        } else {
+            statistics_.late++;
+            return false;
+        }
+    } else if (offset < 0 || offset >= JITTER_BUFFER_CAPACITY) {
+        /* The stream jumped (e.g. the peer restarted its counter), start over from this packet */
+        ESP_LOGW(TAG, "Sequence jumped from %lu to %lu, resyncing", next_sequence_, sequence);
+        statistics_.resyncs++;
+        Flush();
+        started_ = true;
+        next_sequence_ = sequence;
+        highest_sequence_ = sequence;
+    }
+
+    auto &slot = Slot(sequence);
+    if (slot) {
+        statistics_.duplicate++;
+        return false;
+    }
+
+    if ((int32_t)(sequence - highest_sequence_) >= 0) {
+        UpdateJitter(sequence, now_ms);
+        highest_sequence_ = sequence;
+    } else {
+        statistics_.reordered++;
+    }
+
+    if (!playing_ && count_ == 0) {
+        prebuffer_start_ms_ = now_ms;
+    }
+    slot = std::move(packet);
+    count_++;
+    return true;
+}
+
+bool JitterBuffer::SkipToNextPacket() {
+    if (count_ == 0) {
+        return false;
+    }
+    while (!Slot(next_sequence_)) {
+        next_sequence_++;
+        statistics_.skipped++;
+    }
+    consecutive_concealed_ = 0;
+    return true;
+}
+
+JitterBufferResult JitterBuffer::Pop(int64_t now_ms, std::unique_ptr<AudioStreamPacket> &packet) {
+    if (!playing_) {
+        if (count_ == 0) {
+            return kJitterBufferWait;
+        }
+        if ((int)count_ < target_depth_ && now_ms - prebuffer_start_ms_ < (int64_t)target_depth_ * frame_duration_) {
+            return kJitterBufferWait;
+        }
+        /* Never conceal before the first frame, start from the oldest packet we have */
+        playing_ = true;
+        SkipToNextPacket();
+    }
+
+    while (Slot(next_sequence_) && Slot(next_sequence_)->preroll && (int)count_ > target_depth_) {
+        Slot(next_sequence_).reset();
+        count_--;
+        next_sequence_++;
+        statistics_.compressed++;
+    }
+
+    if (!Slot(next_sequence_)) {
+        if (gap_start_ms_ < 0) {
+            gap_start_ms_ = now_ms;
+        }
+        int64_t waited_ms = now_ms - gap_start_ms_;
+        if (count_ == 0) {
+            return kJitterBufferWait;
+        }
+        if (waited_ms >= StallTimeMs()) {
+            /* The stream stopped for a while (end of a sentence, network stall), prebuffer again
+             * instead of concealing silence that has already passed */
+            statistics_.underruns++;
+            playing_ = false;
+            gap_start_ms_ = -1;
+            prebuffer_start_ms_ = now_ms;
+            return Pop(now_ms, packet);
+        }
+        /* Wait for a late packet while less than the target depth of later audio is buffered */
+        if ((int)count_ < target_depth_ && waited_ms < (int64_t)target_depth_ * frame_duration_) {
+            return kJitterBufferWait;
+        }
+        gap_start_ms_ = -1;
+
+        if (consecutive_concealed_ < JITTER_BUFFER_MAX_CONCEAL_FRAMES) {
+            consecutive_concealed_++;
+            next_sequence_++;
+            statistics_.concealed++;
+            return kJitterBufferConceal;
+        }
+        SkipToNextPacket();
+    }
+
+    packet = std::move(Slot(next_sequence_));
+    count_--;
+    next_sequence_++;
+    consecutive_concealed_ = 0;
+    gap_start_ms_ = -1;
+    return kJitterBufferFrame;
+}
+
+int JitterBuffer::GetWaitTimeMs(int64_t now_ms) const {
+    if (count_ == 0) {
+        return -1;
+    }
+    int64_t deadline = now_ms;
+    if (!playing_) {
+        if ((int)count_ < target_depth_) {
+            deadline = prebuffer_start_ms_ + (int64_t)target_depth_ * frame_duration_;
+        }
+    } else if (!slots_[next_sequence_ % JITTER_BUFFER_CAPACITY] && gap_start_ms_ >= 0 && (int)count_ < target_depth_ &&
+               now_ms - gap_start_ms_ < StallTimeMs()) {
+        deadline = gap_start_ms_ + (int64_t)target_depth_ * frame_duration_;
+    }
+    return (int)std::max<int64_t>(deadline - now_ms, 0);
+}
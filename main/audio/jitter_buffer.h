@@ -0,0 +1,93 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "protocol.h"
+
+/*
+ * Reorders sequenced downlink packets in front of the Opus decoder.
+ *
+ * Packets are slotted by sequence number. Playback starts once the buffer holds the target depth
+ * (or the first packet has waited that long), and the target depth follows the measured arrival
+ * jitter. When the next frame is missing and enough later audio is buffered, the caller is told to
+ * conceal the frame with Opus PLC instead of skipping it. Preroll packets (silence the sender
+ * resent late at speech onset) are dropped while more than the target depth is buffered, so they
+ * do not add to the playout delay.
+ *
+ * Only the opus codec task touches the buffer, so it has no locking of its own.
+ */
+
+#define JITTER_BUFFER_CAPACITY 32
+#define JITTER_BUFFER_MIN_DEPTH 1
+#define JITTER_BUFFER_MAX_DEPTH 8
+// Longer gaps are skipped instead of concealed, Opus PLC fades to silence after a few frames anyway
+#define JITTER_BUFFER_MAX_CONCEAL_FRAMES 3
+
+enum JitterBufferResult {
+    kJitterBufferWait,
+    kJitterBufferFrame,
+    kJitterBufferConceal,
+};
+
+struct JitterBufferStatistics {
+    uint32_t received = 0;
+    uint32_t late = 0;
+    uint32_t duplicate = 0;
+    uint32_t reordered = 0;
+    uint32_t concealed = 0;
+    uint32_t skipped = 0;
+    uint32_t compressed = 0;
+    uint32_t underruns = 0;
+    uint32_t resyncs = 0;
+    int jitter_ms = 0;
+    int target_depth = 0;
+};
+
+class JitterBuffer {
+  public:
+    JitterBuffer();
+
+    void Reset();
+    /* Returns false when the packet is dropped as late or duplicate */
+    bool Push(std::unique_ptr<AudioStreamPacket> packet, int64_t now_ms);
+    /* `packet` is only set for kJitterBufferFrame */
+    JitterBufferResult Pop(int64_t now_ms, std::unique_ptr<AudioStreamPacket> &packet);
+    /* Milliseconds until Pop() may make progress without new packets, -1 if it never will */
+    int GetWaitTimeMs(int64_t now_ms) const;
+
+    bool Full() const { return count_ >= JITTER_BUFFER_MAX_DEPTH; }
+    bool Empty() const { return count_ == 0; }
+    const JitterBufferStatistics &statistics() const { return statistics_; }
+
+  private:
+    std::unique_ptr<AudioStreamPacket> slots_[JITTER_BUFFER_CAPACITY];
+    size_t count_ = 0;
+    bool started_ = false;
+    bool playing_ = false;
+    uint32_t next_sequence_ = 0;
+    uint32_t highest_sequence_ = 0;
+    int frame_duration_ = 60;
+    int consecutive_concealed_ = 0;
+    int64_t prebuffer_start_ms_ = 0;
+    int64_t gap_start_ms_ = -1;
+
+    // RFC 3550 style interarrival jitter, in 1/16 ms
+    int64_t last_transit_ms_ = 0;
+    bool has_transit_ = false;
+    int jitter_q4_ = 0;
+    int target_depth_ = JITTER_BUFFER_MIN_DEPTH;
+
+    JitterBufferStatistics statistics_;
+
+    std::unique_ptr<AudioStreamPacket> &Slot(uint32_t sequence) { return slots_[sequence % JITTER_BUFFER_CAPACITY]; }
+    /* A gap longer than this is a stalled stream rather than lost packets */
+    int64_t StallTimeMs() const { return (int64_t)(JITTER_BUFFER_MAX_CONCEAL_FRAMES + target_depth_) * frame_duration_; }
+    void Flush();
+    void UpdateJitter(uint32_t sequence, int64_t now_ms);
+    bool SkipToNextPacket();
+};
+
+#endif // JITTER_BUFFER_H
@@ -0,0 +1,209 @@
+#include "ogg_demuxer.h"
+
+#include <cstring>
+#include <esp_log.h>
+
+#define TAG "OggDemuxer"
+
+#define OGG_HEADER_CONTINUED 0x01
+
+static uint32_t ReadLe32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void OggOpusIndex::GetPacket(std::string_view ogg, size_t i, std::vector<uint8_t> &payload) const {
+    uint32_t first = i == 0 ? 0 : packet_ends[i - 1];
+    uint32_t last = packet_ends[i];
+    size_t size = 0;
+    for (uint32_t s = first; s < last; s++) {
+        size += spans[s].size;
+    }
+    payload.resize(size);
+    uint8_t *dst = payload.data();
+    for (uint32_t s = first; s < last; s++) {
+        memcpy(dst, ogg.data() + spans[s].offset, spans[s].size);
+        dst += spans[s].size;
+    }
+}
+
+int OggDemuxer::GetPacketDuration(const uint8_t *packet, size_t size) {
+    /* Frame size from the TOC byte (RFC 6716 section 3.1), in 48kHz samples */
+    uint8_t config = packet[0] >> 3;
+    int frame_samples;
+    if (config < 12) {
+        static const int silk_samples[] = {480, 960, 1920, 2880};
+        frame_samples = silk_samples[config & 3];
+    } else if (config < 16) {
+        frame_samples = (config & 1) ? 960 : 480;
+    } else {
+        frame_samples = 120 << (config & 3);
+    }
+
+    int frames;
+    switch (packet[0] & 3) {
+    case 0:
+        frames = 1;
+        break;
+    case 1:
+    case 2:
+        frames = 2;
+        break;
+    default:
+        frames = size > 1 ? (packet[1] & 0x3f) : 0;
+        break;
+    }
+    return frame_samples * frames / 48;
+}
+
+bool OggDemuxer::BuildIndex(std::string_view ogg, OggOpusIndex &index) {
+    const uint8_t *buf = reinterpret_cast<const uint8_t *>(ogg.data());
+    size_t size = ogg.size();
+    size_t offset = 0;
+    bool has_serial = false;
+    uint32_t serial = 0;
+    int header_packets = 0;
+    // Spans of the packet being assembled start here, a packet may continue on the next page
+    size_t packet_start = 0;
+
+    index = OggOpusIndex();
+
+    /* Called when the lacing values close a packet made of spans [packet_start, end) */
+    auto finish_packet = [&]() -> bool {
+        size_t packet_size = 0;
+        for (size_t s = packet_start; s < index.spans.size(); s++) {
+            packet_size += index.spans[s].size;
+        }
+
+        if (header_packets < 2) {
+            std::vector<uint8_t> header;
+            header.reserve(packet_size);
+            for (size_t s = packet_start; s < index.spans.size(); s++) {
+                auto &span = index.spans[s];
+                header.insert(header.end(), buf + span.offset, buf + span.offset + span.size);
+            }
+            index.spans.resize(packet_start);
+
+            if (header_packets == 0) {
+                if (header.size() < 19 || memcmp(header.data(), "OpusHead", 8) != 0) {
+                    ESP_LOGE(TAG, "Missing OpusHead");
+                    return false;
+                }
+                /* The decoder can run at any Opus rate, play at the original input rate if it is one */
+                int rate = ReadLe32(header.data() + 12);
+                index.sample_rate = (rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000) ? rate : 48000;
+            }
+            header_packets++;
+            return true;
+        }
+
+        if (packet_size == 0) {
+            /* An empty payload would make the decoder conceal a frame */
+            index.spans.resize(packet_start);
+            return true;
+        }
+        if (index.frame_duration == 0) {
+            const uint8_t *first = buf + index.spans[packet_start].offset;
+            uint8_t toc[2] = {first[0], index.spans[packet_start].size > 1 ? first[1] : (uint8_t)0};
+            index.frame_duration = GetPacketDuration(toc, packet_size);
+        }
+        index.packet_ends.push_back(index.spans.size());
+        packet_start = index.spans.size();
+        return true;
+    };
+
+    while (offset + OGG_PAGE_HEADER_SIZE <= size) {
+        const uint8_t *page = buf + offset;
+        if (memcmp(page, "OggS", 4) != 0) {
+            /* Lost sync, look for the next capture pattern and drop the partial packet */
+            do {
+                offset++;
+            } while (offset + OGG_PAGE_HEADER_SIZE <= size && memcmp(buf + offset, "OggS", 4) != 0);
+            index.spans.resize(packet_start);
+            continue;
+        }
+
+        uint8_t segments = page[26];
+        size_t data = offset + OGG_PAGE_HEADER_SIZE + segments;
+        if (data > size) {
+            break;
+        }
+        size_t body_size = 0;
+        for (int i = 0; i < segments; i++) {
+            body_size += page[OGG_PAGE_HEADER_SIZE + i];
+        }
+        if (data + body_size > size) {
+            ESP_LOGW(TAG, "Truncated page at %u", offset);
+            break;
+        }
+
+        uint32_t page_serial = ReadLe32(page + 14);
+        if (!has_serial) {
+            has_serial = true;
+            serial = page_serial;
+        }
+        if (page[4] != 0 || page_serial != serial) {
+            /* Unknown version or another logical stream */
+            offset = data + body_size;
+            continue;
+        }
+
+        /* A continued page without the start of its packet (or the other way round) loses that packet */
+        bool continued = page[5] & OGG_HEADER_CONTINUED;
+        bool discard = continued && index.spans.size() == packet_start;
+        if (!continued) {
+            index.spans.resize(packet_start);
+        }
+
+        size_t run_start = data;
+        size_t pos = data;
+        for (int i = 0; i < segments; i++) {
+            uint8_t lacing = page[OGG_PAGE_HEADER_SIZE + i];
+            pos += lacing;
+            if (lacing == 255) {
+                continue;
+            }
+            if (discard) {
+                discard = false;
+            } else {
+                if (pos > run_start) {
+                    index.spans.push_back({(uint32_t)run_start, (uint32_t)(pos - run_start)});
+                }
+                if (!finish_packet()) {
+                    return false;
+                }
+            }
+            run_start = pos;
+        }
+        if (pos > run_start && !discard) {
+            index.spans.push_back({(uint32_t)run_start, (uint32_t)(pos - run_start)});
+        }
+
+        offset = data + body_size;
+    }
+
+    index.spans.resize(packet_start);
+    if (header_packets < 2) {
+        ESP_LOGE(TAG, "Not an Ogg/Opus stream");
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const OggOpusIndex> OggOpusIndexCache::Get(std::string_view ogg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : entries_) {
+        if (entry.data == ogg.data() && entry.size == ogg.size()) {
+            return entry.index;
+        }
+    }
+
+    auto index = std::make_shared<OggOpusIndex>();
+    if (!OggDemuxer::BuildIndex(ogg, *index)) {
+        return nullptr;
+    }
+    if (entries_.size() >= OGG_INDEX_CACHE_SIZE) {
+        entries_.erase(entries_.begin());
+    }
+    entries_.push_back({ogg.data(), ogg.size(), index});
+    return index;
+}
@@ -0,0 +1,66 @@
+#ifndef OGG_DEMUXER_H
+#define OGG_DEMUXER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/*
+ * Ogg/Opus demuxer for the sounds embedded in the firmware and assets.
+ *
+ * The file is walked page by page (RFC 3533) and the lacing values are joined into whole packets,
+ * so packets that are 255 bytes or longer, or continued on the next page, come out intact. The
+ * OpusHead and OpusTags header packets (RFC 7845) are consumed, everything after them is indexed
+ * as audio. The index only stores byte spans into the original file, which must outlive it.
+ */
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_INDEX_CACHE_SIZE 8
+
+struct OggSpan {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct OggOpusIndex {
+    int sample_rate = 0;
+    // Duration of the first audio packet, the sounds use a constant frame size
+    int frame_duration = 0;
+    std::vector<OggSpan> spans;
+    // Packet i is made of spans [packet_ends[i - 1], packet_ends[i])
+    std::vector<uint32_t> packet_ends;
+
+    size_t packet_count() const { return packet_ends.size(); }
+    /* Copy packet `i` of `ogg` into `payload` */
+    void GetPacket(std::string_view ogg, size_t i, std::vector<uint8_t> &payload) const;
+};
+
+class OggDemuxer {
+  public:
+    /* Returns false if the data is not an Ogg/Opus stream */
+    static bool BuildIndex(std::string_view ogg, OggOpusIndex &index);
+
+  private:
+    static int GetPacketDuration(const uint8_t *packet, size_t size);
+};
+
+/* Keeps the index of recently played sounds, keyed by their address and size */
+class OggOpusIndexCache {
+  public:
+    std::shared_ptr<const OggOpusIndex> Get(std::string_view ogg);
+
+  private:
+    struct Entry {
+        const char *data;
+        size_t size;
+        std::shared_ptr<const OggOpusIndex> index;
+    };
+
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
+#endif // OGG_DEMUXER_H
@@ -3,9 +3,12 @@
 
 #if CONFIG_USE_AUDIO_DEBUGGER
 #include <esp_log.h>
+#include <esp_random.h>
+#include <esp_timer.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
 #include <cstring>
 #include <string>
 #endif
@@ -30,7 +33,9 @@ AudioDebugger::AudioDebugger() {
             udp_server_addr_.sin_port = htons(port);
             inet_pton(AF_INET, ip.c_str(), &udp_server_addr_.sin_addr);
             
-            ESP_LOGI(TAG, "Initialized server address: %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+            // 每次启动一个新会话，主机按会话分文件
+            session_ = esp_random() & 0xFFFF;
+            ESP_LOGI(TAG, "Initialized server address: %s, session %u", CONFIG_AUDIO_DEBUG_UDP_SERVER, session_);
         } else {
             ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
             close(udp_sockfd_);
@@ -51,18 +56,102 @@ AudioDebugger::~AudioDebugger() {
 #endif
 }
 
-void AudioDebugger::Feed(const std::vector<int16_t>& data) {
+bool AudioDebugger::TapEnabled(AudioDebugTap tap) {
+    switch (tap) {
+#if CONFIG_AUDIO_DEBUG_TAP_MIC
+        case kAudioDebugTapMic:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_PROCESSED
+        case kAudioDebugTapProcessed:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_DECODED
+        case kAudioDebugTapDecoded:
+            return true;
+#endif
+#if CONFIG_AUDIO_DEBUG_TAP_PLAYBACK
+        case kAudioDebugTapPlayback:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+// 无损压缩：同一声道的前后差分，zigzag 后按 7 位一组变长编码。结果不比原始数据小时返回 0
+size_t AudioDebugger::Compress(const int16_t* samples, size_t count, int channels, uint8_t* out, size_t capacity) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t delta = samples[i] - (i >= (size_t)channels ? samples[i - channels] : 0);
+        uint32_t value = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        do {
+            if (size >= capacity) {
+                return 0;
+            }
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            out[size++] = value ? (byte | 0x80) : byte;
+        } while (value);
+    }
+    return size < capacity ? size : 0;
+}
+
+void AudioDebugger::Feed(AudioDebugTap tap, const std::vector<int16_t>& data, int sample_rate, int channels) {
 #if CONFIG_USE_AUDIO_DEBUGGER
-    if (udp_sockfd_ >= 0) {
-        ssize_t sent = sendto(udp_sockfd_, data.data(), data.size() * sizeof(int16_t), 0,
-                             (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
+    if (udp_sockfd_ < 0 || !TapEnabled(tap) || data.empty() || channels <= 0 || sample_rate <= 0) {
+        return;
+    }
+
+    // 最后一个采样对应当前时刻，往前推出首个采样的时间
+    size_t frames = data.size() / channels;
+    int64_t start_us = esp_timer_get_time() - (int64_t)frames * 1000000 / sample_rate;
+    size_t max_frames = AUDIO_DEBUG_MAX_PAYLOAD / (sizeof(int16_t) * channels);
+
+    auto& datagram = datagram_[tap];
+    datagram.resize(sizeof(AudioDebugHeader) + AUDIO_DEBUG_MAX_PAYLOAD);
+    auto header = (AudioDebugHeader*)datagram.data();
+    uint8_t* payload = datagram.data() + sizeof(AudioDebugHeader);
+
+    for (size_t offset = 0; offset < frames; offset += max_frames) {
+        size_t count = std::min(max_frames, frames - offset);
+        const int16_t* samples = data.data() + offset * channels;
+        size_t payload_size = count * channels * sizeof(int16_t);
+        uint8_t flags = 0;
+#if CONFIG_AUDIO_DEBUG_COMPRESS
+        size_t compressed = Compress(samples, count * channels, channels, payload, payload_size);
+        if (compressed > 0) {
+            payload_size = compressed;
+            flags |= AUDIO_DEBUG_FLAG_COMPRESSED;
+        } else
+#endif
+        {
+            // 原始数据为小端 int16，与 WAV 相同
+            memcpy(payload, samples, payload_size);
+        }
+
+        uint64_t timestamp = start_us + (int64_t)offset * 1000000 / sample_rate;
+        header->magic = htons(AUDIO_DEBUG_MAGIC);
+        header->version = AUDIO_DEBUG_VERSION;
+        header->tap = tap;
+        header->flags = flags;
+        header->channels = channels;
+        header->sample_rate = htons(sample_rate);
+        header->session = htons(session_);
+        header->samples = htons(count);
+        header->sequence = htonl(sequence_[tap]++);
+        header->timestamp_high = htonl(timestamp >> 32);
+        header->timestamp_low = htonl(timestamp & 0xFFFFFFFF);
+
+        // 不等待：发不出去就丢掉，序号照常递增，主机会看到缺口
+        ssize_t sent = sendto(udp_sockfd_, datagram.data(), sizeof(AudioDebugHeader) + payload_size, MSG_DONTWAIT,
+                              (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
         if (sent < 0) {
-            ESP_LOGW(TAG, "Failed to send audio data to %s: %d", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno);
-        } else {
-            ESP_LOGD(TAG, "Sent %d bytes audio data to %s", sent, CONFIG_AUDIO_DEBUG_UDP_SERVER);
+            uint32_t dropped = ++dropped_;
+            if (dropped % 100 == 1) {
+                ESP_LOGW(TAG, "Failed to send audio data to %s: %d, %lu datagrams dropped", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno, dropped);
+            }
         }
     }
 #endif
 }
-
- 
\ No newline at end of file
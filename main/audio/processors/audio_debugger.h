@@ -3,20 +3,70 @@
 
 #include <vector>
 #include <cstdint>
+#include <atomic>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+/*
+ * 音频抓取：把音频链路上各个节点（tap）的 PCM 通过 UDP 发给主机，scripts/audio_debug_server.py 接收。
+ *
+ * 每个数据报都带 AudioDebugHeader：会话号、tap、序号和首个采样的 esp_timer 时间戳，主机据此把各个 tap
+ * 对齐成一个多声道 WAV，并报告丢包和乱序。数据报不超过 AUDIO_DEBUG_MAX_PAYLOAD，长帧会被拆开。
+ * 开启 CONFIG_AUDIO_DEBUG_COMPRESS 后载荷做无损的差分 + 变长编码，压不小时按原样发送。
+ *
+ * 发送不阻塞（MSG_DONTWAIT），发不出去就丢弃并计入序号，不影响音频任务的时序。
+ * 每个 tap 只能由一个任务调用 Feed()，不同 tap 可以在不同任务中并发。
+ */
+
+enum AudioDebugTap {
+    kAudioDebugTapMic,        // ReadAudioData 读到的原始麦克风数据（含参考声道）
+    kAudioDebugTapProcessed,  // AudioProcessor 输出，送往编码
+    kAudioDebugTapDecoded,    // 下行解码后（已重采样）
+    kAudioDebugTapPlayback,   // 混音后实际写入 codec 的数据
+    kAudioDebugTapCount,
+};
+
+#define AUDIO_DEBUG_MAGIC 0x4144  // "AD"
+#define AUDIO_DEBUG_VERSION 1
+#define AUDIO_DEBUG_FLAG_COMPRESSED 0x01
+#define AUDIO_DEBUG_MAX_PAYLOAD 1400
+
+// 所有字段为网络字节序
+struct __attribute__((packed)) AudioDebugHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t tap;
+    uint8_t flags;
+    uint8_t channels;
+    uint16_t sample_rate;
+    uint16_t session;
+    uint16_t samples;        // 每声道采样数
+    uint32_t sequence;       // 每个 tap 独立递增
+    uint32_t timestamp_high; // 首个采样的 esp_timer 时间（us）
+    uint32_t timestamp_low;
+};
+
 class AudioDebugger {
 public:
     AudioDebugger();
     ~AudioDebugger();
 
-    void Feed(const std::vector<int16_t>& data);
+    /* `data` 交织 `channels` 个声道，刚刚采集/播放完毕（最后一个采样对应当前时刻） */
+    void Feed(AudioDebugTap tap, const std::vector<int16_t>& data, int sample_rate, int channels = 1);
+
+    /* 无损压缩 `count` 个交织采样（格式见 audio_debug_server.py 的 decompress），结果不比原始数据小时返回 0 */
+    static size_t Compress(const int16_t* samples, size_t count, int channels, uint8_t* out, size_t capacity);
 
 private:
     int udp_sockfd_ = -1;
     struct sockaddr_in udp_server_addr_;
+    uint16_t session_ = 0;
+    uint32_t sequence_[kAudioDebugTapCount] = {};
+    std::vector<uint8_t> datagram_[kAudioDebugTapCount];
+    std::atomic<uint32_t> dropped_{0};
+
+    static bool TapEnabled(AudioDebugTap tap);
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -14,15 +14,15 @@ void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
     }
 
     if (codec_->input_channels() == 2) {
-        // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
+        // If input channels is 2, we need to fetch the left channel data, in place so the
+        // buffer keeps its capacity
+        size_t frames = data.size() / 2;
+        for (size_t i = 0, j = 0; i < frames; ++i, j += 2) {
+            data[i] = data[j];
         }
-        output_callback_(std::move(mono_data));
-    } else {
-        output_callback_(std::move(data));
+        data.resize(frames);
     }
+    output_callback_(std::move(data));
 }
 
 void NoAudioProcessor::Start() {
@@ -52,6 +52,10 @@ size_t NoAudioProcessor::GetFeedSize() {
     return frame_samples_;
 }
 
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 void NoAudioProcessor::EnableDeviceAec(bool enable) {
     if (enable) {
         ESP_LOGE(TAG, "Device AEC is not supported");
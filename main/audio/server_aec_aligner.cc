@@ -0,0 +1,101 @@
+#include "server_aec_aligner.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SampleClock::Update(int64_t now_us, uint64_t position, int sample_rate) {
+    if (!valid_ || sample_rate != sample_rate_ || now_us - base_us_ > SERVER_AEC_RESYNC_US) {
+        /* The first update, a new rate or a direction that stopped in between: start from here, the measured rate is kept */
+        if (sample_rate != sample_rate_) {
+            sample_rate_ = sample_rate;
+            rate_ = sample_rate / 1000000.0;
+        }
+        base_us_ = anchor_us_ = now_us;
+        base_position_ = anchor_position_ = position;
+        valid_ = true;
+        return;
+    }
+
+    /* Smooth the jitter of the blocking calls */
+    double predicted = PositionAt(now_us);
+    base_position_ = predicted + SERVER_AEC_CLOCK_ALPHA * (position - predicted);
+    base_us_ = now_us;
+
+    /* The rate comes from the whole run since the last start, so jitter fades as the run gets longer */
+    if (now_us - anchor_us_ >= SERVER_AEC_RATE_WINDOW_US) {
+        double nominal = sample_rate / 1000000.0;
+        double max_offset = nominal * SERVER_AEC_MAX_DRIFT_PPM / 1000000.0;
+        rate_ = std::clamp((base_position_ - anchor_position_) / (now_us - anchor_us_), nominal - max_offset, nominal + max_offset);
+    }
+}
+
+int64_t SampleClock::TimeOf(uint64_t position) const {
+    return base_us_ + (int64_t)std::llround((position - base_position_) / rate_);
+}
+
+double SampleClock::PositionAt(int64_t time_us) const {
+    return base_position_ + (time_us - base_us_) * rate_;
+}
+
+int SampleClock::drift_ppm() const {
+    if (!valid_) {
+        return 0;
+    }
+    return (int)std::lround((rate_ * 1000000.0 / sample_rate_ - 1.0) * 1000000.0);
+}
+
+void ServerAecAligner::OnPlayback(uint32_t timestamp, size_t samples, int sample_rate, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timestamp > 0) {
+        auto &segment = segments_[next_segment_];
+        segment.start = output_position_;
+        segment.samples = samples;
+        segment.timestamp = timestamp;
+        next_segment_ = (next_segment_ + 1) % SERVER_AEC_SEGMENTS;
+    }
+    output_position_ += samples;
+    output_clock_.Update(now_us, output_position_, sample_rate);
+}
+
+void ServerAecAligner::OnCapture(size_t samples, int sample_rate, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    input_position_ += samples;
+    input_clock_.Update(now_us, input_position_, sample_rate);
+}
+
+uint32_t ServerAecAligner::GetTimestamp(size_t frame_samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!input_clock_.valid() || !output_clock_.valid() || input_position_ < frame_samples) {
+        statistics_.unaligned++;
+        return 0;
+    }
+
+    /* Which output sample had been written when the first sample of the frame was captured */
+    int64_t captured_us = input_clock_.TimeOf(input_position_ - frame_samples);
+    double played = output_clock_.PositionAt(captured_us);
+    if (played >= 0) {
+        uint64_t position = (uint64_t)played;
+        for (auto &segment : segments_) {
+            if (segment.samples > 0 && position >= segment.start && position < segment.start + segment.samples) {
+                statistics_.aligned++;
+                return segment.timestamp + (uint32_t)((position - segment.start) * 1000 / output_clock_.sample_rate());
+            }
+        }
+        /* The frame being written right now has no segment yet, its timestamps continue the last one */
+        auto &last = segments_[(next_segment_ + SERVER_AEC_SEGMENTS - 1) % SERVER_AEC_SEGMENTS];
+        if (last.samples > 0 && last.start + last.samples == output_position_ && position >= output_position_ &&
+            position < output_position_ + last.samples) {
+            statistics_.aligned++;
+            return last.timestamp + (uint32_t)((position - last.start) * 1000 / output_clock_.sample_rate());
+        }
+    }
+    statistics_.unaligned++;
+    return 0;
+}
+
+ServerAecStatistics ServerAecAligner::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.input_drift_ppm = input_clock_.drift_ppm();
+    statistics_.output_drift_ppm = output_clock_.drift_ppm();
+    return statistics_;
+}
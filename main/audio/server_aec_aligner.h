@@ -0,0 +1,100 @@
+#ifndef SERVER_AEC_ALIGNER_H
+#define SERVER_AEC_ALIGNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * Reference timestamps for server side AEC.
+ *
+ * Every downlink frame carries the server timestamp (ms) of its first sample. The server needs to
+ * know, for every uplink frame, which of those samples the speaker was playing while the mic
+ * captured it.
+ *
+ * Both codec directions keep a sample counter: samples written to the speaker and samples read
+ * from the mic. A SampleClock per counter tracks how it advances against esp_timer: a small filter
+ * smooths the jitter of the blocking reads / writes, and the actual sample rate is measured over
+ * the whole run of the direction. For an uplink frame the aligner takes the local time at which its
+ * first sample was captured, asks the output clock which sample had been written at that time, and
+ * looks that sample up in the recently played frames. Since the rates are measured rather than assumed, input and
+ * output clocks drifting apart do not shift the timestamps over time.
+ *
+ * The DMA depth and the processor delay are constant offsets and are left to the server, like the
+ * acoustic path itself.
+ */
+
+#define SERVER_AEC_SEGMENTS 32
+// Without a read / write for this long the codec direction stopped, the clock starts over
+#define SERVER_AEC_RESYNC_US 250000
+// Share of the measured position error taken over per update
+#define SERVER_AEC_CLOCK_ALPHA 0.1
+// Shortest run the sample rate is measured over
+#define SERVER_AEC_RATE_WINDOW_US 1000000
+// Measured rates further than this from nominal are clamped (ppm)
+#define SERVER_AEC_MAX_DRIFT_PPM 10000
+
+class SampleClock {
+  public:
+    /* `position` samples done at local time `now_us`, right after a blocking read / write */
+    void Update(int64_t now_us, uint64_t position, int sample_rate);
+    void Reset() { valid_ = false; }
+
+    bool valid() const { return valid_; }
+    int sample_rate() const { return sample_rate_; }
+    /* Local time at which `position` was reached */
+    int64_t TimeOf(uint64_t position) const;
+    /* Position reached at local time `time_us` */
+    double PositionAt(int64_t time_us) const;
+    /* Measured rate against nominal */
+    int drift_ppm() const;
+
+  private:
+    bool valid_ = false;
+    int sample_rate_ = 0;
+    // Samples per microsecond
+    double rate_ = 0;
+    int64_t base_us_ = 0;
+    double base_position_ = 0;
+    // Start of the current run
+    int64_t anchor_us_ = 0;
+    double anchor_position_ = 0;
+};
+
+struct ServerAecStatistics {
+    uint32_t aligned = 0;
+    uint32_t unaligned = 0;
+    int input_drift_ppm = 0;
+    int output_drift_ppm = 0;
+};
+
+class ServerAecAligner {
+  public:
+    /* Output task, after `samples` were written to the codec. `timestamp` is 0 for audio without one (prompts) */
+    void OnPlayback(uint32_t timestamp, size_t samples, int sample_rate, int64_t now_us);
+    /* Input task, after `samples` per channel were read */
+    void OnCapture(size_t samples, int sample_rate, int64_t now_us);
+    /* Reference timestamp for the uplink frame of `frame_samples` that ends with the latest capture, 0 if nothing was playing */
+    uint32_t GetTimestamp(size_t frame_samples);
+
+    ServerAecStatistics GetStatistics();
+
+  private:
+    struct Segment {
+        uint64_t start = 0;
+        uint32_t samples = 0;
+        uint32_t timestamp = 0;
+    };
+
+    std::mutex mutex_;
+    SampleClock input_clock_;
+    SampleClock output_clock_;
+    uint64_t input_position_ = 0;
+    uint64_t output_position_ = 0;
+    // Latest frames that carried a timestamp
+    Segment segments_[SERVER_AEC_SEGMENTS];
+    size_t next_segment_ = 0;
+    ServerAecStatistics statistics_;
+};
+
+#endif // SERVER_AEC_ALIGNER_H
@@ -0,0 +1,130 @@
+#include "sound_pcm_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "SoundPcmCache"
+
+SoundPcm::~SoundPcm() {
+    heap_caps_free(samples);
+}
+
+void SoundPcmCache::Register(std::string_view ogg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &sound : registered_) {
+        if (sound.data == ogg.data() && sound.size == ogg.size()) {
+            return;
+        }
+    }
+    registered_.push_back({ogg.data(), ogg.size()});
+}
+
+std::shared_ptr<const SoundPcm> SoundPcmCache::Lookup(std::string_view ogg, const OggOpusIndex &index, int sample_rate, uint32_t &fill_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fill_id = 0;
+    auto registered = std::find_if(registered_.begin(), registered_.end(), [&ogg](const Sound &sound) {
+        return sound.data == ogg.data() && sound.size == ogg.size();
+    });
+    if (registered == registered_.end()) {
+        return nullptr;
+    }
+    for (auto &entry : entries_) {
+        if (entry.data == ogg.data() && entry.size == ogg.size() && entry.pcm->sample_rate == sample_rate) {
+            hits_++;
+            return entry.pcm;
+        }
+    }
+    misses_++;
+
+    int64_t now_us = esp_timer_get_time();
+    if (fill_id_ != 0 && now_us >= fill_deadline_us_) {
+        ESP_LOGW(TAG, "Capture %lu timed out at frame %lu of %lu", fill_id_, fill_next_frame_, fill_frames_);
+        fill_id_ = 0;
+        fill_pcm_.reset();
+    }
+    if (fill_id_ != 0 || entries_.size() >= SOUND_PCM_CACHE_MAX_SOUNDS) {
+        return nullptr;
+    }
+    size_t frames = index.packet_count();
+    if (frames == 0 || frames * index.frame_duration > CONFIG_SOUND_PCM_CACHE_MAX_SOUND_MS) {
+        return nullptr;
+    }
+    size_t capacity = frames * (index.frame_duration * sample_rate / 1000);
+    if (bytes_ + capacity * sizeof(int16_t) > CONFIG_SOUND_PCM_CACHE_SIZE_KB * 1024) {
+        return nullptr;
+    }
+
+    auto pcm = std::make_shared<SoundPcm>();
+    pcm->samples = (int16_t *)heap_caps_malloc(capacity * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (pcm->samples == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes", capacity * sizeof(int16_t));
+        return nullptr;
+    }
+    pcm->capacity = capacity;
+    pcm->sample_rate = sample_rate;
+
+    fill_generation_ = fill_generation_ + 1 == 0 ? 1 : fill_generation_ + 1;
+    fill_id_ = fill_generation_;
+    fill_next_frame_ = 0;
+    fill_frames_ = frames;
+    fill_deadline_us_ = now_us + (int64_t)(frames * index.frame_duration + SOUND_PCM_CACHE_FILL_SLACK_MS) * 1000;
+    fill_data_ = ogg.data();
+    fill_size_ = ogg.size();
+    fill_pcm_ = std::move(pcm);
+    fill_id = fill_id_;
+    return nullptr;
+}
+
+void SoundPcmCache::Append(uint32_t fill_id, uint32_t frame, const std::vector<int16_t> &pcm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fill_id != fill_id_) {
+        return;
+    }
+    if (frame != fill_next_frame_ || fill_pcm_->size + pcm.size() > fill_pcm_->capacity) {
+        ESP_LOGW(TAG, "Capture of frame %lu failed, expected %lu", frame, fill_next_frame_);
+        fill_id_ = 0;
+        fill_pcm_.reset();
+        return;
+    }
+
+    if (fill_pcm_->frame_samples == 0) {
+        fill_pcm_->frame_samples = pcm.size();
+    }
+    memcpy(fill_pcm_->samples + fill_pcm_->size, pcm.data(), pcm.size() * sizeof(int16_t));
+    fill_pcm_->size += pcm.size();
+
+    if (++fill_next_frame_ == fill_frames_) {
+        bytes_ += fill_pcm_->capacity * sizeof(int16_t);
+        entries_.push_back({fill_data_, fill_size_, std::move(fill_pcm_)});
+        fill_id_ = 0;
+        ESP_LOGI(TAG, "Cached sound %u: %u samples, %u bytes in use", entries_.size(), entries_.back().pcm->size, bytes_);
+    }
+}
+
+void SoundPcmCache::AbortFill() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fill_id_ = 0;
+    fill_pcm_.reset();
+}
+
+void SoundPcmCache::AbortFill(uint32_t fill_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fill_id == 0 || fill_id != fill_id_) {
+        return;
+    }
+    fill_id_ = 0;
+    fill_pcm_.reset();
+}
+
+SoundPcmCacheStatistics SoundPcmCache::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SoundPcmCacheStatistics stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.sounds = entries_.size();
+    stats.bytes = bytes_;
+    return stats;
+}
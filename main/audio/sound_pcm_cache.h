@@ -0,0 +1,106 @@
+#ifndef SOUND_PCM_CACHE_H
+#define SOUND_PCM_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "ogg_demuxer.h"
+
+/*
+ * Decoded PCM of short sounds, kept in PSRAM at the codec output rate.
+ *
+ * A sound is captured the first time it is played: PlaySound tags its packets with a fill id and
+ * the decode task hands every decoded frame to Append(). Once the last frame arrives in order the
+ * sound is cached, and later plays push its PCM straight to the speaker. Only one sound is captured
+ * at a time; a dropped or failed frame abandons the capture and the next play tries again. A capture
+ * that is still open SOUND_PCM_CACHE_FILL_SLACK_MS after the sound should have ended is abandoned by
+ * the next Lookup, so a frame lost without an AbortFill cannot block the cache.
+ *
+ * Only registered sounds are captured, so one-off prompts (activation codes, digits) do not take
+ * the budget of the cues that are played over and over.
+ */
+
+#define SOUND_PCM_CACHE_MAX_SOUNDS 8
+#define SOUND_PCM_CACHE_FILL_SLACK_MS 2000
+
+struct SoundPcm {
+    SoundPcm() = default;
+    ~SoundPcm();
+    SoundPcm(const SoundPcm &) = delete;
+    SoundPcm &operator=(const SoundPcm &) = delete;
+
+    int16_t *samples = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t frame_samples = 0;
+    int sample_rate = 0;
+};
+
+struct SoundPcmCacheStatistics {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t sounds = 0;
+    uint32_t bytes = 0;
+};
+
+class SoundPcmCache {
+  public:
+    static SoundPcmCache &GetInstance() {
+        static SoundPcmCache instance;
+        return instance;
+    }
+
+    // 删除拷贝构造函数和赋值运算符
+    SoundPcmCache(const SoundPcmCache &) = delete;
+    SoundPcmCache &operator=(const SoundPcmCache &) = delete;
+
+    /* Allow `ogg` to be cached, it must stay at the same address like the embedded sounds */
+    void Register(std::string_view ogg);
+    /* Returns the cached PCM, or nullptr and sets `fill_id` (0 if the sound will not be captured) */
+    std::shared_ptr<const SoundPcm> Lookup(std::string_view ogg, const OggOpusIndex &index, int sample_rate, uint32_t &fill_id);
+    /* Decode task: `pcm` is frame number `frame` of the sound captured as `fill_id` */
+    void Append(uint32_t fill_id, uint32_t frame, const std::vector<int16_t> &pcm);
+    /* The packets of the sound being captured were dropped */
+    void AbortFill();
+    /* Abandon the capture `fill_id`, a newer capture is kept */
+    void AbortFill(uint32_t fill_id);
+
+    SoundPcmCacheStatistics GetStatistics() const;
+
+  private:
+    SoundPcmCache() = default;
+
+    struct Entry {
+        const char *data;
+        size_t size;
+        std::shared_ptr<const SoundPcm> pcm;
+    };
+
+    struct Sound {
+        const char *data;
+        size_t size;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Sound> registered_;
+    std::vector<Entry> entries_;
+    size_t bytes_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+
+    // The sound being captured
+    uint32_t fill_generation_ = 0;
+    uint32_t fill_id_ = 0;
+    uint32_t fill_next_frame_ = 0;
+    uint32_t fill_frames_ = 0;
+    int64_t fill_deadline_us_ = 0;
+    const char *fill_data_ = nullptr;
+    size_t fill_size_ = 0;
+    std::shared_ptr<SoundPcm> fill_pcm_;
+};
+
+#endif // SOUND_PCM_CACHE_H
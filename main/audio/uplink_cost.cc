@@ -0,0 +1,112 @@
+#include "uplink_cost.h"
+
+#include <esp_log.h>
+
+#include "audio_service.h"
+
+#define TAG "UplinkCost"
+
+static const char *const kStageNames[kUplinkCostStageCount] = {
+    "resample",
+    "process",
+    "encode",
+};
+
+void UplinkCostMeter::Record(UplinkCostStage stage, int64_t elapsed_us, int64_t audio_us) {
+    stage_us_[stage].fetch_add(elapsed_us, std::memory_order_relaxed);
+    stage_audio_us_[stage].fetch_add(audio_us, std::memory_order_relaxed);
+}
+
+void UplinkCostMeter::RecordPacket(size_t bytes, int frame_duration_ms) {
+    packets_.fetch_add(1, std::memory_order_relaxed);
+    packet_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    packet_audio_ms_.fetch_add(frame_duration_ms, std::memory_order_relaxed);
+}
+
+void UplinkCostMeter::Reset() {
+    for (int i = 0; i < kUplinkCostStageCount; i++) {
+        stage_us_[i] = 0;
+        stage_audio_us_[i] = 0;
+    }
+    packets_ = 0;
+    packet_bytes_ = 0;
+    packet_audio_ms_ = 0;
+    allocation_base_ = PoolMisses();
+}
+
+uint32_t UplinkCostMeter::GetCpuUsPerFrame(UplinkCostStage stage) const {
+    uint64_t audio_us = stage_audio_us_[stage].load(std::memory_order_relaxed);
+    if (audio_us == 0) {
+        return 0;
+    }
+    return stage_us_[stage].load(std::memory_order_relaxed) * OPUS_FRAME_DURATION_MS * 1000 / audio_us;
+}
+
+uint32_t UplinkCostMeter::GetCpuUsPerFrame() const {
+    uint32_t total = 0;
+    for (int i = 0; i < kUplinkCostStageCount; i++) {
+        total += GetCpuUsPerFrame(static_cast<UplinkCostStage>(i));
+    }
+    return total;
+}
+
+uint32_t UplinkCostMeter::GetBytesPerSecond() const {
+    uint64_t audio_ms = packet_audio_ms_.load(std::memory_order_relaxed);
+    if (audio_ms == 0) {
+        return 0;
+    }
+    return packet_bytes_.load(std::memory_order_relaxed) * 1000 / audio_ms;
+}
+
+uint32_t UplinkCostMeter::GetAllocations() const {
+    return PoolMisses() - allocation_base_.load(std::memory_order_relaxed);
+}
+
+uint32_t UplinkCostMeter::PoolMisses() {
+    auto statistics = AudioPool::GetInstance().GetStatistics();
+    return statistics.packet_misses + statistics.task_misses + statistics.buffer_misses;
+}
+
+bool UplinkCostMeter::CheckBudget() const {
+    bool within = true;
+    uint32_t cpu_us = GetCpuUsPerFrame();
+    if (CONFIG_AUDIO_UPLINK_BUDGET_CPU_US > 0 && cpu_us > CONFIG_AUDIO_UPLINK_BUDGET_CPU_US) {
+        ESP_LOGW(TAG, "CPU %luus per %dms frame (resample %lu, process %lu, encode %lu), budget %dus", cpu_us, OPUS_FRAME_DURATION_MS,
+                 GetCpuUsPerFrame(kUplinkCostResample), GetCpuUsPerFrame(kUplinkCostProcess), GetCpuUsPerFrame(kUplinkCostEncode),
+                 CONFIG_AUDIO_UPLINK_BUDGET_CPU_US);
+        within = false;
+    }
+    uint32_t bytes_per_second = GetBytesPerSecond();
+    if (CONFIG_AUDIO_UPLINK_BUDGET_BYTES_PER_SECOND > 0 && bytes_per_second > CONFIG_AUDIO_UPLINK_BUDGET_BYTES_PER_SECOND) {
+        ESP_LOGW(TAG, "%lu bytes per second, budget %d", bytes_per_second, CONFIG_AUDIO_UPLINK_BUDGET_BYTES_PER_SECOND);
+        within = false;
+    }
+    uint32_t allocations = GetAllocations();
+    if (CONFIG_AUDIO_UPLINK_BUDGET_ALLOCATIONS > 0 && allocations > CONFIG_AUDIO_UPLINK_BUDGET_ALLOCATIONS) {
+        ESP_LOGW(TAG, "%lu heap allocations outside the audio pool, budget %d", allocations, CONFIG_AUDIO_UPLINK_BUDGET_ALLOCATIONS);
+        within = false;
+    }
+    return within;
+}
+
+cJSON *UplinkCostMeter::ToJson() const {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "frame_ms", OPUS_FRAME_DURATION_MS);
+    cJSON *cpu = cJSON_CreateObject();
+    for (int i = 0; i < kUplinkCostStageCount; i++) {
+        cJSON_AddNumberToObject(cpu, kStageNames[i], GetCpuUsPerFrame(static_cast<UplinkCostStage>(i)));
+    }
+    cJSON_AddNumberToObject(cpu, "total", GetCpuUsPerFrame());
+    cJSON_AddItemToObject(json, "cpu_us_per_frame", cpu);
+    cJSON_AddNumberToObject(json, "packets", packets_.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "bytes_per_second", GetBytesPerSecond());
+    cJSON_AddNumberToObject(json, "allocations", GetAllocations());
+
+    cJSON *budget = cJSON_CreateObject();
+    cJSON_AddNumberToObject(budget, "cpu_us_per_frame", CONFIG_AUDIO_UPLINK_BUDGET_CPU_US);
+    cJSON_AddNumberToObject(budget, "bytes_per_second", CONFIG_AUDIO_UPLINK_BUDGET_BYTES_PER_SECOND);
+    cJSON_AddNumberToObject(budget, "allocations", CONFIG_AUDIO_UPLINK_BUDGET_ALLOCATIONS);
+    cJSON_AddItemToObject(json, "budget", budget);
+    cJSON_AddBoolToObject(json, "within_budget", CheckBudget());
+    return json;
+}
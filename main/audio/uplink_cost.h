@@ -0,0 +1,59 @@
+#ifndef UPLINK_COST_H
+#define UPLINK_COST_H
+
+#include <atomic>
+#include <cJSON.h>
+#include <cstdint>
+
+#include "audio_pool.h"
+
+/*
+ * What the uplink costs: CPU time of its stages, encoded bytes per second and the heap
+ * allocations the AudioPool could not avoid.
+ *
+ * CPU time is accumulated together with the duration of the audio it covered and reported per
+ * OPUS_FRAME_DURATION_MS of audio, so the numbers do not move with the read size or the frame
+ * duration. Allocations are the pool misses since the last Reset().
+ *
+ * The budgets come from the configuration (CONFIG_AUDIO_UPLINK_BUDGET_*), a zero budget is not
+ * checked. Every stage is recorded by a single task, the counters are atomic so the MCP tool can
+ * read them from the main task at any time.
+ */
+
+enum UplinkCostStage {
+    kUplinkCostResample, // ReadAudioData, codec rate -> 16kHz (and channel split)
+    kUplinkCostProcess,  // AudioProcessor::Feed, the whole processing for processors without a task of their own
+    kUplinkCostEncode,   // Opus encode
+    kUplinkCostStageCount,
+};
+
+class UplinkCostMeter {
+  public:
+    void Record(UplinkCostStage stage, int64_t elapsed_us, int64_t audio_us);
+    void RecordPacket(size_t bytes, int frame_duration_ms);
+    void Reset();
+
+    /* CPU time of a stage per OPUS_FRAME_DURATION_MS of audio */
+    uint32_t GetCpuUsPerFrame(UplinkCostStage stage) const;
+    uint32_t GetCpuUsPerFrame() const;
+    uint32_t GetBytesPerSecond() const;
+    uint32_t GetAllocations() const;
+
+    /* Logs every number above its budget, returns false if there was one */
+    bool CheckBudget() const;
+    /* Caller owns the returned object */
+    cJSON *ToJson() const;
+
+  private:
+    std::atomic<uint64_t> stage_us_[kUplinkCostStageCount] = {};
+    std::atomic<uint64_t> stage_audio_us_[kUplinkCostStageCount] = {};
+    std::atomic<uint32_t> packets_{0};
+    std::atomic<uint64_t> packet_bytes_{0};
+    std::atomic<uint64_t> packet_audio_ms_{0};
+    // Pool misses at the last Reset()
+    std::atomic<uint32_t> allocation_base_{0};
+
+    static uint32_t PoolMisses();
+};
+
+#endif // UPLINK_COST_H
@@ -0,0 +1,53 @@
+#include "uplink_dtx.h"
+
+#include <algorithm>
+
+UplinkDtxDecision UplinkDtx::Process(const std::vector<int16_t> &pcm, int64_t origin_us, bool voice_detected, int64_t now_us) {
+    bool enabled = enabled_;
+    if (!enabled || voice_detected) {
+        hangover_until_us_ = now_us + UPLINK_DTX_HANGOVER_MS * 1000;
+    }
+    if (now_us < hangover_until_us_) {
+        if (!suppressing_) {
+            return kUplinkDtxSend;
+        }
+        suppressing_ = false;
+        if (!enabled) {
+            preroll_count_ = 0;
+            return kUplinkDtxSend;
+        }
+        return kUplinkDtxOnset;
+    }
+
+    PrerollFrame &frame = preroll_[preroll_next_];
+    frame.pcm.assign(pcm.begin(), pcm.end());
+    frame.origin_us = origin_us;
+    preroll_next_ = (preroll_next_ + 1) % UPLINK_DTX_PREROLL_SLOTS;
+    preroll_count_ = std::min<size_t>(preroll_count_ + 1, UPLINK_DTX_PREROLL_SLOTS);
+    suppressing_ = true;
+    suppressed_count_++;
+
+    if (now_us - last_packet_us_ >= UPLINK_DTX_KEEPALIVE_MS * 1000) {
+        last_packet_us_ = now_us;
+        return kUplinkDtxKeepalive;
+    }
+    return kUplinkDtxSuppress;
+}
+
+bool UplinkDtx::PopPreroll(size_t max_frames, std::vector<int16_t> &pcm, int64_t &origin_us) {
+    if (preroll_count_ == 0) {
+        return false;
+    }
+    /* Longer frames cover the preroll with fewer of them */
+    size_t frame_ms = std::max<size_t>(preroll_[(preroll_next_ + UPLINK_DTX_PREROLL_SLOTS - 1) % UPLINK_DTX_PREROLL_SLOTS].pcm.size() / 16, 1);
+    size_t keep = std::min(max_frames, std::max<size_t>(UPLINK_DTX_PREROLL_MS / frame_ms, 1));
+    preroll_count_ = std::min(preroll_count_, keep);
+    if (preroll_count_ == 0) {
+        return false;
+    }
+    const PrerollFrame &frame = preroll_[(preroll_next_ + UPLINK_DTX_PREROLL_SLOTS - preroll_count_) % UPLINK_DTX_PREROLL_SLOTS];
+    pcm.assign(frame.pcm.begin(), frame.pcm.end());
+    origin_us = frame.origin_us;
+    preroll_count_--;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef UPLINK_DTX_H
+#define UPLINK_DTX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Decides which uplink frames are sent while DTX is enabled.
+ *
+ * Frames the VAD marks as silence are dropped once UPLINK_DTX_HANGOVER_MS have passed since the
+ * last speech, and a DTX packet stands in for them every UPLINK_DTX_KEEPALIVE_MS. The latest
+ * dropped frames are kept with their capture time. When speech starts they are resent ahead of it,
+ * so the VAD delay does not clip the first syllable; by then they are late, so the caller sends
+ * them marked as preroll (the receiver may drop them to catch up) and only as many as its encode
+ * ring has room for.
+ *
+ * SetEnabled() may be called from any task, everything else belongs to the processor output.
+ */
+
+// Frames kept sending after the VAD reports silence, silence resent at speech onset, and the
+// interval of the DTX packets that keep the receiver (and NAT) informed
+#define UPLINK_DTX_HANGOVER_MS 300
+#define UPLINK_DTX_PREROLL_MS 120
+#define UPLINK_DTX_KEEPALIVE_MS 400
+// Enough for the preroll in the shortest frames (OPUS_MIN_FRAME_DURATION_MS)
+#define UPLINK_DTX_PREROLL_SLOTS (UPLINK_DTX_PREROLL_MS / 20)
+
+enum UplinkDtxDecision {
+    kUplinkDtxSend,      // Encode and send the frame
+    kUplinkDtxOnset,     // Speech started: send the preroll (PopPreroll) and then the frame
+    kUplinkDtxSuppress,  // Drop the frame
+    kUplinkDtxKeepalive, // Drop the frame, a DTX packet goes out in its place
+};
+
+class UplinkDtx {
+  public:
+    void SetEnabled(bool enable) { enabled_ = enable; }
+
+    /* `origin_us` is the capture time of the frame, kept for the preroll */
+    UplinkDtxDecision Process(const std::vector<int16_t> &pcm, int64_t origin_us, bool voice_detected, int64_t now_us);
+    /* After kUplinkDtxOnset: copies the oldest kept frame into `pcm`, returns false when none is
+     * left. Only the newest `max_frames` are sent, older ones are dropped */
+    bool PopPreroll(size_t max_frames, std::vector<int16_t> &pcm, int64_t &origin_us);
+
+    uint32_t suppressed_count() const { return suppressed_count_; }
+
+  private:
+    struct PrerollFrame {
+        std::vector<int16_t> pcm;
+        int64_t origin_us = 0;
+    };
+
+    std::atomic<bool> enabled_{false};
+    bool suppressing_ = false;
+    int64_t hangover_until_us_ = 0;
+    int64_t last_packet_us_ = 0;
+    uint32_t suppressed_count_ = 0;
+    // Ring of the latest suppressed frames, the slots keep their capacity
+    PrerollFrame preroll_[UPLINK_DTX_PREROLL_SLOTS];
+    size_t preroll_next_ = 0;
+    size_t preroll_count_ = 0;
+};
+
+#endif // UPLINK_DTX_H
@@ -0,0 +1,68 @@
+#include "uplink_encoder.h"
+
+#include <esp_log.h>
+
+#define TAG "UplinkEncoder"
+
+UplinkEncoder::UplinkEncoder(int sample_rate, int channels) : sample_rate_(sample_rate), channels_(channels) {
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, channels, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+    /* Same defaults as OpusEncoderWrapper */
+    SetDtx(true);
+    SetComplexity(0);
+}
+
+UplinkEncoder::~UplinkEncoder() {
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+}
+
+bool UplinkEncoder::Encode(const std::vector<int16_t> &pcm, std::vector<uint8_t> &opus) {
+    if (encoder_ == nullptr) {
+        return false;
+    }
+    int ret = opus_encode(encoder_, pcm.data(), pcm.size() / channels_, packet_, sizeof(packet_));
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+        return false;
+    }
+    /* Copy out of the scratch packet, pooled payload buffers keep their small reserve */
+    opus.assign(packet_, packet_ + ret);
+    return true;
+}
+
+void UplinkEncoder::ResetState() {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+}
+
+void UplinkEncoder::SetComplexity(int complexity) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
+    }
+}
+
+void UplinkEncoder::SetBitrate(int bitrate) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate));
+    }
+}
+
+void UplinkEncoder::SetInbandFec(bool enable, int loss_percent) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_INBAND_FEC(enable ? 1 : 0));
+        opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(loss_percent));
+    }
+}
+
+void UplinkEncoder::SetDtx(bool enable) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_DTX(enable ? 1 : 0));
+    }
+}
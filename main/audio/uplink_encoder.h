@@ -0,0 +1,49 @@
+#ifndef UPLINK_ENCODER_H
+#define UPLINK_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opus.h>
+
+/*
+ * The Opus encoder of the uplink.
+ *
+ * OpusEncoderWrapper only exposes complexity and DTX, the encoder controller also needs bitrate and
+ * in-band FEC, so the uplink talks to libopus directly. Every Encode() takes exactly one frame and
+ * the frame size comes from the pcm size, so a change of frame duration keeps the encoder state and
+ * its settings.
+ *
+ * Only the task that encodes may call the setters.
+ */
+
+// Enough for a 60ms frame at the highest bitrate the controller may choose
+#define UPLINK_ENCODER_MAX_PACKET_SIZE 1500
+
+class UplinkEncoder {
+  public:
+    UplinkEncoder(int sample_rate, int channels);
+    ~UplinkEncoder();
+    UplinkEncoder(const UplinkEncoder &) = delete;
+    UplinkEncoder &operator=(const UplinkEncoder &) = delete;
+
+    bool Encode(const std::vector<int16_t> &pcm, std::vector<uint8_t> &opus);
+    void ResetState();
+
+    void SetComplexity(int complexity);
+    /* Bits per second, OPUS_AUTO lets libopus choose */
+    void SetBitrate(int bitrate);
+    void SetInbandFec(bool enable, int loss_percent);
+    void SetDtx(bool enable);
+
+    int sample_rate() const { return sample_rate_; }
+
+  private:
+    OpusEncoder *encoder_ = nullptr;
+    int sample_rate_;
+    int channels_;
+    uint8_t packet_[UPLINK_ENCODER_MAX_PACKET_SIZE];
+};
+
+#endif // UPLINK_ENCODER_H
@@ -0,0 +1,227 @@
+#include "wake_word_preroll.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "WakeWordPreroll"
+
+#define WAKE_WORD_PREROLL_CAPACITY (WAKE_WORD_PREROLL_FRAMES * WAKE_WORD_PREROLL_FRAME_SAMPLES)
+#define WAKE_WORD_ENCODE_STACK_SIZE (4096 * 7)
+
+WakeWordPreroll::WakeWordPreroll() {
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+    for (auto &frame : packet_frames_) {
+        frame = UINT64_MAX;
+    }
+#endif
+}
+
+WakeWordPreroll::~WakeWordPreroll() {
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+    if (encode_task_ != nullptr) {
+        vTaskDelete(encode_task_);
+    }
+#endif
+    if (pcm_ != nullptr) {
+        heap_caps_free(pcm_);
+    }
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+}
+
+void WakeWordPreroll::Store(const int16_t *data, size_t samples) {
+    uint64_t frames;
+    bool new_frame;
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        if (pcm_ == nullptr) {
+            pcm_ = (int16_t *)heap_caps_malloc(WAKE_WORD_PREROLL_CAPACITY * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+            assert(pcm_ != nullptr);
+        }
+        frames = written_ / WAKE_WORD_PREROLL_FRAME_SAMPLES;
+        while (samples > 0) {
+            size_t pos = written_ % WAKE_WORD_PREROLL_CAPACITY;
+            size_t n = std::min<size_t>(samples, WAKE_WORD_PREROLL_CAPACITY - pos);
+            memcpy(pcm_ + pos, data, n * sizeof(int16_t));
+            data += n;
+            samples -= n;
+            written_ += n;
+        }
+        new_frame = written_ / WAKE_WORD_PREROLL_FRAME_SAMPLES != frames;
+    }
+
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+    if (encode_task_ == nullptr) {
+        encoder_ = std::make_unique<UplinkEncoder>(16000, 1);
+        encode_task_stack_ = (StackType_t *)heap_caps_malloc(WAKE_WORD_ENCODE_STACK_SIZE, MALLOC_CAP_SPIRAM);
+        encode_task_buffer_ = (StaticTask_t *)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        assert(encode_task_stack_ != nullptr && encode_task_buffer_ != nullptr);
+        /* Below every audio task, it only has to keep up on average */
+        encode_task_ = xTaskCreateStatic([](void *arg) {
+            auto this_ = (WakeWordPreroll *)arg;
+            this_->EncodeTask();
+        }, "wake_word_preroll", WAKE_WORD_ENCODE_STACK_SIZE, this, 1, encode_task_stack_, encode_task_buffer_);
+    }
+    if (new_frame) {
+        xTaskNotifyGive(encode_task_);
+    }
+#else
+    (void)new_frame;
+#endif
+}
+
+uint64_t WakeWordPreroll::GetOldestFrame() const {
+    /* The frame being written has overwritten the start of the oldest slot */
+    uint64_t frames = (written_ + WAKE_WORD_PREROLL_FRAME_SAMPLES - 1) / WAKE_WORD_PREROLL_FRAME_SAMPLES;
+    return frames > WAKE_WORD_PREROLL_FRAMES ? frames - WAKE_WORD_PREROLL_FRAMES : 0;
+}
+
+bool WakeWordPreroll::GetFrame(uint64_t frame, std::vector<int16_t> &pcm) {
+    std::lock_guard<std::mutex> lock(pcm_mutex_);
+    if (pcm_ == nullptr || frame < GetOldestFrame() || frame >= written_ / WAKE_WORD_PREROLL_FRAME_SAMPLES) {
+        return false;
+    }
+    const int16_t *src = pcm_ + (frame * WAKE_WORD_PREROLL_FRAME_SAMPLES) % WAKE_WORD_PREROLL_CAPACITY;
+    pcm.assign(src, src + WAKE_WORD_PREROLL_FRAME_SAMPLES);
+    return true;
+}
+
+void WakeWordPreroll::PushOpus(std::vector<uint8_t> &&opus) {
+    std::lock_guard<std::mutex> lock(opus_mutex_);
+    opus_.emplace_back(std::move(opus));
+    opus_cv_.notify_all();
+}
+
+void WakeWordPreroll::Encode() {
+    {
+        std::lock_guard<std::mutex> lock(opus_mutex_);
+        opus_.clear();
+    }
+    detected_us_ = esp_timer_get_time();
+
+    /* The pre-roll is every complete frame still in the ring, later detections start after it */
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        encode_first_ = std::max(GetOldestFrame(), start_frame_);
+        encode_last_ = written_ / WAKE_WORD_PREROLL_FRAME_SAMPLES;
+        start_frame_ = encode_last_;
+    }
+
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+    /* Encode what the background task has not reached yet, then hand out the packets */
+    std::vector<int16_t> pcm;
+    while (EncodeNextFrame(pcm, encode_last_)) {
+    }
+
+    int packets = 0;
+    {
+        std::lock_guard<std::mutex> lock(encoder_mutex_);
+        for (uint64_t frame = encode_first_; frame < encode_last_; frame++) {
+            size_t slot = frame % WAKE_WORD_PREROLL_FRAMES;
+            if (packet_frames_[slot] == frame) {
+                PushOpus(std::vector<uint8_t>(packets_[slot]));
+                packets++;
+            }
+        }
+    }
+    ESP_LOGI(TAG, "Wake word pre-roll ready, %d packets in %ld ms", packets, (long)((esp_timer_get_time() - detected_us_.load()) / 1000));
+    PushOpus(std::vector<uint8_t>());
+#else
+    if (encode_task_stack_ == nullptr) {
+        encode_task_stack_ = (StackType_t *)heap_caps_malloc(WAKE_WORD_ENCODE_STACK_SIZE, MALLOC_CAP_SPIRAM);
+        assert(encode_task_stack_ != nullptr);
+    }
+    if (encode_task_buffer_ == nullptr) {
+        encode_task_buffer_ = (StaticTask_t *)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        assert(encode_task_buffer_ != nullptr);
+    }
+
+    encode_task_ = xTaskCreateStatic([](void *arg) {
+        auto this_ = (WakeWordPreroll *)arg;
+        this_->EncodeTask();
+        vTaskDelete(NULL);
+    }, "encode_wake_word", WAKE_WORD_ENCODE_STACK_SIZE, this, 2, encode_task_stack_, encode_task_buffer_);
+#endif
+}
+
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+void WakeWordPreroll::EncodeTask() {
+    std::vector<int16_t> pcm;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (EncodeNextFrame(pcm, UINT64_MAX)) {
+        }
+    }
+}
+
+bool WakeWordPreroll::EncodeNextFrame(std::vector<int16_t> &pcm, uint64_t end) {
+    std::lock_guard<std::mutex> lock(encoder_mutex_);
+    if (next_frame_ >= end) {
+        return false;
+    }
+    if (!GetFrame(next_frame_, pcm)) {
+        uint64_t oldest;
+        {
+            std::lock_guard<std::mutex> pcm_lock(pcm_mutex_);
+            oldest = GetOldestFrame();
+        }
+        if (next_frame_ >= oldest) {
+            // Not complete yet
+            return false;
+        }
+        /* Fell behind the ring, continue with the oldest frame and a fresh encoder state */
+        next_frame_ = oldest;
+        encoder_->ResetState();
+        return true;
+    }
+
+    size_t slot = next_frame_ % WAKE_WORD_PREROLL_FRAMES;
+    packet_frames_[slot] = encoder_->Encode(pcm, packets_[slot]) ? next_frame_ : UINT64_MAX;
+    next_frame_++;
+    return true;
+}
+#else
+void WakeWordPreroll::EncodeTask() {
+    auto start_time = esp_timer_get_time();
+    auto encoder = std::make_unique<UplinkEncoder>(16000, 1);
+
+    std::vector<int16_t> pcm;
+    int packets = 0;
+    for (uint64_t frame = encode_first_; frame < encode_last_; frame++) {
+        std::vector<uint8_t> opus;
+        if (GetFrame(frame, pcm) && encoder->Encode(pcm, opus)) {
+            PushOpus(std::move(opus));
+            packets++;
+        }
+    }
+
+    auto end_time = esp_timer_get_time();
+    ESP_LOGI(TAG, "Encode wake word opus %d packets in %ld ms", packets, (long)((end_time - start_time) / 1000));
+    PushOpus(std::vector<uint8_t>());
+}
+#endif
+
+bool WakeWordPreroll::GetOpus(std::vector<uint8_t> &opus) {
+    std::unique_lock<std::mutex> lock(opus_mutex_);
+    opus_cv_.wait(lock, [this]() {
+        return !opus_.empty();
+    });
+    opus.swap(opus_.front());
+    opus_.pop_front();
+    if (!opus.empty()) {
+        int64_t detected_us = detected_us_.exchange(0);
+        if (detected_us != 0) {
+            wake_to_first_packet_us_ = esp_timer_get_time() - detected_us;
+            ESP_LOGI(TAG, "Wake word to first packet: %ld ms", (long)(wake_to_first_packet_us_ / 1000));
+        }
+    }
+    return !opus.empty();
+}
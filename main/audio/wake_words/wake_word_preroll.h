@@ -0,0 +1,89 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "uplink_encoder.h"
+
+/*
+ * The last ~2 seconds of 16kHz mono audio before a wake word, sent to the server for speaker
+ * recognition.
+ *
+ * Samples go into a ring allocated once in PSRAM, so storing the 30ms detection chunks does not
+ * touch the heap. Frame n of the ring is samples [n * frame, (n + 1) * frame) of everything stored,
+ * the ring holds the latest WAKE_WORD_PREROLL_FRAMES frames.
+ *
+ * Encode() is called when the wake word fires and GetOpus() hands out the packets in order. By
+ * default Encode() starts a task that encodes the whole ring. With
+ * CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE a low priority task encodes every frame as soon as it is
+ * complete, so at detection only the last frame or two are left and the pre-roll is ready at once.
+ */
+
+#define WAKE_WORD_PREROLL_FRAME_MS 60
+#define WAKE_WORD_PREROLL_FRAME_SAMPLES (16000 / 1000 * WAKE_WORD_PREROLL_FRAME_MS)
+#define WAKE_WORD_PREROLL_FRAMES (2000 / WAKE_WORD_PREROLL_FRAME_MS)
+
+class WakeWordPreroll {
+  public:
+    WakeWordPreroll();
+    ~WakeWordPreroll();
+
+    /* Detection task */
+    void Store(const int16_t *data, size_t samples);
+    /* The wake word fired, make the stored audio available to GetOpus() */
+    void Encode();
+    /* Blocks until the next packet, returns false after the last one */
+    bool GetOpus(std::vector<uint8_t> &opus);
+    /* From the latest Encode() to the first packet GetOpus() handed out, -1 before there was one */
+    int64_t wake_to_first_packet_us() const { return wake_to_first_packet_us_; }
+
+  private:
+    int16_t *pcm_ = nullptr;
+    // Samples stored since the start, and the first frame that belongs to the next pre-roll
+    uint64_t written_ = 0;
+    uint64_t start_frame_ = 0;
+    std::mutex pcm_mutex_;
+    // Frames of the pre-roll being handed out
+    uint64_t encode_first_ = 0;
+    uint64_t encode_last_ = 0;
+
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t *encode_task_buffer_ = nullptr;
+    StackType_t *encode_task_stack_ = nullptr;
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+    std::unique_ptr<UplinkEncoder> encoder_;
+    std::mutex encoder_mutex_;
+    // Packets of the latest frames, slot n % WAKE_WORD_PREROLL_FRAMES holds frame n
+    std::vector<uint8_t> packets_[WAKE_WORD_PREROLL_FRAMES];
+    uint64_t packet_frames_[WAKE_WORD_PREROLL_FRAMES];
+    uint64_t next_frame_ = 0;
+#endif
+
+    std::deque<std::vector<uint8_t>> opus_;
+    std::mutex opus_mutex_;
+    std::condition_variable opus_cv_;
+    // Set by Encode() on the detection task, taken by GetOpus() on the sending task
+    std::atomic<int64_t> detected_us_{0};
+    std::atomic<int64_t> wake_to_first_packet_us_{-1};
+
+    /* First frame still complete in the ring, with pcm_mutex_ held */
+    uint64_t GetOldestFrame() const;
+    bool GetFrame(uint64_t frame, std::vector<int16_t> &pcm);
+    void PushOpus(std::vector<uint8_t> &&opus);
+    void EncodeTask();
+#if CONFIG_USE_WAKE_WORD_BACKGROUND_ENCODE
+    /* Encodes the next frame if it is complete and before `end` */
+    bool EncodeNextFrame(std::vector<int16_t> &pcm, uint64_t end);
+#endif
+};
+
+#endif // WAKE_WORD_PREROLL_H
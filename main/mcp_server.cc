@@ -61,6 +61,39 @@ void McpServer::AddCommonTools() {
                 return true;
             });
 
+    AddTool("self.audio.get_latency_stats",
+            "Get the latency histograms of every audio pipeline stage (mic read, processing, encode, send queue, decode queue, decode, playback).\n"
+            "Args:\n"
+            "  `reset`: Clear the histograms after reading them.\n"
+            "Return:\n"
+            "  A JSON object with the bucket bounds in milliseconds and, per stage, count / mean / p50 / p90 / p99 / max and bucket counts.",
+            PropertyList({Property("reset", kPropertyTypeBoolean, false)}),
+            [](const PropertyList &properties) -> ReturnValue {
+                auto &latency_stats = Application::GetInstance().GetAudioService().GetLatencyStats();
+                cJSON *json = latency_stats.ToJson();
+                if (properties["reset"].value<bool>()) {
+                    latency_stats.Reset();
+                }
+                return json;
+            });
+
+    AddTool("self.audio.get_uplink_cost",
+            "Get what the uplink costs: CPU time per frame of resampling, processing and encoding, encoded bytes per second and heap allocations, "
+            "each against the budget set in the firmware configuration.\n"
+            "Args:\n"
+            "  `reset`: Start measuring again after reading.\n"
+            "Return:\n"
+            "  A JSON object with `cpu_us_per_frame`, `bytes_per_second`, `allocations`, `budget` and `within_budget`.",
+            PropertyList({Property("reset", kPropertyTypeBoolean, false)}),
+            [](const PropertyList &properties) -> ReturnValue {
+                auto &uplink_cost = Application::GetInstance().GetAudioService().GetUplinkCost();
+                cJSON *json = uplink_cost.ToJson();
+                if (properties["reset"].value<bool>()) {
+                    uplink_cost.Reset();
+                }
+                return json;
+            });
+
     auto backlight = board.GetBacklight();
     if (backlight) {
         AddTool("self.screen.set_brightness",
@@ -0,0 +1,79 @@
+#include "audio_bundle.h"
+#include "audio_pool.h"
+
+#include <algorithm>
+
+void AudioBundler::SetFramesPerPacket(int frames) {
+    frames_per_packet_ = std::clamp(frames, 1, AUDIO_BUNDLE_MAX_FRAMES);
+    Clear();
+}
+
+bool AudioBundler::Continues(const AudioStreamPacket& packet) const {
+    if (frames_ == 0) {
+        return true;
+    }
+    if (packet.frame_duration != frame_duration_) {
+        return false;
+    }
+    /* The encoder skipped frames in between (DTX suppression, a pause), the timestamps would be off */
+    if (packet.origin_us > 0 && last_origin_us_ > 0 &&
+        packet.origin_us - last_origin_us_ > (int64_t)frame_duration_ * 1500) {
+        return false;
+    }
+    /* The receiver gives frame i the timestamp of the first plus i frames, a packet without a
+     * timestamp only joins frames without one */
+    uint32_t expected = timestamp_ > 0 ? timestamp_ + frames_ * frame_duration_ : 0;
+    if (packet.timestamp != expected) {
+        return false;
+    }
+    return true;
+}
+
+bool AudioBundler::Add(const AudioStreamPacket& packet) {
+    if (frames_ == 0) {
+        if (payload_.capacity() == 0) {
+            payload_.reserve(frames_per_packet_ * (AUDIO_POOL_PAYLOAD_RESERVE + 2));
+        }
+        timestamp_ = packet.timestamp;
+        origin_us_ = packet.origin_us;
+        frame_duration_ = packet.frame_duration;
+    }
+    size_t size = packet.payload.size();
+    payload_.push_back(size >> 8);
+    payload_.push_back(size & 0xFF);
+    payload_.insert(payload_.end(), packet.payload.begin(), packet.payload.end());
+    last_origin_us_ = packet.origin_us;
+    frames_++;
+    return frames_ >= frames_per_packet_ || packet.dtx;
+}
+
+void AudioBundler::Clear() {
+    frames_ = 0;
+    last_origin_us_ = 0;
+    payload_.clear();
+}
+
+bool AudioBundler::Split(const uint8_t* data, size_t size, const std::function<void(const uint8_t* frame, size_t frame_size)>& callback) {
+    /* Check the whole list first, a malformed bundle is dropped as a whole */
+    size_t offset = 0;
+    int frames = 0;
+    while (offset < size) {
+        if (size - offset < 2) {
+            return false;
+        }
+        size_t frame_size = (data[offset] << 8) | data[offset + 1];
+        offset += 2 + frame_size;
+        frames++;
+    }
+    if (offset != size || frames == 0 || frames > AUDIO_BUNDLE_MAX_FRAMES) {
+        return false;
+    }
+
+    offset = 0;
+    while (offset < size) {
+        size_t frame_size = (data[offset] << 8) | data[offset + 1];
+        callback(data + offset + 2, frame_size);
+        offset += 2 + frame_size;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef AUDIO_BUNDLE_H
+#define AUDIO_BUNDLE_H
+
+#include "protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Several consecutive Opus frames in one UDP datagram.
+ *
+ * Every datagram costs IP/UDP overhead and, on cellular modems, an AT command round trip. When both
+ * ends agree on frames_per_packet > 1, the sender collects that many frames and sends them as a
+ * length prefixed list:
+ *
+ * |size 2u|opus size| |size 2u|opus size| ...
+ *
+ * The transport header of such a datagram has the AUDIO_BUNDLE_FLAG set and describes the first
+ * frame: its sequence number and timestamp. Frame i has sequence + i and timestamp
+ * + i * frame_duration. A bundle is cut short by a DTX packet (silence should not wait), by a
+ * gap in the capture times and by a timestamp that does not follow on, so the frames of a bundle
+ * are always consecutive and their timestamps are the ones the receiver derives. The added latency is
+ * (frames_per_packet - 1) frames at most.
+ */
+
+#define AUDIO_BUNDLE_FLAG 0x01
+#define AUDIO_BUNDLE_MAX_FRAMES 4
+
+class AudioBundler {
+public:
+    /* 1 sends every frame on its own */
+    void SetFramesPerPacket(int frames);
+    int frames_per_packet() const { return frames_per_packet_; }
+    bool enabled() const { return frames_per_packet_ > 1; }
+
+    bool empty() const { return frames_ == 0; }
+    int frames() const { return frames_; }
+    /* Timestamp and capture time of the first pending frame */
+    uint32_t timestamp() const { return timestamp_; }
+    int64_t origin_us() const { return origin_us_; }
+    const std::vector<uint8_t>& payload() const { return payload_; }
+
+    /* Whether `packet` may join the pending frames, otherwise they have to be sent first */
+    bool Continues(const AudioStreamPacket& packet) const;
+    /* Returns true when the bundle is complete and should be sent */
+    bool Add(const AudioStreamPacket& packet);
+    void Clear();
+
+    /* Calls `callback` for every frame of a received bundle, returns false if it is malformed */
+    static bool Split(const uint8_t* data, size_t size, const std::function<void(const uint8_t* frame, size_t frame_size)>& callback);
+
+private:
+    int frames_per_packet_ = 1;
+    int frames_ = 0;
+    uint32_t timestamp_ = 0;
+    int64_t origin_us_ = 0;
+    int frame_duration_ = 0;
+    int64_t last_origin_us_ = 0;
+    std::vector<uint8_t> payload_;
+};
+
+#endif // AUDIO_BUNDLE_H
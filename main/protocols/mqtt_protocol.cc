@@ -4,6 +4,7 @@
 #include "settings.h"
 
 #include "assets/lang_config.h"
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cstring>
 #include <esp_log.h>
@@ -158,30 +159,76 @@ bool MqttProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         return false;
     }
 
-    std::string nonce(aes_nonce_);
-    *(uint16_t *)&nonce[2] = htons(packet->payload.size());
-    *(uint32_t *)&nonce[8] = htonl(packet->timestamp);
-    *(uint32_t *)&nonce[12] = htonl(++local_sequence_);
+    if (!bundler_.enabled()) {
+        return SendDatagram(packet->payload.data(), packet->payload.size(), packet->timestamp, 1, false);
+    }
+    bool result = true;
+    if (!bundler_.Continues(*packet)) {
+        result = SendBundle();
+    }
+    if (bundler_.Add(*packet)) {
+        result = SendBundle() && result;
+    }
+    return result;
+}
 
-    std::string encrypted;
-    encrypted.resize(aes_nonce_.size() + packet->payload.size());
-    memcpy(encrypted.data(), nonce.data(), nonce.size());
+/* Sends the pending frames, called with channel_mutex_ held */
+bool MqttProtocol::SendBundle() {
+    if (bundler_.empty()) {
+        return true;
+    }
+    auto &payload = bundler_.payload();
+    bool result = SendDatagram(payload.data(), payload.size(), bundler_.timestamp(), bundler_.frames(), true);
+    bundler_.Clear();
+    return result;
+}
+
+/* Encrypts `payload` behind the packet header into send_buffer_, called with channel_mutex_ held */
+bool MqttProtocol::SendDatagram(const uint8_t *payload, size_t size, uint32_t timestamp, int frames, bool bundle) {
+    uint8_t nonce[16];
+    if (aes_nonce_.size() != sizeof(nonce)) {
+        return false;
+    }
+    memcpy(nonce, aes_nonce_.data(), sizeof(nonce));
+    if (bundle) {
+        nonce[1] |= AUDIO_BUNDLE_FLAG;
+    }
+    *(uint16_t *)&nonce[2] = htons(size);
+    *(uint32_t *)&nonce[8] = htonl(timestamp);
+    /* The header carries the sequence number of the first frame */
+    *(uint32_t *)&nonce[12] = htonl(local_sequence_ + 1);
+    local_sequence_ += frames;
+
+    send_buffer_.resize(sizeof(nonce) + size);
+    memcpy(send_buffer_.data(), nonce, sizeof(nonce));
 
     size_t nc_off = 0;
     uint8_t stream_block[16] = {0};
-    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet->payload.size(), &nc_off, (uint8_t *)nonce.c_str(), stream_block,
-                              (uint8_t *)packet->payload.data(), (uint8_t *)&encrypted[nonce.size()]) != 0) {
+    if (mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off, nonce, stream_block,
+                              payload, (uint8_t *)&send_buffer_[sizeof(nonce)]) != 0) {
         ESP_LOGE(TAG, "Failed to encrypt audio data");
         return false;
     }
 
-    return udp_->Send(encrypted) > 0;
+    return udp_->Send(send_buffer_) > 0;
+}
+
+void MqttProtocol::SendStopListening() {
+    {
+        /* The end of the utterance should not wait for the bundle to fill up */
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        if (udp_ != nullptr) {
+            SendBundle();
+        }
+    }
+    Protocol::SendStopListening();
 }
 
 void MqttProtocol::CloseAudioChannel() {
     {
         std::lock_guard<std::mutex> lock(channel_mutex_);
         udp_.reset();
+        bundler_.Clear();
     }
 
     std::string message = "{";
@@ -228,6 +275,8 @@ bool MqttProtocol::OpenAudioChannel() {
          * UDP Encrypted OPUS Packet Format:
          * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
          * |payload payload_len|
+         *
+         * With AUDIO_BUNDLE_FLAG in flags the payload is a list of frames, see audio_bundle.h
          */
         if (data.size() < sizeof(aes_nonce_)) {
             ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
@@ -239,12 +288,9 @@ bool MqttProtocol::OpenAudioChannel() {
         }
         uint32_t timestamp = ntohl(*(uint32_t *)&data[8]);
         uint32_t sequence = ntohl(*(uint32_t *)&data[12]);
-        if (sequence < remote_sequence_) {
-            ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
-            return;
-        }
+        /* Late and out-of-order packets are handled by the jitter buffer in AudioService */
         if (sequence != remote_sequence_ + 1) {
-            ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
+            ESP_LOGD(TAG, "Received audio packet with sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
         }
 
         size_t decrypted_size = data.size() - aes_nonce_.size();
@@ -252,10 +298,40 @@ bool MqttProtocol::OpenAudioChannel() {
         uint8_t stream_block[16] = {0};
         auto nonce = (uint8_t *)data.data();
         auto encrypted = (uint8_t *)data.data() + aes_nonce_.size();
+        if ((data[1] & AUDIO_BUNDLE_FLAG) && bundler_.enabled()) {
+            receive_buffer_.resize(decrypted_size);
+            if (mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, receive_buffer_.data()) != 0) {
+                ESP_LOGE(TAG, "Failed to decrypt audio data");
+                return;
+            }
+            int index = 0;
+            bool valid = AudioBundler::Split(receive_buffer_.data(), receive_buffer_.size(), [&](const uint8_t *frame, size_t frame_size) {
+                auto packet = std::make_unique<AudioStreamPacket>();
+                packet->sample_rate = server_sample_rate_;
+                packet->frame_duration = server_frame_duration_;
+                packet->timestamp = timestamp > 0 ? timestamp + index * server_frame_duration_ : 0;
+                packet->sequence = sequence + index;
+                packet->payload.assign(frame, frame + frame_size);
+                index++;
+                if (on_incoming_audio_ != nullptr) {
+                    on_incoming_audio_(std::move(packet));
+                }
+            });
+            if (!valid) {
+                ESP_LOGE(TAG, "Invalid audio bundle of %u bytes", decrypted_size);
+                return;
+            }
+            if ((int32_t)(sequence + index - 1 - remote_sequence_) > 0) {
+                remote_sequence_ = sequence + index - 1;
+            }
+            last_incoming_time_ = std::chrono::steady_clock::now();
+            return;
+        }
         auto packet = std::make_unique<AudioStreamPacket>();
         packet->sample_rate = server_sample_rate_;
         packet->frame_duration = server_frame_duration_;
         packet->timestamp = timestamp;
+        packet->sequence = sequence;
         packet->payload.resize(decrypted_size);
         int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, (uint8_t *)packet->payload.data());
         if (ret != 0) {
@@ -265,7 +341,9 @@ bool MqttProtocol::OpenAudioChannel() {
         if (on_incoming_audio_ != nullptr) {
             on_incoming_audio_(std::move(packet));
         }
-        remote_sequence_ = sequence;
+        if ((int32_t)(sequence - remote_sequence_) > 0) {
+            remote_sequence_ = sequence;
+        }
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -293,7 +371,10 @@ std::string MqttProtocol::GetHelloMessage() {
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", Application::GetInstance().GetAudioService().frame_duration());
+#if CONFIG_AUDIO_FRAMES_PER_PACKET > 1
+    cJSON_AddNumberToObject(audio_params, "frames_per_packet", CONFIG_AUDIO_FRAMES_PER_PACKET);
+#endif
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -327,6 +408,12 @@ void MqttProtocol::ParseServerHello(const cJSON *root) {
             server_frame_duration_ = frame_duration->valueint;
         }
     }
+    /* Bundling is only used when the server answers with its own frames_per_packet */
+    auto frames_per_packet = cJSON_IsObject(audio_params) ? cJSON_GetObjectItem(audio_params, "frames_per_packet") : nullptr;
+    {
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        bundler_.SetFramesPerPacket(cJSON_IsNumber(frames_per_packet) ? std::min(frames_per_packet->valueint, CONFIG_AUDIO_FRAMES_PER_PACKET) : 1);
+    }
 
     auto udp = cJSON_GetObjectItem(root, "udp");
     if (!cJSON_IsObject(udp)) {
@@ -341,6 +428,10 @@ void MqttProtocol::ParseServerHello(const cJSON *root) {
     // auto encryption = cJSON_GetObjectItem(udp, "encryption")->valuestring;
     // ESP_LOGI(TAG, "UDP server: %s, port: %d, encryption: %s", udp_server_.c_str(), udp_port_, encryption);
     aes_nonce_ = DecodeHexString(nonce);
+    // The bundle flag in nonce[1] is set per datagram, a server nonce with it set would make every single frame look like a bundle
+    if (aes_nonce_.size() > 1) {
+        aes_nonce_[1] &= ~AUDIO_BUNDLE_FLAG;
+    }
     mbedtls_aes_init(&aes_ctx_);
     mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char *)DecodeHexString(key).c_str(), 128);
     local_sequence_ = 0;
@@ -3,6 +3,7 @@
 
 
 #include "protocol.h"
+#include "audio_bundle.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
@@ -31,6 +32,7 @@ public:
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
+    void SendStopListening() override;
 
 private:
     EventGroupHandle_t event_group_handle_;
@@ -42,6 +44,12 @@ private:
     std::unique_ptr<Udp> udp_;
     mbedtls_aes_context aes_ctx_;
     std::string aes_nonce_;
+    // Reused by SendAudio under channel_mutex_ so that sending a frame does not allocate
+    std::string send_buffer_;
+    // Frames waiting for the rest of their datagram when the server agreed on frames_per_packet > 1
+    AudioBundler bundler_;
+    // Decrypted bundles, owned by the UDP receive callback
+    std::vector<uint8_t> receive_buffer_;
     std::string udp_server_;
     int udp_port_;
     uint32_t local_sequence_;
@@ -54,6 +62,8 @@ private:
 
     bool SendText(const std::string& text) override;
     std::string GetHelloMessage();
+    bool SendDatagram(const uint8_t* payload, size_t size, uint32_t timestamp, int frames, bool bundle);
+    bool SendBundle();
 };
 
 
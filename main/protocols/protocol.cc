@@ -1,9 +1,28 @@
 #include "protocol.h"
+#include "audio_pool.h"
 
 #include <esp_log.h>
 
 #define TAG "Protocol"
 
+static_assert(sizeof(AudioStreamPacket) <= AUDIO_POOL_SLOT_SIZE, "AudioStreamPacket does not fit in an audio pool slot");
+
+AudioStreamPacket::AudioStreamPacket() {
+    AudioPool::GetInstance().AcquirePayload(payload);
+}
+
+AudioStreamPacket::~AudioStreamPacket() {
+    AudioPool::GetInstance().ReleasePayload(payload);
+}
+
+void* AudioStreamPacket::operator new(size_t size) {
+    return AudioPool::GetInstance().AllocatePacket(size);
+}
+
+void AudioStreamPacket::operator delete(void* ptr) {
+    AudioPool::GetInstance().FreePacket(ptr);
+}
+
 void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
     on_incoming_json_ = callback;
 }
@@ -5,12 +5,34 @@
 #include <string>
 #include <functional>
 #include <chrono>
+#include <memory>
 #include <vector>
 
+/* Packets and their payload buffers are recycled by AudioPool, see audio_pool.h */
 struct AudioStreamPacket {
+    AudioStreamPacket();
+    ~AudioStreamPacket();
+    AudioStreamPacket(const AudioStreamPacket&) = delete;
+    AudioStreamPacket& operator=(const AudioStreamPacket&) = delete;
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
+    // Transport sequence number, 0 if the transport does not have one (bypasses the jitter buffer)
+    uint32_t sequence = 0;
+    // esp_timer stamps for the audio latency histograms, see audio_latency.h
+    int64_t origin_us = 0;
+    int64_t queued_us = 0;
+    // Set on PlaySound packets whose decoded PCM is being captured, see sound_pcm_cache.h
+    uint32_t sound_id = 0;
+    uint32_t sound_frame = 0;
+    // A one byte DTX packet standing in for suppressed silence, the receiver conceals it
+    bool dtx = false;
+    // Silence from before speech onset, sent late; a receiver that is behind may drop it to catch up
+    bool preroll = false;
     std::vector<uint8_t> payload;
 };
 
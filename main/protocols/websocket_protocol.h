@@ -25,6 +25,8 @@ private:
     EventGroupHandle_t event_group_handle_;
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
+    // Reused by SendAudio so that framing a packet does not allocate
+    std::string send_buffer_;
 
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;
@@ -1,4 +1,6 @@
 #include "system_info.h"
+#include "audio_pool.h"
+#include "sound_pcm_cache.h"
 
 #include <freertos/task.h>
 #include <esp_log.h>
@@ -148,4 +150,15 @@ void SystemInfo::PrintHeapStats() {
     int free_sram = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
     int min_free_sram = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
     ESP_LOGI(TAG, "free sram: %u minimal sram: %u", free_sram, min_free_sram);
+
+    // Misses that keep growing after start-up mean the audio path is allocating per frame
+    auto pool = AudioPool::GetInstance().GetStatistics();
+    ESP_LOGI(TAG, "audio pool: packets %lu in use, %lu/%lu hit/miss, tasks %lu in use, %lu/%lu hit/miss, buffers %lu/%lu hit/miss",
+             pool.packets_in_use, pool.packet_hits, pool.packet_misses, pool.tasks_in_use, pool.task_hits, pool.task_misses,
+             pool.buffer_hits, pool.buffer_misses);
+
+#if CONFIG_USE_SOUND_PCM_CACHE
+    auto sounds = SoundPcmCache::GetInstance().GetStatistics();
+    ESP_LOGI(TAG, "sound pcm cache: %lu sounds, %lu bytes, %lu/%lu hit/miss", sounds.sounds, sounds.bytes, sounds.hits, sounds.misses);
+#endif
 }
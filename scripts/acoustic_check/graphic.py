@@ -1,4 +1,5 @@
 import sys
+import struct
 import numpy as np
 import asyncio
 import wave
@@ -19,6 +20,36 @@ from PyQt6.QtCore import QTimer
 # 导入解码器
 from demod import RealTimeAFSKDecoder
 
+# AudioDebugger 数据报头（见 main/audio/processors/audio_debugger.h），只取原始麦克风 tap
+AUDIO_DEBUG_HEADER = struct.Struct('!HBBBBHHHIII')
+AUDIO_DEBUG_MAGIC = 0x4144
+AUDIO_DEBUG_TAP_MIC = 0
+AUDIO_DEBUG_FLAG_COMPRESSED = 0x01
+
+
+def audio_debug_payload(data):
+    """去掉数据报头并解压，返回小端 int16 PCM；不是麦克风 tap 时返回 None"""
+    if len(data) < AUDIO_DEBUG_HEADER.size:
+        return None
+    magic, _, tap, flags, channels, _, _, count, _, _, _ = AUDIO_DEBUG_HEADER.unpack_from(data)
+    if magic != AUDIO_DEBUG_MAGIC or tap != AUDIO_DEBUG_TAP_MIC:
+        return None
+    payload = data[AUDIO_DEBUG_HEADER.size:]
+    if not flags & AUDIO_DEBUG_FLAG_COMPRESSED:
+        return payload
+    # 差分 + zigzag + 变长编码
+    samples = []
+    value = shift = 0
+    for byte in payload:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte & 0x80:
+            continue
+        previous = samples[-channels] if len(samples) >= channels else 0
+        samples.append(previous + ((value >> 1) ^ -(value & 1)))
+        value = shift = 0
+    return np.array(samples[:count * channels], dtype='<i2').tobytes()
+
 
 class UDPServerProtocol(asyncio.DatagramProtocol):
     """UDP服务器协议类"""
@@ -38,7 +69,9 @@ class UDPServerProtocol(asyncio.DatagramProtocol):
         # 只处理来自已记录客户端的数据
         if addr == self.client_address:
             # 将接收到的音频数据添加到队列
-            self.data_queue.extend(data)
+            pcm = audio_debug_payload(data)
+            if pcm is not None:
+                self.data_queue.extend(pcm)
         else:
             print(f"忽略来自未知地址 {addr} 的数据")
 
@@ -1,54 +1,215 @@
 import socket
+import struct
 import wave
 import argparse
+import time
+from array import array
 
 
 '''
-  Create a UDP socket and bind it to the server's IP:8000.
-  Listen for incoming messages and print them to the console.
-  Save the audio to a WAV file.
+  Receive the audio captured by AudioDebugger (CONFIG_USE_AUDIO_DEBUGGER) over UDP.
+
+  Every datagram starts with a header (see AudioDebugHeader in main/audio/processors/audio_debugger.h):
+  session, tap, sequence number and the esp_timer time of its first sample. Each session (a device
+  boot) is written to one multi-channel WAV file: every channel of every tap becomes a channel of
+  the file, placed by its timestamps and resampled to the highest tap rate, so the microphone and
+  the playback line up for AEC and latency analysis. Lost, late and duplicate datagrams are reported
+  (a late one is not counted as lost); lost audio is left silent instead of shifting everything
+  after it.
 '''
-def main(samplerate, channels):
+
+HEADER = struct.Struct('!HBBBBHHHIII')
+MAGIC = 0x4144
+FLAG_COMPRESSED = 0x01
+TAPS = ['mic', 'processed', 'decoded', 'playback']
+
+
+def decompress(payload, count, channels):
+    '''Delta + zigzag + 7 bit varint, the inverse of AudioDebugger::Compress'''
+    samples = array('h')
+    value = 0
+    shift = 0
+    for byte in payload:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte & 0x80:
+            continue
+        delta = (value >> 1) ^ -(value & 1)
+        previous = samples[-channels] if len(samples) >= channels else 0
+        samples.append(previous + delta)
+        value = 0
+        shift = 0
+    if len(samples) != count:
+        raise ValueError(f'expected {count} samples, got {len(samples)}')
+    return samples
+
+
+class TapStream:
+    # A datagram later than this stays counted as lost and is dropped
+    REORDER_WINDOW = 1024
+
+    def __init__(self, name, sample_rate, channels):
+        self.name = name
+        self.sample_rate = sample_rate
+        self.channels = channels
+        self.chunks = []  # (timestamp_us, interleaved samples)
+        self.next_sequence = None
+        self.missing = set()  # sequence numbers skipped by a gap that may still arrive late
+        self.datagrams = 0
+        self.lost = 0
+        self.reordered = 0
+        self.duplicates = 0
+
+    def add(self, sequence, timestamp, samples):
+        if self.next_sequence is not None and sequence < self.next_sequence:
+            if sequence not in self.missing:
+                # A duplicate, or later than REORDER_WINDOW
+                self.duplicates += 1
+                return
+            # Late, not lost: it was counted as lost by the gap it left
+            self.missing.discard(sequence)
+            self.lost -= 1
+            self.reordered += 1
+        elif self.next_sequence is not None and sequence > self.next_sequence:
+            missing = sequence - self.next_sequence
+            self.lost += missing
+            self.missing.update(range(max(self.next_sequence, sequence - self.REORDER_WINDOW), sequence))
+            print(f'[{self.name}] gap: {missing} datagram(s) lost before #{sequence}')
+        if self.next_sequence is None or sequence >= self.next_sequence:
+            self.next_sequence = sequence + 1
+            if self.missing:
+                self.missing = {s for s in self.missing if s >= sequence - self.REORDER_WINDOW}
+        self.datagrams += 1
+        self.chunks.append((timestamp, samples))
+
+    def span(self):
+        start = min(ts for ts, _ in self.chunks)
+        end = max(ts + len(s) // self.channels * 1000000 // self.sample_rate for ts, s in self.chunks)
+        return start, end
+
+
+class Session:
+    def __init__(self, session_id):
+        self.session_id = session_id
+        self.taps = {}
+        self.last_seen = time.time()
+
+    def add(self, tap, sample_rate, channels, sequence, timestamp, samples):
+        stream = self.taps.get(tap)
+        if stream is None:
+            name = TAPS[tap] if tap < len(TAPS) else f'tap{tap}'
+            stream = self.taps[tap] = TapStream(name, sample_rate, channels)
+            print(f'Session {self.session_id:04x}: {name} at {sample_rate}Hz, {channels} channel(s)')
+        stream.add(sequence, timestamp, samples)
+        self.last_seen = time.time()
+
+    def save(self, output_rate=None):
+        if not self.taps:
+            return
+        streams = [self.taps[tap] for tap in sorted(self.taps)]
+        rate = output_rate or max(s.sample_rate for s in streams)
+        spans = [s.span() for s in streams]
+        start = min(a for a, _ in spans)
+        end = max(b for _, b in spans)
+        length = (end - start) * rate // 1000000 + 1
+
+        channels = []
+        names = []
+        for stream in streams:
+            tracks = [array('h', bytes(2 * length)) for _ in range(stream.channels)]
+            for timestamp, samples in stream.chunks:
+                frames = len(samples) // stream.channels
+                out_frames = frames * rate // stream.sample_rate
+                offset = (timestamp - start) * rate // 1000000
+                for c, track in enumerate(tracks):
+                    source = samples[c::stream.channels]
+                    for i in range(out_frames):
+                        position = offset + i
+                        if position >= length:
+                            break
+                        if out_frames == frames:
+                            track[position] = source[i]
+                            continue
+                        # Linear interpolation within the chunk
+                        x = i * stream.sample_rate / rate
+                        k = int(x)
+                        frac = x - k
+                        b = source[k + 1] if k + 1 < frames else source[k]
+                        track[position] = int(source[k] + (b - source[k]) * frac)
+            channels.extend(tracks)
+            names.extend(stream.name if stream.channels == 1 else f'{stream.name}/{c}' for c in range(stream.channels))
+
+        frames = array('h', bytes(2 * length * len(channels)))
+        for c, track in enumerate(channels):
+            frames[c::len(channels)] = track
+
+        filename = f"capture_{self.session_id:04x}_{time.strftime('%Y%m%d_%H%M%S')}.wav"
+        with wave.open(filename, 'wb') as wav_file:
+            wav_file.setnchannels(len(channels))
+            wav_file.setsampwidth(2)
+            wav_file.setframerate(rate)
+            wav_file.writeframes(frames.tobytes())
+
+        print(f"Saved '{filename}': {length / rate:.1f}s at {rate}Hz, channels: {', '.join(names)}")
+        for stream in streams:
+            print(f'  {stream.name}: {stream.datagrams} datagrams, {stream.lost} lost, {stream.reordered} reordered, '
+                  f'{stream.duplicates} duplicate')
+
+
+def main(port, samplerate, idle):
     # Create a UDP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    server_socket.bind(('0.0.0.0', 8000))
+    server_socket.bind(('0.0.0.0', port))
+    server_socket.settimeout(0.5)
 
-    # Create WAV file with parameters
-    filename = f"{samplerate}_{channels}.wav"
-    wav_file = wave.open(filename, "wb")
-    wav_file.setnchannels(channels)     # channels parameter
-    wav_file.setsampwidth(2)            # 2 bytes per sample (16-bit)
-    wav_file.setframerate(samplerate)   # samplerate parameter
-
-    print(f"Start saving audio from 0.0.0.0:8000 to {filename}...")
+    print(f"Start receiving audio captures on 0.0.0.0:{port}...")
+    sessions = {}
 
     try:
         while True:
-            # Receive a message from the client
-            message, address = server_socket.recvfrom(8000)
-            
-            # Write PCM data to WAV file
-            wav_file.writeframes(message)
-
-            # Print length of the message
-            print(f"Received {len(message)} bytes from {address}")
-    
+            try:
+                message, address = server_socket.recvfrom(2048)
+            except socket.timeout:
+                message = None
+
+            if message is not None and len(message) >= HEADER.size:
+                (magic, version, tap, flags, channels, sample_rate, session_id, count, sequence,
+                 ts_high, ts_low) = HEADER.unpack_from(message)
+                if magic != MAGIC or channels == 0:
+                    print(f"Ignoring {len(message)} bytes from {address}, not an audio capture")
+                    continue
+                payload = message[HEADER.size:]
+                if flags & FLAG_COMPRESSED:
+                    samples = decompress(payload, count * channels, channels)
+                else:
+                    samples = array('h', payload)
+                session = sessions.get(session_id)
+                if session is None:
+                    session = sessions[session_id] = Session(session_id)
+                session.add(tap, sample_rate, channels, sequence, (ts_high << 32) | ts_low, samples)
+
+            # A session without traffic for a while is over (the device rebooted or stopped)
+            now = time.time()
+            for session_id in [s for s, session in sessions.items() if now - session.last_seen > idle]:
+                sessions.pop(session_id).save(samplerate)
+
     except KeyboardInterrupt:
         print("\nStopping recording...")
-    
+
     finally:
-        # Close files and socket
-        wav_file.close()
+        for session in sessions.values():
+            session.save(samplerate)
         server_socket.close()
-        print(f"WAV file '{filename}' saved successfully")
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='UDP音频数据接收器，保存为WAV文件')
-    parser.add_argument('--samplerate', '-s', type=int, default=16000, 
-                        help='采样率 (默认: 16000)')
-    parser.add_argument('--channels', '-c', type=int, default=2, 
-                        help='声道数 (默认: 2)')
-    
+    parser = argparse.ArgumentParser(description='UDP音频抓取接收器，每个会话保存为一个对齐的多声道WAV文件')
+    parser.add_argument('--port', '-p', type=int, default=8000,
+                        help='UDP端口 (默认: 8000)')
+    parser.add_argument('--samplerate', '-s', type=int, default=None,
+                        help='输出采样率 (默认: 各tap中最高的采样率)')
+    parser.add_argument('--idle', type=float, default=5.0,
+                        help='会话无数据多少秒后保存 (默认: 5)')
+
     args = parser.parse_args()
-    main(args.samplerate, args.channels)
+    main(args.port, args.samplerate, args.idle)
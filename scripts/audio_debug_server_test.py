@@ -0,0 +1,83 @@
+import json
+import os
+import sys
+import unittest
+from array import array
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import audio_debug_server  # noqa: E402
+
+
+'''
+  Tests of audio_debug_server.py: the loss accounting of TapStream, and decompress against the bytes
+  AudioDebugger::Compress produces (test/data/audio_debug_compress.json, which
+  test/unit/audio_debugger_test.cc checks on the device side).
+
+  python3 scripts/audio_debug_server_test.py
+'''
+
+FIXTURE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'test', 'data', 'audio_debug_compress.json')
+
+
+def feed(stream, sequences):
+    for sequence in sequences:
+        stream.add(sequence, sequence * 20000, array('h', [sequence]))
+
+
+class TapStreamTest(unittest.TestCase):
+    def setUp(self):
+        self.stream = audio_debug_server.TapStream('mic', 16000, 1)
+
+    def test_in_order(self):
+        feed(self.stream, [0, 1, 2, 3])
+        self.assertEqual((self.stream.lost, self.stream.reordered, self.stream.duplicates), (0, 0, 0))
+        self.assertEqual(self.stream.datagrams, 4)
+
+    def test_gap_is_lost(self):
+        feed(self.stream, [0, 1, 4, 5])
+        self.assertEqual(self.stream.lost, 2)
+        self.assertEqual(self.stream.reordered, 0)
+
+    def test_late_datagram_is_not_lost(self):
+        feed(self.stream, [0, 1, 3, 4, 2])
+        self.assertEqual(self.stream.lost, 0)
+        self.assertEqual(self.stream.reordered, 1)
+        self.assertEqual(self.stream.datagrams, 5)
+
+    def test_partly_filled_gap(self):
+        feed(self.stream, [0, 5, 3, 1])
+        self.assertEqual(self.stream.lost, 2)
+        self.assertEqual(self.stream.reordered, 2)
+
+    def test_duplicates_are_dropped(self):
+        feed(self.stream, [0, 1, 1, 3, 2, 2])
+        self.assertEqual(self.stream.duplicates, 2)
+        self.assertEqual(self.stream.lost, 0)
+        self.assertEqual(self.stream.reordered, 1)
+        self.assertEqual(len(self.stream.chunks), 4)
+
+    def test_too_late_stays_lost(self):
+        window = audio_debug_server.TapStream.REORDER_WINDOW
+        feed(self.stream, [0, 2, window + 10, 1])
+        self.assertEqual(self.stream.lost, window + 8)
+        self.assertEqual(self.stream.reordered, 0)
+
+
+class DecompressTest(unittest.TestCase):
+    def test_matches_the_device(self):
+        with open(FIXTURE) as file:
+            fixture = json.load(file)
+        samples = audio_debug_server.decompress(bytes.fromhex(fixture['compressed']), len(fixture['samples']),
+                                                fixture['channels'])
+        self.assertEqual(list(samples), fixture['samples'])
+
+    def test_wrong_count_is_rejected(self):
+        with open(FIXTURE) as file:
+            fixture = json.load(file)
+        with self.assertRaises(ValueError):
+            audio_debug_server.decompress(bytes.fromhex(fixture['compressed']), len(fixture['samples']) + 1,
+                                          fixture['channels'])
+
+
+if __name__ == '__main__':
+    unittest.main()
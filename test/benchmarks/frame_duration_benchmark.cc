@@ -0,0 +1,209 @@
+/*
+ * Compares the 20, 40 and 60ms frame profiles (AudioService::SetFrameDuration, the intercom uses
+ * CONFIG_FBT_INTERCOM_FRAME_DURATION) on the host pipeline of pipeline_benchmark:
+ *
+ *   WAV mic -> AudioService uplink -> send queue -> loopback -> decode queue -> mixer -> WAV speaker
+ *
+ * For every profile it reports the CPU time of the process per second of audio, the packets per
+ * second the transport has to send, and the device part of the talk-to-hear delay: the frame
+ * itself (its first sample waits a frame for the read), the uplink (mic read -> send queue pop)
+ * and the downlink (arrival -> codec write) latency, mean and p90.
+ *
+ *   frame_duration_benchmark [--input mic.wav] [--seconds N] [--json result.json] [--smoke]
+ *
+ * The codec is paced like I2S. CPU numbers are only meaningful with libopus.
+ */
+#include <cJSON.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+#include "wav_file.h"
+
+namespace {
+
+const int kFrameDurations[] = {20, 40, 60};
+
+struct Options {
+    std::string input;
+    std::string json;
+    int seconds = 10;
+};
+
+struct Profile {
+    int frame_ms = 0;
+    uint32_t frames = 0;
+    double cpu_us_per_second = 0;
+    double packets_per_second = 0;
+    double uplink_mean_ms = 0;
+    int uplink_p90_ms = 0;
+    double downlink_mean_ms = 0;
+    int downlink_p90_ms = 0;
+
+    double talk_to_hear_ms() const { return frame_ms + uplink_mean_ms + downlink_mean_ms; }
+};
+
+int64_t ProcessCpuUs() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+double MeanMs(const LatencyHistogram &histogram) {
+    cJSON *json = histogram.ToJson();
+    cJSON *mean = cJSON_GetObjectItem(json, "mean_ms");
+    double value = cJSON_IsNumber(mean) ? mean->valuedouble : 0;
+    cJSON_Delete(json);
+    return value;
+}
+
+Profile Run(const WavFile &input, int frame_ms, int run_ms) {
+    WavAudioCodec codec(input, 24000);
+    AudioService service;
+    service.Initialize(&codec);
+    service.SetFrameDuration(frame_ms);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool send_ready = false;
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        send_ready = true;
+        cv.notify_one();
+    };
+    service.SetCallbacks(callbacks);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    /* Every uplink packet comes straight back as a downlink packet */
+    std::atomic<bool> running{true};
+    std::atomic<uint32_t> looped{0};
+    std::thread loopback([&]() {
+        while (running) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait_for(lock, std::chrono::milliseconds(50), [&]() { return send_ready; });
+                send_ready = false;
+            }
+            while (auto packet = service.PopPacketFromSendQueue()) {
+                packet->sequence = 0;
+                service.PushPacketToDecodeQueue(std::move(packet), true);
+                looped++;
+            }
+        }
+    });
+
+    int64_t cpu_before = ProcessCpuUs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(run_ms));
+    int64_t cpu_us = ProcessCpuUs() - cpu_before;
+    running = false;
+    loopback.join();
+    service.Stop();
+    host_task_join_all();
+
+    auto &stats = service.GetLatencyStats();
+    Profile profile;
+    profile.frame_ms = frame_ms;
+    profile.frames = stats.Get(kAudioStageEncode).count();
+    profile.cpu_us_per_second = cpu_us * 1000.0 / run_ms;
+    profile.packets_per_second = looped * 1000.0 / run_ms;
+    profile.uplink_mean_ms = MeanMs(stats.Get(kAudioStageUplink));
+    profile.uplink_p90_ms = stats.Get(kAudioStageUplink).GetPercentileMs(90);
+    profile.downlink_mean_ms = MeanMs(stats.Get(kAudioStageDownlink));
+    profile.downlink_p90_ms = stats.Get(kAudioStageDownlink).GetPercentileMs(90);
+    return profile;
+}
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--smoke") {
+            options.seconds = 2;
+        } else if (arg == "--input" && i + 1 < argc) {
+            options.input = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.json = argv[++i];
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.seconds > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: frame_duration_benchmark [--input mic.wav] [--seconds N] [--json result.json] [--smoke]\n");
+        return 2;
+    }
+
+    WavFile input;
+    if (options.input.empty()) {
+        input = SynthesizeSpeech(16000, 1, options.seconds * 1000);
+    } else if (!ReadWav(options.input, input)) {
+        return 1;
+    }
+    if (input.channels > 2) {
+        fprintf(stderr, "Only mono or mic + reference input is supported\n");
+        return 1;
+    }
+    int run_ms = std::min((int)(input.frames() * 1000 / input.sample_rate), options.seconds * 1000);
+
+    printf("frame duration profiles, %d ms of %d Hz x%d input, codec %s\n", run_ms, input.sample_rate, input.channels,
+           HOST_OPUS_CODEC);
+    printf("%-8s %8s %12s %10s %12s %10s %12s %10s %14s\n", "frame", "frames", "cpu us/s", "packets/s", "uplink ms", "p90 ms",
+           "downlink ms", "p90 ms", "talk-to-hear");
+    cJSON *profiles = cJSON_CreateArray();
+    int failures = 0;
+    for (int frame_ms : kFrameDurations) {
+        auto profile = Run(input, frame_ms, run_ms);
+        printf("%5d ms %8u %12.0f %10.1f %12.1f %10d %12.1f %10d %11.1f ms\n", profile.frame_ms, profile.frames,
+               profile.cpu_us_per_second, profile.packets_per_second, profile.uplink_mean_ms, profile.uplink_p90_ms,
+               profile.downlink_mean_ms, profile.downlink_p90_ms, profile.talk_to_hear_ms());
+        if (profile.frames == 0) {
+            fprintf(stderr, "No frame was encoded at %d ms\n", frame_ms);
+            failures++;
+        }
+
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddNumberToObject(json, "frame_ms", profile.frame_ms);
+        cJSON_AddNumberToObject(json, "frames", profile.frames);
+        cJSON_AddNumberToObject(json, "cpu_us_per_second", profile.cpu_us_per_second);
+        cJSON_AddNumberToObject(json, "packets_per_second", profile.packets_per_second);
+        cJSON_AddNumberToObject(json, "uplink_mean_ms", profile.uplink_mean_ms);
+        cJSON_AddNumberToObject(json, "uplink_p90_ms", profile.uplink_p90_ms);
+        cJSON_AddNumberToObject(json, "downlink_mean_ms", profile.downlink_mean_ms);
+        cJSON_AddNumberToObject(json, "downlink_p90_ms", profile.downlink_p90_ms);
+        cJSON_AddNumberToObject(json, "talk_to_hear_ms", profile.talk_to_hear_ms());
+        cJSON_AddItemToArray(profiles, json);
+    }
+
+    if (!options.json.empty()) {
+        cJSON *root = cJSON_CreateObject();
+        cJSON_AddStringToObject(root, "codec", HOST_OPUS_CODEC);
+        cJSON_AddItemToObject(root, "profiles", profiles);
+        char *text = cJSON_Print(root);
+        std::ofstream(options.json) << text << "\n";
+        cJSON_free(text);
+        cJSON_Delete(root);
+    } else {
+        cJSON_Delete(profiles);
+    }
+    return failures == 0 ? 0 : 1;
+}
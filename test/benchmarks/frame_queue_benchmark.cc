@@ -0,0 +1,225 @@
+/*
+ * Contention benchmark of the AudioService queues: the old design, std::deque queues behind one
+ * mutex and one condition variable with notify_all on every change, against AudioFrameRing with a
+ * NOT_EMPTY / NOT_FULL event group bit per ring.
+ *
+ * Both run the topology of AudioService with split codec tasks, unpaced:
+ *   mic -> {encode, 2} -> encoder -> {send, 40} -> network
+ *   network -> {decode, 40} -> decoder -> {playback, 2} -> speaker
+ * and report the wall time per frame, the push-to-pop latency of each direction and how often a
+ * waiting task was woken up, per frame.
+ *
+ *   frame_queue_benchmark [--frames N] [--work-us N] [--smoke]
+ *
+ * On the host the event group is itself a mutex and a condition variable, so the ring's gain here
+ * comes from waking only the stage that can proceed; on the device the rings also take no lock.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include "audio_frame_ring.h"
+
+namespace {
+
+struct Frame {
+    int64_t origin_us;
+};
+
+enum Queue { kEncode, kSend, kDecode, kPlayback, kQueueCount };
+
+const size_t kLimits[kQueueCount] = {2, 40, 40, 2};
+
+/* Before: every queue behind audio_queue_mutex_, every change wakes every waiter */
+class LockedQueues {
+  public:
+    void Push(Queue queue, std::unique_ptr<Frame> frame) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Wait(lock, [&]() { return queues_[queue].size() < kLimits[queue]; });
+        queues_[queue].push_back(std::move(frame));
+        cv_.notify_all();
+    }
+
+    std::unique_ptr<Frame> Pop(Queue queue) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Wait(lock, [&]() { return !queues_[queue].empty(); });
+        auto frame = std::move(queues_[queue].front());
+        queues_[queue].pop_front();
+        cv_.notify_all();
+        return frame;
+    }
+
+    uint64_t wakeups() const { return wakeups_; }
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Frame>> queues_[kQueueCount];
+    std::atomic<uint64_t> wakeups_{0};
+
+    template <typename Predicate>
+    void Wait(std::unique_lock<std::mutex> &lock, Predicate ready) {
+        while (!ready()) {
+            cv_.wait(lock);
+            wakeups_++;
+        }
+    }
+};
+
+/* After: AudioFrameRing per queue, each ring with its own bits like AS_EVENT_*_NOT_EMPTY / NOT_FULL */
+class RingQueues {
+  public:
+    RingQueues() {
+        event_group_ = xEventGroupCreate();
+        for (int i = 0; i < kQueueCount; i++) {
+            rings_[i] = std::make_unique<AudioFrameRing<Frame>>(kLimits[i]);
+        }
+    }
+
+    ~RingQueues() { vEventGroupDelete(event_group_); }
+
+    void Push(Queue queue, std::unique_ptr<Frame> frame) {
+        while (!rings_[queue]->TryPush(frame)) {
+            xEventGroupWaitBits(event_group_, NotFull(queue), pdTRUE, pdFALSE, portMAX_DELAY);
+            wakeups_++;
+        }
+        xEventGroupSetBits(event_group_, NotEmpty(queue));
+    }
+
+    std::unique_ptr<Frame> Pop(Queue queue) {
+        std::unique_ptr<Frame> frame;
+        while (!(frame = rings_[queue]->Pop())) {
+            xEventGroupWaitBits(event_group_, NotEmpty(queue), pdTRUE, pdFALSE, portMAX_DELAY);
+            wakeups_++;
+        }
+        xEventGroupSetBits(event_group_, NotFull(queue));
+        return frame;
+    }
+
+    uint64_t wakeups() const { return wakeups_; }
+
+  private:
+    EventGroupHandle_t event_group_;
+    std::unique_ptr<AudioFrameRing<Frame>> rings_[kQueueCount];
+    std::atomic<uint64_t> wakeups_{0};
+
+    static EventBits_t NotEmpty(Queue queue) { return 1 << (queue * 2); }
+    static EventBits_t NotFull(Queue queue) { return 1 << (queue * 2 + 1); }
+};
+
+void Work(int work_us) {
+    if (work_us <= 0) {
+        return;
+    }
+    int64_t until = esp_timer_get_time() + work_us;
+    while (esp_timer_get_time() < until) {
+    }
+}
+
+struct Result {
+    double wall_us_per_frame;
+    int64_t uplink_p50_us, uplink_p99_us;
+    int64_t downlink_p50_us, downlink_p99_us;
+    double wakeups_per_frame;
+};
+
+int64_t Percentile(std::vector<int64_t> &values, int percentile) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * percentile / 100)];
+}
+
+template <typename Queues>
+Result Run(int frames, int work_us) {
+    Queues queues;
+    std::vector<int64_t> uplink(frames), downlink(frames);
+
+    auto source = [&](Queue queue) {
+        for (int i = 0; i < frames; i++) {
+            queues.Push(queue, std::unique_ptr<Frame>(new Frame{esp_timer_get_time()}));
+        }
+    };
+    auto stage = [&](Queue from, Queue to) {
+        for (int i = 0; i < frames; i++) {
+            auto frame = queues.Pop(from);
+            Work(work_us);
+            queues.Push(to, std::move(frame));
+        }
+    };
+    auto sink = [&](Queue queue, std::vector<int64_t> &latency) {
+        for (int i = 0; i < frames; i++) {
+            auto frame = queues.Pop(queue);
+            latency[i] = esp_timer_get_time() - frame->origin_us;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread threads[] = {
+        std::thread(source, kEncode),
+        std::thread(stage, kEncode, kSend),
+        std::thread(sink, kSend, std::ref(uplink)),
+        std::thread(source, kDecode),
+        std::thread(stage, kDecode, kPlayback),
+        std::thread(sink, kPlayback, std::ref(downlink)),
+    };
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    Result result;
+    result.wall_us_per_frame = (double)elapsed_us / frames;
+    result.uplink_p50_us = Percentile(uplink, 50);
+    result.uplink_p99_us = Percentile(uplink, 99);
+    result.downlink_p50_us = Percentile(downlink, 50);
+    result.downlink_p99_us = Percentile(downlink, 99);
+    result.wakeups_per_frame = (double)queues.wakeups() / frames;
+    return result;
+}
+
+void Print(const char *name, const Result &result) {
+    printf("%-22s %10.2f %10lld %10lld %10lld %10lld %10.2f\n", name, result.wall_us_per_frame, (long long)result.uplink_p50_us,
+           (long long)result.uplink_p99_us, (long long)result.downlink_p50_us, (long long)result.downlink_p99_us,
+           result.wakeups_per_frame);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int frames = 100000;
+    int work_us = 5;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--smoke") {
+            frames = 2000;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (arg == "--work-us" && i + 1 < argc) {
+            work_us = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: frame_queue_benchmark [--frames N] [--work-us N] [--smoke]\n");
+            return 2;
+        }
+    }
+    if (frames <= 0) {
+        return 2;
+    }
+
+    printf("%d frames per direction, %d us of codec work per frame\n", frames, work_us);
+    printf("%-22s %10s %10s %10s %10s %10s %10s\n", "queues", "us/frame", "up p50", "up p99", "down p50", "down p99", "wakeups");
+    Print("mutex + condvar", Run<LockedQueues>(frames, work_us));
+    Print("AudioFrameRing", Run<RingQueues>(frames, work_us));
+    return 0;
+}
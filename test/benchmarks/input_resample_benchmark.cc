@@ -0,0 +1,179 @@
+/*
+ * Microbenchmark of the resampling step of AudioService::ReadAudioData for a codec that does not
+ * run at 16kHz: the old code, which built four temporary vectors per stereo read (one for mono),
+ * against the current one, which splits into [mic | reference] scratch buffers in one pass and
+ * interleaves straight back into the caller's vector.
+ *
+ *   input_resample_benchmark [--reads N] [--frame-ms N] [--smoke]
+ *
+ * Both variants are copies of the ReadAudioData bodies, run at 24kHz and 48kHz, mono and mic +
+ * reference. The host OpusResampler interpolates linearly instead of running SILK, so the absolute
+ * numbers understate the resampler's share; the split / interleave and allocation difference is
+ * what this measures.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <opus_resampler.h>
+
+#include "heap_counter.h"
+
+namespace {
+
+/* ReadAudioData before the scratch buffers */
+class OldInput {
+  public:
+    OldInput(int codec_rate) {
+        input_resampler_.Configure(codec_rate, 16000);
+        reference_resampler_.Configure(codec_rate, 16000);
+    }
+
+    void Resample(std::vector<int16_t> &data, int channels) {
+        if (channels == 2) {
+            auto mic_channel = std::vector<int16_t>(data.size() / 2);
+            auto reference_channel = std::vector<int16_t>(data.size() / 2);
+            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
+                mic_channel[i] = data[j];
+                reference_channel[i] = data[j + 1];
+            }
+            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
+            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
+            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
+            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
+            data.resize(resampled_mic.size() + resampled_reference.size());
+            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
+                data[j] = resampled_mic[i];
+                data[j + 1] = resampled_reference[i];
+            }
+        } else {
+            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
+            input_resampler_.Process(data.data(), data.size(), resampled.data());
+            data = std::move(resampled);
+        }
+    }
+
+  private:
+    OpusResampler input_resampler_;
+    OpusResampler reference_resampler_;
+};
+
+/* ReadAudioData as it is now */
+class NewInput {
+  public:
+    NewInput(int codec_rate) {
+        input_resampler_.Configure(codec_rate, 16000);
+        reference_resampler_.Configure(codec_rate, 16000);
+    }
+
+    void Resample(std::vector<int16_t> &data, int channels) {
+        if (channels == 2) {
+            size_t frames = data.size() / 2;
+            input_split_buffer_.resize(data.size());
+            int16_t *mic = input_split_buffer_.data();
+            int16_t *reference = mic + frames;
+            const int16_t *src = data.data();
+            for (size_t i = 0; i < frames; ++i, src += 2) {
+                mic[i] = src[0];
+                reference[i] = src[1];
+            }
+
+            size_t resampled_frames = input_resampler_.GetOutputSamples(frames);
+            input_resampled_buffer_.resize(resampled_frames * 2);
+            int16_t *resampled_mic = input_resampled_buffer_.data();
+            int16_t *resampled_reference = resampled_mic + resampled_frames;
+            input_resampler_.Process(mic, frames, resampled_mic);
+            reference_resampler_.Process(reference, frames, resampled_reference);
+
+            data.resize(resampled_frames * 2);
+            int16_t *dst = data.data();
+            for (size_t i = 0; i < resampled_frames; ++i, dst += 2) {
+                dst[0] = resampled_mic[i];
+                dst[1] = resampled_reference[i];
+            }
+        } else {
+            input_resampled_buffer_.resize(input_resampler_.GetOutputSamples(data.size()));
+            input_resampler_.Process(data.data(), data.size(), input_resampled_buffer_.data());
+            data.assign(input_resampled_buffer_.begin(), input_resampled_buffer_.end());
+        }
+    }
+
+  private:
+    OpusResampler input_resampler_;
+    OpusResampler reference_resampler_;
+    std::vector<int16_t> input_split_buffer_;
+    std::vector<int16_t> input_resampled_buffer_;
+};
+
+struct Result {
+    double ns_per_read;
+    double allocations_per_read;
+};
+
+template <typename Input>
+Result Run(int codec_rate, int channels, int frame_ms, int reads) {
+    Input input(codec_rate);
+    size_t samples = (size_t)codec_rate * frame_ms / 1000 * channels;
+    std::vector<int16_t> codec_data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        codec_data[i] = (int16_t)((i * 7919) & 0x3fff);
+    }
+    // The caller's vector, like the one AudioService reuses for every read
+    std::vector<int16_t> data;
+    data.reserve(samples);
+
+    heap_counter::Scope scope;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++) {
+        data.assign(codec_data.begin(), codec_data.end());
+        input.Resample(data, channels);
+    }
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return {(double)elapsed_ns / reads, (double)scope.allocations() / reads};
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int reads = 200000;
+    int frame_ms = 30;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--smoke") {
+            reads = 2000;
+        } else if (arg == "--reads" && i + 1 < argc) {
+            reads = atoi(argv[++i]);
+        } else if (arg == "--frame-ms" && i + 1 < argc) {
+            frame_ms = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: input_resample_benchmark [--reads N] [--frame-ms N] [--smoke]\n");
+            return 2;
+        }
+    }
+    if (reads <= 0 || frame_ms <= 0) {
+        return 2;
+    }
+
+    printf("%d reads of %d ms per case\n", reads, frame_ms);
+    printf("%-10s %-9s %12s %12s %10s %10s %8s\n", "rate", "channels", "old ns", "new ns", "old alloc", "new alloc", "speedup");
+    int failures = 0;
+    for (int codec_rate : {24000, 48000}) {
+        for (int channels : {1, 2}) {
+            auto before = Run<OldInput>(codec_rate, channels, frame_ms, reads);
+            auto after = Run<NewInput>(codec_rate, channels, frame_ms, reads);
+            printf("%-10d %-9d %12.0f %12.0f %10.2f %10.2f %7.2fx\n", codec_rate, channels, before.ns_per_read, after.ns_per_read,
+                   before.allocations_per_read, after.allocations_per_read, before.ns_per_read / after.ns_per_read);
+            // The scratch buffers grow on the first read only
+            if (after.allocations_per_read * reads > 2) {
+                failures++;
+            }
+        }
+    }
+    if (failures > 0) {
+        fprintf(stderr, "The current ReadAudioData path allocates per read\n");
+        return 1;
+    }
+    return 0;
+}
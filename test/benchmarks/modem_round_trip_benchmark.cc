@@ -0,0 +1,184 @@
+/*
+ * AT command round trips per second of the uplink audio against a mock cellular modem, with and
+ * without AudioBundler.
+ *
+ *   modem_round_trip_benchmark [--seconds N] [--at-rtt-ms N] [--at-per-send N] [--smoke]
+ *
+ * On the ML307 every Udp::Send is an AT command exchange with the modem (--at-per-send of them,
+ * each taking --at-rtt-ms), so the datagram rate decides how busy the UART and the modem are. The
+ * uplink is modelled as talk spurts with one DTX packet at the start of every pause, packed the way
+ * FbtPhoneTransport::OnAudioMicrophone does it, and sent through a MockUdp that counts the sends.
+ * Reported per frame duration and frames per packet: datagrams and AT round trips per second, the
+ * share of time the modem is busy with them, the bytes per second on the air (IP/UDP and the
+ * 16 byte audio header included) and the latency the bundling adds.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "audio_bundle.h"
+#include "mock_udp.h"
+
+namespace {
+
+const size_t kIpUdpOverhead = 28;
+const size_t kAudioHeader = 16;
+// Opus at 16kbps, about 2 bytes per ms of speech
+const int kBytesPerMs = 2;
+
+struct Options {
+    int seconds = 600;
+    int at_rtt_ms = 20;
+    int at_per_send = 1;
+};
+
+struct Result {
+    double datagrams_per_second = 0;
+    double at_round_trips_per_second = 0;
+    double modem_busy = 0;
+    double bytes_per_second = 0;
+    double mean_added_latency_ms = 0;
+    double max_added_latency_ms = 0;
+};
+
+/* The encoder output: talk spurts of 1 to 4 s, pauses of 0.5 to 2 s that start with one DTX packet */
+std::vector<std::unique_ptr<AudioStreamPacket>> Uplink(int seconds, int frame_ms) {
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> talk_ms(1000, 4000), pause_ms(500, 2000), jitter(-10, 10);
+    std::vector<std::unique_ptr<AudioStreamPacket>> packets;
+    int64_t now_ms = 0, end_ms = (int64_t)seconds * 1000;
+    while (now_ms < end_ms) {
+        for (int64_t spurt_end = now_ms + talk_ms(random); now_ms < spurt_end; now_ms += frame_ms) {
+            auto packet = std::make_unique<AudioStreamPacket>();
+            packet->frame_duration = frame_ms;
+            packet->timestamp = now_ms;
+            packet->origin_us = now_ms * 1000;
+            packet->payload.assign(frame_ms * kBytesPerMs * (100 + jitter(random)) / 100, 0x55);
+            packets.push_back(std::move(packet));
+        }
+        auto dtx = std::make_unique<AudioStreamPacket>();
+        dtx->frame_duration = frame_ms;
+        dtx->timestamp = now_ms;
+        dtx->origin_us = now_ms * 1000;
+        dtx->payload.assign(1, 0x58);
+        dtx->dtx = true;
+        packets.push_back(std::move(dtx));
+        now_ms += pause_ms(random);
+    }
+    return packets;
+}
+
+Result Run(const Options &options, const std::vector<std::unique_ptr<AudioStreamPacket>> &uplink, int frames_per_packet) {
+    MockUdp modem;
+    modem.Connect("127.0.0.1", 8000);
+    size_t datagrams = 0, bytes = 0;
+    modem.OnSend([&](const std::string &data) {
+        datagrams++;
+        bytes += data.size() + kIpUdpOverhead;
+    });
+
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(frames_per_packet);
+    std::string datagram;
+    double latency_sum_ms = 0, latency_max_ms = 0;
+    size_t frames = 0;
+    // Capture times of the pending frames, they go out with the frame that completes the bundle
+    std::vector<int64_t> pending;
+    auto send = [&](const uint8_t *payload, size_t size, int64_t now_us) {
+        datagram.assign(kAudioHeader, 0);
+        datagram.append(reinterpret_cast<const char *>(payload), size);
+        modem.Send(datagram);
+        for (int64_t origin_us : pending) {
+            double latency_ms = (now_us - origin_us) / 1000.0;
+            latency_sum_ms += latency_ms;
+            latency_max_ms = std::max(latency_max_ms, latency_ms);
+            frames++;
+        }
+        pending.clear();
+    };
+    auto flush = [&](int64_t now_us) {
+        if (!bundler.empty()) {
+            send(bundler.payload().data(), bundler.payload().size(), now_us);
+            bundler.Clear();
+        }
+    };
+
+    for (auto &packet : uplink) {
+        if (!bundler.enabled()) {
+            pending.push_back(packet->origin_us);
+            send(packet->payload.data(), packet->payload.size(), packet->origin_us);
+            continue;
+        }
+        if (!bundler.Continues(*packet)) {
+            // Sent when the next frame shows up, the transports see no timer
+            flush(packet->origin_us);
+        }
+        pending.push_back(packet->origin_us);
+        if (bundler.Add(*packet)) {
+            flush(packet->origin_us);
+        }
+    }
+    flush(uplink.back()->origin_us);
+
+    Result result;
+    result.datagrams_per_second = (double)datagrams / options.seconds;
+    result.at_round_trips_per_second = result.datagrams_per_second * options.at_per_send;
+    result.modem_busy = result.at_round_trips_per_second * options.at_rtt_ms / 1000.0;
+    result.bytes_per_second = (double)bytes / options.seconds;
+    result.mean_added_latency_ms = frames > 0 ? latency_sum_ms / frames : 0;
+    result.max_added_latency_ms = latency_max_ms;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--smoke") {
+            options.seconds = 30;
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = atoi(argv[++i]);
+        } else if (arg == "--at-rtt-ms" && i + 1 < argc) {
+            options.at_rtt_ms = atoi(argv[++i]);
+        } else if (arg == "--at-per-send" && i + 1 < argc) {
+            options.at_per_send = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: modem_round_trip_benchmark [--seconds N] [--at-rtt-ms N] [--at-per-send N] [--smoke]\n");
+            return 2;
+        }
+    }
+    if (options.seconds <= 0 || options.at_rtt_ms < 0 || options.at_per_send <= 0) {
+        return 2;
+    }
+
+    printf("%d s of uplink, %d AT exchange(s) of %d ms per datagram\n", options.seconds, options.at_per_send, options.at_rtt_ms);
+    printf("%-6s %-7s %11s %9s %11s %10s %12s %12s\n", "frame", "frames", "datagrams/s", "AT RTT/s", "modem busy", "bytes/s",
+           "latency avg", "latency max");
+    bool fewer = true;
+    for (int frame_ms : {20, 60}) {
+        auto uplink = Uplink(options.seconds, frame_ms);
+        double single_rate = 0;
+        for (int frames_per_packet = 1; frames_per_packet <= AUDIO_BUNDLE_MAX_FRAMES; frames_per_packet++) {
+            auto result = Run(options, uplink, frames_per_packet);
+            printf("%4dms %7d %11.1f %9.1f %10.1f%% %10.0f %10.1fms %10.1fms\n", frame_ms, frames_per_packet,
+                   result.datagrams_per_second, result.at_round_trips_per_second, result.modem_busy * 100, result.bytes_per_second,
+                   result.mean_added_latency_ms, result.max_added_latency_ms);
+            if (frames_per_packet == 1) {
+                single_rate = result.at_round_trips_per_second;
+            } else if (result.at_round_trips_per_second >= single_rate) {
+                fewer = false;
+            }
+        }
+    }
+    if (!fewer) {
+        fprintf(stderr, "Bundling did not reduce the AT round trips\n");
+        return 1;
+    }
+    return 0;
+}
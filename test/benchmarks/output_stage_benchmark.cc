@@ -0,0 +1,122 @@
+/*
+ * Cost of AudioOutputStage per playback block, against the volume multiply NoAudioCodec::Write
+ * did before the stage existed.
+ *
+ *   output_stage_benchmark [--seconds N] [--rate HZ] [--block-ms N] [--smoke]
+ *
+ * Reports ns per sample and the share of one core the stage takes at real time. The cases are a
+ * steady gain (the common path), the DC blocker on top, a gain change on every block (a worst case
+ * for the ramp) and a signal boosted into the limiter all the time.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "audio_output_stage.h"
+#include "wav_file.h"
+
+namespace {
+
+struct Options {
+    int seconds = 60;
+    int rate = 24000;
+    int block_ms = 20;
+};
+
+double Measure(const Options &options, const std::vector<int16_t> &signal, const std::function<void(int16_t *, size_t, size_t)> &process) {
+    size_t block = options.rate * options.block_ms / 1000;
+    std::vector<int16_t> buffer(block);
+    size_t total = (size_t)options.seconds * options.rate;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t done = 0, index = 0; done < total; done += block, index++) {
+        size_t offset = done % (signal.size() - block);
+        std::copy(signal.begin() + offset, signal.begin() + offset + block, buffer.begin());
+        process(buffer.data(), block, index);
+    }
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return (double)elapsed_ns / total;
+}
+
+/* NoAudioCodec::Write without the output stage: volume into a 32 bit I2S buffer */
+void LegacyVolume(const int16_t *data, size_t samples, int32_t volume_factor, std::vector<int32_t> &buffer) {
+    buffer.resize(samples);
+    for (size_t i = 0; i < samples; i++) {
+        int64_t temp = int64_t(data[i]) * volume_factor;
+        if (temp > INT32_MAX) {
+            buffer[i] = INT32_MAX;
+        } else if (temp < INT32_MIN) {
+            buffer[i] = INT32_MIN;
+        } else {
+            buffer[i] = static_cast<int32_t>(temp);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--smoke") {
+            options.seconds = 2;
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = atoi(argv[++i]);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = atoi(argv[++i]);
+        } else if (arg == "--block-ms" && i + 1 < argc) {
+            options.block_ms = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: output_stage_benchmark [--seconds N] [--rate HZ] [--block-ms N] [--smoke]\n");
+            return 2;
+        }
+    }
+    if (options.seconds <= 0 || options.rate <= 0 || options.block_ms <= 0) {
+        return 2;
+    }
+
+    auto signal = SynthesizeSpeech(options.rate, 1, 5000).samples;
+    printf("%d s of %d Hz in %d ms blocks\n", options.seconds, options.rate, options.block_ms);
+    printf("%-22s %10s %12s %10s\n", "case", "ns/sample", "core share", "limited");
+
+    auto report = [&](const char *name, double ns, uint32_t limited) {
+        printf("%-22s %10.2f %11.3f%% %10u\n", name, ns, ns * options.rate / 1e7, limited);
+    };
+
+    std::vector<int32_t> i2s_buffer;
+    int32_t volume_factor = std::pow(0.7, 2) * 65536;
+    report("legacy volume", Measure(options, signal, [&](int16_t *samples, size_t count, size_t) {
+               LegacyVolume(samples, count, volume_factor, i2s_buffer);
+           }),
+           0);
+
+    struct Case {
+        const char *name;
+        bool dc_block;
+        int gain;
+        bool toggle_gain;
+    };
+    const Case cases[] = {
+        {"stage steady gain", false, AUDIO_OUTPUT_UNITY_GAIN / 2, false},
+        {"stage + dc block", true, AUDIO_OUTPUT_UNITY_GAIN / 2, false},
+        {"stage ramp per block", true, AUDIO_OUTPUT_UNITY_GAIN / 2, true},
+        {"stage limiting", true, AUDIO_OUTPUT_MAX_GAIN, false},
+    };
+    for (auto &c : cases) {
+        AudioOutputStage stage;
+        stage.SetGain(c.gain);
+        stage.Configure(options.rate, -1, c.dc_block);
+        double ns = Measure(options, signal, [&](int16_t *samples, size_t count, size_t index) {
+            if (c.toggle_gain) {
+                stage.SetGain(index % 2 ? c.gain : c.gain / 2);
+            }
+            stage.Process(samples, count);
+        });
+        report(c.name, ns, stage.limited_count());
+    }
+    return 0;
+}
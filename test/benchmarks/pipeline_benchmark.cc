@@ -0,0 +1,256 @@
+/*
+ * End to end benchmark of AudioService on the host:
+ *
+ *   WAV mic -> [ReadAudioData] -> [NoAudioProcessor] -> [encode] -> send queue
+ *     -> loopback (stands in for the network) -> decode queue -> [decode] -> [mixer] -> WAV speaker
+ *
+ * The codec is paced like I2S, so the queues see device timing. Reports the per-stage latency
+ * percentiles of AudioLatencyStats, the CPU time per frame of every AudioService task and the
+ * uplink cost, as a table and optionally as JSON.
+ *
+ *   pipeline_benchmark [--input mic.wav] [--seconds 10] [--output-rate 24000] [--frame-ms 60]
+ *                      [--output speaker.wav] [--json result.json] [--smoke]
+ *
+ * Without --input a synthetic speech signal at 16kHz mono is used. Latency percentiles come from
+ * the firmware's bucketed histograms, so they are bucket upper bounds.
+ */
+#include <cJSON.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "audio_service.h"
+#include "heap_counter.h"
+#include "wav_audio_codec.h"
+#include "wav_file.h"
+
+namespace {
+
+struct Options {
+    std::string input;
+    std::string output;
+    std::string json;
+    int seconds = 10;
+    int output_rate = 24000;
+    int frame_ms = 60;
+};
+
+void Usage() {
+    fprintf(stderr, "usage: pipeline_benchmark [--input mic.wav] [--seconds N] [--output-rate HZ] [--frame-ms 20|40|60]\n"
+                    "                          [--output speaker.wav] [--json result.json] [--smoke]\n");
+}
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *v = nullptr;
+        if (arg == "--smoke") {
+            options.seconds = 2;
+            continue;
+        }
+        if (arg == "--help") {
+            return false;
+        }
+        if ((v = value()) == nullptr) {
+            return false;
+        }
+        if (arg == "--input") {
+            options.input = v;
+        } else if (arg == "--output") {
+            options.output = v;
+        } else if (arg == "--json") {
+            options.json = v;
+        } else if (arg == "--seconds") {
+            options.seconds = atoi(v);
+        } else if (arg == "--output-rate") {
+            options.output_rate = atoi(v);
+        } else if (arg == "--frame-ms") {
+            options.frame_ms = atoi(v);
+        } else {
+            return false;
+        }
+    }
+    return options.seconds > 0 && options.output_rate > 0;
+}
+
+/* CPU time of every thread of the process, by thread name, in microseconds */
+std::map<std::string, int64_t> ThreadCpuUs() {
+    std::map<std::string, int64_t> result;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return result;
+    }
+    while (dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string base = std::string("/proc/self/task/") + entry->d_name;
+        std::ifstream comm(base + "/comm");
+        std::ifstream schedstat(base + "/schedstat");
+        std::string name;
+        int64_t ns = 0;
+        if (std::getline(comm, name) && (schedstat >> ns)) {
+            result[name] += ns / 1000;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+int64_t ProcessCpuUs() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        Usage();
+        return 2;
+    }
+
+    WavFile input;
+    if (options.input.empty()) {
+        input = SynthesizeSpeech(16000, 1, options.seconds * 1000);
+    } else if (!ReadWav(options.input, input)) {
+        return 1;
+    }
+    if (input.channels > 2) {
+        fprintf(stderr, "Only mono or mic + reference input is supported\n");
+        return 1;
+    }
+    int input_ms = input.frames() * 1000 / input.sample_rate;
+    int run_ms = std::min(input_ms, options.seconds * 1000);
+
+    WavAudioCodec codec(input, options.output_rate);
+    AudioService service;
+    service.Initialize(&codec);
+    service.SetFrameDuration(options.frame_ms);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool send_ready = false;
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        send_ready = true;
+        cv.notify_one();
+    };
+    service.SetCallbacks(callbacks);
+
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    /* Every uplink packet comes straight back as a downlink packet */
+    std::atomic<bool> running{true};
+    std::atomic<uint32_t> looped{0};
+    std::thread loopback([&]() {
+        while (running) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait_for(lock, std::chrono::milliseconds(50), [&]() { return send_ready; });
+                send_ready = false;
+            }
+            while (auto packet = service.PopPacketFromSendQueue()) {
+                packet->sequence = 0;
+                service.PushPacketToDecodeQueue(std::move(packet), true);
+                looped++;
+            }
+        }
+    });
+
+    auto threads_before = ThreadCpuUs();
+    int64_t cpu_before = ProcessCpuUs();
+    uint64_t allocations_before = heap_counter::Allocations();
+    std::this_thread::sleep_for(std::chrono::milliseconds(run_ms));
+    // Let the last frames reach the speaker
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    int64_t cpu_us = ProcessCpuUs() - cpu_before;
+    uint64_t allocations = heap_counter::Allocations() - allocations_before;
+    auto threads_after = ThreadCpuUs();
+
+    running = false;
+    loopback.join();
+    service.Stop();
+    host_task_join_all();
+
+    auto &stats = service.GetLatencyStats();
+    uint32_t frames = stats.Get(kAudioStageEncode).count();
+    if (frames == 0) {
+        fprintf(stderr, "No frame was encoded\n");
+        return 1;
+    }
+
+    printf("pipeline: %d ms of %d Hz x%d input, %d ms frames, %d Hz output, codec %s\n", run_ms, input.sample_rate, input.channels,
+           options.frame_ms, options.output_rate, HOST_OPUS_CODEC);
+    printf("%u frames encoded, %u looped back, %u decoded, %llu heap allocations while running\n\n", frames, looped.load(),
+           stats.Get(kAudioStageDecode).count(), (unsigned long long)allocations);
+    static const char *const kStages[kAudioStageCount] = {"codec_read", "process", "encode_queue", "encode", "send_queue", "uplink",
+                                                          "decode_queue", "decode", "playback_queue", "codec_write", "downlink"};
+    printf("%-16s %8s %8s %8s %8s %10s\n", "stage", "count", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int i = 0; i < kAudioStageCount; i++) {
+        auto &histogram = stats.Get(static_cast<AudioLatencyStage>(i));
+        printf("%-16s %8u %8d %8d %8d %10.2f\n", kStages[i], histogram.count(), histogram.GetPercentileMs(50),
+               histogram.GetPercentileMs(90), histogram.GetPercentileMs(99), histogram.max_us() / 1000.0);
+    }
+
+    printf("\n%-16s %12s\n", "task", "cpu us/frame");
+    cJSON *tasks = cJSON_CreateObject();
+    for (const char *name : {"audio_input", "audio_output", "opus_codec", "opus_encode", "opus_decode"}) {
+        auto after = threads_after.find(name);
+        if (after == threads_after.end()) {
+            continue;
+        }
+        double per_frame = (double)(after->second - threads_before[name]) / frames;
+        printf("%-16s %12.1f\n", name, per_frame);
+        cJSON_AddNumberToObject(tasks, name, per_frame);
+    }
+    printf("%-16s %12.1f\n", "process", (double)cpu_us / frames);
+
+    cJSON *cost = service.GetUplinkCost().ToJson();
+    char *cost_text = cJSON_PrintUnformatted(cost);
+    printf("\nuplink cost: %s\n", cost_text);
+    cJSON_free(cost_text);
+
+    if (!options.json.empty()) {
+        cJSON *json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "codec", HOST_OPUS_CODEC);
+        cJSON_AddNumberToObject(json, "input_sample_rate", input.sample_rate);
+        cJSON_AddNumberToObject(json, "input_channels", input.channels);
+        cJSON_AddNumberToObject(json, "output_sample_rate", options.output_rate);
+        cJSON_AddNumberToObject(json, "frame_ms", options.frame_ms);
+        cJSON_AddNumberToObject(json, "frames", frames);
+        cJSON_AddNumberToObject(json, "allocations", allocations);
+        cJSON_AddNumberToObject(json, "process_cpu_us_per_frame", (double)cpu_us / frames);
+        cJSON_AddItemToObject(json, "task_cpu_us_per_frame", tasks);
+        cJSON_AddItemToObject(json, "latency", stats.ToJson());
+        cJSON_AddItemToObject(json, "uplink_cost", cost);
+        char *text = cJSON_Print(json);
+        std::ofstream(options.json) << text << "\n";
+        cJSON_free(text);
+        cJSON_Delete(json);
+    } else {
+        cJSON_Delete(tasks);
+        cJSON_Delete(cost);
+    }
+
+    if (!options.output.empty() && !WriteWav(options.output, codec.GetOutput())) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * Runs a corpus of WAV files through the uplink of a host AudioService:
+ *
+ *   WavAudioCodec -> [ReadAudioData, 16kHz] -> [NoAudioProcessor] -> [encode] -> send queue
+ *
+ * and reports, per file and 60ms frame, the time of every stage and the encoded bytes per second
+ * from the service's UplinkCostMeter (the numbers the device reports), the CPU time of the input
+ * and codec tasks, and the heap allocations of the whole process once the pipeline is warm. The
+ * result is written as JSON and checked against the thresholds file checked in next to this
+ * benchmark; any file over a threshold fails the run.
+ *
+ *   uplink_corpus_benchmark [--corpus DIR] [--seconds N] [--json result.json]
+ *                           [--thresholds FILE] [--no-check] [--smoke]
+ *
+ * Without --corpus, synthetic speech at 16, 24 and 48kHz, mono and mic + reference, is used. The
+ * thresholds are kept per Opus build, the fake codec of the host build has its own.
+ */
+#include <cJSON.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_service.h"
+#include "heap_counter.h"
+#include "wav_audio_codec.h"
+#include "wav_file.h"
+
+namespace {
+
+const int kFrameMs = 60;
+// Encoded frames before counting starts, every pooled buffer grows to its size in the first few
+const uint32_t kWarmupFrames = 8;
+
+struct Options {
+    std::string corpus;
+    std::string json;
+    std::string thresholds = REPO_ROOT "/test/benchmarks/uplink_corpus_thresholds.json";
+    int seconds = 20;
+    bool check = true;
+};
+
+struct Entry {
+    std::string name;
+    WavFile wav;
+};
+
+struct Result {
+    std::string name;
+    int sample_rate = 0;
+    int channels = 0;
+    int frames = 0;
+    // UplinkCostMeter, esp_timer time per stage
+    double resample_us = 0;
+    double process_us = 0;
+    double encode_us = 0;
+    double bytes_per_second = 0;
+    double allocations_per_frame = 0;
+
+    // CPU time of the input and codec tasks, a preempted stage does not count here
+    double cpu_us = 0;
+};
+
+/* CPU time of the threads of the process by name, in microseconds */
+std::map<std::string, int64_t> ThreadCpuUs() {
+    std::map<std::string, int64_t> result;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return result;
+    }
+    while (dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string base = std::string("/proc/self/task/") + entry->d_name;
+        std::ifstream comm(base + "/comm");
+        std::ifstream schedstat(base + "/schedstat");
+        std::string name;
+        int64_t ns = 0;
+        if (std::getline(comm, name) && (schedstat >> ns)) {
+            result[name] += ns / 1000;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+/* The uplink tasks, the output task only plays silence here */
+int64_t UplinkCpuUs() {
+    auto threads = ThreadCpuUs();
+    return threads["audio_input"] + threads["opus_codec"] + threads["opus_encode"];
+}
+
+std::vector<Entry> LoadCorpus(const Options &options) {
+    std::vector<Entry> corpus;
+    if (options.corpus.empty()) {
+        for (int rate : {16000, 24000, 48000}) {
+            for (int channels : {1, 2}) {
+                std::string name = "synthetic_" + std::to_string(rate / 1000) + "k_" + (channels == 1 ? "mono" : "stereo");
+                corpus.push_back({name, SynthesizeSpeech(rate, channels, options.seconds * 1000)});
+            }
+        }
+        return corpus;
+    }
+
+    DIR *dir = opendir(options.corpus.c_str());
+    if (dir == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", options.corpus.c_str());
+        return corpus;
+    }
+    std::vector<std::string> names;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (auto &name : names) {
+        Entry entry{name, {}};
+        if (!ReadWav(options.corpus + "/" + name, entry.wav) || entry.wav.channels > 2) {
+            fprintf(stderr, "Skipping %s\n", name.c_str());
+            continue;
+        }
+        // Only the first --seconds of every file
+        entry.wav.samples.resize(std::min(entry.wav.samples.size(), (size_t)options.seconds * entry.wav.sample_rate * entry.wav.channels));
+        corpus.push_back(std::move(entry));
+    }
+    return corpus;
+}
+
+Result Run(const Entry &entry) {
+    const WavFile &wav = entry.wav;
+    // Paced like I2S: unpaced, the input warm-up, which waits on the clock, would read the whole file
+    WavAudioCodec codec(wav, 16000);
+    AudioService service;
+    service.Initialize(&codec);
+    service.SetFrameDuration(kFrameMs);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    Result result;
+    result.name = entry.name;
+    result.sample_rate = wav.sample_rate;
+    result.channels = wav.channels;
+
+    auto &encoded = service.GetLatencyStats().Get(kAudioStageEncode);
+    uint32_t frames_before = 0;
+    uint64_t allocations_before = 0;
+    int64_t cpu_before = 0;
+    bool warm = false;
+    while (codec.input_position() < wav.samples.size()) {
+        while (service.PopPacketFromSendQueue()) {
+        }
+        if (!warm && encoded.count() >= kWarmupFrames) {
+            warm = true;
+            service.GetUplinkCost().Reset();
+            frames_before = encoded.count();
+            // Reading /proc allocates, before the count starts
+            cpu_before = UplinkCpuUs();
+            allocations_before = heap_counter::Allocations();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    uint64_t allocations = heap_counter::Allocations() - allocations_before;
+    int64_t cpu_us = UplinkCpuUs() - cpu_before;
+    int frames = warm ? (int)(encoded.count() - frames_before) : 0;
+
+    auto &cost = service.GetUplinkCost();
+    result.resample_us = cost.GetCpuUsPerFrame(kUplinkCostResample);
+    result.process_us = cost.GetCpuUsPerFrame(kUplinkCostProcess);
+    result.encode_us = cost.GetCpuUsPerFrame(kUplinkCostEncode);
+    result.bytes_per_second = cost.GetBytesPerSecond();
+    service.Stop();
+    host_task_join_all();
+
+    if (frames > 0) {
+        result.frames = frames;
+        result.cpu_us = (double)cpu_us / frames;
+        result.allocations_per_frame = (double)allocations / frames;
+    }
+    return result;
+}
+
+cJSON *ToJson(const std::vector<Result> &results) {
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "codec", HOST_OPUS_CODEC);
+    cJSON_AddNumberToObject(root, "frame_ms", kFrameMs);
+    cJSON *files = cJSON_CreateArray();
+    for (auto &result : results) {
+        cJSON *file = cJSON_CreateObject();
+        cJSON_AddStringToObject(file, "name", result.name.c_str());
+        cJSON_AddNumberToObject(file, "sample_rate", result.sample_rate);
+        cJSON_AddNumberToObject(file, "channels", result.channels);
+        cJSON_AddNumberToObject(file, "frames", result.frames);
+        cJSON *stages = cJSON_CreateObject();
+        cJSON_AddNumberToObject(stages, "resample", result.resample_us);
+        cJSON_AddNumberToObject(stages, "process", result.process_us);
+        cJSON_AddNumberToObject(stages, "encode", result.encode_us);
+        cJSON_AddItemToObject(file, "stage_us_per_frame", stages);
+        cJSON_AddNumberToObject(file, "cpu_us_per_frame", result.cpu_us);
+        cJSON_AddNumberToObject(file, "bytes_per_second", result.bytes_per_second);
+        cJSON_AddNumberToObject(file, "allocations_per_frame", result.allocations_per_frame);
+        cJSON_AddItemToArray(files, file);
+    }
+    cJSON_AddItemToObject(root, "files", files);
+    return root;
+}
+
+/* Returns the number of values over their threshold, -1 if the thresholds cannot be read */
+int CheckThresholds(const std::string &path, const std::vector<Result> &results) {
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    cJSON *root = cJSON_Parse(text.str().c_str());
+    cJSON *limits = root ? cJSON_GetObjectItem(root, HOST_OPUS_CODEC) : nullptr;
+    if (!cJSON_IsObject(limits)) {
+        fprintf(stderr, "No thresholds for codec %s in %s\n", HOST_OPUS_CODEC, path.c_str());
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    /* A threshold is a number, or an object with one for "mono" and one for "stereo" */
+    auto limit = [limits](const char *name, int channels) {
+        cJSON *item = cJSON_GetObjectItem(limits, name);
+        if (cJSON_IsObject(item)) {
+            item = cJSON_GetObjectItem(item, channels == 1 ? "mono" : "stereo");
+        }
+        return cJSON_IsNumber(item) ? item->valuedouble : -1;
+    };
+    int failures = 0;
+    auto check = [&failures](const Result &result, const char *name, double value, double threshold) {
+        if (threshold >= 0 && value > threshold) {
+            fprintf(stderr, "%s: %s %.2f is over the threshold of %.2f\n", result.name.c_str(), name, value, threshold);
+            failures++;
+        }
+    };
+    for (auto &result : results) {
+        check(result, "cpu_us_per_frame", result.cpu_us, limit("cpu_us_per_frame", result.channels));
+        check(result, "bytes_per_second", result.bytes_per_second, limit("bytes_per_second", result.channels));
+        check(result, "allocations_per_frame", result.allocations_per_frame, limit("allocations_per_frame", result.channels));
+    }
+    cJSON_Delete(root);
+    return failures;
+}
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--smoke") {
+            options.seconds = 2;
+        } else if (arg == "--no-check") {
+            options.check = false;
+        } else if (arg == "--corpus" && i + 1 < argc) {
+            options.corpus = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.json = argv[++i];
+        } else if (arg == "--thresholds" && i + 1 < argc) {
+            options.thresholds = argv[++i];
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.seconds > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: uplink_corpus_benchmark [--corpus DIR] [--seconds N] [--json result.json]\n"
+                        "                               [--thresholds FILE] [--no-check] [--smoke]\n");
+        return 2;
+    }
+    auto corpus = LoadCorpus(options);
+    if (corpus.empty()) {
+        return 1;
+    }
+
+    std::vector<Result> results;
+    printf("uplink corpus, %d ms frames, codec %s\n", kFrameMs, HOST_OPUS_CODEC);
+    printf("%-26s %8s %10s %10s %10s %10s %10s %8s\n", "file", "frames", "resample", "process", "encode", "cpu us", "bytes/s",
+           "allocs");
+    for (auto &entry : corpus) {
+        auto result = Run(entry);
+        printf("%-26s %8d %10.1f %10.1f %10.1f %10.1f %10.0f %8.2f\n", result.name.c_str(), result.frames, result.resample_us,
+               result.process_us, result.encode_us, result.cpu_us, result.bytes_per_second, result.allocations_per_frame);
+        results.push_back(result);
+    }
+
+    cJSON *json = ToJson(results);
+    char *text = cJSON_Print(json);
+    if (!options.json.empty()) {
+        std::ofstream(options.json) << text << "\n";
+    }
+    cJSON_free(text);
+    cJSON_Delete(json);
+
+    if (options.check) {
+        int failures = CheckThresholds(options.thresholds, results);
+        if (failures != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "opus.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Packet: [0] marker, [1] frame duration in 2.5ms units, [2..] mu-law points spread evenly over
+ * the frame. A packet of only the marker is DTX.
+ */
+#define FAKE_OPUS_MARKER 0xF4
+#define FAKE_OPUS_HEADER 2
+#define FAKE_OPUS_DEFAULT_BITRATE 24000
+#define FAKE_OPUS_SILENCE 16
+
+struct OpusEncoder {
+    opus_int32 sample_rate;
+    int channels;
+    opus_int32 bitrate;
+    int dtx;
+};
+
+struct OpusDecoder {
+    opus_int32 sample_rate;
+    int channels;
+    opus_int16 last;
+    int lost;
+};
+
+static unsigned char linear_to_ulaw(int sample) {
+    const int bias = 0x84;
+    int sign = 0;
+    if (sample < 0) {
+        sample = -sample;
+        sign = 0x80;
+    }
+    if (sample > 32635) {
+        sample = 32635;
+    }
+    sample += bias;
+    int exponent = 7;
+    for (int mask = 0x4000; (sample & mask) == 0 && exponent > 0; mask >>= 1) {
+        exponent--;
+    }
+    int mantissa = (sample >> (exponent + 3)) & 0x0F;
+    return (unsigned char)~(sign | (exponent << 4) | mantissa);
+}
+
+static int ulaw_to_linear(unsigned char value) {
+    value = ~value;
+    int sign = value & 0x80;
+    int exponent = (value >> 4) & 0x07;
+    int mantissa = value & 0x0F;
+    int sample = (((mantissa << 3) + 0x84) << exponent) - 0x84;
+    return sign ? -sample : sample;
+}
+
+OpusEncoder *opus_encoder_create(opus_int32 Fs, int channels, int application, int *error) {
+    (void)application;
+    if (Fs <= 0 || channels < 1 || channels > 2) {
+        if (error != NULL) {
+            *error = OPUS_BAD_ARG;
+        }
+        return NULL;
+    }
+    OpusEncoder *st = (OpusEncoder *)calloc(1, sizeof(OpusEncoder));
+    st->sample_rate = Fs;
+    st->channels = channels;
+    st->bitrate = OPUS_AUTO;
+    if (error != NULL) {
+        *error = OPUS_OK;
+    }
+    return st;
+}
+
+void opus_encoder_destroy(OpusEncoder *st) {
+    free(st);
+}
+
+opus_int32 opus_encode(OpusEncoder *st, const opus_int16 *pcm, int frame_size, unsigned char *data, opus_int32 max_data_bytes) {
+    int duration_us = (int)((int64_t)frame_size * 1000000 / st->sample_rate);
+    if (frame_size <= 0 || duration_us % 2500 != 0 || duration_us > 120000) {
+        return OPUS_BAD_ARG;
+    }
+    if (max_data_bytes < FAKE_OPUS_HEADER) {
+        return OPUS_BUFFER_TOO_SMALL;
+    }
+
+    int silent = 1;
+    for (int i = 0; i < frame_size * st->channels; i++) {
+        if (pcm[i] > FAKE_OPUS_SILENCE || pcm[i] < -FAKE_OPUS_SILENCE) {
+            silent = 0;
+            break;
+        }
+    }
+    data[0] = FAKE_OPUS_MARKER;
+    if (silent && st->dtx) {
+        return 1;
+    }
+    data[1] = (unsigned char)(duration_us / 2500);
+
+    opus_int32 bitrate = st->bitrate == OPUS_AUTO || st->bitrate == OPUS_BITRATE_MAX ? FAKE_OPUS_DEFAULT_BITRATE : st->bitrate;
+    int points = (int)((int64_t)bitrate * duration_us / 8000000);
+    if (points > frame_size) {
+        points = frame_size;
+    }
+    if (points > max_data_bytes - FAKE_OPUS_HEADER) {
+        points = max_data_bytes - FAKE_OPUS_HEADER;
+    }
+    if (points < 1) {
+        return OPUS_BUFFER_TOO_SMALL;
+    }
+    for (int i = 0; i < points; i++) {
+        /* First channel only, the decoder duplicates it */
+        int index = (int)((int64_t)i * frame_size / points);
+        data[FAKE_OPUS_HEADER + i] = linear_to_ulaw(pcm[index * st->channels]);
+    }
+    return FAKE_OPUS_HEADER + points;
+}
+
+int opus_encoder_ctl(OpusEncoder *st, int request, ...) {
+    va_list args;
+    va_start(args, request);
+    int ret = OPUS_OK;
+    switch (request) {
+    case OPUS_SET_BITRATE_REQUEST:
+        st->bitrate = va_arg(args, opus_int32);
+        break;
+    case OPUS_GET_BITRATE_REQUEST:
+        *va_arg(args, opus_int32 *) = st->bitrate == OPUS_AUTO ? FAKE_OPUS_DEFAULT_BITRATE : st->bitrate;
+        break;
+    case OPUS_SET_DTX_REQUEST:
+        st->dtx = va_arg(args, opus_int32) != 0;
+        break;
+    case OPUS_SET_COMPLEXITY_REQUEST:
+    case OPUS_SET_INBAND_FEC_REQUEST:
+    case OPUS_SET_PACKET_LOSS_PERC_REQUEST:
+        (void)va_arg(args, opus_int32);
+        break;
+    case OPUS_RESET_STATE:
+        break;
+    default:
+        ret = OPUS_UNIMPLEMENTED;
+    }
+    va_end(args);
+    return ret;
+}
+
+OpusDecoder *opus_decoder_create(opus_int32 Fs, int channels, int *error) {
+    if (Fs <= 0 || channels < 1 || channels > 2) {
+        if (error != NULL) {
+            *error = OPUS_BAD_ARG;
+        }
+        return NULL;
+    }
+    OpusDecoder *st = (OpusDecoder *)calloc(1, sizeof(OpusDecoder));
+    st->sample_rate = Fs;
+    st->channels = channels;
+    if (error != NULL) {
+        *error = OPUS_OK;
+    }
+    return st;
+}
+
+void opus_decoder_destroy(OpusDecoder *st) {
+    free(st);
+}
+
+int opus_packet_get_nb_samples(const unsigned char packet[], opus_int32 len, opus_int32 Fs) {
+    if (len < FAKE_OPUS_HEADER || packet[0] != FAKE_OPUS_MARKER) {
+        return OPUS_INVALID_PACKET;
+    }
+    return (int)((int64_t)packet[1] * 2500 * Fs / 1000000);
+}
+
+static void write_sample(OpusDecoder *st, opus_int16 *pcm, int index, int sample) {
+    for (int c = 0; c < st->channels; c++) {
+        pcm[index * st->channels + c] = (opus_int16)sample;
+    }
+}
+
+int opus_decode(OpusDecoder *st, const unsigned char *data, opus_int32 len, opus_int16 *pcm, int frame_size, int decode_fec) {
+    (void)decode_fec;
+    if (data == NULL || len == 0 || (len == 1 && data[0] == FAKE_OPUS_MARKER)) {
+        /* Loss or DTX: fade the last sample out, like the PLC of a quiet tail */
+        int sample = st->lost ? 0 : st->last;
+        for (int i = 0; i < frame_size; i++) {
+            write_sample(st, pcm, i, sample * (frame_size - i) / frame_size);
+        }
+        st->last = 0;
+        st->lost = 1;
+        return frame_size;
+    }
+    int samples = opus_packet_get_nb_samples(data, len, st->sample_rate);
+    if (samples < 0 || len < FAKE_OPUS_HEADER + 1) {
+        return OPUS_INVALID_PACKET;
+    }
+    if (samples > frame_size) {
+        return OPUS_BUFFER_TOO_SMALL;
+    }
+    int points = len - FAKE_OPUS_HEADER;
+    const unsigned char *payload = data + FAKE_OPUS_HEADER;
+    for (int i = 0; i < samples; i++) {
+        /* Linear interpolation between the points, position in 1/samples units */
+        int64_t position = (int64_t)i * points;
+        int index = (int)(position / samples);
+        int frac = (int)(position % samples);
+        int a = ulaw_to_linear(payload[index]);
+        int b = index + 1 < points ? ulaw_to_linear(payload[index + 1]) : a;
+        write_sample(st, pcm, i, (int)(a + (int64_t)(b - a) * frac / samples));
+    }
+    st->last = pcm[(samples - 1) * st->channels];
+    st->lost = 0;
+    return samples;
+}
+
+int opus_decoder_ctl(OpusDecoder *st, int request, ...) {
+    if (request == OPUS_RESET_STATE) {
+        st->last = 0;
+        st->lost = 0;
+        return OPUS_OK;
+    }
+    return OPUS_UNIMPLEMENTED;
+}
@@ -0,0 +1,67 @@
+/*
+ * A stand-in for libopus, used by the host build when libopus is not installed.
+ *
+ * Same API and constants as libopus for the calls the firmware makes. The "codec" keeps an evenly
+ * spaced subset of the samples as 8 bit mu-law, as many as the bitrate allows, and the decoder
+ * interpolates them back. It is deterministic and cheap, so tests can compare outputs exactly; its
+ * CPU cost and sound quality say nothing about Opus. With DTX on, silent frames encode to a one
+ * byte packet like libopus.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int16_t opus_int16;
+typedef int32_t opus_int32;
+
+#define OPUS_OK 0
+#define OPUS_BAD_ARG -1
+#define OPUS_BUFFER_TOO_SMALL -2
+#define OPUS_INTERNAL_ERROR -3
+#define OPUS_INVALID_PACKET -4
+#define OPUS_UNIMPLEMENTED -5
+
+#define OPUS_AUTO -1000
+#define OPUS_BITRATE_MAX -1
+
+#define OPUS_APPLICATION_VOIP 2048
+#define OPUS_APPLICATION_AUDIO 2049
+#define OPUS_APPLICATION_RESTRICTED_LOWDELAY 2051
+
+#define OPUS_SET_BITRATE_REQUEST 4002
+#define OPUS_GET_BITRATE_REQUEST 4003
+#define OPUS_SET_COMPLEXITY_REQUEST 4010
+#define OPUS_SET_INBAND_FEC_REQUEST 4012
+#define OPUS_SET_PACKET_LOSS_PERC_REQUEST 4014
+#define OPUS_SET_DTX_REQUEST 4016
+#define OPUS_RESET_STATE 4028
+
+#define OPUS_SET_BITRATE(x) OPUS_SET_BITRATE_REQUEST, (opus_int32)(x)
+#define OPUS_GET_BITRATE(x) OPUS_GET_BITRATE_REQUEST, (opus_int32 *)(x)
+#define OPUS_SET_COMPLEXITY(x) OPUS_SET_COMPLEXITY_REQUEST, (opus_int32)(x)
+#define OPUS_SET_INBAND_FEC(x) OPUS_SET_INBAND_FEC_REQUEST, (opus_int32)(x)
+#define OPUS_SET_PACKET_LOSS_PERC(x) OPUS_SET_PACKET_LOSS_PERC_REQUEST, (opus_int32)(x)
+#define OPUS_SET_DTX(x) OPUS_SET_DTX_REQUEST, (opus_int32)(x)
+
+typedef struct OpusEncoder OpusEncoder;
+typedef struct OpusDecoder OpusDecoder;
+
+OpusEncoder *opus_encoder_create(opus_int32 Fs, int channels, int application, int *error);
+void opus_encoder_destroy(OpusEncoder *st);
+opus_int32 opus_encode(OpusEncoder *st, const opus_int16 *pcm, int frame_size, unsigned char *data, opus_int32 max_data_bytes);
+int opus_encoder_ctl(OpusEncoder *st, int request, ...);
+
+OpusDecoder *opus_decoder_create(opus_int32 Fs, int channels, int *error);
+void opus_decoder_destroy(OpusDecoder *st);
+int opus_decode(OpusDecoder *st, const unsigned char *data, opus_int32 len, opus_int16 *pcm, int frame_size, int decode_fec);
+int opus_decoder_ctl(OpusDecoder *st, int request, ...);
+
+int opus_packet_get_nb_samples(const unsigned char packet[], opus_int32 len, opus_int32 Fs);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,25 @@
+/*
+ * audio_codec.h and fbt_udp.h include board.h. The firmware's board.h pulls in the display, network
+ * and LED stacks; the host build gets this stand-in, whose only board part is the network that
+ * CreateFbtUdp asks for. Tests that need one install it with SetNetwork.
+ */
+#pragma once
+
+#include "network_interface.h"
+#include "udp.h"
+
+class Board {
+  public:
+    static Board &GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    NetworkInterface *GetNetwork() { return network_; }
+    void SetNetwork(NetworkInterface *network) { network_ = network; }
+
+  private:
+    Board() = default;
+
+    NetworkInterface *network_ = nullptr;
+};
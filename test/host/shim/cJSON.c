@@ -0,0 +1,696 @@
+#include "cJSON.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *copy_string(const char *string) {
+    size_t length = strlen(string) + 1;
+    char *copy = (char *)malloc(length);
+    if (copy != NULL) {
+        memcpy(copy, string, length);
+    }
+    return copy;
+}
+
+static cJSON *new_item(int type) {
+    cJSON *item = (cJSON *)calloc(1, sizeof(cJSON));
+    if (item != NULL) {
+        item->type = type;
+    }
+    return item;
+}
+
+void cJSON_Delete(cJSON *item) {
+    while (item != NULL) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void *object) {
+    free(object);
+}
+
+/* Parser */
+
+typedef struct {
+    const char *content;
+    size_t length;
+    size_t offset;
+} parse_buffer;
+
+static int can_read(const parse_buffer *buffer, size_t size) {
+    return buffer->offset + size <= buffer->length;
+}
+
+static const char *at(const parse_buffer *buffer) {
+    return buffer->content + buffer->offset;
+}
+
+static void skip_whitespace(parse_buffer *buffer) {
+    while (can_read(buffer, 1) && isspace((unsigned char)*at(buffer))) {
+        buffer->offset++;
+    }
+}
+
+static int parse_value(cJSON *item, parse_buffer *buffer);
+
+static int parse_hex4(const char *input, unsigned *out) {
+    unsigned value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = input[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return 0;
+        }
+    }
+    *out = value;
+    return 1;
+}
+
+static size_t encode_utf8(unsigned codepoint, char *out) {
+    if (codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+static char *parse_string_raw(parse_buffer *buffer) {
+    if (!can_read(buffer, 1) || *at(buffer) != '"') {
+        return NULL;
+    }
+    buffer->offset++;
+    size_t start = buffer->offset;
+    size_t end = start;
+    while (end < buffer->length && buffer->content[end] != '"') {
+        if (buffer->content[end] == '\\') {
+            end++;
+        }
+        end++;
+    }
+    if (end >= buffer->length) {
+        return NULL;
+    }
+    /* Escapes only ever shrink the string */
+    char *output = (char *)malloc(end - start + 1);
+    if (output == NULL) {
+        return NULL;
+    }
+    char *out = output;
+    const char *input = buffer->content + start;
+    const char *input_end = buffer->content + end;
+    while (input < input_end) {
+        if (*input != '\\') {
+            *out++ = *input++;
+            continue;
+        }
+        input++;
+        switch (*input) {
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case '"':
+        case '\\':
+        case '/': *out++ = *input; break;
+        case 'u': {
+            unsigned codepoint;
+            if (input_end - input < 5 || !parse_hex4(input + 1, &codepoint)) {
+                free(output);
+                return NULL;
+            }
+            input += 4;
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF && input_end - input >= 7 && input[1] == '\\' && input[2] == 'u') {
+                unsigned low;
+                if (parse_hex4(input + 3, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    codepoint = 0x10000 + (((codepoint & 0x3FF) << 10) | (low & 0x3FF));
+                    input += 6;
+                }
+            }
+            out += encode_utf8(codepoint, out);
+            break;
+        }
+        default:
+            free(output);
+            return NULL;
+        }
+        input++;
+    }
+    *out = '\0';
+    buffer->offset = end + 1;
+    return output;
+}
+
+static int parse_number(cJSON *item, parse_buffer *buffer) {
+    char *end = NULL;
+    /* The input need not be terminated, copy the number out */
+    char number[64];
+    size_t length = 0;
+    while (can_read(buffer, length + 1) && length < sizeof(number) - 1 && strchr("+-0123456789.eE", at(buffer)[length]) != NULL) {
+        length++;
+    }
+    memcpy(number, at(buffer), length);
+    number[length] = '\0';
+    double value = strtod(number, &end);
+    if (end == number) {
+        return 0;
+    }
+    item->type = cJSON_Number;
+    item->valuedouble = value;
+    if (value >= 2147483647.0) {
+        item->valueint = 2147483647;
+    } else if (value <= -2147483648.0) {
+        item->valueint = -2147483647 - 1;
+    } else {
+        item->valueint = (int)value;
+    }
+    buffer->offset += end - number;
+    return 1;
+}
+
+static int parse_children(cJSON *item, parse_buffer *buffer, char close, int named) {
+    buffer->offset++;
+    skip_whitespace(buffer);
+    if (can_read(buffer, 1) && *at(buffer) == close) {
+        buffer->offset++;
+        return 1;
+    }
+    cJSON *tail = NULL;
+    while (1) {
+        cJSON *child = new_item(cJSON_Invalid);
+        if (child == NULL) {
+            return 0;
+        }
+        if (tail == NULL) {
+            item->child = child;
+        } else {
+            tail->next = child;
+            child->prev = tail;
+        }
+        tail = child;
+        item->child->prev = tail;
+
+        skip_whitespace(buffer);
+        if (named) {
+            child->string = parse_string_raw(buffer);
+            if (child->string == NULL) {
+                return 0;
+            }
+            skip_whitespace(buffer);
+            if (!can_read(buffer, 1) || *at(buffer) != ':') {
+                return 0;
+            }
+            buffer->offset++;
+            skip_whitespace(buffer);
+        }
+        if (!parse_value(child, buffer)) {
+            return 0;
+        }
+        skip_whitespace(buffer);
+        if (!can_read(buffer, 1)) {
+            return 0;
+        }
+        if (*at(buffer) == ',') {
+            buffer->offset++;
+            continue;
+        }
+        if (*at(buffer) == close) {
+            buffer->offset++;
+            return 1;
+        }
+        return 0;
+    }
+}
+
+static int parse_value(cJSON *item, parse_buffer *buffer) {
+    if (can_read(buffer, 4) && strncmp(at(buffer), "null", 4) == 0) {
+        item->type = cJSON_NULL;
+        buffer->offset += 4;
+        return 1;
+    }
+    if (can_read(buffer, 5) && strncmp(at(buffer), "false", 5) == 0) {
+        item->type = cJSON_False;
+        buffer->offset += 5;
+        return 1;
+    }
+    if (can_read(buffer, 4) && strncmp(at(buffer), "true", 4) == 0) {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        buffer->offset += 4;
+        return 1;
+    }
+    if (!can_read(buffer, 1)) {
+        return 0;
+    }
+    char c = *at(buffer);
+    if (c == '"') {
+        item->type = cJSON_String;
+        item->valuestring = parse_string_raw(buffer);
+        return item->valuestring != NULL;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        return parse_number(item, buffer);
+    }
+    if (c == '[') {
+        item->type = cJSON_Array;
+        return parse_children(item, buffer, ']', 0);
+    }
+    if (c == '{') {
+        item->type = cJSON_Object;
+        return parse_children(item, buffer, '}', 1);
+    }
+    return 0;
+}
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t length) {
+    if (value == NULL || length == 0) {
+        return NULL;
+    }
+    parse_buffer buffer = {value, length, 0};
+    /* A terminating NUL inside the length ends the input, like cJSON */
+    const char *nul = (const char *)memchr(value, '\0', length);
+    if (nul != NULL) {
+        buffer.length = nul - value;
+    }
+    cJSON *item = new_item(cJSON_Invalid);
+    if (item == NULL) {
+        return NULL;
+    }
+    skip_whitespace(&buffer);
+    if (!parse_value(item, &buffer)) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON *cJSON_Parse(const char *value) {
+    return value != NULL ? cJSON_ParseWithLength(value, strlen(value) + 1) : NULL;
+}
+
+/* Printer */
+
+typedef struct {
+    char *buffer;
+    size_t length;
+    size_t capacity;
+} print_buffer;
+
+static int reserve(print_buffer *p, size_t needed) {
+    if (p->length + needed + 1 <= p->capacity) {
+        return 1;
+    }
+    size_t capacity = p->capacity * 2;
+    if (capacity < p->length + needed + 1) {
+        capacity = p->length + needed + 1;
+    }
+    char *buffer = (char *)realloc(p->buffer, capacity);
+    if (buffer == NULL) {
+        return 0;
+    }
+    p->buffer = buffer;
+    p->capacity = capacity;
+    return 1;
+}
+
+static int append(print_buffer *p, const char *text, size_t length) {
+    if (!reserve(p, length)) {
+        return 0;
+    }
+    memcpy(p->buffer + p->length, text, length);
+    p->length += length;
+    p->buffer[p->length] = '\0';
+    return 1;
+}
+
+static int append_string(print_buffer *p, const char *string) {
+    if (!append(p, "\"", 1)) {
+        return 0;
+    }
+    for (const unsigned char *c = (const unsigned char *)string; *c != '\0'; c++) {
+        char escaped[8];
+        switch (*c) {
+        case '"': append(p, "\\\"", 2); break;
+        case '\\': append(p, "\\\\", 2); break;
+        case '\b': append(p, "\\b", 2); break;
+        case '\f': append(p, "\\f", 2); break;
+        case '\n': append(p, "\\n", 2); break;
+        case '\r': append(p, "\\r", 2); break;
+        case '\t': append(p, "\\t", 2); break;
+        default:
+            if (*c < 0x20) {
+                snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                append(p, escaped, 6);
+            } else {
+                append(p, (const char *)c, 1);
+            }
+        }
+    }
+    return append(p, "\"", 1);
+}
+
+static int append_number(print_buffer *p, double value) {
+    char number[32];
+    int length;
+    if (isnan(value) || isinf(value)) {
+        length = snprintf(number, sizeof(number), "null");
+    } else if (value == (double)(long long)value && fabs(value) < 1e15) {
+        length = snprintf(number, sizeof(number), "%lld", (long long)value);
+    } else {
+        length = snprintf(number, sizeof(number), "%1.15g", value);
+        if (strtod(number, NULL) != value) {
+            length = snprintf(number, sizeof(number), "%1.17g", value);
+        }
+    }
+    return append(p, number, length);
+}
+
+static int append_indent(print_buffer *p, int depth) {
+    for (int i = 0; i < depth; i++) {
+        if (!append(p, "\t", 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int print_value(const cJSON *item, print_buffer *p, int depth, int format) {
+    switch (item->type & 0xFF) {
+    case cJSON_NULL: return append(p, "null", 4);
+    case cJSON_False: return append(p, "false", 5);
+    case cJSON_True: return append(p, "true", 4);
+    case cJSON_Number: return append_number(p, item->valuedouble);
+    case cJSON_String: return append_string(p, item->valuestring != NULL ? item->valuestring : "");
+    case cJSON_Array:
+    case cJSON_Object: {
+        int object = (item->type & 0xFF) == cJSON_Object;
+        append(p, object ? "{" : "[", 1);
+        if (format && object && item->child != NULL) {
+            append(p, "\n", 1);
+        }
+        for (const cJSON *child = item->child; child != NULL; child = child->next) {
+            if (format && object) {
+                append_indent(p, depth + 1);
+            }
+            if (object) {
+                append_string(p, child->string != NULL ? child->string : "");
+                append(p, format ? ":\t" : ":", format ? 2 : 1);
+            }
+            if (!print_value(child, p, depth + 1, format)) {
+                return 0;
+            }
+            if (child->next != NULL) {
+                append(p, ",", 1);
+                if (format && !object) {
+                    append(p, " ", 1);
+                }
+            }
+            if (format && object) {
+                append(p, "\n", 1);
+            }
+        }
+        if (format && object && item->child != NULL) {
+            append_indent(p, depth);
+        }
+        return append(p, object ? "}" : "]", 1);
+    }
+    default:
+        return 0;
+    }
+}
+
+static char *print(const cJSON *item, int format) {
+    if (item == NULL) {
+        return NULL;
+    }
+    print_buffer p = {NULL, 0, 0};
+    if (!reserve(&p, 64) || !print_value(item, &p, 0, format)) {
+        free(p.buffer);
+        return NULL;
+    }
+    return p.buffer;
+}
+
+char *cJSON_Print(const cJSON *item) {
+    return print(item, 1);
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item) {
+    return print(item, 0);
+}
+
+cJSON *cJSON_Duplicate(const cJSON *item, cJSON_bool recurse) {
+    if (item == NULL) {
+        return NULL;
+    }
+    cJSON *copy = new_item(item->type);
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy->valueint = item->valueint;
+    copy->valuedouble = item->valuedouble;
+    copy->valuestring = item->valuestring != NULL ? copy_string(item->valuestring) : NULL;
+    copy->string = item->string != NULL ? copy_string(item->string) : NULL;
+    if (recurse) {
+        cJSON *tail = NULL;
+        for (const cJSON *child = item->child; child != NULL; child = child->next) {
+            cJSON *child_copy = cJSON_Duplicate(child, 1);
+            if (child_copy == NULL) {
+                cJSON_Delete(copy);
+                return NULL;
+            }
+            if (tail == NULL) {
+                copy->child = child_copy;
+            } else {
+                tail->next = child_copy;
+                child_copy->prev = tail;
+            }
+            tail = child_copy;
+            copy->child->prev = tail;
+        }
+    }
+    return copy;
+}
+
+/* Access */
+
+int cJSON_GetArraySize(const cJSON *array) {
+    int size = 0;
+    for (const cJSON *child = array != NULL ? array->child : NULL; child != NULL; child = child->next) {
+        size++;
+    }
+    return size;
+}
+
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index) {
+    cJSON *child = array != NULL ? array->child : NULL;
+    while (child != NULL && index-- > 0) {
+        child = child->next;
+    }
+    return child;
+}
+
+static cJSON *get_object_item(const cJSON *object, const char *string, int case_sensitive) {
+    if (object == NULL || string == NULL) {
+        return NULL;
+    }
+    for (cJSON *child = object->child; child != NULL; child = child->next) {
+        if (child->string == NULL) {
+            continue;
+        }
+        if (case_sensitive ? strcmp(child->string, string) == 0 : strcasecmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string) {
+    return get_object_item(object, string, 0);
+}
+
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string) {
+    return get_object_item(object, string, 1);
+}
+
+cJSON_bool cJSON_HasObjectItem(const cJSON *object, const char *string) {
+    return cJSON_GetObjectItem(object, string) != NULL;
+}
+
+char *cJSON_GetStringValue(const cJSON *item) {
+    return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+double cJSON_GetNumberValue(const cJSON *item) {
+    return cJSON_IsNumber(item) ? item->valuedouble : NAN;
+}
+
+cJSON_bool cJSON_IsInvalid(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_Invalid; }
+cJSON_bool cJSON_IsFalse(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_False; }
+cJSON_bool cJSON_IsTrue(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_True; }
+cJSON_bool cJSON_IsBool(const cJSON *item) { return item != NULL && (item->type & (cJSON_True | cJSON_False)) != 0; }
+cJSON_bool cJSON_IsNull(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_NULL; }
+cJSON_bool cJSON_IsNumber(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_Number; }
+cJSON_bool cJSON_IsString(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_String; }
+cJSON_bool cJSON_IsArray(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON *item) { return item != NULL && (item->type & 0xFF) == cJSON_Object; }
+
+/* Construction */
+
+cJSON *cJSON_CreateNull(void) { return new_item(cJSON_NULL); }
+cJSON *cJSON_CreateTrue(void) { return cJSON_CreateBool(1); }
+cJSON *cJSON_CreateFalse(void) { return cJSON_CreateBool(0); }
+
+cJSON *cJSON_CreateBool(cJSON_bool boolean) {
+    cJSON *item = new_item(boolean ? cJSON_True : cJSON_False);
+    if (item != NULL) {
+        item->valueint = boolean ? 1 : 0;
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateNumber(double num) {
+    cJSON *item = new_item(cJSON_Number);
+    if (item != NULL) {
+        item->valuedouble = num;
+        item->valueint = num >= 2147483647.0 ? 2147483647 : num <= -2147483648.0 ? (-2147483647 - 1) : (int)num;
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateString(const char *string) {
+    cJSON *item = new_item(cJSON_String);
+    if (item != NULL) {
+        item->valuestring = copy_string(string != NULL ? string : "");
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateArray(void) { return new_item(cJSON_Array); }
+cJSON *cJSON_CreateObject(void) { return new_item(cJSON_Object); }
+
+cJSON *cJSON_CreateIntArray(const int *numbers, int count) {
+    cJSON *array = cJSON_CreateArray();
+    for (int i = 0; array != NULL && i < count; i++) {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(numbers[i]));
+    }
+    return array;
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON *array, cJSON *item) {
+    if (array == NULL || item == NULL || array == item) {
+        return 0;
+    }
+    item->next = NULL;
+    if (array->child == NULL) {
+        array->child = item;
+        item->prev = item;
+    } else {
+        cJSON *tail = array->child->prev;
+        tail->next = item;
+        item->prev = tail;
+        array->child->prev = item;
+    }
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item) {
+    if (object == NULL || string == NULL || item == NULL) {
+        return 0;
+    }
+    free(item->string);
+    item->string = copy_string(string);
+    return cJSON_AddItemToArray(object, item);
+}
+
+cJSON *cJSON_DetachItemFromObject(cJSON *object, const char *string) {
+    cJSON *item = cJSON_GetObjectItem(object, string);
+    if (item == NULL) {
+        return NULL;
+    }
+    if (item == object->child) {
+        object->child = item->next;
+        if (object->child != NULL) {
+            object->child->prev = item->prev;
+        }
+    } else {
+        item->prev->next = item->next;
+        if (item->next != NULL) {
+            item->next->prev = item->prev;
+        } else {
+            object->child->prev = item->prev;
+        }
+    }
+    item->next = NULL;
+    item->prev = NULL;
+    return item;
+}
+
+void cJSON_DeleteItemFromObject(cJSON *object, const char *string) {
+    cJSON_Delete(cJSON_DetachItemFromObject(object, string));
+}
+
+cJSON_bool cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem) {
+    if (newitem == NULL) {
+        return 0;
+    }
+    cJSON_DeleteItemFromObject(object, string);
+    return cJSON_AddItemToObject(object, string, newitem);
+}
+
+static cJSON *add_to_object(cJSON *object, const char *name, cJSON *item) {
+    if (cJSON_AddItemToObject(object, name, item)) {
+        return item;
+    }
+    cJSON_Delete(item);
+    return NULL;
+}
+
+cJSON *cJSON_AddNullToObject(cJSON *const object, const char *const name) { return add_to_object(object, name, cJSON_CreateNull()); }
+cJSON *cJSON_AddTrueToObject(cJSON *const object, const char *const name) { return add_to_object(object, name, cJSON_CreateTrue()); }
+cJSON *cJSON_AddFalseToObject(cJSON *const object, const char *const name) { return add_to_object(object, name, cJSON_CreateFalse()); }
+
+cJSON *cJSON_AddBoolToObject(cJSON *const object, const char *const name, const cJSON_bool boolean) {
+    return add_to_object(object, name, cJSON_CreateBool(boolean));
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *const object, const char *const name, const double number) {
+    return add_to_object(object, name, cJSON_CreateNumber(number));
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *const object, const char *const name, const char *const string) {
+    return add_to_object(object, name, cJSON_CreateString(string));
+}
+
+cJSON *cJSON_AddObjectToObject(cJSON *const object, const char *const name) { return add_to_object(object, name, cJSON_CreateObject()); }
+cJSON *cJSON_AddArrayToObject(cJSON *const object, const char *const name) { return add_to_object(object, name, cJSON_CreateArray()); }
@@ -0,0 +1,31 @@
+#include "esp_log.h"
+#include "esp_random.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <random>
+
+extern "C" {
+
+int host_log_enabled(esp_log_level_t level) {
+    static const int threshold = []() {
+        const char *value = getenv("FBT_HOST_LOG");
+        // Errors and warnings unless asked for more
+        return value != nullptr ? ESP_LOG_WARN + atoi(value) : ESP_LOG_WARN;
+    }();
+    return level <= threshold;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;
+    (void)level;
+}
+
+uint32_t esp_random(void) {
+    static std::mutex mutex;
+    static std::mt19937 generator(std::random_device{}());
+    std::lock_guard<std::mutex> lock(mutex);
+    return generator();
+}
+
+} // extern "C"
@@ -0,0 +1,189 @@
+#include "esp_timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t deadline_us = 0;
+    int64_t period_us = 0;
+    bool active = false;
+    // The callback is running, esp_timer_delete waits for it
+    bool running = false;
+    esp_timer *next = nullptr;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point kStart = Clock::now();
+
+std::mutex timer_mutex;
+std::condition_variable timer_cv;
+std::condition_variable callback_done_cv;
+// Active timers, sorted by deadline
+esp_timer *active_timers = nullptr;
+std::atomic<bool> manual_clock{false};
+std::atomic<int64_t> manual_time_us{0};
+std::once_flag dispatcher_once;
+
+int64_t Now() {
+    if (manual_clock) {
+        return manual_time_us;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - kStart).count();
+}
+
+void Unlink(esp_timer *timer) {
+    for (esp_timer **link = &active_timers; *link != nullptr; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            timer->next = nullptr;
+            return;
+        }
+    }
+}
+
+void Insert(esp_timer *timer) {
+    esp_timer **link = &active_timers;
+    while (*link != nullptr && (*link)->deadline_us <= timer->deadline_us) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+}
+
+/* Runs the first timer that is due at `now`, the caller holds the lock. Returns false if none is */
+bool RunDueTimer(std::unique_lock<std::mutex> &lock, int64_t now) {
+    esp_timer *timer = active_timers;
+    if (timer == nullptr || timer->deadline_us > now) {
+        return false;
+    }
+    Unlink(timer);
+    if (timer->period_us > 0) {
+        timer->deadline_us += timer->period_us;
+        if (timer->deadline_us < now) {
+            timer->deadline_us = now + timer->period_us;
+        }
+        Insert(timer);
+    } else {
+        timer->active = false;
+    }
+    timer->running = true;
+    lock.unlock();
+    timer->callback(timer->arg);
+    lock.lock();
+    timer->running = false;
+    callback_done_cv.notify_all();
+    return true;
+}
+
+void Dispatcher() {
+    std::unique_lock<std::mutex> lock(timer_mutex);
+    while (true) {
+        if (manual_clock || active_timers == nullptr) {
+            timer_cv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+        int64_t now = Now();
+        if (RunDueTimer(lock, now)) {
+            continue;
+        }
+        timer_cv.wait_for(lock, std::chrono::microseconds(active_timers->deadline_us - now));
+    }
+}
+
+esp_err_t Start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    std::call_once(dispatcher_once, []() { std::thread(Dispatcher).detach(); });
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->deadline_us = Now() + timeout_us;
+    timer->period_us = period_us;
+    Insert(timer);
+    timer_cv.notify_all();
+    return ESP_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto timer = new esp_timer();
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return Start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return Start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    Unlink(timer);
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    std::unique_lock<std::mutex> lock(timer_mutex);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    callback_done_cv.wait(lock, [timer]() { return !timer->running; });
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    return timer->active;
+}
+
+int64_t esp_timer_get_time(void) {
+    return Now();
+}
+
+void host_clock_set_manual(bool manual) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    if (manual && !manual_clock) {
+        manual_time_us = Now();
+    }
+    manual_clock = manual;
+    timer_cv.notify_all();
+}
+
+void host_clock_advance_us(int64_t us) {
+    std::unique_lock<std::mutex> lock(timer_mutex);
+    int64_t target = manual_time_us + us;
+    /* Step through the deadlines, so every callback sees the time it was due at */
+    while (active_timers != nullptr && active_timers->deadline_us <= target) {
+        if (active_timers->deadline_us > manual_time_us) {
+            manual_time_us = active_timers->deadline_us;
+        }
+        RunDueTimer(lock, manual_time_us);
+    }
+    manual_time_us = target;
+}
+
+} // extern "C"
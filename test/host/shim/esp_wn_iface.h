@@ -0,0 +1,28 @@
+/* The WakeNet interface EspWakeWord compiles against, esp_wn_handle_from_name never finds a model on the host */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct model_iface_data_t model_iface_data_t;
+
+typedef enum {
+    DET_MODE_90 = 0,
+    DET_MODE_95 = 1,
+} det_mode_t;
+
+typedef struct {
+    model_iface_data_t *(*create)(const void *model_name, det_mode_t det_mode);
+    int (*get_samp_chunksize)(model_iface_data_t *model);
+    int (*get_samp_rate)(model_iface_data_t *model);
+    int (*detect)(model_iface_data_t *model, int16_t *samples);
+    char *(*get_word_name)(model_iface_data_t *model, int word_index);
+    void (*destroy)(model_iface_data_t *model);
+} esp_wn_iface_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "esp_wn_iface.h"
+
+static inline const esp_wn_iface_t *esp_wn_handle_from_name(const char *model_name) {
+    (void)model_name;
+    return NULL;
+}
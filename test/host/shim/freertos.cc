@@ -0,0 +1,324 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <pthread.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point kStart = Clock::now();
+
+/* portMAX_DELAY waits forever, anything else is a deadline */
+template <typename Predicate>
+bool WaitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate predicate) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, predicate);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(ticks), predicate);
+}
+
+} // namespace
+
+struct HostTask {
+    ~HostTask() {
+        // Tasks that never return, like a worker's while (1), are still running at exit
+        if (thread.joinable()) {
+            thread.detach();
+        }
+    }
+
+    std::string name;
+    std::thread thread;
+};
+
+namespace {
+
+std::mutex tasks_mutex;
+std::vector<std::unique_ptr<HostTask>> tasks;
+thread_local HostTask *current_task = nullptr;
+HostTask main_task{"main", {}};
+std::recursive_mutex critical_mutex;
+
+} // namespace
+
+extern "C" {
+
+void host_task_yield(void) {
+    std::this_thread::yield();
+}
+
+void host_enter_critical(portMUX_TYPE *mux) {
+    (void)mux;
+    critical_mutex.lock();
+}
+
+void host_exit_critical(portMUX_TYPE *mux) {
+    (void)mux;
+    critical_mutex.unlock();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id) {
+    (void)stack_depth;
+    (void)priority;
+    (void)core_id;
+    auto task = std::make_unique<HostTask>();
+    HostTask *raw = task.get();
+    raw->name = name ? name : "";
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        tasks.push_back(std::move(task));
+    }
+    if (handle != nullptr) {
+        *handle = raw;
+    }
+    raw->thread = std::thread([raw, function, arg]() {
+        current_task = raw;
+        pthread_setname_np(pthread_self(), raw->name.substr(0, 15).c_str());
+        function(arg);
+    });
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg,
+                               UBaseType_t priority, StackType_t *stack, StaticTask_t *task_buffer) {
+    (void)stack;
+    (void)task_buffer;
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, &handle, tskNO_AFFINITY);
+    return handle;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    /* A task deleting itself is at the end of its function, returning ends the thread */
+    if (task == nullptr || task == current_task) {
+        return;
+    }
+    fprintf(stderr, "W (freertos) vTaskDelete(%s) from another task is not supported on the host\n", task->name.c_str());
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - kStart).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current_task != nullptr ? current_task : &main_task;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    (void)task;
+}
+
+void vTaskResume(TaskHandle_t task) {
+    (void)task;
+}
+
+void host_task_join_all(void) {
+    std::vector<HostTask *> joinable;
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        for (auto &task : tasks) {
+            joinable.push_back(task.get());
+        }
+    }
+    for (auto task : joinable) {
+        if (task->thread.joinable() && task->thread.get_id() != std::this_thread::get_id()) {
+            task->thread.join();
+        }
+    }
+}
+
+} // extern "C"
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+extern "C" {
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_for_all,
+                                TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [&]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool ok = WaitFor(group->cv, lock, ticks, satisfied);
+    /* Like FreeRTOS, the bits as they were before clearing, also on timeout */
+    EventBits_t result = group->bits;
+    if (ok && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+} // extern "C"
+
+/* Fixed storage ring, sending and receiving do not allocate */
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::vector<uint8_t> storage;
+    size_t length;
+    size_t item_size;
+    size_t head = 0;
+    size_t count = 0;
+
+    HostQueue(size_t length, size_t item_size) : storage(length * item_size), length(length), item_size(item_size) {
+    }
+};
+
+extern "C" {
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    if (length == 0) {
+        return nullptr;
+    }
+    return new HostQueue(length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+static BaseType_t QueueSend(QueueHandle_t queue, const void *item, TickType_t ticks, bool front) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!WaitFor(queue->not_full, lock, ticks, [queue]() { return queue->count < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    size_t slot;
+    if (front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    if (queue->item_size > 0) {
+        memcpy(queue->storage.data() + slot * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    queue->not_empty.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return QueueSend(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return QueueSend(queue, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!WaitFor(queue->not_empty, lock, ticks, [queue]() { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    if (queue->item_size > 0) {
+        memcpy(item, queue->storage.data() + queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->not_full.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->head = 0;
+    queue->count = 0;
+    queue->not_full.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->length - queue->count;
+}
+
+/* Semaphores are queues of empty items, as in FreeRTOS: taking receives, giving sends */
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    QueueHandle_t queue = xQueueCreate(max_count, 0);
+    queue->count = initial_count;
+    return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xQueueReceive(semaphore, nullptr, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return xQueueSend(semaphore, nullptr, 0);
+}
+
+} // extern "C"
@@ -0,0 +1,40 @@
+/* ESP-SR model list on the host: there are no models, so no wake word and no AFE */
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_WN_PREFIX "wn"
+#define ESP_MN_PREFIX "mn"
+#define ESP_NSNET_PREFIX "nsnet"
+
+typedef struct {
+    char **model_name;
+    char **model_info;
+    int num;
+    void *partition;
+    void *mmap_handle;
+} srmodel_list_t;
+
+static inline srmodel_list_t *esp_srmodel_init(const char *partition_label) {
+    (void)partition_label;
+    return NULL;
+}
+
+static inline void esp_srmodel_deinit(srmodel_list_t *models) {
+    (void)models;
+}
+
+static inline char *esp_srmodel_filter(srmodel_list_t *models, const char *keyword1, const char *keyword2) {
+    (void)models;
+    (void)keyword1;
+    (void)keyword2;
+    return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,12 @@
+/* NetworkInterface of the esp-ml307 component, only the part the host build uses */
+#pragma once
+
+#include <memory>
+
+#include "udp.h"
+
+class NetworkInterface {
+  public:
+    virtual ~NetworkInterface() = default;
+    virtual std::unique_ptr<Udp> CreateUdp(int connect_id) = 0;
+};
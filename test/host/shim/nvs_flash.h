@@ -0,0 +1,6 @@
+/* Settings keep their values in memory on the host, see settings.cc */
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t nvs_handle_t;
@@ -0,0 +1,28 @@
+/* OpusDecoderWrapper of the esp-opus-encoder component, same interface, for the host build */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <opus.h>
+
+class OpusDecoderWrapper {
+  public:
+    OpusDecoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusDecoderWrapper();
+
+    /* An empty packet asks the decoder to conceal a lost frame */
+    bool Decode(std::vector<uint8_t> &&opus, std::vector<int16_t> &pcm);
+    void ResetState();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+  private:
+    std::mutex mutex_;
+    OpusDecoder *audio_dec_ = nullptr;
+    int frame_size_;
+    int sample_rate_;
+    int duration_ms_;
+};
@@ -0,0 +1,37 @@
+/* OpusEncoderWrapper of the esp-opus-encoder component, same interface, for the host build */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <opus.h>
+
+#define MAX_OPUS_PACKET_SIZE 1500
+
+class OpusEncoderWrapper {
+  public:
+    OpusEncoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusEncoderWrapper();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+    void SetDtx(bool enable);
+    void SetComplexity(int complexity);
+    /* Buffers the pcm and calls the handler for every complete frame */
+    void Encode(std::vector<int16_t> &&pcm, std::function<void(std::vector<uint8_t> &&opus)> handler);
+    /* Exactly one frame */
+    bool Encode(std::vector<int16_t> &&pcm, std::vector<uint8_t> &opus);
+    bool IsBufferEmpty() const { return in_buffer_.empty(); }
+    void ResetState();
+
+  private:
+    std::mutex mutex_;
+    OpusEncoder *audio_enc_ = nullptr;
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+    std::vector<int16_t> in_buffer_;
+};
@@ -0,0 +1,30 @@
+/*
+ * OpusResampler of the esp-opus-encoder component, same interface, for the host build.
+ *
+ * The device uses the SILK resampler; this one interpolates linearly and keeps its phase and the
+ * last input sample between calls. Output sizes match the device, so the pipeline sees the same
+ * frame sizes, but its CPU cost and frequency response do not.
+ */
+#pragma once
+
+#include <cstdint>
+
+class OpusResampler {
+  public:
+    OpusResampler();
+    ~OpusResampler();
+
+    void Configure(int input_sample_rate, int output_sample_rate);
+    void Process(const int16_t *input, int input_samples, int16_t *output);
+    int GetOutputSamples(int input_samples) const;
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+  private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    // Position of the next output sample, in 1/output_sample_rate_ input samples, relative to the first new input
+    int64_t phase_ = 0;
+    int16_t last_sample_ = 0;
+};
@@ -0,0 +1,60 @@
+/*
+ * Configuration of the host build. Mirrors the Kconfig defaults of a board without PSRAM and
+ * without the ESP-SR audio processor; the test CMakeLists can override any option with -D.
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+
+#ifndef CONFIG_USE_AUDIO_SPLIT_CODEC_TASKS
+#define CONFIG_USE_AUDIO_SPLIT_CODEC_TASKS 0
+#endif
+#define CONFIG_AUDIO_DECODE_TASK_PRIORITY 5
+#define CONFIG_AUDIO_DECODE_TASK_CORE -1
+#define CONFIG_AUDIO_ENCODE_TASK_PRIORITY 2
+#define CONFIG_AUDIO_ENCODE_TASK_CORE -1
+
+#ifndef CONFIG_AUDIO_POOL_MAX_PACKETS
+#define CONFIG_AUDIO_POOL_MAX_PACKETS 128
+#endif
+
+#ifndef CONFIG_USE_SOUND_PCM_CACHE
+#define CONFIG_USE_SOUND_PCM_CACHE 1
+#endif
+#define CONFIG_SOUND_PCM_CACHE_SIZE_KB 2048
+#define CONFIG_SOUND_PCM_CACHE_MAX_SOUND_MS 40000
+
+#ifndef CONFIG_USE_UPLINK_DTX
+#define CONFIG_USE_UPLINK_DTX 1
+#endif
+
+#ifndef CONFIG_USE_OPUS_ENCODER_CONTROLLER
+#define CONFIG_USE_OPUS_ENCODER_CONTROLLER 0
+#endif
+#define CONFIG_OPUS_ENCODER_COMPLEXITY_MIN 0
+#define CONFIG_OPUS_ENCODER_COMPLEXITY_MAX 5
+#define CONFIG_OPUS_ENCODER_BITRATE_MIN_KBPS 12
+#define CONFIG_OPUS_ENCODER_BITRATE_MAX_KBPS 32
+#define CONFIG_OPUS_ENCODER_ENABLE_FEC 1
+
+#ifndef CONFIG_USE_AUDIO_OUTPUT_STAGE
+#define CONFIG_USE_AUDIO_OUTPUT_STAGE 0
+#endif
+#define CONFIG_AUDIO_OUTPUT_BOOST_DB 0
+#define CONFIG_AUDIO_OUTPUT_LIMITER_HEADROOM_DB 1
+#define CONFIG_AUDIO_OUTPUT_DC_BLOCK 1
+
+#define CONFIG_AUDIO_FRAMES_PER_PACKET 1
+#define CONFIG_AUDIO_UPLINK_BUDGET_CPU_US 30000
+#define CONFIG_AUDIO_UPLINK_BUDGET_BYTES_PER_SECOND 4500
+#define CONFIG_AUDIO_UPLINK_BUDGET_ALLOCATIONS 32
+
+#define CONFIG_FBT_UDP_RELIABLE_WINDOW 4
+#define CONFIG_FBT_TRANSPORT_WORKER_PRIORITY 10
+#define CONFIG_FBT_TRANSPORT_WORKER_STACK_SIZE 4096
+#define CONFIG_FBT_TRANSPORT_WORKER_QUEUE_LENGTH 16
+#define CONFIG_FBT_EVENT_DISPATCH_PRIORITY 1
+#define CONFIG_FBT_EVENT_DISPATCH_STACK_SIZE 4096
+#define CONFIG_FBT_EVENT_DISPATCH_QUEUE_LENGTH 16
@@ -0,0 +1,71 @@
+/* In-memory Settings for the host build, every namespace starts empty */
+#include "settings.h"
+
+#include <map>
+#include <mutex>
+
+namespace {
+
+std::mutex settings_mutex;
+std::map<std::string, std::map<std::string, std::string>> strings;
+std::map<std::string, std::map<std::string, int32_t>> ints;
+
+} // namespace
+
+Settings::Settings(const std::string &ns, bool read_write) : ns_(ns), read_write_(read_write) {
+}
+
+Settings::~Settings() {
+}
+
+std::string Settings::GetString(const std::string &key, const std::string &default_value) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    auto &values = strings[ns_];
+    auto it = values.find(key);
+    return it != values.end() ? it->second : default_value;
+}
+
+void Settings::SetString(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (read_write_) {
+        strings[ns_][key] = value;
+    }
+}
+
+int32_t Settings::GetInt(const std::string &key, int32_t default_value) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    auto &values = ints[ns_];
+    auto it = values.find(key);
+    return it != values.end() ? it->second : default_value;
+}
+
+void Settings::SetInt(const std::string &key, int32_t value) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (read_write_) {
+        ints[ns_][key] = value;
+    }
+}
+
+bool Settings::GetBool(const std::string &key, bool default_value) {
+    return GetInt(key, default_value ? 1 : 0) != 0;
+}
+
+void Settings::SetBool(const std::string &key, bool value) {
+    SetInt(key, value ? 1 : 0);
+}
+
+void Settings::EraseKey(const std::string &key) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (read_write_) {
+        strings[ns_].erase(key);
+        ints[ns_].erase(key);
+    }
+}
+
+void Settings::EraseAll() {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    if (read_write_) {
+        strings.erase(ns_);
+        ints.erase(ns_);
+    }
+}
@@ -0,0 +1,27 @@
+/*
+ * Counts the operator new calls of the whole process, for tests and benchmarks that check a path
+ * does not allocate. Linked into every host target, the counters are cheap atomics.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace heap_counter {
+
+uint64_t Allocations();
+uint64_t Bytes();
+
+/* Allocations made while the scope is alive */
+class Scope {
+  public:
+    Scope() : start_(Allocations()), start_bytes_(Bytes()) {}
+    uint64_t allocations() const { return Allocations() - start_; }
+    uint64_t bytes() const { return Bytes() - start_bytes_; }
+
+  private:
+    uint64_t start_;
+    uint64_t start_bytes_;
+};
+
+} // namespace heap_counter
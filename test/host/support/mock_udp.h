@@ -0,0 +1,96 @@
+/*
+ * A Udp whose network is the test. Send records the datagram (and hands it to an optional link,
+ * see OnSend); Receive delivers a datagram to the message callback like the modem's receive task,
+ * and counts what the receive path copied on the way.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "heap_counter.h"
+#include "udp.h"
+
+class MockUdp : public Udp {
+  public:
+    /* Like the modem's receive task, a datagram being delivered finishes before the Udp goes away */
+    ~MockUdp() override {
+        while (receiving_ > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool Connect(const std::string &host, int port) override {
+        connected_ = true;
+        return true;
+    }
+    void Disconnect() override { connected_ = false; }
+    int GetLastError() override { return 0; }
+
+    int Send(const std::string &data) override {
+        std::function<void(const std::string &)> link;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sent_.push_back(data);
+            link = link_;
+        }
+        if (link) {
+            link(data);
+        }
+        return data.size();
+    }
+
+    /*
+     * Delivers `packet` from the receive buffer, the callback sees this very string. Returns the heap
+     * bytes allocated while the callback ran: every copy of the packet, or of part of it, shows up
+     * here unless the receive path copies into memory it allocated beforehand.
+     */
+    size_t Receive(const std::string &packet) {
+        receiving_++;
+        heap_counter::Scope scope;
+        if (message_callback_) {
+            message_callback_(packet);
+        }
+        size_t copied = scope.bytes();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            received_++;
+            copied_bytes_ += copied;
+        }
+        receiving_--;
+        return copied;
+    }
+
+    /* Called with every sent datagram, outside the lock, e.g. to deliver it to a peer */
+    void OnSend(std::function<void(const std::string &data)> link) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        link_ = std::move(link);
+    }
+
+    std::vector<std::string> TakeSent() {
+        std::vector<std::string> sent;
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent.swap(sent_);
+        return sent;
+    }
+    size_t received() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return received_;
+    }
+    size_t copied_bytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return copied_bytes_;
+    }
+
+  private:
+    std::atomic<int> receiving_{0};
+    std::mutex mutex_;
+    std::vector<std::string> sent_;
+    std::function<void(const std::string &data)> link_;
+    size_t received_ = 0;
+    size_t copied_bytes_ = 0;
+};
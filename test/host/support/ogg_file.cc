@@ -0,0 +1,87 @@
+#include "ogg_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "ogg_demuxer.h"
+#include "opus_encoder.h"
+
+namespace {
+
+std::vector<uint8_t> OpusHead(uint32_t input_rate) {
+    std::vector<uint8_t> head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1, 0x38, 0x01};
+    for (int i = 0; i < 4; i++) {
+        head.push_back((input_rate >> (8 * i)) & 0xff);
+    }
+    head.insert(head.end(), {0, 0, 0});
+    return head;
+}
+
+std::vector<uint8_t> OpusTags() {
+    std::vector<uint8_t> tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+    tags.insert(tags.end(), 8, 0);
+    return tags;
+}
+
+} // namespace
+
+std::string WriteOggOpus(const std::vector<std::vector<uint8_t>> &packets, uint32_t input_rate) {
+    std::vector<std::vector<uint8_t>> all = {OpusHead(input_rate), OpusTags()};
+    all.insert(all.end(), packets.begin(), packets.end());
+
+    std::vector<uint8_t> lacing;
+    std::vector<uint8_t> body;
+    for (auto &packet : all) {
+        size_t size = packet.size();
+        while (size >= 255) {
+            lacing.push_back(255);
+            size -= 255;
+        }
+        lacing.push_back(size);
+        body.insert(body.end(), packet.begin(), packet.end());
+    }
+
+    std::string ogg;
+    size_t segment = 0, offset = 0;
+    bool continued = false;
+    uint32_t sequence = 0;
+    while (segment < lacing.size()) {
+        size_t count = std::min<size_t>(255, lacing.size() - segment);
+        std::string page(OGG_PAGE_HEADER_SIZE, '\0');
+        memcpy(&page[0], "OggS", 4);
+        page[5] = (continued ? 0x01 : 0) | (segment == 0 ? 0x02 : 0) | (segment + count == lacing.size() ? 0x04 : 0);
+        for (int i = 0; i < 4; i++) {
+            page[14 + i] = (0x5eed >> (8 * i)) & 0xff;
+            page[18 + i] = (sequence >> (8 * i)) & 0xff;
+        }
+        page[26] = count;
+        size_t body_size = 0;
+        for (size_t i = 0; i < count; i++) {
+            page.push_back(lacing[segment + i]);
+            body_size += lacing[segment + i];
+        }
+        page.append(reinterpret_cast<const char *>(body.data()) + offset, body_size);
+        continued = lacing[segment + count - 1] == 255;
+        segment += count;
+        offset += body_size;
+        sequence++;
+        ogg += page;
+    }
+    return ogg;
+}
+
+std::string EncodeOggOpus(const std::vector<int16_t> &pcm, int sample_rate, int frame_ms) {
+    OpusEncoderWrapper encoder(sample_rate, 1, frame_ms);
+    // Every frame is a packet, silence included
+    encoder.SetDtx(false);
+    std::vector<std::vector<uint8_t>> packets;
+    size_t frame_samples = sample_rate / 1000 * frame_ms;
+    for (size_t offset = 0; offset + frame_samples <= pcm.size(); offset += frame_samples) {
+        std::vector<uint8_t> opus;
+        if (encoder.Encode(std::vector<int16_t>(pcm.begin() + offset, pcm.begin() + offset + frame_samples), opus)) {
+            packets.push_back(std::move(opus));
+        }
+    }
+    return WriteOggOpus(packets, sample_rate);
+}
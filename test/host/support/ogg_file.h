@@ -0,0 +1,15 @@
+/* Ogg Opus streams for the host tests, laid out like the sounds in main/assets */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* OpusHead, OpusTags and `packets` as Ogg pages, without CRCs: OggDemuxer does not check them */
+std::string WriteOggOpus(const std::vector<std::vector<uint8_t>> &packets, uint32_t input_rate);
+
+/*
+ * `pcm` (mono) encoded with OpusEncoderWrapper into `frame_ms` packets. Use 10ms frames for tests
+ * that must pass with the fake codec too: its packets always carry the TOC byte of a 10ms frame.
+ */
+std::string EncodeOggOpus(const std::vector<int16_t> &pcm, int sample_rate, int frame_ms);
@@ -0,0 +1,59 @@
+#include "wav_audio_codec.h"
+
+#include <algorithm>
+#include <thread>
+
+WavAudioCodec::WavAudioCodec(const WavFile &input, int output_sample_rate, bool paced) : input_(input), paced_(paced) {
+    duplex_ = true;
+    input_sample_rate_ = input.sample_rate;
+    input_channels_ = input.channels;
+    input_reference_ = input.channels == 2;
+    output_sample_rate_ = output_sample_rate;
+    output_.sample_rate = output_sample_rate;
+    output_.channels = 1;
+}
+
+WavFile WavAudioCodec::GetOutput() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return output_;
+}
+
+size_t WavAudioCodec::input_position() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return input_position_;
+}
+
+void WavAudioCodec::Pace(Clock::time_point &clock, int frames, int sample_rate) {
+    if (!paced_) {
+        return;
+    }
+    auto now = Clock::now();
+    // A stream that was idle restarts from now, like a DMA buffer that ran dry
+    if (clock < now) {
+        clock = now;
+    }
+    clock += std::chrono::microseconds((int64_t)frames * 1000000 / sample_rate);
+    std::this_thread::sleep_until(clock);
+}
+
+int WavAudioCodec::Read(int16_t *dest, int samples) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t available = input_.samples.size() - std::min(input_position_, input_.samples.size());
+        size_t count = std::min<size_t>(samples, available);
+        std::copy_n(input_.samples.begin() + input_position_, count, dest);
+        std::fill(dest + count, dest + samples, 0);
+        input_position_ += samples;
+    }
+    Pace(input_clock_, samples / input_channels_, input_sample_rate_);
+    return samples;
+}
+
+int WavAudioCodec::Write(const int16_t *data, int samples) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        output_.samples.insert(output_.samples.end(), data, data + samples);
+    }
+    Pace(output_clock_, samples / output_channels_, output_sample_rate_);
+    return samples;
+}
@@ -0,0 +1,43 @@
+/*
+ * An AudioCodec whose microphone plays a WAV file and whose speaker records into one.
+ *
+ * Paced, Read() and Write() take as long as the I2S transfer would at the codec's sample rate, so
+ * the queues and tasks of AudioService see the timing of a device. Unpaced, they return at once,
+ * for tests that only care about the samples. After the input ends the microphone returns silence.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "audio_codec.h"
+#include "wav_file.h"
+
+class WavAudioCodec : public AudioCodec {
+  public:
+    WavAudioCodec(const WavFile &input, int output_sample_rate, bool paced = true);
+
+    /* Everything written to the speaker so far */
+    WavFile GetOutput();
+    size_t input_position();
+
+  protected:
+    int Read(int16_t *dest, int samples) override;
+    int Write(const int16_t *data, int samples) override;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    WavFile input_;
+    bool paced_;
+    std::mutex mutex_;
+    size_t input_position_ = 0;
+    WavFile output_;
+    // When the next read / write completes, the two directions are clocked separately
+    Clock::time_point input_clock_;
+    Clock::time_point output_clock_;
+
+    void Pace(Clock::time_point &clock, int frames, int sample_rate);
+};
@@ -0,0 +1,147 @@
+#include "wav_file.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+uint32_t ReadLe32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t ReadLe16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+void WriteLe32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+void WriteLe16(uint8_t *p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+} // namespace
+
+bool ReadWav(const std::string &path, WavFile &wav) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+
+    if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 || memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "%s is not a WAV file\n", path.c_str());
+        return false;
+    }
+    bool have_format = false;
+    size_t offset = 12;
+    while (offset + 8 <= data.size()) {
+        const uint8_t *chunk = data.data() + offset;
+        uint32_t size = ReadLe32(chunk + 4);
+        const uint8_t *body = chunk + 8;
+        if (offset + 8 + size > data.size()) {
+            size = data.size() - offset - 8;
+        }
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint16_t format = ReadLe16(body);
+            wav.channels = ReadLe16(body + 2);
+            wav.sample_rate = ReadLe32(body + 4);
+            uint16_t bits = ReadLe16(body + 14);
+            // WAVE_FORMAT_EXTENSIBLE carries the format in its sub-format GUID
+            if (format == 0xFFFE && size >= 26) {
+                format = ReadLe16(body + 24);
+            }
+            if (format != 1 || bits != 16 || wav.channels < 1) {
+                fprintf(stderr, "%s: only 16 bit PCM is supported\n", path.c_str());
+                return false;
+            }
+            have_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && have_format) {
+            wav.samples.resize(size / 2);
+            for (size_t i = 0; i < wav.samples.size(); i++) {
+                wav.samples[i] = (int16_t)ReadLe16(body + i * 2);
+            }
+            wav.samples.resize(wav.frames() * wav.channels);
+            return true;
+        }
+        offset += 8 + size + (size & 1);
+    }
+    fprintf(stderr, "%s has no PCM data\n", path.c_str());
+    return false;
+}
+
+bool WriteWav(const std::string &path, const WavFile &wav) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot create %s\n", path.c_str());
+        return false;
+    }
+    uint32_t data_size = wav.samples.size() * 2;
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    WriteLe32(header + 4, 36 + data_size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    WriteLe32(header + 16, 16);
+    WriteLe16(header + 20, 1);
+    WriteLe16(header + 22, wav.channels);
+    WriteLe32(header + 24, wav.sample_rate);
+    WriteLe32(header + 28, wav.sample_rate * wav.channels * 2);
+    WriteLe16(header + 32, wav.channels * 2);
+    WriteLe16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    WriteLe32(header + 40, data_size);
+    fwrite(header, 1, sizeof(header), file);
+    std::vector<uint8_t> body(data_size);
+    for (size_t i = 0; i < wav.samples.size(); i++) {
+        WriteLe16(body.data() + i * 2, (uint16_t)wav.samples[i]);
+    }
+    bool ok = fwrite(body.data(), 1, body.size(), file) == body.size();
+    fclose(file);
+    return ok;
+}
+
+WavFile SynthesizeSpeech(int sample_rate, int channels, int duration_ms, uint32_t seed) {
+    WavFile wav;
+    wav.sample_rate = sample_rate;
+    wav.channels = channels;
+    size_t frames = (size_t)sample_rate * duration_ms / 1000;
+    wav.samples.resize(frames * channels);
+
+    uint32_t noise = seed * 2654435761u + 1;
+    double phase = 0;
+    for (size_t i = 0; i < frames; i++) {
+        double t = (double)i / sample_rate;
+        // 1.2s talk spurts, 0.5s pauses
+        double cycle = std::fmod(t, 1.7);
+        bool talking = cycle < 1.2;
+        double pitch = 140 + 40 * std::sin(2 * M_PI * 0.7 * t);
+        phase += 2 * M_PI * pitch / sample_rate;
+        noise = noise * 1664525u + 1013904223u;
+        double value = ((int32_t)noise >> 20) / 4096.0 * 60;
+        if (talking) {
+            double envelope = std::sin(M_PI * cycle / 1.2);
+            for (int harmonic = 1; harmonic <= 8; harmonic++) {
+                value += envelope * 6000 / harmonic * std::sin(harmonic * phase);
+            }
+        }
+        for (int c = 0; c < channels; c++) {
+            // Other channels are the quiet reference of a speaker that is not playing
+            double sample = c == 0 ? value : value / 16;
+            wav.samples[i * channels + c] = (int16_t)std::lround(std::fmax(-32768, std::fmin(32767, sample)));
+        }
+    }
+    return wav;
+}
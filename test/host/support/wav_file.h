@@ -0,0 +1,25 @@
+/* 16 bit PCM WAV files for the host tests and benchmarks */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct WavFile {
+    int sample_rate = 16000;
+    int channels = 1;
+    // Interleaved
+    std::vector<int16_t> samples;
+
+    size_t frames() const { return channels > 0 ? samples.size() / channels : 0; }
+};
+
+/* Only PCM 16 bit is accepted, errors go to stderr */
+bool ReadWav(const std::string &path, WavFile &wav);
+bool WriteWav(const std::string &path, const WavFile &wav);
+
+/*
+ * Speech-like test signal: talk spurts of harmonics with a moving pitch, separated by pauses of
+ * low noise. The same arguments always give the same samples.
+ */
+WavFile SynthesizeSpeech(int sample_rate, int channels, int duration_ms, uint32_t seed = 1);
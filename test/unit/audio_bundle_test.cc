@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "audio_bundle.h"
+
+namespace {
+
+std::unique_ptr<AudioStreamPacket> Frame(size_t size, uint8_t fill, int64_t origin_us, int frame_duration = 60) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->frame_duration = frame_duration;
+    packet->timestamp = origin_us / 1000;
+    packet->origin_us = origin_us;
+    packet->payload.assign(size, fill);
+    return packet;
+}
+
+std::vector<std::vector<uint8_t>> SplitAll(const std::vector<uint8_t> &bundle, bool *valid = nullptr) {
+    std::vector<std::vector<uint8_t>> frames;
+    bool result = AudioBundler::Split(bundle.data(), bundle.size(), [&frames](const uint8_t *frame, size_t frame_size) {
+        frames.emplace_back(frame, frame + frame_size);
+    });
+    if (valid) {
+        *valid = result;
+    }
+    return frames;
+}
+
+} // namespace
+
+TEST(AudioBundler, BundlesAndSplitsFrames) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(3);
+    ASSERT_TRUE(bundler.enabled());
+
+    EXPECT_FALSE(bundler.Add(*Frame(100, 1, 1000000)));
+    EXPECT_TRUE(bundler.Continues(*Frame(80, 2, 1060000)));
+    EXPECT_FALSE(bundler.Add(*Frame(80, 2, 1060000)));
+    EXPECT_TRUE(bundler.Add(*Frame(300, 3, 1120000)));
+    EXPECT_EQ(bundler.frames(), 3);
+    // The header describes the first frame
+    EXPECT_EQ(bundler.timestamp(), 1000u);
+    EXPECT_EQ(bundler.origin_us(), 1000000);
+    EXPECT_EQ(bundler.payload().size(), 3 * 2 + 100 + 80 + 300u);
+
+    bool valid = false;
+    auto frames = SplitAll(bundler.payload(), &valid);
+    ASSERT_TRUE(valid);
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0], std::vector<uint8_t>(100, 1));
+    EXPECT_EQ(frames[1], std::vector<uint8_t>(80, 2));
+    EXPECT_EQ(frames[2], std::vector<uint8_t>(300, 3));
+
+    bundler.Clear();
+    EXPECT_TRUE(bundler.empty());
+    EXPECT_TRUE(bundler.payload().empty());
+}
+
+TEST(AudioBundler, FramesPerPacketIsClamped) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(0);
+    EXPECT_EQ(bundler.frames_per_packet(), 1);
+    EXPECT_FALSE(bundler.enabled());
+    bundler.SetFramesPerPacket(100);
+    EXPECT_EQ(bundler.frames_per_packet(), AUDIO_BUNDLE_MAX_FRAMES);
+}
+
+TEST(AudioBundler, DtxEndsTheBundle) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(4);
+    EXPECT_FALSE(bundler.Add(*Frame(100, 1, 1000000)));
+    auto dtx = Frame(1, 0x58, 1060000);
+    dtx->dtx = true;
+    // Silence does not wait for the bundle to fill
+    EXPECT_TRUE(bundler.Add(*dtx));
+    EXPECT_EQ(SplitAll(bundler.payload()).size(), 2u);
+}
+
+TEST(AudioBundler, GapsAndFrameDurationChangesDoNotContinue) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(4);
+    bundler.Add(*Frame(100, 1, 1000000));
+    // 1.5 frames without a packet: the encoder skipped some, the timestamps of the list would be off
+    // (the timestamps follow on, only the capture times are late)
+    auto late = Frame(100, 1, 1000000 + 91000);
+    late->timestamp = 1060;
+    EXPECT_FALSE(bundler.Continues(*late));
+    late->origin_us = 1000000 + 89000;
+    EXPECT_TRUE(bundler.Continues(*late));
+    EXPECT_FALSE(bundler.Continues(*Frame(100, 1, 1060000, 20)));
+    // An empty bundler takes anything
+    bundler.Clear();
+    EXPECT_TRUE(bundler.Continues(*Frame(100, 1, 5000000, 20)));
+}
+
+TEST(AudioBundler, TimestampsThatDoNotFollowOnDoNotContinue) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(4);
+    bundler.Add(*Frame(100, 1, 1000000));
+    bundler.Add(*Frame(100, 1, 1060000));
+    // Captured on time, but the timestamp jumped (e.g. the speaker timeline of the server AEC)
+    auto jumped = Frame(100, 1, 1120000);
+    jumped->timestamp = 1000 + 2 * 60 + 20;
+    EXPECT_FALSE(bundler.Continues(*jumped));
+    jumped->timestamp = 1000 + 2 * 60;
+    EXPECT_TRUE(bundler.Continues(*jumped));
+    // Going back in time, or losing the timestamp, ends the bundle as well
+    jumped->timestamp = 1000;
+    EXPECT_FALSE(bundler.Continues(*jumped));
+    jumped->timestamp = 0;
+    EXPECT_FALSE(bundler.Continues(*jumped));
+}
+
+TEST(AudioBundler, FramesWithoutTimestampsContinue) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(4);
+    auto first = Frame(100, 1, 1000000);
+    first->timestamp = 0;
+    bundler.Add(*first);
+    auto next = Frame(100, 1, 1060000);
+    next->timestamp = 0;
+    EXPECT_TRUE(bundler.Continues(*next));
+    // A timestamp appearing mid-bundle could not be derived from the header's 0
+    next->timestamp = 1060;
+    EXPECT_FALSE(bundler.Continues(*next));
+}
+
+TEST(AudioBundler, SplitsFramesAtTheSizePrefixLimit) {
+    // Two byte sizes: frames up to 65535 bytes, and empty ones
+    std::vector<uint8_t> bundle = {0x01, 0x00};
+    bundle.insert(bundle.end(), 256, 9);
+    bundle.insert(bundle.end(), {0x00, 0x00});
+    bool valid = false;
+    auto frames = SplitAll(bundle, &valid);
+    ASSERT_TRUE(valid);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].size(), 256u);
+    EXPECT_TRUE(frames[1].empty());
+}
+
+TEST(AudioBundler, MalformedBundlesAreDroppedWhole) {
+    std::vector<std::vector<uint8_t>> malformed = {
+        {},                          // no frame
+        {0x00},                      // half a size
+        {0x00, 0x03, 1, 2},          // frame runs past the end
+        {0x00, 0x01, 1, 0x00},       // trailing byte
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // more than AUDIO_BUNDLE_MAX_FRAMES
+    };
+    for (auto &bundle : malformed) {
+        int calls = 0;
+        bool valid = AudioBundler::Split(bundle.data(), bundle.size(), [&calls](const uint8_t *, size_t) { calls++; });
+        EXPECT_FALSE(valid) << bundle.size() << " bytes";
+        // Nothing of a bad bundle reaches the decoder
+        EXPECT_EQ(calls, 0);
+    }
+}
+
+TEST(AudioBundler, SplitHandsOutViewsOfTheDatagram) {
+    AudioBundler bundler;
+    bundler.SetFramesPerPacket(2);
+    bundler.Add(*Frame(50, 1, 1000000));
+    bundler.Add(*Frame(60, 2, 1060000));
+    const auto &payload = bundler.payload();
+    std::vector<const uint8_t *> starts;
+    AudioBundler::Split(payload.data(), payload.size(), [&starts](const uint8_t *frame, size_t) { starts.push_back(frame); });
+    ASSERT_EQ(starts.size(), 2u);
+    EXPECT_EQ(starts[0], payload.data() + 2);
+    EXPECT_EQ(starts[1], payload.data() + 2 + 50 + 2);
+}
@@ -0,0 +1,66 @@
+/*
+ * AudioDebugger::Compress, the payload format scripts/audio_debug_server.py decompresses. The bytes
+ * are pinned by test/data/audio_debug_compress.json, which scripts/audio_debug_server_test.py
+ * decompresses back to the same samples.
+ */
+#include <gtest/gtest.h>
+
+#include <cJSON.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "processors/audio_debugger.h"
+
+namespace {
+
+struct Fixture {
+    int channels = 0;
+    std::vector<int16_t> samples;
+    std::vector<uint8_t> compressed;
+};
+
+bool LoadFixture(Fixture &fixture) {
+    std::ifstream file(std::string(REPO_ROOT) + "/test/data/audio_debug_compress.json");
+    std::stringstream text;
+    text << file.rdbuf();
+    cJSON *root = cJSON_Parse(text.str().c_str());
+    if (!root) {
+        return false;
+    }
+    fixture.channels = cJSON_GetObjectItem(root, "channels")->valueint;
+    cJSON *samples = cJSON_GetObjectItem(root, "samples");
+    for (int i = 0; i < cJSON_GetArraySize(samples); i++) {
+        fixture.samples.push_back(cJSON_GetArrayItem(samples, i)->valueint);
+    }
+    std::string hex = cJSON_GetStringValue(cJSON_GetObjectItem(root, "compressed"));
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        fixture.compressed.push_back(std::stoi(hex.substr(i, 2), nullptr, 16));
+    }
+    cJSON_Delete(root);
+    return true;
+}
+
+} // namespace
+
+TEST(AudioDebugger, CompressMatchesTheFormatOfTheServer) {
+    Fixture fixture;
+    ASSERT_TRUE(LoadFixture(fixture));
+    size_t capacity = fixture.samples.size() * sizeof(int16_t);
+    std::vector<uint8_t> out(capacity);
+    size_t size = AudioDebugger::Compress(fixture.samples.data(), fixture.samples.size(), fixture.channels, out.data(), capacity);
+    out.resize(size);
+    EXPECT_EQ(out, fixture.compressed);
+}
+
+TEST(AudioDebugger, CompressGivesUpOnNoise) {
+    // A full swing every sample takes 3 bytes per sample, more than the raw data
+    std::vector<int16_t> samples;
+    for (int i = 0; i < 64; i++) {
+        samples.push_back(i % 2 ? 32767 : -32768);
+    }
+    std::vector<uint8_t> out(samples.size() * sizeof(int16_t));
+    EXPECT_EQ(AudioDebugger::Compress(samples.data(), samples.size(), 1, out.data(), out.size()), 0u);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "audio_frame_assembler.h"
+#include "heap_counter.h"
+
+namespace {
+
+/* Feeds `chunks` chunks of a sample counter through the assembler, like the AFE fetching 512 samples */
+std::vector<std::vector<int16_t>> Assemble(AudioFrameAssembler &assembler, int16_t &counter, int chunks, size_t chunk_samples,
+                                           size_t frame_samples) {
+    std::vector<std::vector<int16_t>> frames;
+    std::vector<int16_t> chunk(chunk_samples);
+    for (int i = 0; i < chunks; i++) {
+        for (auto &sample : chunk) {
+            sample = counter++;
+        }
+        assembler.Append(chunk.data(), chunk.size(), frame_samples, [&frames](std::vector<int16_t> &&frame) {
+            frames.push_back(std::move(frame));
+        });
+    }
+    return frames;
+}
+
+} // namespace
+
+TEST(AudioFrameAssembler, Cuts512SampleChunksInto480SampleFrames) {
+    AudioFrameAssembler assembler;
+    int16_t counter = 0;
+    // 15 chunks of 512 are exactly 16 frames of 480
+    auto frames = Assemble(assembler, counter, 15, 512, 480);
+    ASSERT_EQ(frames.size(), 16u);
+    int16_t expected = 0;
+    for (auto &frame : frames) {
+        ASSERT_EQ(frame.size(), 480u);
+        for (auto sample : frame) {
+            ASSERT_EQ(sample, expected++);
+        }
+    }
+}
+
+TEST(AudioFrameAssembler, CarriesTheRemainderIntoTheNextFrame) {
+    AudioFrameAssembler assembler;
+    int16_t counter = 0;
+    auto frames = Assemble(assembler, counter, 1, 512, 480);
+    ASSERT_EQ(frames.size(), 1u);
+    // The 32 samples left over start the next frame
+    frames = Assemble(assembler, counter, 1, 448, 480);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].front(), 480);
+    EXPECT_EQ(frames[0].back(), 959);
+}
+
+TEST(AudioFrameAssembler, Joins480SampleChunksInto960SampleFrames) {
+    AudioFrameAssembler assembler;
+    int16_t counter = 0;
+    auto frames = Assemble(assembler, counter, 5, 480, 960);
+    // The fifth chunk waits for its other half
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].size(), 960u);
+    EXPECT_EQ(frames[0].front(), 0);
+    EXPECT_EQ(frames[1].front(), 960);
+    EXPECT_EQ(frames[1].back(), 1919);
+    frames = Assemble(assembler, counter, 1, 480, 960);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].front(), 1920);
+}
+
+TEST(AudioFrameAssembler, CarriesAPartialFrameOverWhenTheFrameGetsShorter) {
+    AudioFrameAssembler assembler;
+    int16_t counter = 0;
+    // 512 into 960 sample frames leaves a partial frame of 512
+    EXPECT_TRUE(Assemble(assembler, counter, 1, 512, 960).empty());
+    auto frames = Assemble(assembler, counter, 1, 512, 320);
+    // The partial frame makes one frame of 320, its other 192 samples start the next
+    ASSERT_EQ(frames.size(), 3u);
+    int16_t expected = 0;
+    for (auto &frame : frames) {
+        ASSERT_EQ(frame.size(), 320u);
+        EXPECT_EQ(frame.front(), expected);
+        EXPECT_EQ(frame.back(), expected + 319);
+        expected += 320;
+    }
+    // 64 samples are left, the next frame continues from them
+    frames = Assemble(assembler, counter, 1, 256, 320);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].front(), 960);
+}
+
+TEST(AudioFrameAssembler, FrameSizeChangesMidStreamKeepEverySample) {
+    AudioFrameAssembler assembler;
+    int16_t counter = 0;
+    std::vector<std::vector<int16_t>> frames;
+    // 60ms, 20ms, 40ms, 20ms frames of the 16kHz stream, the AFE's 512 sample chunks throughout
+    for (size_t frame_samples : {960, 320, 640, 320}) {
+        auto more = Assemble(assembler, counter, 7, 512, frame_samples);
+        frames.insert(frames.end(), more.begin(), more.end());
+    }
+    int16_t expected = 0;
+    for (auto &frame : frames) {
+        for (auto sample : frame) {
+            ASSERT_EQ(sample, expected++);
+        }
+    }
+    // Only the last partial frame is still held
+    EXPECT_LT(counter - expected, 320);
+}
+
+TEST(AudioFrameAssembler, SwappingBuffersBackDoesNotAllocate) {
+    AudioFrameAssembler assembler;
+    std::vector<int16_t> chunk(512, 1);
+    // The consumer's recycled buffer, like the pcm of a pooled AudioTask
+    std::vector<int16_t> recycled;
+    recycled.reserve(480);
+    auto swap_back = [&recycled](std::vector<int16_t> &&frame) {
+        frame.swap(recycled);
+    };
+    for (int i = 0; i < 4; i++) {
+        assembler.Append(chunk.data(), chunk.size(), 480, swap_back);
+    }
+
+    heap_counter::Scope scope;
+    for (int i = 0; i < 1500; i++) {
+        assembler.Append(chunk.data(), chunk.size(), 480, swap_back);
+    }
+    EXPECT_EQ(scope.allocations(), 0u);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+#include "audio_frame_ring.h"
+
+namespace {
+
+std::unique_ptr<int> Frame(int value) {
+    return std::make_unique<int>(value);
+}
+
+} // namespace
+
+TEST(AudioFrameRing, PopsInPushOrder) {
+    AudioFrameRing<int> ring(4);
+    for (int i = 0; i < 4; i++) {
+        auto frame = Frame(i);
+        ASSERT_TRUE(ring.TryPush(frame));
+        EXPECT_EQ(frame, nullptr);
+    }
+    auto extra = Frame(4);
+    EXPECT_FALSE(ring.TryPush(extra));
+    // A failed push leaves the frame with the caller
+    ASSERT_NE(extra, nullptr);
+    EXPECT_EQ(ring.Size(), 4u);
+    for (int i = 0; i < 4; i++) {
+        auto frame = ring.Pop();
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(*frame, i);
+    }
+    EXPECT_EQ(ring.Pop(), nullptr);
+    EXPECT_TRUE(ring.Empty());
+}
+
+TEST(AudioFrameRing, LimitBelowCapacity) {
+    AudioFrameRing<int> ring(8);
+    ring.SetLimit(2);
+    auto a = Frame(1), b = Frame(2), c = Frame(3);
+    EXPECT_TRUE(ring.TryPush(a));
+    EXPECT_TRUE(ring.TryPush(b));
+    EXPECT_FALSE(ring.TryPush(c));
+    EXPECT_TRUE(ring.TryPush(c, true));
+    EXPECT_EQ(ring.Size(), 3u);
+
+    ring.SetLimit(100);
+    EXPECT_EQ(ring.limit(), 8u);
+}
+
+TEST(AudioFrameRing, ClearDropsQueuedFrames) {
+    AudioFrameRing<int> ring(4);
+    for (int i = 0; i < 3; i++) {
+        auto frame = Frame(i);
+        ring.TryPush(frame);
+    }
+    ring.Clear();
+    EXPECT_TRUE(ring.Empty());
+    // The dropped frames no longer count against the capacity
+    for (int i = 10; i < 14; i++) {
+        auto frame = Frame(i);
+        EXPECT_TRUE(ring.TryPush(frame));
+    }
+    auto frame = ring.Pop();
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(*frame, 10);
+}
+
+TEST(AudioFrameRing, ProducerAndConsumerThreads) {
+    const int kFrames = 200000;
+    AudioFrameRing<int> ring(16);
+    std::thread producer([&]() {
+        for (int i = 0; i < kFrames; i++) {
+            auto frame = Frame(i);
+            while (!ring.TryPush(frame)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int expected = 0;
+    while (expected < kFrames) {
+        auto frame = ring.Pop();
+        if (!frame) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(*frame, expected);
+        expected++;
+    }
+    producer.join();
+    EXPECT_TRUE(ring.Empty());
+}
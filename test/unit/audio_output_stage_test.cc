@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "audio_output_stage.h"
+
+namespace {
+
+const int kSampleRate = 24000;
+const size_t kBlockSamples = kSampleRate * 20 / 1000;
+
+/*
+ * Two seconds of a DC offset, a triangle, a square and noise that reach full scale in the second
+ * half. Integer only, so the samples are the same on every host.
+ */
+std::vector<int16_t> TestSignal() {
+    std::vector<int16_t> samples(2 * kSampleRate);
+    uint32_t noise = 12345;
+    for (size_t i = 0; i < samples.size(); i++) {
+        int32_t triangle = (int32_t)(i % 96) - 48;
+        int32_t square = (i / 40) % 2 ? 1 : -1;
+        noise = noise * 1664525 + 1013904223;
+        int32_t level = i < samples.size() / 2 ? 120 : 600;
+        int32_t value = 1500 + triangle * level + square * level * 8 + (int32_t)(noise >> 22) - 512;
+        samples[i] = std::clamp(value, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+    }
+    return samples;
+}
+
+struct GainStep {
+    size_t at_block;
+    int gain;
+};
+
+std::vector<int16_t> ProcessBlocks(AudioOutputStage &stage, std::vector<int16_t> samples, const std::vector<GainStep> &steps) {
+    for (size_t block = 0, offset = 0; offset < samples.size(); block++, offset += kBlockSamples) {
+        for (auto &step : steps) {
+            if (step.at_block == block) {
+                stage.SetGain(step.gain);
+            }
+        }
+        stage.Process(samples.data() + offset, std::min(kBlockSamples, samples.size() - offset));
+    }
+    return samples;
+}
+
+uint64_t Fnv1a(const std::vector<int16_t> &samples) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int16_t sample : samples) {
+        for (int shift = 0; shift < 16; shift += 8) {
+            hash ^= ((uint16_t)sample >> shift) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+int32_t Peak(const std::vector<int16_t> &samples, size_t from = 0) {
+    int32_t peak = 0;
+    for (size_t i = from; i < samples.size(); i++) {
+        peak = std::max(peak, std::abs((int32_t)samples[i]));
+    }
+    return peak;
+}
+
+} // namespace
+
+/*
+ * The whole chain against outputs recorded when the stage was written. A change to the fixed point
+ * math shows up here first; if it is intended, run with PRINT_GOLDEN=1 and update the values.
+ */
+TEST(AudioOutputStage, MatchesGoldenOutput) {
+    struct Case {
+        const char *name;
+        int threshold_db;
+        bool dc_block;
+        std::vector<GainStep> steps;
+        uint64_t golden;
+    };
+    const Case cases[] = {
+        {"unity_dc_block", -1, true, {}, 0x6c0e7e66dd614105ULL},
+        {"volume_steps", -1, true, {{10, AUDIO_OUTPUT_UNITY_GAIN / 2}, {40, AUDIO_OUTPUT_UNITY_GAIN * 3 / 2}}, 0x423e384959f8bdf0ULL},
+        {"boost_limited", -3, false, {{0, AUDIO_OUTPUT_MAX_GAIN}}, 0x6a94af70fde7596eULL},
+    };
+    bool print = getenv("PRINT_GOLDEN") != nullptr;
+    for (auto &c : cases) {
+        SCOPED_TRACE(c.name);
+        AudioOutputStage stage;
+        stage.SetGain(AUDIO_OUTPUT_UNITY_GAIN);
+        stage.Configure(kSampleRate, c.threshold_db, c.dc_block);
+        uint64_t hash = Fnv1a(ProcessBlocks(stage, TestSignal(), c.steps));
+        if (print) {
+            printf("%s: 0x%016llxULL\n", c.name, (unsigned long long)hash);
+        } else {
+            EXPECT_EQ(hash, c.golden);
+        }
+    }
+}
+
+TEST(AudioOutputStage, UnityGainIsBitExactBehindTheLookahead) {
+    AudioOutputStage stage;
+    stage.SetGain(AUDIO_OUTPUT_UNITY_GAIN);
+    stage.Configure(kSampleRate, 0, false);
+    auto input = TestSignal();
+    input.resize(kSampleRate / 2);
+    auto output = ProcessBlocks(stage, input, {});
+
+    size_t lookahead = kSampleRate * AUDIO_OUTPUT_LIMITER_LOOKAHEAD_MS / 1000;
+    for (size_t i = 0; i < lookahead; i++) {
+        ASSERT_EQ(output[i], 0);
+    }
+    for (size_t i = lookahead; i < output.size(); i++) {
+        ASSERT_EQ(output[i], input[i - lookahead]);
+    }
+    EXPECT_EQ(stage.limited_count(), 0u);
+}
+
+TEST(AudioOutputStage, LimiterKeepsBoostedPeaksAtTheThreshold) {
+    AudioOutputStage stage;
+    stage.SetGain(AUDIO_OUTPUT_MAX_GAIN);
+    stage.Configure(kSampleRate, -1, true);
+    auto output = ProcessBlocks(stage, TestSignal(), {});
+    // -1dBFS
+    EXPECT_LE(Peak(output), 29204);
+    EXPECT_GT(Peak(output), 25000);
+    EXPECT_GT(stage.limited_count(), 0u);
+}
+
+TEST(AudioOutputStage, GainChangesAreRamped) {
+    AudioOutputStage stage;
+    stage.SetGain(AUDIO_OUTPUT_UNITY_GAIN);
+    stage.Configure(kSampleRate, 0, false);
+    std::vector<int16_t> input(kSampleRate / 4, 16000);
+    auto output = ProcessBlocks(stage, input, {{5, AUDIO_OUTPUT_UNITY_GAIN / 4}});
+
+    /* From 16000 to 4000 over the ramp, no sample jumps by more than an even share of the step.
+     * The input itself steps from silence when it leaves the lookahead delay, skip that */
+    size_t ramp = kSampleRate * AUDIO_OUTPUT_GAIN_RAMP_MS / 1000;
+    size_t lookahead = kSampleRate * AUDIO_OUTPUT_LIMITER_LOOKAHEAD_MS / 1000;
+    int32_t max_step = 0;
+    for (size_t i = lookahead + 1; i < output.size(); i++) {
+        max_step = std::max(max_step, std::abs(output[i] - output[i - 1]));
+    }
+    EXPECT_LE(max_step, 12000 / (int32_t)ramp + 2);
+    EXPECT_EQ(output.back(), 4000);
+}
+
+TEST(AudioOutputStage, DcBlockerRemovesAnOffset) {
+    AudioOutputStage stage;
+    stage.SetGain(AUDIO_OUTPUT_UNITY_GAIN);
+    stage.Configure(kSampleRate, 0, true);
+    std::vector<int16_t> input(kSampleRate, 5000);
+    auto output = ProcessBlocks(stage, input, {});
+    EXPECT_LE(Peak(output, output.size() - kBlockSamples), 50);
+}
+
+TEST(AudioOutputStage, AStreamAfterResetStartsFromSilence) {
+    auto first = TestSignal();
+    std::vector<int16_t> second(kSampleRate / 2);
+    for (size_t i = 0; i < second.size(); i++) {
+        second[i] = (int16_t)((i % 48) * 200 - 4800);
+    }
+
+    // The reference: the second stream through a fresh stage
+    AudioOutputStage fresh;
+    fresh.SetGain(AUDIO_OUTPUT_MAX_GAIN);
+    fresh.Configure(kSampleRate, -1, true);
+    auto expected = ProcessBlocks(fresh, second, {});
+
+    // A boosted stream that is limited hard, cut off with its peaks still in the delay line
+    AudioOutputStage stage;
+    stage.SetGain(AUDIO_OUTPUT_MAX_GAIN);
+    stage.Configure(kSampleRate, -1, true);
+    ProcessBlocks(stage, first, {});
+    ASSERT_GT(stage.limited_count(), 0u);
+    stage.Reset();
+    auto output = ProcessBlocks(stage, second, {});
+
+    size_t lookahead = kSampleRate * AUDIO_OUTPUT_LIMITER_LOOKAHEAD_MS / 1000;
+    for (size_t i = 0; i < lookahead; i++) {
+        ASSERT_EQ(output[i], 0) << i;
+    }
+    // Neither the limiter gain nor the DC blocker state carried over
+    EXPECT_EQ(output, expected);
+}
+
+TEST(AudioOutputStage, WithoutResetTheLastStreamLeaksIntoTheNext) {
+    AudioOutputStage stage;
+    stage.SetGain(AUDIO_OUTPUT_UNITY_GAIN);
+    stage.Configure(kSampleRate, 0, false);
+    ProcessBlocks(stage, std::vector<int16_t>(kBlockSamples, 8000), {});
+    auto output = ProcessBlocks(stage, std::vector<int16_t>(kBlockSamples, 0), {});
+    EXPECT_EQ(output[0], 8000);
+}
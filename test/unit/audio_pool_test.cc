@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "audio_pool.h"
+#include "audio_service.h"
+#include "heap_counter.h"
+
+namespace {
+
+std::unique_ptr<AudioStreamPacket> Packet(size_t payload_size) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->payload.assign(payload_size, 0x55);
+    return packet;
+}
+
+std::unique_ptr<AudioTask> Task(size_t samples) {
+    auto task = std::make_unique<AudioTask>();
+    task->pcm.assign(samples, 0);
+    return task;
+}
+
+} // namespace
+
+TEST(AudioPool, SteadyStateDoesNotAllocate) {
+    // Warm up the payload and pcm stashes
+    {
+        std::vector<std::unique_ptr<AudioStreamPacket>> packets;
+        std::vector<std::unique_ptr<AudioTask>> tasks;
+        for (int i = 0; i < 8; i++) {
+            packets.push_back(Packet(120));
+            tasks.push_back(Task(960));
+        }
+    }
+
+    heap_counter::Scope scope;
+    for (int i = 0; i < 1000; i++) {
+        // One frame in flight per stage, like the pipeline at its steady state
+        auto packet = Packet(120);
+        auto task = Task(960);
+        auto next_packet = Packet(200);
+        auto next_task = Task(960);
+    }
+    EXPECT_EQ(scope.allocations(), 0u);
+}
+
+TEST(AudioPool, ManyPacketsInFlightDoNotAllocate) {
+    // The decode ring and the jitter buffer full: more packets than a fixed stash of 48 payload
+    // buffers held, so every frame reallocated one
+    const size_t kInFlight = MAX_DECODE_QUEUE_MS / OPUS_FRAME_DURATION_MS + JITTER_BUFFER_CAPACITY;
+    std::vector<std::unique_ptr<AudioStreamPacket>> ring(kInFlight);
+    // The oldest packet is decoded and freed as the next one arrives. The first round fills the
+    // payload stash
+    auto run = [&](size_t frames) {
+        for (size_t i = 0; i < frames; i++) {
+            ring[i % kInFlight] = Packet(60 + i % 200);
+        }
+    };
+    run(2 * kInFlight);
+
+    auto before = AudioPool::GetInstance().GetStatistics();
+    heap_counter::Scope scope;
+    run(1000);
+    EXPECT_EQ(scope.allocations(), 0u);
+    auto after = AudioPool::GetInstance().GetStatistics();
+    EXPECT_EQ(after.packet_misses, before.packet_misses);
+    EXPECT_EQ(after.buffer_misses, before.buffer_misses);
+}
+
+TEST(AudioPool, FullRingsAtTheDefaultFramesStayInTheSlab) {
+    auto before = AudioPool::GetInstance().GetStatistics();
+    std::vector<std::unique_ptr<AudioStreamPacket>> packets;
+    int count = (MAX_DECODE_QUEUE_MS + MAX_SEND_QUEUE_MS) / OPUS_FRAME_DURATION_MS + JITTER_BUFFER_CAPACITY +
+                MAX_PROMPT_PACKETS_IN_QUEUE;
+    for (int i = 0; i < count; i++) {
+        packets.push_back(Packet(60));
+    }
+    auto full = AudioPool::GetInstance().GetStatistics();
+    EXPECT_EQ(full.packet_misses, before.packet_misses);
+    EXPECT_EQ(full.packets_in_use, before.packets_in_use + count);
+
+    packets.clear();
+    EXPECT_EQ(AudioPool::GetInstance().GetStatistics().packets_in_use, before.packets_in_use);
+}
+
+TEST(AudioPool, ExhaustedSlabFallsBackToTheHeap) {
+    auto before = AudioPool::GetInstance().GetStatistics();
+    std::vector<std::unique_ptr<AudioTask>> tasks;
+    for (int i = 0; i < AUDIO_POOL_MAX_TASKS + 4; i++) {
+        tasks.push_back(std::make_unique<AudioTask>());
+        ASSERT_NE(tasks.back(), nullptr);
+    }
+    auto after = AudioPool::GetInstance().GetStatistics();
+    EXPECT_EQ(after.task_misses - before.task_misses, 4u);
+
+    // Heap-allocated tasks are freed to the heap, slab tasks back to the slab
+    tasks.clear();
+    EXPECT_EQ(AudioPool::GetInstance().GetStatistics().tasks_in_use, before.tasks_in_use);
+}
@@ -0,0 +1,114 @@
+/*
+ * PlaySound and StopPrompts on a running AudioService, with a WAV codec whose speaker output is
+ * checked for the sound.
+ */
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_service.h"
+#include "ogg_demuxer.h"
+#include "ogg_file.h"
+#include "sound_pcm_cache.h"
+#include "wav_audio_codec.h"
+
+namespace {
+
+const int kSampleRate = 16000;
+
+std::vector<int16_t> Tone(int duration_ms) {
+    std::vector<int16_t> pcm(kSampleRate / 1000 * duration_ms);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (int16_t)(8000 * sin(2 * M_PI * 440 * i / kSampleRate));
+    }
+    return pcm;
+}
+
+/* Samples of the speaker output louder than the fake codec's quantisation noise */
+size_t LoudSamples(const WavFile &output) {
+    size_t loud = 0;
+    for (auto sample : output.samples) {
+        loud += abs(sample) > 1000;
+    }
+    return loud;
+}
+
+class AudioServicePromptTest : public testing::Test {
+  protected:
+    AudioServicePromptTest() : codec_(WavFile{kSampleRate, 1, std::vector<int16_t>(kSampleRate * 10)}, kSampleRate) {}
+
+    void SetUp() override {
+        service_.Initialize(&codec_);
+        service_.Start();
+    }
+
+    void TearDown() override {
+        service_.Stop();
+        host_task_join_all();
+    }
+
+    /* Waits up to `timeout_ms` for `samples` loud samples at the speaker */
+    bool WaitForSound(size_t samples, int timeout_ms) {
+        for (int ms = 0; ms < timeout_ms; ms += 10) {
+            if (LoudSamples(codec_.GetOutput()) >= samples) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    WavAudioCodec codec_;
+    AudioService service_;
+};
+
+} // namespace
+
+TEST_F(AudioServicePromptTest, StopPromptsWhileIdleDoesNotSilenceTheNextSound) {
+    std::string sound = EncodeOggOpus(Tone(300), kSampleRate, 10);
+    service_.StopPrompts();
+    service_.StopPrompts();
+    service_.PlaySound(sound);
+    // Most of the 300ms tone reaches the speaker
+    EXPECT_TRUE(WaitForSound(kSampleRate / 1000 * 200, 3000)) << LoudSamples(codec_.GetOutput());
+}
+
+TEST_F(AudioServicePromptTest, StopPromptsCutsTheSoundThatIsPlaying) {
+    std::string sound = EncodeOggOpus(Tone(3000), kSampleRate, 10);
+    std::thread play([&]() { service_.PlaySound(sound); });
+    EXPECT_TRUE(WaitForSound(kSampleRate / 10, 3000));
+    service_.StopPrompts();
+    play.join();
+    size_t loud = LoudSamples(codec_.GetOutput());
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // At most what the queues held when it was stopped
+    EXPECT_LT(LoudSamples(codec_.GetOutput()), loud + kSampleRate / 2);
+    EXPECT_LT(LoudSamples(codec_.GetOutput()), (size_t)kSampleRate * 2);
+}
+
+TEST_F(AudioServicePromptTest, AnInterruptedCaptureDoesNotBlockTheCache) {
+    // Static, the cache keys sounds by address
+    static const std::string kLong = EncodeOggOpus(Tone(3000), kSampleRate, 10);
+    static const std::string kShort = EncodeOggOpus(Tone(200), kSampleRate, 10);
+    auto &cache = SoundPcmCache::GetInstance();
+    cache.Register(kLong);
+    cache.Register(kShort);
+
+    std::thread play([&]() { service_.PlaySound(kLong); });
+    EXPECT_TRUE(WaitForSound(kSampleRate / 10, 3000));
+    // PlaySound returns early while its capture is half done
+    service_.Stop();
+    play.join();
+
+    OggOpusIndex index;
+    ASSERT_TRUE(OggDemuxer::BuildIndex(kShort, index));
+    uint32_t fill_id = 0;
+    EXPECT_EQ(cache.Lookup(kShort, index, kSampleRate, fill_id), nullptr);
+    EXPECT_NE(fill_id, 0u);
+    cache.AbortFill(fill_id);
+}
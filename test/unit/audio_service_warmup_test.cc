@@ -0,0 +1,116 @@
+/*
+ * The input warm-up of AudioService: a cold input hands the end of its warm-up to the processor
+ * ahead of the live audio, and an input powered up by PrewarmInput() needs no warm-up at all.
+ *
+ * Every 20ms chunk of the microphone is a 100Hz tone whose amplitude marks chunk % 4, so the
+ * decoded uplink packets tell which chunks were sent and in which order.
+ */
+#include <gtest/gtest.h>
+
+#include <opus.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+
+namespace {
+
+const int kSampleRate = 16000;
+const int kFrameMs = 20;
+const int kChunk = kSampleRate / 1000 * kFrameMs;
+
+WavFile MarkedInput(int duration_ms) {
+    WavFile input{kSampleRate, 1, std::vector<int16_t>(kSampleRate / 1000 * duration_ms)};
+    for (size_t i = 0; i < input.samples.size(); i++) {
+        int amplitude = 2000 * ((i / kChunk) % 4 + 1);
+        input.samples[i] = (int16_t)(amplitude * sin(2 * M_PI * 100 * i / kSampleRate));
+    }
+    return input;
+}
+
+class AudioServiceWarmupTest : public testing::Test {
+  protected:
+    AudioServiceWarmupTest() : codec_(MarkedInput(5000), kSampleRate) {}
+
+    void SetUp() override {
+        int error = 0;
+        decoder_ = opus_decoder_create(kSampleRate, 1, &error);
+        ASSERT_NE(decoder_, nullptr);
+        service_.Initialize(&codec_);
+        service_.Start();
+        service_.SetFrameDuration(kFrameMs);
+        // Powered down, as after the power timeout
+        codec_.EnableInput(false);
+    }
+
+    void TearDown() override {
+        service_.Stop();
+        host_task_join_all();
+        opus_decoder_destroy(decoder_);
+    }
+
+    /* The amplitude marks of the first `count` uplink packets, fewer if they take too long */
+    std::vector<int> Marks(size_t count) {
+        std::vector<int> marks;
+        std::vector<int16_t> pcm(kChunk);
+        for (int ms = 0; marks.size() < count && ms < 3000;) {
+            auto packet = service_.PopPacketFromSendQueue();
+            if (!packet) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                ms += 5;
+                continue;
+            }
+            int samples = opus_decode(decoder_, packet->payload.data(), packet->payload.size(), pcm.data(), pcm.size(), 0);
+            EXPECT_EQ(samples, kChunk);
+            // The second half of the frame, clear of the codec delay
+            int peak = 0;
+            for (int i = samples / 2; i < samples; i++) {
+                peak = std::max(peak, abs(pcm[i]));
+            }
+            marks.push_back((peak + 1000) / 2000 - 1);
+        }
+        return marks;
+    }
+
+    WavAudioCodec codec_;
+    AudioService service_;
+    OpusDecoder *decoder_ = nullptr;
+};
+
+} // namespace
+
+TEST_F(AudioServiceWarmupTest, ColdInputSendsTheEndOfTheWarmUpFirst) {
+    service_.EnableVoiceProcessing(true);
+    auto marks = Marks(8);
+    ASSERT_EQ(marks.size(), 8u);
+    // The kept chunks and the live audio join without a gap
+    for (size_t i = 1; i < marks.size(); i++) {
+        EXPECT_EQ(marks[i], (marks[0] + (int)i) % 4) << "packet " << i;
+    }
+    // The first chunks of the warm-up were given up
+    EXPECT_GE(codec_.input_position(), 8u * kChunk + (AUDIO_INPUT_WARMUP_MS - AUDIO_INPUT_PREWARM_MS) * kSampleRate / 1000);
+    uint32_t saved_ms = service_.GetDebugStatistics().warmup_saved_ms;
+    EXPECT_GT(saved_ms, 0u);
+    EXPECT_LE(saved_ms, (uint32_t)AUDIO_INPUT_PREWARM_MS);
+}
+
+TEST_F(AudioServiceWarmupTest, PrewarmedInputSkipsTheWarmUp) {
+    service_.PrewarmInput();
+    // Powered up by the input task, without anything to read
+    for (int ms = 0; !codec_.input_enabled() && ms < 1000; ms += 5) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(codec_.input_enabled());
+    std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_INPUT_WARMUP_MS + 20));
+
+    service_.EnableVoiceProcessing(true);
+    // Nothing was read ahead, the uplink starts with the first chunk
+    EXPECT_EQ(Marks(4), (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(service_.GetDebugStatistics().warmup_saved_ms, (uint32_t)AUDIO_INPUT_WARMUP_MS);
+}
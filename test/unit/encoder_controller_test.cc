@@ -0,0 +1,159 @@
+/*
+ * EncoderController decisions, one interval of 20ms frames at a time: complexity follows the share
+ * of the frame time spent encoding, bitrate backs off on backlog or heavy loss and creeps back when
+ * the network keeps up, FEC follows the reported loss. Bounds are the CONFIG_OPUS_ENCODER_* values
+ * of test/host/shim/sdkconfig.h.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "encoder_controller.h"
+
+namespace {
+
+const int kFrameMs = 20;
+const int kMinBitrate = CONFIG_OPUS_ENCODER_BITRATE_MIN_KBPS * 1000;
+const int kMaxBitrate = CONFIG_OPUS_ENCODER_BITRATE_MAX_KBPS * 1000;
+
+/* Encode time per frame for a load in percent of the frame time */
+int EncodeUs(int load_percent) {
+    return kFrameMs * 1000 * load_percent / 100;
+}
+
+class EncoderControllerTest : public testing::Test {
+  protected:
+    /* Runs one interval, returns what the last Update() returned */
+    bool Interval(int load_percent, int backlog_ms = 0) {
+        bool changed = false;
+        for (int ms = 0; ms < ENCODER_CONTROLLER_INTERVAL_MS; ms += kFrameMs) {
+            changed = controller_.Update(EncodeUs(load_percent), kFrameMs, backlog_ms);
+        }
+        return changed;
+    }
+
+    EncoderController controller_;
+};
+
+} // namespace
+
+TEST_F(EncoderControllerTest, StartsCheapAndAtTheHighestBitrate) {
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN);
+    EXPECT_EQ(controller_.settings().bitrate, kMaxBitrate);
+    EXPECT_FALSE(controller_.settings().fec);
+}
+
+TEST_F(EncoderControllerTest, DecidesOncePerInterval) {
+    for (int ms = kFrameMs; ms < ENCODER_CONTROLLER_INTERVAL_MS; ms += kFrameMs) {
+        EXPECT_FALSE(controller_.Update(EncodeUs(1), kFrameMs, 0));
+    }
+    EXPECT_TRUE(controller_.Update(EncodeUs(1), kFrameMs, 0));
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN + 1);
+    EXPECT_EQ(controller_.statistics().load_percent, 1);
+}
+
+TEST_F(EncoderControllerTest, ComplexityStepsUpWhileTheCpuIsIdle) {
+    for (int complexity = CONFIG_OPUS_ENCODER_COMPLEXITY_MIN + 1; complexity <= CONFIG_OPUS_ENCODER_COMPLEXITY_MAX; complexity++) {
+        EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_LOW - 5));
+        EXPECT_EQ(controller_.settings().complexity, complexity);
+    }
+    // Held at the highest complexity
+    EXPECT_FALSE(Interval(ENCODER_CONTROLLER_LOAD_LOW - 5));
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MAX);
+    EXPECT_EQ(controller_.statistics().complexity_changes,
+              (uint32_t)(CONFIG_OPUS_ENCODER_COMPLEXITY_MAX - CONFIG_OPUS_ENCODER_COMPLEXITY_MIN));
+}
+
+TEST_F(EncoderControllerTest, ComplexityStepsDownUnderLoad) {
+    Interval(ENCODER_CONTROLLER_LOAD_LOW - 5);
+    Interval(ENCODER_CONTROLLER_LOAD_LOW - 5);
+    ASSERT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN + 2);
+
+    // Between the thresholds nothing moves
+    EXPECT_FALSE(Interval((ENCODER_CONTROLLER_LOAD_LOW + ENCODER_CONTROLLER_LOAD_HIGH) / 2));
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN + 2);
+
+    EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_HIGH + 10));
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN + 1);
+    EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_HIGH + 10));
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN);
+    // Held at the lowest complexity
+    EXPECT_FALSE(Interval(ENCODER_CONTROLLER_LOAD_HIGH + 10));
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN);
+}
+
+TEST_F(EncoderControllerTest, BacklogBacksTheBitrateOffAndHoldsTheComplexity) {
+    int bitrate = kMaxBitrate;
+    while (bitrate > kMinBitrate) {
+        EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_LOW - 5, ENCODER_CONTROLLER_BACKLOG_MS));
+        bitrate = std::max(bitrate * 3 / 4, kMinBitrate);
+        EXPECT_EQ(controller_.settings().bitrate, bitrate);
+        // An idle CPU does not raise the complexity while the network does not keep up
+        EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN);
+    }
+    EXPECT_FALSE(Interval(ENCODER_CONTROLLER_LOAD_LOW + 5, ENCODER_CONTROLLER_BACKLOG_MS));
+    EXPECT_EQ(controller_.settings().bitrate, kMinBitrate);
+    EXPECT_EQ(controller_.statistics().backlog_ms, ENCODER_CONTROLLER_BACKLOG_MS);
+}
+
+TEST_F(EncoderControllerTest, BitrateRecoversWhileTheQueueStaysDrained) {
+    Interval(ENCODER_CONTROLLER_LOAD_LOW + 5, ENCODER_CONTROLLER_BACKLOG_MS);
+    int bitrate = controller_.settings().bitrate;
+    ASSERT_LT(bitrate, kMaxBitrate);
+
+    // Some backlog, but not congested: held
+    EXPECT_FALSE(Interval(ENCODER_CONTROLLER_LOAD_LOW + 5, kFrameMs * 2));
+    EXPECT_EQ(controller_.settings().bitrate, bitrate);
+
+    while (bitrate < kMaxBitrate) {
+        EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_LOW + 5, kFrameMs));
+        bitrate = std::min(bitrate + ENCODER_CONTROLLER_BITRATE_STEP, kMaxBitrate);
+        EXPECT_EQ(controller_.settings().bitrate, bitrate);
+    }
+}
+
+TEST_F(EncoderControllerTest, HeavyLossBacksTheBitrateOffWithFec) {
+    controller_.ReportLoss(ENCODER_CONTROLLER_HIGH_LOSS + 5);
+    EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_LOW - 5));
+    EXPECT_EQ(controller_.settings().bitrate, kMaxBitrate * 3 / 4);
+    EXPECT_EQ(controller_.settings().complexity, CONFIG_OPUS_ENCODER_COMPLEXITY_MIN);
+    EXPECT_TRUE(controller_.settings().fec);
+    EXPECT_EQ(controller_.settings().loss_percent, ENCODER_CONTROLLER_HIGH_LOSS + 5);
+    EXPECT_EQ(controller_.statistics().loss_percent, ENCODER_CONTROLLER_HIGH_LOSS + 5);
+}
+
+TEST_F(EncoderControllerTest, LightLossTurnsFecOnAndHoldsTheBitrate) {
+    Interval(ENCODER_CONTROLLER_LOAD_LOW + 5, ENCODER_CONTROLLER_BACKLOG_MS);
+    int bitrate = controller_.settings().bitrate;
+
+    // The queue drained, but the bitrate does not grow back while packets are lost
+    controller_.ReportLoss(ENCODER_CONTROLLER_FEC_LOSS + 1);
+    EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_LOW + 5));
+    EXPECT_TRUE(controller_.settings().fec);
+    EXPECT_EQ(controller_.settings().bitrate, bitrate);
+
+    // Below the FEC threshold FEC stays on until no loss is reported
+    controller_.ReportLoss(1);
+    Interval(ENCODER_CONTROLLER_LOAD_LOW + 5);
+    EXPECT_TRUE(controller_.settings().fec);
+    controller_.ReportLoss(0);
+    EXPECT_TRUE(Interval(ENCODER_CONTROLLER_LOAD_LOW + 5));
+    EXPECT_FALSE(controller_.settings().fec);
+    EXPECT_EQ(controller_.statistics().fec_changes, 2u);
+}
+
+TEST_F(EncoderControllerTest, LossFadesOutWithoutReports) {
+    controller_.ReportLoss(40);
+    Interval(ENCODER_CONTROLLER_LOAD_LOW + 5);
+    EXPECT_EQ(controller_.settings().loss_percent, 40);
+    for (int loss : {20, 10, 5, 2, 1, 0}) {
+        Interval(ENCODER_CONTROLLER_LOAD_LOW + 5);
+        EXPECT_EQ(controller_.settings().loss_percent, loss);
+    }
+    EXPECT_FALSE(controller_.settings().fec);
+
+    // Out of range reports are clamped
+    controller_.ReportLoss(250);
+    Interval(ENCODER_CONTROLLER_LOAD_LOW + 5);
+    EXPECT_EQ(controller_.settings().loss_percent, 100);
+}
@@ -0,0 +1,109 @@
+/*
+ * FbtEventBus::PublishAsync runs its handlers on the low-priority event task, never on the transport
+ * worker: a handler may close a call and destroy an FbtUdp whose ACKs are still queued there.
+ */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "fbt_constants.h"
+#include "fbt_event_bus.h"
+#include "fbt_transport_worker.h"
+#include "fbt_udp.h"
+#include "mock_udp.h"
+
+namespace {
+
+/* Holds the transport worker until released, so what is posted after it stays queued */
+struct Blocker {
+    std::atomic<bool> running{false};
+    std::atomic<bool> released{false};
+
+    void Post() {
+        ASSERT_TRUE(FbtTransportWorker::Instance().Post(
+            [](void *arg) {
+                auto *self = static_cast<Blocker *>(arg);
+                self->running = true;
+                while (!self->released) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            },
+            this));
+        while (!running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
+
+} // namespace
+
+TEST(FbtEventBus, AsyncHandlersRunOnTheEventTask) {
+    std::atomic<bool> on_transport{true}, on_events{false};
+    auto &event_bus = FbtEventBus::GetInstance();
+    event_bus.Subscribe("test", "test_where", [&](const std::string &, const std::string &) {
+        on_transport = FbtTransportWorker::Instance().InWorker();
+        on_events = FbtTransportWorker::EventDispatcher().InWorker();
+    });
+    event_bus.PublishAsync("test_where", "");
+    FbtTransportWorker::EventDispatcher().Drain();
+    EXPECT_FALSE(on_transport);
+    EXPECT_TRUE(on_events);
+}
+
+TEST(FbtEventBus, ABlockedHandlerDoesNotHoldUpAcks) {
+    std::atomic<bool> released{false};
+    auto &event_bus = FbtEventBus::GetInstance();
+    event_bus.Subscribe("test", "test_slow", [&](const std::string &, const std::string &) {
+        while (!released) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    event_bus.PublishAsync("test_slow", "");
+
+    auto mock = std::make_unique<MockUdp>();
+    auto *udp = mock.get();
+    FbtUdp fbt_udp(std::move(mock));
+    fbt_udp.Connect("127.0.0.1", 8000);
+    fbt_udp.OnPacket([](std::string_view) {});
+    udp->Receive(std::string(1, PacketType::RELIABLE_CONTROL) + "{}");
+    FbtTransportWorker::Instance().Drain();
+    EXPECT_EQ(udp->TakeSent().size(), 1u);
+
+    released = true;
+    FbtTransportWorker::EventDispatcher().Drain();
+}
+
+TEST(FbtEventBus, ClosingFromAHandlerWaitsForQueuedAcks) {
+    auto mock = std::make_unique<MockUdp>();
+    auto *udp = mock.get();
+    auto fbt_udp = std::make_unique<FbtUdp>(std::move(mock));
+    fbt_udp->Connect("127.0.0.1", 8000);
+    fbt_udp->OnPacket([](std::string_view) {});
+    std::atomic<bool> destroyed{false};
+    std::atomic<int> sent_alive{0};
+    udp->OnSend([&](const std::string &) { sent_alive += !destroyed; });
+
+    auto &event_bus = FbtEventBus::GetInstance();
+    event_bus.Subscribe("test", "test_close", [&](const std::string &, const std::string &) {
+        // What FbtPhoneTransport::close() does on CLOSE_PHONE
+        fbt_udp.reset();
+        destroyed = true;
+    });
+
+    Blocker blocker;
+    blocker.Post();
+    // The ACK waits behind the blocker while the handler destroys its FbtUdp
+    udp->Receive(std::string(1, PacketType::RELIABLE_CONTROL) + "{}");
+    event_bus.PublishAsync("test_close", "");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(destroyed);
+
+    blocker.released = true;
+    FbtTransportWorker::EventDispatcher().Drain();
+    EXPECT_TRUE(destroyed);
+    EXPECT_EQ(sent_alive, 1);
+}
@@ -0,0 +1,241 @@
+/*
+ * The intercom receive path, FbtIntercomReceiver behind an FbtUdp on a MockUdp like in
+ * FbtVoiceTransport: AUDIO_EXT sequence numbers extended across the 16 bit wrap, duplicates
+ * dropped, late packets passed on for the jitter buffer, bundles split, and legacy AUDIO packets
+ * from talkers without the header. Also the answer that decides which header a talker sends.
+ */
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_bundle.h"
+#include "fbt_constants.h"
+#include "fbt_intercom_receiver.h"
+#include "fbt_udp.h"
+#include "mock_udp.h"
+
+namespace {
+
+struct Frame {
+    uint32_t sequence;
+    bool preroll;
+    std::string payload;
+};
+
+std::string ExtPacket(uint16_t talker, uint16_t sequence, const std::string &payload, uint8_t flags = 0,
+                      uint32_t timestamp = 0) {
+    FbtIntercomAudioHeader header;
+    header.type = PacketType::AUDIO_EXT;
+    header.version_flags = (FBT_INTERCOM_AUDIO_VERSION << 4) | flags;
+    header.talker = htons(talker);
+    header.sequence = htons(sequence);
+    header.timestamp = htonl(timestamp);
+    return std::string(reinterpret_cast<const char *>(&header), sizeof(header)) + payload;
+}
+
+std::string LegacyPacket(const std::string &payload) {
+    return std::string(1, PacketType::AUDIO) + payload;
+}
+
+/* |size 2u|frame| for every frame, see audio_bundle.h */
+std::string Bundle(const std::vector<std::string> &frames) {
+    std::string bundle;
+    for (auto &frame : frames) {
+        bundle.push_back(frame.size() >> 8);
+        bundle.push_back(frame.size() & 0xFF);
+        bundle.append(frame);
+    }
+    return bundle;
+}
+
+class FbtIntercomReceiverTest : public testing::Test {
+  protected:
+    FbtIntercomReceiverTest()
+        : receiver_({
+              .on_audio =
+                  [this](std::unique_ptr<AudioStreamPacket> packet) {
+                      frames_.push_back({packet->sequence, packet->preroll,
+                                         std::string(packet->payload.begin(), packet->payload.end())});
+                  },
+              .on_talker_changed = [this]() { talker_changes_++; },
+              .on_packet_loss = [this](int loss_percent) { loss_reports_.push_back(loss_percent); },
+          }) {}
+
+    void SetUp() override {
+        auto udp = std::make_unique<MockUdp>();
+        mock_ = udp.get();
+        fbt_udp_ = std::make_unique<FbtUdp>(std::move(udp));
+        fbt_udp_->Connect("127.0.0.1", 8000);
+        fbt_udp_->OnPacket([this](std::string_view packet) { receiver_.OnPacket(packet); });
+        receiver_.SetFormat(16000, 20);
+        receiver_.Reset();
+    }
+
+    void TearDown() override {
+        fbt_udp_.reset();
+    }
+
+    std::vector<uint32_t> Sequences() const {
+        std::vector<uint32_t> sequences;
+        for (auto &frame : frames_) {
+            sequences.push_back(frame.sequence);
+        }
+        return sequences;
+    }
+
+    MockUdp *mock_ = nullptr;
+    std::unique_ptr<FbtUdp> fbt_udp_;
+    FbtIntercomReceiver receiver_;
+    std::vector<Frame> frames_;
+    int talker_changes_ = 0;
+    std::vector<int> loss_reports_;
+};
+
+} // namespace
+
+TEST_F(FbtIntercomReceiverTest, ExtendsSequencesAcrossTheWrap) {
+    for (uint16_t sequence : {0xFFFE, 0xFFFF, 0x0000, 0x0001}) {
+        mock_->Receive(ExtPacket(7, sequence, "opus"));
+    }
+    auto sequences = Sequences();
+    ASSERT_EQ(sequences.size(), 4u);
+    // Never 0 (no sequence), and still increasing after the 16 bit wrap
+    EXPECT_NE(sequences[0], 0u);
+    for (size_t i = 1; i < sequences.size(); i++) {
+        EXPECT_EQ(sequences[i], sequences[0] + i);
+    }
+    EXPECT_EQ(receiver_.stats().received, 4u);
+    EXPECT_EQ(receiver_.stats().lost, 0u);
+}
+
+TEST_F(FbtIntercomReceiverTest, DropsDuplicates) {
+    mock_->Receive(ExtPacket(7, 10, "a"));
+    mock_->Receive(ExtPacket(7, 11, "b"));
+    mock_->Receive(ExtPacket(7, 11, "b"));
+    mock_->Receive(ExtPacket(7, 10, "a"));
+    EXPECT_EQ(frames_.size(), 2u);
+    EXPECT_EQ(receiver_.stats().duplicate, 2u);
+    EXPECT_EQ(receiver_.stats().received, 2u);
+}
+
+TEST_F(FbtIntercomReceiverTest, PassesLatePacketsOnAndTakesThemOffTheLoss) {
+    mock_->Receive(ExtPacket(7, 0xFFFF, "a"));
+    mock_->Receive(ExtPacket(7, 0x0001, "c"));
+    EXPECT_EQ(receiver_.stats().lost, 1u);
+
+    // Late across the wrap: sorted in by the jitter buffer with its extended sequence
+    mock_->Receive(ExtPacket(7, 0x0000, "b"));
+    auto sequences = Sequences();
+    ASSERT_EQ(sequences.size(), 3u);
+    EXPECT_EQ(sequences[2], sequences[0] + 1);
+    EXPECT_EQ(frames_[2].payload, "b");
+    EXPECT_EQ(receiver_.stats().reordered, 1u);
+    EXPECT_EQ(receiver_.stats().lost, 0u);
+}
+
+TEST_F(FbtIntercomReceiverTest, DropsPacketsTooOldForTheJitterBuffer) {
+    mock_->Receive(ExtPacket(7, 100, "a"));
+    mock_->Receive(ExtPacket(7, 200, "b"));
+    mock_->Receive(ExtPacket(7, 101, "late"));
+    EXPECT_EQ(frames_.size(), 2u);
+    EXPECT_EQ(receiver_.stats().reordered, 1u);
+}
+
+TEST_F(FbtIntercomReceiverTest, SplitsBundles) {
+    mock_->Receive(ExtPacket(7, 0xFFFE, Bundle({"a", "bb", "ccc"}), AUDIO_BUNDLE_FLAG));
+    ASSERT_EQ(frames_.size(), 3u);
+    EXPECT_EQ(frames_[0].payload, "a");
+    EXPECT_EQ(frames_[2].payload, "ccc");
+    EXPECT_EQ(frames_[2].sequence, frames_[0].sequence + 2);
+
+    // A malformed bundle is dropped as a whole
+    mock_->Receive(ExtPacket(7, 0x0001, std::string("\x00\x09xx", 4), AUDIO_BUNDLE_FLAG));
+    EXPECT_EQ(frames_.size(), 3u);
+}
+
+TEST_F(FbtIntercomReceiverTest, MarksPreroll) {
+    mock_->Receive(ExtPacket(7, 1, "p", FBT_INTERCOM_AUDIO_PREROLL_FLAG));
+    mock_->Receive(ExtPacket(7, 2, "s"));
+    ASSERT_EQ(frames_.size(), 2u);
+    EXPECT_TRUE(frames_[0].preroll);
+    EXPECT_FALSE(frames_[1].preroll);
+}
+
+TEST_F(FbtIntercomReceiverTest, RestartsOnANewTalker) {
+    mock_->Receive(ExtPacket(7, 500, "a"));
+    mock_->Receive(ExtPacket(8, 3, "b"));
+    EXPECT_EQ(talker_changes_, 1);
+    EXPECT_EQ(receiver_.talker(), 8);
+    EXPECT_EQ(receiver_.stats().received, 1u);
+    EXPECT_EQ(receiver_.stats().lost, 0u);
+}
+
+TEST_F(FbtIntercomReceiverTest, IgnoresUnknownVersions) {
+    std::string packet = ExtPacket(7, 1, "a");
+    packet[1] = (FBT_INTERCOM_AUDIO_VERSION + 1) << 4;
+    mock_->Receive(packet);
+    EXPECT_TRUE(frames_.empty());
+}
+
+TEST_F(FbtIntercomReceiverTest, PlaysLegacyPacketsWithoutSequence) {
+    mock_->Receive(LegacyPacket("old"));
+    ASSERT_EQ(frames_.size(), 1u);
+    EXPECT_EQ(frames_[0].sequence, 0u);
+    EXPECT_EQ(frames_[0].payload, "old");
+    EXPECT_EQ(talker_changes_, 0);
+}
+
+TEST_F(FbtIntercomReceiverTest, SwitchesBetweenLegacyAndExtTalkers) {
+    mock_->Receive(ExtPacket(7, 40, "a"));
+    mock_->Receive(ExtPacket(7, 41, "b"));
+    // A talker without the header: the audio of the previous one is dropped
+    mock_->Receive(LegacyPacket("old"));
+    EXPECT_EQ(talker_changes_, 1);
+    mock_->Receive(LegacyPacket("old"));
+    EXPECT_EQ(talker_changes_, 1);
+
+    // The same talker as before starts afresh, its sequence numbers are not compared with the old ones
+    mock_->Receive(ExtPacket(7, 2, "c"));
+    ASSERT_EQ(frames_.size(), 5u);
+    EXPECT_EQ(frames_[4].payload, "c");
+    EXPECT_NE(frames_[4].sequence, 0u);
+    EXPECT_EQ(receiver_.stats().received, 1u);
+    EXPECT_EQ(receiver_.stats().lost, 0u);
+}
+
+TEST_F(FbtIntercomReceiverTest, ReportsLossEveryReportInterval) {
+    uint16_t sequence = 1;
+    for (int i = 0; i < FBT_VOICE_LOSS_REPORT_FRAMES; i++) {
+        mock_->Receive(ExtPacket(7, sequence, "a"));
+        // Every fourth frame is lost
+        sequence += i % 3 == 2 ? 2 : 1;
+    }
+    ASSERT_EQ(loss_reports_.size(), 1u);
+    EXPECT_GT(loss_reports_[0], 15);
+    EXPECT_LT(loss_reports_[0], 30);
+}
+
+TEST(FbtIntercomHeaderVersion, SendsTheHeaderOnlyWhenTheAnswerConfirmsIt) {
+    // An old server, or a room with a member that did not declare the header
+    EXPECT_EQ(FbtIntercomHeaderVersion(nullptr), 0);
+    cJSON *audio = cJSON_CreateObject();
+    EXPECT_EQ(FbtIntercomHeaderVersion(audio), 0);
+    cJSON_AddNumberToObject(audio, "header", 0);
+    EXPECT_EQ(FbtIntercomHeaderVersion(audio), 0);
+    cJSON_Delete(audio);
+
+    audio = cJSON_CreateObject();
+    cJSON_AddNumberToObject(audio, "header", FBT_INTERCOM_AUDIO_VERSION);
+    EXPECT_EQ(FbtIntercomHeaderVersion(audio), FBT_INTERCOM_AUDIO_VERSION);
+    cJSON_Delete(audio);
+
+    // A newer room still gets the version this receiver understands
+    audio = cJSON_CreateObject();
+    cJSON_AddNumberToObject(audio, "header", FBT_INTERCOM_AUDIO_VERSION + 1);
+    EXPECT_EQ(FbtIntercomHeaderVersion(audio), FBT_INTERCOM_AUDIO_VERSION);
+    cJSON_Delete(audio);
+}
@@ -0,0 +1,301 @@
+/*
+ * The reliable messages of FbtUdp (SendMust) between two FbtUdp over an in-memory link that delays
+ * and drops datagrams. The clock is manual and moves in 1ms steps; after every step the transport
+ * worker runs until it is idle, so every run is the same.
+ */
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "esp_timer.h"
+#include "fbt_constants.h"
+#include "fbt_transport_worker.h"
+#include "fbt_udp.h"
+#include "mock_udp.h"
+
+namespace {
+
+// Retries for the lossy runs: with 20% loss each way a message and its ACK get through with 64%
+const int kMaxRetries = 10;
+
+struct Endpoint {
+    MockUdp *mock = nullptr;
+    std::unique_ptr<FbtUdp> udp;
+    std::vector<std::string> messages;
+    std::vector<std::string> sent;
+};
+
+class LossyLink {
+  public:
+    LossyLink(double loss, int64_t delay_us) : loss_(loss), delay_us_(delay_us) {}
+
+    void Connect(Endpoint &a, Endpoint &b) {
+        Attach(a, b);
+        Attach(b, a);
+    }
+
+    /* Delivers what is due, moves the clock by 1ms and lets the worker finish what that started */
+    void Step() {
+        std::vector<Datagram> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            int64_t now_us = esp_timer_get_time();
+            for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+                if (it->deliver_us <= now_us) {
+                    due.push_back(*it);
+                    it = in_flight_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto &datagram : due) {
+            datagram.to->mock->Receive(datagram.data);
+        }
+        Settle();
+        host_clock_advance_us(1000);
+        Settle();
+    }
+
+    void DropNext(int count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop_next_ = count;
+    }
+
+    static void Settle() {
+        auto &worker = FbtTransportWorker::Instance();
+        do {
+            worker.Drain();
+        } while (worker.GetStatistics().queue_depth > 0);
+    }
+
+  private:
+    struct Datagram {
+        int64_t deliver_us;
+        Endpoint *to;
+        std::string data;
+    };
+
+    void Attach(Endpoint &from, Endpoint &to) {
+        from.mock->OnSend([this, &from, &to](const std::string &data) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            from.sent.push_back(data);
+            if (drop_next_ > 0) {
+                drop_next_--;
+                return;
+            }
+            if (std::uniform_real_distribution<double>(0, 1)(random_) < loss_) {
+                return;
+            }
+            in_flight_.push_back({esp_timer_get_time() + delay_us_, &to, data});
+        });
+    }
+
+    std::mutex mutex_;
+    std::mt19937 random_{11};
+    double loss_;
+    int64_t delay_us_;
+    int drop_next_ = 0;
+    std::vector<Datagram> in_flight_;
+};
+
+std::string Message(int n) {
+    return std::string(1, PacketType::RELIABLE_CONTROL) + "{\"type\":\"test\",\"n\":" + std::to_string(n) + "}";
+}
+
+uint8_t Type(const std::string &packet) {
+    return packet.empty() ? 0 : (uint8_t)packet[0];
+}
+
+class FbtUdpReliableTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        host_clock_set_manual(true);
+        for (auto *endpoint : {&a_, &b_}) {
+            auto mock = std::make_unique<MockUdp>();
+            endpoint->mock = mock.get();
+            endpoint->udp = std::make_unique<FbtUdp>(std::move(mock), kMaxRetries);
+            endpoint->udp->OnPacket([endpoint](std::string_view packet) {
+                if (!packet.empty() && (uint8_t)packet[0] == PacketType::RELIABLE_CONTROL) {
+                    endpoint->messages.emplace_back(packet);
+                }
+            });
+            endpoint->udp->Connect("127.0.0.1", 8000);
+        }
+    }
+
+    void TearDown() override {
+        a_.udp.reset();
+        b_.udp.reset();
+        host_clock_set_manual(false);
+    }
+
+    /* Steps until both have `a_count` and `b_count` messages or `max_ms` have passed, returns the ms taken */
+    int RunUntil(LossyLink &link, size_t a_count, size_t b_count, int max_ms) {
+        for (int ms = 0; ms < max_ms; ms++) {
+            if (a_.messages.size() >= a_count && b_.messages.size() >= b_count) {
+                return ms;
+            }
+            link.Step();
+        }
+        return max_ms;
+    }
+
+    Endpoint a_;
+    Endpoint b_;
+};
+
+} // namespace
+
+TEST_F(FbtUdpReliableTest, DeliversEveryMessageOnceOverALossyLink) {
+    LossyLink link(0.2, 40000);
+    link.Connect(a_, b_);
+    // Both sides saw "reliable" in the offer and the answer
+    a_.udp->SetPeerWindowed();
+    b_.udp->SetPeerWindowed();
+
+    const int count = 40;
+    for (int i = 0; i < count; i++) {
+        ASSERT_TRUE(a_.udp->SendMust(Message(i)));
+    }
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(b_.udp->SendMust(Message(1000 + i)));
+    }
+    LossyLink::Settle();
+    // A window of messages goes out at once, not one per round trip
+    std::set<std::string> first_burst(a_.sent.begin(), a_.sent.end());
+    EXPECT_EQ(first_burst.size(), (size_t)CONFIG_FBT_UDP_RELIABLE_WINDOW);
+
+    int ms = RunUntil(link, 10, count, 60000);
+    // Let the last retransmissions arrive, duplicates must not reach the callback
+    for (int i = 0; i < 3000; i++) {
+        link.Step();
+    }
+    printf("%d + 10 messages over 20%% loss and 80ms RTT in %d ms\n", count, ms);
+
+    std::multiset<std::string> at_b(b_.messages.begin(), b_.messages.end());
+    ASSERT_EQ(b_.messages.size(), (size_t)count);
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(at_b.count(Message(i)), 1u) << i;
+    }
+    std::multiset<std::string> at_a(a_.messages.begin(), a_.messages.end());
+    ASSERT_EQ(a_.messages.size(), 10u);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(at_a.count(Message(1000 + i)), 1u) << i;
+    }
+    for (auto &packet : b_.sent) {
+        EXPECT_TRUE(Type(packet) == PacketType::RELIABLE_WINDOW || Type(packet) == PacketType::ACK_WINDOW) << (int)Type(packet);
+    }
+}
+
+TEST_F(FbtUdpReliableTest, TheFirstMessageMayBeLost) {
+    LossyLink link(0, 40000);
+    link.Connect(a_, b_);
+    a_.udp->SetPeerWindowed();
+    // B starts counting at the oldest message A still waits for, not at the first one it sees
+    link.DropNext(1);
+    for (int i = 0; i < 3; i++) {
+        a_.udp->SendMust(Message(i));
+    }
+    EXPECT_LT(RunUntil(link, 0, 3, 3000), 3000);
+    std::set<std::string> at_b(b_.messages.begin(), b_.messages.end());
+    EXPECT_EQ(at_b.count(Message(0)), 1u);
+    EXPECT_EQ(b_.messages.size(), 3u);
+}
+
+TEST_F(FbtUdpReliableTest, StopAndWaitUntilThePeerAdvertisesTheWindow) {
+    LossyLink link(0, 40000);
+    link.Connect(a_, b_);
+    for (int i = 0; i < 3; i++) {
+        a_.udp->SendMust(Message(i));
+    }
+    LossyLink::Settle();
+    // A legacy server: one unnumbered message at a time
+    ASSERT_EQ(a_.sent.size(), 1u);
+    EXPECT_EQ(a_.sent[0], Message(0));
+    EXPECT_LT(RunUntil(link, 0, 3, 2000), 2000);
+    for (auto &packet : b_.sent) {
+        EXPECT_EQ(packet, std::string(1, PacketType::ACK));
+    }
+
+    a_.sent.clear();
+    b_.sent.clear();
+    a_.udp->SetPeerWindowed();
+    for (int i = 3; i < 6; i++) {
+        a_.udp->SendMust(Message(i));
+    }
+    LossyLink::Settle();
+    ASSERT_EQ(a_.sent.size(), 3u);
+    for (auto &packet : a_.sent) {
+        EXPECT_EQ(Type(packet), PacketType::RELIABLE_WINDOW);
+    }
+    EXPECT_LT(RunUntil(link, 0, 6, 2000), 2000);
+    ASSERT_FALSE(b_.sent.empty());
+    EXPECT_EQ(Type(b_.sent.back()), PacketType::ACK_WINDOW);
+}
+
+TEST_F(FbtUdpReliableTest, AcknowledgesInTheFormatOfThePacket) {
+    // A sequenced message, then a legacy one from the same peer
+    std::string sequenced = {(char)PacketType::RELIABLE_WINDOW, 0x12, 0x34, 0x12, 0x34};
+    sequenced += Message(1);
+    b_.mock->Receive(sequenced);
+    LossyLink::Settle();
+    b_.mock->Receive(Message(2));
+    LossyLink::Settle();
+
+    auto sent = b_.mock->TakeSent();
+    ASSERT_EQ(sent.size(), 2u);
+    // |ACK_WINDOW|next 0x1235|mask 0|
+    EXPECT_EQ(sent[0], std::string({(char)PacketType::ACK_WINDOW, 0x12, 0x35, 0, 0, 0, 0}));
+    // A legacy sender only knows the single byte ACK
+    EXPECT_EQ(sent[1], std::string(1, PacketType::ACK));
+    EXPECT_EQ(b_.messages.size(), 2u);
+
+    // A duplicate is acknowledged again but not handed on
+    b_.mock->Receive(sequenced);
+    LossyLink::Settle();
+    EXPECT_EQ(b_.mock->TakeSent().size(), 1u);
+    EXPECT_EQ(b_.messages.size(), 2u);
+}
+
+TEST_F(FbtUdpReliableTest, RetransmitTimeoutFollowsTheRoundTrip) {
+    LossyLink link(0, 50000);
+    link.Connect(a_, b_);
+    a_.udp->SetPeerWindowed();
+    // RTT samples of 100ms
+    for (int i = 0; i < 10; i++) {
+        a_.udp->SendMust(Message(i));
+        ASSERT_LT(RunUntil(link, 0, i + 1, 1000), 1000);
+        for (int ms = 0; ms < 100; ms++) {
+            link.Step();
+        }
+    }
+
+    // The next message is lost once
+    a_.sent.clear();
+    link.DropNext(1);
+    int64_t sent_us = esp_timer_get_time();
+    a_.udp->SendMust(Message(10));
+    LossyLink::Settle();
+    int64_t retransmitted_us = 0;
+    for (int ms = 0; ms < 2000 && retransmitted_us == 0; ms++) {
+        link.Step();
+        if (a_.sent.size() > 1) {
+            retransmitted_us = esp_timer_get_time();
+        }
+    }
+    ASSERT_GT(retransmitted_us, 0);
+    EXPECT_EQ(a_.sent[0], a_.sent[1]);
+    // Well under FBT_UDP_INITIAL_RTO_US, and not under the minimum
+    int64_t rto_us = retransmitted_us - sent_us;
+    printf("retransmitted after %lld ms\n", (long long)rto_us / 1000);
+    EXPECT_GE(rto_us, FBT_UDP_MIN_RTO_US);
+    EXPECT_LT(rto_us, FBT_UDP_INITIAL_RTO_US / 2);
+    EXPECT_LT(RunUntil(link, 0, 11, 1000), 1000);
+}
@@ -0,0 +1,206 @@
+/*
+ * The receive path of FbtUdp against a MockUdp that counts the bytes copied per datagram. Audio goes
+ * on to FbtIntercomReceiver, which is what FbtVoiceTransport hands its audio datagrams to, so the
+ * count is the whole path from the modem's receive buffer to the decode queue: an audio payload is
+ * copied once, into AudioStreamPacket::payload, and nothing else is.
+ */
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "fbt_constants.h"
+#include "fbt_intercom_receiver.h"
+#include "fbt_transport_worker.h"
+#include "fbt_udp.h"
+#include "mock_udp.h"
+#include "protocol.h"
+
+namespace {
+
+std::string Datagram(uint8_t type, size_t payload_size) {
+    std::string packet(1 + payload_size, 0);
+    packet[0] = type;
+    for (size_t i = 1; i < packet.size(); i++) {
+        packet[i] = (char)(i * 7);
+    }
+    return packet;
+}
+
+/* |RELIABLE_WINDOW|sequence|oldest|RELIABLE_CONTROL|json|, the only message the sender waits for */
+std::string ReliableWindow(uint16_t sequence, const std::string &json) {
+    std::string packet;
+    packet.push_back(PacketType::RELIABLE_WINDOW);
+    packet.push_back(sequence >> 8);
+    packet.push_back(sequence & 0xFF);
+    packet.push_back(sequence >> 8);
+    packet.push_back(sequence & 0xFF);
+    packet.push_back(PacketType::RELIABLE_CONTROL);
+    packet.append(json);
+    return packet;
+}
+
+/* An AUDIO_EXT datagram of `payload_size` bytes of audio, see fbt_intercom_receiver.h */
+std::string ExtDatagram(uint16_t sequence, size_t payload_size) {
+    FbtIntercomAudioHeader header = {};
+    header.type = PacketType::AUDIO_EXT;
+    header.version_flags = FBT_INTERCOM_AUDIO_VERSION << 4;
+    header.talker = htons(7);
+    header.sequence = htons(sequence);
+    std::string packet = Datagram(PacketType::AUDIO_EXT, payload_size);
+    packet.replace(0, 1, reinterpret_cast<const char *>(&header), sizeof(header));
+    return packet;
+}
+
+bool Within(std::string_view view, const std::string &buffer) {
+    return view.data() >= buffer.data() && view.data() + view.size() <= buffer.data() + buffer.size();
+}
+
+class FbtUdpReceiveTest : public testing::Test {
+  protected:
+    /* The decode queue holds the last packet, the one before has been decoded and went back to the pool */
+    FbtUdpReceiveTest() : receiver_({.on_audio = [this](std::unique_ptr<AudioStreamPacket> packet) { decoded_ = std::move(packet); }}) {}
+
+    void SetUp() override {
+        auto udp = std::make_unique<MockUdp>();
+        mock_ = udp.get();
+        fbt_udp_ = std::make_unique<FbtUdp>(std::move(udp));
+        fbt_udp_->Connect("127.0.0.1", 8000);
+        receiver_.SetFormat(16000, 20);
+        receiver_.Reset();
+        // Warms the pool up: two payload buffers are in use at a time below (the packet in the decode
+        // queue and the one being filled), after these two the stash has them and nothing is allocated
+        auto first = std::make_unique<AudioStreamPacket>();
+        auto second = std::make_unique<AudioStreamPacket>();
+    }
+
+    void TearDown() override {
+        fbt_udp_.reset();
+    }
+
+    MockUdp *mock_ = nullptr;
+    std::unique_ptr<FbtUdp> fbt_udp_;
+    FbtIntercomReceiver receiver_;
+    std::unique_ptr<AudioStreamPacket> decoded_;
+};
+
+} // namespace
+
+TEST_F(FbtUdpReceiveTest, AudioIsCopiedOnceIntoTheDecodeQueue) {
+    std::string received;
+    std::string_view seen;
+    fbt_udp_->OnPacket([&](std::string_view packet) {
+        seen = packet;
+        receiver_.OnPacket(packet);
+    });
+
+    for (size_t size : {1, 40, 120, 400}) {
+        received = Datagram(PacketType::AUDIO, size);
+        // The one copy goes into a pooled payload buffer, nothing on the way allocates
+        EXPECT_EQ(mock_->Receive(received), 0u) << "payload of " << size << " bytes";
+        // The callback sees the modem's buffer itself
+        EXPECT_EQ(seen.data(), received.data());
+        EXPECT_EQ(seen.size(), received.size());
+        ASSERT_EQ(decoded_->payload.size(), size);
+        EXPECT_EQ(memcmp(decoded_->payload.data(), received.data() + 1, size), 0);
+    }
+}
+
+TEST_F(FbtUdpReceiveTest, ExtAudioIsCopiedOnceIntoTheDecodeQueue) {
+    fbt_udp_->OnPacket([&](std::string_view packet) { receiver_.OnPacket(packet); });
+
+    uint16_t sequence = 1;
+    for (size_t size : {1, 40, 120, 400}) {
+        std::string received = ExtDatagram(sequence++, size);
+        EXPECT_EQ(mock_->Receive(received), 0u) << "payload of " << size << " bytes";
+        ASSERT_EQ(decoded_->payload.size(), size);
+        EXPECT_EQ(memcmp(decoded_->payload.data(), received.data() + sizeof(FbtIntercomAudioHeader), size), 0);
+    }
+    EXPECT_EQ(receiver_.stats().received, 4u);
+}
+
+TEST_F(FbtUdpReceiveTest, ControlPacketsAreNotCopied) {
+    std::string received = Datagram(PacketType::CONTROL, 200);
+    std::string_view seen;
+    fbt_udp_->OnPacket([&](std::string_view packet) { seen = packet; });
+    EXPECT_EQ(mock_->Receive(received), 0u);
+    EXPECT_EQ(seen.data(), received.data());
+}
+
+TEST_F(FbtUdpReceiveTest, SequencedMessagesAreViewsPastTheHeader) {
+    std::string received = ReliableWindow(7, "{\"type\":\"answer\"}");
+    std::string_view seen;
+    fbt_udp_->OnPacket([&](std::string_view packet) { seen = packet; });
+    mock_->Receive(received);
+    FbtTransportWorker::Instance().Drain();
+
+    // Handed on as |RELIABLE_CONTROL|json| without the sequence
+    ASSERT_EQ(seen.size(), received.size() - FBT_UDP_WINDOW_HEADER_SIZE);
+    EXPECT_TRUE(Within(seen, received));
+    EXPECT_EQ(seen[0], PacketType::RELIABLE_CONTROL);
+    // And acknowledged from the worker
+    EXPECT_EQ(mock_->TakeSent().size(), 1u);
+}
+
+TEST_F(FbtUdpReceiveTest, OnMessagePassesTheReceivedString) {
+    std::string received = Datagram(PacketType::AUDIO, 120);
+    const std::string *seen = nullptr;
+    fbt_udp_->OnMessage([&](const std::string &data) { seen = &data; });
+    EXPECT_EQ(mock_->Receive(received), 0u);
+    EXPECT_EQ(seen, &received);
+
+    // A sequenced message has to be cut into a string of its own for the string callback
+    received = ReliableWindow(1, "{\"type\":\"answer\",\"status\":1}");
+    size_t copied = mock_->Receive(received);
+    FbtTransportWorker::Instance().Drain();
+    EXPECT_NE(seen, &received);
+    EXPECT_GE(copied, received.size() - FBT_UDP_WINDOW_HEADER_SIZE);
+}
+
+TEST_F(FbtUdpReceiveTest, SteadyAudioDoesNotAllocateInTheTransport) {
+    std::string received = Datagram(PacketType::AUDIO, 160);
+    size_t views = 0;
+    fbt_udp_->OnPacket([&](std::string_view packet) { views += Within(packet, received); });
+    for (int i = 0; i < 1000; i++) {
+        mock_->Receive(received);
+    }
+    EXPECT_EQ(views, 1000u);
+    EXPECT_EQ(mock_->copied_bytes(), 0u);
+}
+
+TEST_F(FbtUdpReceiveTest, DestructionWaitsForARunningReceiveCallback) {
+    std::atomic<bool> entered{false}, released{false}, destroyed{false};
+    std::atomic<int> sent_alive{0};
+    mock_->OnSend([&](const std::string &) { sent_alive += !destroyed; });
+    fbt_udp_->OnPacket([&](std::string_view) {
+        entered = true;
+        while (!released) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    // A message is being handed on when the owner closes the transport
+    std::thread receive([&]() { mock_->Receive(std::string(1, PacketType::RELIABLE_CONTROL) + "{}"); });
+    while (!entered) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::thread close([&]() {
+        fbt_udp_.reset();
+        destroyed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(destroyed);
+
+    released = true;
+    receive.join();
+    close.join();
+    EXPECT_TRUE(destroyed);
+    // The ACK the callback queued went out while the FbtUdp was still there
+    EXPECT_EQ(sent_alive, 1);
+}
@@ -0,0 +1,74 @@
+/* The FreeRTOS and esp_timer stand-ins the other host tests build on */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+TEST(HostShim, EventGroupWakesWaiter) {
+    EventGroupHandle_t group = xEventGroupCreate();
+    std::atomic<EventBits_t> seen{0};
+    xTaskCreate(
+        [](void *arg) {
+            auto group = static_cast<EventGroupHandle_t>(arg);
+            vTaskDelay(pdMS_TO_TICKS(5));
+            xEventGroupSetBits(group, 0x4);
+        },
+        "setter", 2048, group, 5, nullptr);
+    seen = xEventGroupWaitBits(group, 0x4, pdTRUE, pdFALSE, pdMS_TO_TICKS(1000));
+    host_task_join_all();
+    EXPECT_EQ(seen & 0x4, 0x4u);
+    EXPECT_EQ(xEventGroupGetBits(group), 0u);
+    vEventGroupDelete(group);
+}
+
+TEST(HostShim, QueueKeepsOrderAndTimesOut) {
+    QueueHandle_t queue = xQueueCreate(2, sizeof(int));
+    int values[] = {1, 2, 3};
+    EXPECT_EQ(xQueueSend(queue, &values[0], 0), pdTRUE);
+    EXPECT_EQ(xQueueSendToFront(queue, &values[1], 0), pdTRUE);
+    EXPECT_NE(xQueueSend(queue, &values[2], pdMS_TO_TICKS(1)), pdTRUE);
+    int value = 0;
+    EXPECT_EQ(xQueueReceive(queue, &value, 0), pdTRUE);
+    EXPECT_EQ(value, 2);
+    EXPECT_EQ(xQueueReceive(queue, &value, 0), pdTRUE);
+    EXPECT_EQ(value, 1);
+    EXPECT_NE(xQueueReceive(queue, &value, pdMS_TO_TICKS(1)), pdTRUE);
+    vQueueDelete(queue);
+
+    SemaphoreHandle_t semaphore = xSemaphoreCreateBinary();
+    EXPECT_NE(xSemaphoreTake(semaphore, 0), pdTRUE);
+    xSemaphoreGive(semaphore);
+    EXPECT_EQ(xSemaphoreTake(semaphore, 0), pdTRUE);
+    vSemaphoreDelete(semaphore);
+}
+
+TEST(HostShim, ManualClockRunsTimersInOrder) {
+    host_clock_set_manual(true);
+    std::vector<int64_t> fired;
+    esp_timer_create_args_t args = {};
+    args.callback = [](void *arg) { static_cast<std::vector<int64_t> *>(arg)->push_back(esp_timer_get_time()); };
+    args.arg = &fired;
+    esp_timer_handle_t periodic;
+    ASSERT_EQ(esp_timer_create(&args, &periodic), ESP_OK);
+
+    int64_t start = esp_timer_get_time();
+    esp_timer_start_periodic(periodic, 1000);
+    host_clock_advance_us(3500);
+    EXPECT_EQ(esp_timer_get_time(), start + 3500);
+    ASSERT_EQ(fired.size(), 3u);
+    EXPECT_EQ(fired[0], start + 1000);
+    EXPECT_EQ(fired[2], start + 3000);
+
+    esp_timer_stop(periodic);
+    host_clock_advance_us(5000);
+    EXPECT_EQ(fired.size(), 3u);
+    esp_timer_delete(periodic);
+    host_clock_set_manual(false);
+}
@@ -0,0 +1,205 @@
+/*
+ * Replays synthetic network traces through JitterBuffer, with the opus codec task pulling one frame
+ * per frame duration like the playback queue does, and reports the concealment ratio and the delay
+ * the buffer adds to every played frame.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "jitter_buffer.h"
+
+namespace {
+
+const int kFrameMs = 60;
+
+struct Arrival {
+    uint32_t sequence;
+    int64_t arrival_ms;
+};
+
+struct TraceOptions {
+    int frames = 500;
+    int max_jitter_ms = 0;
+    double loss = 0;
+    // A loss starts a burst of this many frames
+    int burst = 1;
+    double swap = 0;
+    uint32_t seed = 1;
+};
+
+/* Frame i leaves the server at i * kFrameMs and arrives after 40ms plus uniform jitter */
+std::vector<Arrival> MakeTrace(const TraceOptions &options) {
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<Arrival> trace;
+    for (int i = 0; i < options.frames; i++) {
+        if (uniform(random) < options.loss) {
+            i += options.burst - 1;
+            continue;
+        }
+        int64_t jitter = options.max_jitter_ms > 0 ? (int64_t)(uniform(random) * options.max_jitter_ms) : 0;
+        trace.push_back({(uint32_t)i, (int64_t)i * kFrameMs + 40 + jitter});
+    }
+    for (size_t i = 0; i + 1 < trace.size(); i++) {
+        if (uniform(random) < options.swap) {
+            std::swap(trace[i].arrival_ms, trace[i + 1].arrival_ms);
+        }
+    }
+    std::stable_sort(trace.begin(), trace.end(), [](const Arrival &a, const Arrival &b) { return a.arrival_ms < b.arrival_ms; });
+    return trace;
+}
+
+struct Replay {
+    int played = 0;
+    int concealed = 0;
+    int frames = 0;
+    int64_t added_p50_ms = 0;
+    int64_t added_p95_ms = 0;
+    JitterBufferStatistics statistics;
+
+    double conceal_ratio() const { return frames > 0 ? (double)concealed / frames : 0; }
+};
+
+Replay ReplayTrace(const char *name, const TraceOptions &options) {
+    auto trace = MakeTrace(options);
+    JitterBuffer buffer;
+    std::map<uint32_t, int64_t> arrival_ms;
+    std::vector<int64_t> added_ms;
+    Replay replay;
+    replay.frames = options.frames;
+
+    size_t next_arrival = 0;
+    int64_t next_pull_ms = trace.front().arrival_ms;
+    int64_t end_ms = trace.back().arrival_ms + 20 * kFrameMs;
+    for (int64_t now = 0; now < end_ms; now++) {
+        while (next_arrival < trace.size() && trace[next_arrival].arrival_ms <= now) {
+            auto packet = std::make_unique<AudioStreamPacket>();
+            packet->sequence = trace[next_arrival].sequence;
+            packet->frame_duration = kFrameMs;
+            arrival_ms[packet->sequence] = now;
+            buffer.Push(std::move(packet), now);
+            next_arrival++;
+        }
+        if (now < next_pull_ms) {
+            continue;
+        }
+        std::unique_ptr<AudioStreamPacket> packet;
+        switch (buffer.Pop(now, packet)) {
+        case kJitterBufferFrame:
+            replay.played++;
+            added_ms.push_back(now - arrival_ms[packet->sequence]);
+            next_pull_ms = std::max(next_pull_ms + kFrameMs, now);
+            break;
+        case kJitterBufferConceal:
+            replay.concealed++;
+            next_pull_ms = std::max(next_pull_ms + kFrameMs, now);
+            break;
+        case kJitterBufferWait:
+            // The speaker runs dry, try again on the next tick
+            break;
+        }
+    }
+
+    std::sort(added_ms.begin(), added_ms.end());
+    if (!added_ms.empty()) {
+        replay.added_p50_ms = added_ms[added_ms.size() / 2];
+        replay.added_p95_ms = added_ms[added_ms.size() * 95 / 100];
+    }
+    replay.statistics = buffer.statistics();
+    printf("%-16s played %4d, concealed %3d (%5.2f%%), skipped %3lu, added latency p50 %3lld ms p95 %3lld ms, depth %d\n", name,
+           replay.played, replay.concealed, replay.conceal_ratio() * 100, replay.statistics.skipped, (long long)replay.added_p50_ms,
+           (long long)replay.added_p95_ms, replay.statistics.target_depth);
+    ::testing::Test::RecordProperty(std::string(name) + "_conceal_ratio", std::to_string(replay.conceal_ratio()));
+    ::testing::Test::RecordProperty(std::string(name) + "_added_p95_ms", std::to_string(replay.added_p95_ms));
+    return replay;
+}
+
+} // namespace
+
+TEST(JitterBufferReplay, CleanNetworkAddsNoDelay) {
+    auto replay = ReplayTrace("clean", TraceOptions());
+    EXPECT_EQ(replay.played, replay.frames);
+    EXPECT_EQ(replay.concealed, 0);
+    EXPECT_LE(replay.added_p95_ms, kFrameMs);
+}
+
+TEST(JitterBufferReplay, JitterIsAbsorbedWithinTheMaximumDepth) {
+    TraceOptions options;
+    options.max_jitter_ms = 150;
+    auto replay = ReplayTrace("jitter_150ms", options);
+    // A frame later than the deepest wait is concealed, and dropped when it finally arrives
+    EXPECT_EQ(replay.played + (int)replay.statistics.late, replay.frames);
+    EXPECT_EQ(replay.concealed, (int)replay.statistics.late);
+    EXPECT_LE(replay.conceal_ratio(), 0.02);
+    EXPECT_LE(replay.added_p95_ms, JITTER_BUFFER_MAX_DEPTH * kFrameMs);
+    EXPECT_GT(replay.statistics.target_depth, 1);
+}
+
+TEST(JitterBufferReplay, ReorderedPacketsArePlayedInOrder) {
+    TraceOptions options;
+    options.max_jitter_ms = 20;
+    options.swap = 0.1;
+    auto replay = ReplayTrace("reorder_10pct", options);
+    EXPECT_EQ(replay.played, replay.frames);
+    EXPECT_EQ(replay.statistics.late, 0u);
+    EXPECT_GT(replay.statistics.reordered, 0u);
+}
+
+TEST(JitterBufferReplay, RandomLossIsConcealed) {
+    TraceOptions options;
+    options.max_jitter_ms = 20;
+    options.loss = 0.05;
+    auto replay = ReplayTrace("loss_5pct", options);
+    int lost = replay.frames - (int)replay.statistics.received;
+    EXPECT_EQ(replay.played, (int)replay.statistics.received);
+    // Single losses are concealed, never skipped
+    EXPECT_EQ(replay.concealed + (int)replay.statistics.skipped, lost);
+    EXPECT_GE(replay.concealed, lost * 9 / 10);
+}
+
+TEST(JitterBufferReplay, LongBurstsAreSkippedAfterTheConcealLimit) {
+    TraceOptions options;
+    options.loss = 0.02;
+    options.burst = 6;
+    auto replay = ReplayTrace("burst_loss", options);
+    EXPECT_EQ(replay.played, (int)replay.statistics.received);
+    EXPECT_GT(replay.statistics.skipped, 0u);
+    EXPECT_LE(replay.concealed, (int)(replay.frames - replay.statistics.received));
+}
+
+TEST(JitterBuffer, PrerollIsDroppedWhileMoreThanTheTargetIsBuffered) {
+    JitterBuffer buffer;
+    // Speech onset after a pause: the resent silence and the first live frame arrive together
+    for (uint32_t sequence = 1; sequence <= 5; sequence++) {
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->sequence = sequence;
+        packet->frame_duration = kFrameMs;
+        packet->preroll = sequence <= 4;
+        buffer.Push(std::move(packet), 0);
+    }
+    std::unique_ptr<AudioStreamPacket> packet;
+    ASSERT_EQ(buffer.Pop(0, packet), kJitterBufferFrame);
+    // The burst raises the target depth, the oldest preroll goes until the target is left
+    auto &statistics = buffer.statistics();
+    EXPECT_GT(statistics.compressed, 0u);
+    EXPECT_EQ(packet->sequence, statistics.compressed + 1);
+    EXPECT_EQ(6 - (int)packet->sequence, statistics.target_depth);
+}
+
+TEST(JitterBuffer, PrerollIsPlayedWhenTheBufferIsNotBehind) {
+    JitterBuffer buffer;
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sequence = 1;
+    packet->frame_duration = kFrameMs;
+    packet->preroll = true;
+    buffer.Push(std::move(packet), 0);
+    ASSERT_EQ(buffer.Pop(0, packet), kJitterBufferFrame);
+    EXPECT_EQ(packet->sequence, 1u);
+    EXPECT_EQ(buffer.statistics().compressed, 0u);
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "ogg_demuxer.h"
+
+namespace {
+
+using Packet = std::vector<uint8_t>;
+
+Packet OpusHead(uint32_t input_rate) {
+    Packet head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1, 0x38, 0x01};
+    for (int i = 0; i < 4; i++) {
+        head.push_back((input_rate >> (8 * i)) & 0xff);
+    }
+    head.insert(head.end(), {0, 0, 0});
+    return head;
+}
+
+Packet OpusTags() {
+    Packet tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+    tags.insert(tags.end(), 8, 0);
+    return tags;
+}
+
+/* A 60ms SILK frame (config 3, code 0) of `size` bytes, filled with `fill` */
+Packet Audio(size_t size, uint8_t fill) {
+    Packet packet(size, fill);
+    packet[0] = 3 << 3;
+    return packet;
+}
+
+/* Lays the packets out as Ogg pages of at most `max_segments` lacing values, without CRCs */
+std::string WriteOgg(const std::vector<Packet> &packets, int max_segments = 255, uint32_t serial = 0x1234) {
+    std::vector<uint8_t> lacing;
+    std::vector<uint8_t> body;
+    for (auto &packet : packets) {
+        size_t size = packet.size();
+        while (size >= 255) {
+            lacing.push_back(255);
+            size -= 255;
+        }
+        lacing.push_back(size);
+        body.insert(body.end(), packet.begin(), packet.end());
+    }
+
+    std::string ogg;
+    size_t segment = 0, offset = 0;
+    bool continued = false;
+    uint32_t sequence = 0;
+    while (segment < lacing.size()) {
+        size_t count = std::min<size_t>(max_segments, lacing.size() - segment);
+        std::string page(OGG_PAGE_HEADER_SIZE, '\0');
+        memcpy(&page[0], "OggS", 4);
+        page[5] = (continued ? 0x01 : 0) | (segment == 0 ? 0x02 : 0);
+        for (int i = 0; i < 4; i++) {
+            page[14 + i] = (serial >> (8 * i)) & 0xff;
+            page[18 + i] = (sequence >> (8 * i)) & 0xff;
+        }
+        page[26] = count;
+        size_t body_size = 0;
+        for (size_t i = 0; i < count; i++) {
+            page.push_back(lacing[segment + i]);
+            body_size += lacing[segment + i];
+        }
+        page.append(reinterpret_cast<const char *>(body.data()) + offset, body_size);
+        continued = lacing[segment + count - 1] == 255;
+        segment += count;
+        offset += body_size;
+        sequence++;
+        ogg += page;
+    }
+    return ogg;
+}
+
+std::vector<Packet> Packets(std::string_view ogg, const OggOpusIndex &index) {
+    std::vector<Packet> packets(index.packet_count());
+    for (size_t i = 0; i < packets.size(); i++) {
+        index.GetPacket(ogg, i, packets[i]);
+    }
+    return packets;
+}
+
+struct ReferenceStream {
+    std::vector<Packet> packets;
+    int64_t last_granule = 0;
+};
+
+/* The plain reading of RFC 3533 for a well formed single stream: join every lacing run */
+ReferenceStream ReadReference(const std::string &ogg) {
+    ReferenceStream stream;
+    Packet current;
+    size_t offset = 0;
+    while (offset + OGG_PAGE_HEADER_SIZE <= ogg.size()) {
+        auto page = reinterpret_cast<const uint8_t *>(ogg.data() + offset);
+        int segments = page[26];
+        const uint8_t *data = page + OGG_PAGE_HEADER_SIZE + segments;
+        for (int i = 0; i < segments; i++) {
+            current.insert(current.end(), data, data + page[OGG_PAGE_HEADER_SIZE + i]);
+            data += page[OGG_PAGE_HEADER_SIZE + i];
+            if (page[OGG_PAGE_HEADER_SIZE + i] < 255) {
+                stream.packets.push_back(std::move(current));
+                current.clear();
+            }
+        }
+        int64_t granule;
+        memcpy(&granule, page + 6, sizeof(granule));
+        if (granule >= 0) {
+            stream.last_granule = granule;
+        }
+        offset = data - reinterpret_cast<const uint8_t *>(ogg.data());
+    }
+    return stream;
+}
+
+} // namespace
+
+TEST(OggDemuxer, IndexesAudioAfterTheHeaders) {
+    auto ogg = WriteOgg({OpusHead(16000), OpusTags(), Audio(40, 1), Audio(50, 2)});
+    OggOpusIndex index;
+    ASSERT_TRUE(OggDemuxer::BuildIndex(ogg, index));
+    EXPECT_EQ(index.sample_rate, 16000);
+    EXPECT_EQ(index.frame_duration, 60);
+    auto packets = Packets(ogg, index);
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_EQ(packets[0], Audio(40, 1));
+    EXPECT_EQ(packets[1], Audio(50, 2));
+}
+
+TEST(OggDemuxer, JoinsPacketsOf255BytesAndLonger) {
+    std::vector<Packet> audio = {Audio(255, 1), Audio(300, 2), Audio(510, 3), Audio(1000, 4)};
+    std::vector<Packet> all = {OpusHead(24000), OpusTags()};
+    all.insert(all.end(), audio.begin(), audio.end());
+    auto ogg = WriteOgg(all);
+    OggOpusIndex index;
+    ASSERT_TRUE(OggDemuxer::BuildIndex(ogg, index));
+    EXPECT_EQ(index.sample_rate, 24000);
+    EXPECT_EQ(Packets(ogg, index), audio);
+}
+
+TEST(OggDemuxer, JoinsPacketsContinuedOnTheNextPage) {
+    std::vector<Packet> audio = {Audio(700, 1), Audio(20, 2), Audio(900, 3)};
+    std::vector<Packet> all = {OpusHead(16000), OpusTags()};
+    all.insert(all.end(), audio.begin(), audio.end());
+    // Two lacing values per page splits every long packet across pages
+    auto ogg = WriteOgg(all, 2);
+    OggOpusIndex index;
+    ASSERT_TRUE(OggDemuxer::BuildIndex(ogg, index));
+    EXPECT_EQ(Packets(ogg, index), audio);
+}
+
+TEST(OggDemuxer, DropsThePacketCutByLostSync) {
+    auto first = WriteOgg({OpusHead(16000), OpusTags(), Audio(40, 1)});
+    auto second = WriteOgg({Audio(600, 2)}, 2);
+    auto third = WriteOgg({Audio(30, 3)});
+    // Corrupt the capture pattern of the second page of the long packet
+    size_t second_page = OGG_PAGE_HEADER_SIZE + 2 + 255 + 255;
+    second[second_page] = 'X';
+    auto ogg = first + second + third;
+
+    OggOpusIndex index;
+    ASSERT_TRUE(OggDemuxer::BuildIndex(ogg, index));
+    std::vector<Packet> expected = {Audio(40, 1), Audio(30, 3)};
+    EXPECT_EQ(Packets(ogg, index), expected);
+}
+
+TEST(OggDemuxer, RejectsStreamsThatAreNotOpus) {
+    OggOpusIndex index;
+    EXPECT_FALSE(OggDemuxer::BuildIndex("", index));
+    EXPECT_FALSE(OggDemuxer::BuildIndex("not an ogg file at all, just some text", index));
+    Packet vorbis = {0x01, 'v', 'o', 'r', 'b', 'i', 's'};
+    vorbis.resize(30);
+    EXPECT_FALSE(OggDemuxer::BuildIndex(WriteOgg({vorbis, OpusTags(), Audio(40, 1)}), index));
+}
+
+TEST(OggDemuxer, CacheReusesTheIndexOfTheSameSound) {
+    auto ogg = WriteOgg({OpusHead(16000), OpusTags(), Audio(40, 1)});
+    OggOpusIndexCache cache;
+    auto index = cache.Get(ogg);
+    ASSERT_NE(index, nullptr);
+    EXPECT_EQ(cache.Get(ogg), index);
+    EXPECT_EQ(cache.Get("garbage"), nullptr);
+}
+
+/* Every sound shipped in main/assets, against the reference reading and the granule positions */
+TEST(OggDemuxer, IndexesEveryAsset) {
+    namespace fs = std::filesystem;
+    int files = 0;
+    for (auto &entry : fs::recursive_directory_iterator(fs::path(REPO_ROOT) / "main" / "assets")) {
+        if (entry.path().extension() != ".ogg") {
+            continue;
+        }
+        SCOPED_TRACE(entry.path().string());
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::string ogg((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        files++;
+
+        OggOpusIndex index;
+        ASSERT_TRUE(OggDemuxer::BuildIndex(ogg, index));
+        EXPECT_GT(index.sample_rate, 0);
+        EXPECT_GT(index.frame_duration, 0);
+
+        auto reference = ReadReference(ogg);
+        ASSERT_GE(reference.packets.size(), 2u);
+        std::vector<Packet> audio;
+        for (size_t i = 2; i < reference.packets.size(); i++) {
+            if (!reference.packets[i].empty()) {
+                audio.push_back(reference.packets[i]);
+            }
+        }
+        ASSERT_EQ(Packets(ogg, index), audio);
+
+        /* The sounds use one frame size, so the packets must cover the stream's granule length */
+        int pre_skip = reference.packets[0][10] | (reference.packets[0][11] << 8);
+        int64_t indexed_samples = (int64_t)index.packet_count() * index.frame_duration * 48;
+        int64_t stream_samples = reference.last_granule;
+        EXPECT_GE(indexed_samples, stream_samples - pre_skip);
+        EXPECT_LE(indexed_samples, stream_samples + index.frame_duration * 48);
+    }
+    EXPECT_GT(files, 0);
+}
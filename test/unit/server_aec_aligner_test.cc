@@ -0,0 +1,127 @@
+/*
+ * Runs ServerAecAligner against simulated codec clocks: the speaker at 24kHz nominal running 0.1%
+ * fast, the mic at 16kHz nominal running 0.1% slow, and every blocking read / write returning up to
+ * 2ms late. The reference timestamps must follow the true playback position for minutes, where
+ * assuming the nominal rates would drift by 2ms every second.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "server_aec_aligner.h"
+
+namespace {
+
+const int kOutputRate = 24000;
+const int kInputRate = 16000;
+const size_t kPlaybackSamples = kOutputRate * 60 / 1000;
+const size_t kCaptureSamples = kInputRate * 30 / 1000;
+const size_t kUplinkFrameSamples = kInputRate * 60 / 1000;
+const uint32_t kFirstTimestamp = 1000;
+// A write returns once its samples are in the DMA buffers, this long before they are played
+const size_t kOutputDmaSamples = kOutputRate * 20 / 1000;
+
+struct Skew {
+    double output_ppm;
+    double input_ppm;
+};
+
+struct Result {
+    double max_error_ms = 0;
+    uint32_t checked = 0;
+    // Frames after the warm-up that got no timestamp
+    uint32_t missed = 0;
+    ServerAecStatistics statistics;
+};
+
+Result Simulate(const Skew &skew, int seconds) {
+    ServerAecAligner aligner;
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> late_us(0, 2000);
+
+    // True samples per microsecond
+    double output_rate = kOutputRate * (1 + skew.output_ppm / 1e6) / 1e6;
+    double input_rate = kInputRate * (1 + skew.input_ppm / 1e6) / 1e6;
+    uint64_t output_position = 0, input_position = 0;
+    uint32_t timestamp = kFirstTimestamp;
+    Result result;
+
+    int64_t end_us = (int64_t)seconds * 1000000;
+    while (true) {
+        // The next call to return is the one whose samples are done first
+        int64_t output_done = (int64_t)std::ceil((output_position + kPlaybackSamples - kOutputDmaSamples) / output_rate);
+        int64_t input_done = (int64_t)std::ceil((input_position + kCaptureSamples) / input_rate);
+        if (std::min(output_done, input_done) > end_us) {
+            break;
+        }
+        if (output_done <= input_done) {
+            output_position += kPlaybackSamples;
+            aligner.OnPlayback(timestamp, kPlaybackSamples, kOutputRate, output_done + late_us(random));
+            timestamp += 60;
+            continue;
+        }
+        input_position += kCaptureSamples;
+        aligner.OnCapture(kCaptureSamples, kInputRate, input_done + late_us(random));
+        if (input_position % kUplinkFrameSamples != 0) {
+            continue;
+        }
+
+        uint32_t aligned = aligner.GetTimestamp(kUplinkFrameSamples);
+        // Skip the first seconds, the rates are measured over at least one
+        if (input_done < 3000000) {
+            continue;
+        }
+        if (aligned == 0) {
+            result.missed++;
+            continue;
+        }
+        /* What had been written when the frame's first sample was captured, the DMA depth is left to the server */
+        double captured_us = (input_position - kUplinkFrameSamples) / input_rate;
+        double written = captured_us * output_rate + kOutputDmaSamples;
+        double expected = kFirstTimestamp + written * 1000 / kOutputRate;
+        result.max_error_ms = std::max(result.max_error_ms, std::fabs(aligned - expected));
+        result.checked++;
+    }
+    result.statistics = aligner.GetStatistics();
+    return result;
+}
+
+} // namespace
+
+TEST(ServerAecAligner, FollowsPlaybackWithoutSkew) {
+    auto result = Simulate({0, 0}, 60);
+    EXPECT_GT(result.checked, 900u);
+    EXPECT_LE(result.max_error_ms, 3.0);
+    EXPECT_NEAR(result.statistics.output_drift_ppm, 0, 100);
+    EXPECT_NEAR(result.statistics.input_drift_ppm, 0, 100);
+    EXPECT_EQ(result.missed, 0u);
+}
+
+TEST(ServerAecAligner, DoesNotDriftWithClocksSkewedByATenthOfAPercent) {
+    auto result = Simulate({1000, -1000}, 180);
+    EXPECT_GT(result.checked, 2900u);
+    // Nominal rates would be 360ms off by the end
+    EXPECT_LE(result.max_error_ms, 3.0);
+    EXPECT_NEAR(result.statistics.output_drift_ppm, 1000, 100);
+    EXPECT_NEAR(result.statistics.input_drift_ppm, -1000, 100);
+    EXPECT_EQ(result.missed, 0u);
+}
+
+TEST(SampleClock, MeasuresTheRateOverTheWholeRun) {
+    SampleClock clock;
+    // 16kHz running 0.1% fast, 30ms reads
+    double rate = 16016 / 1e6;
+    uint64_t position = 0;
+    for (int i = 1; i <= 200; i++) {
+        position += 480;
+        clock.Update((int64_t)(position / rate) + (i % 3) * 500, position, 16000);
+    }
+    EXPECT_NEAR(clock.drift_ppm(), 1000, 100);
+    EXPECT_NEAR(clock.PositionAt(clock.TimeOf(position)), position, 1.0);
+
+    // A stop longer than the resync time starts a new run and keeps the measured rate
+    position += 4800;
+    clock.Update((int64_t)(position / rate) + 1000000, position, 16000);
+    EXPECT_NEAR(clock.drift_ppm(), 1000, 100);
+}
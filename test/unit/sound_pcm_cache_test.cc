@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <string_view>
+#include <vector>
+
+#include "esp_timer.h"
+#include "sound_pcm_cache.h"
+
+namespace {
+
+/* An index of `frames` 60ms packets, the cache only looks at the count and the duration */
+OggOpusIndex Index(size_t frames) {
+    OggOpusIndex index;
+    index.sample_rate = 16000;
+    index.frame_duration = 60;
+    for (size_t i = 0; i < frames; i++) {
+        index.packet_ends.push_back(i);
+    }
+    return index;
+}
+
+} // namespace
+
+TEST(SoundPcmCache, OnlyRegisteredSoundsAreCaptured) {
+    static const char kCue[] = "registered cue";
+    static const char kPrompt[] = "one-off prompt";
+    auto &cache = SoundPcmCache::GetInstance();
+    auto index = Index(2);
+    std::vector<int16_t> frame(960, 7);
+
+    auto before = cache.GetStatistics();
+    uint32_t fill_id = 1;
+    EXPECT_EQ(cache.Lookup(kPrompt, index, 16000, fill_id), nullptr);
+    EXPECT_EQ(fill_id, 0u);
+    EXPECT_EQ(cache.GetStatistics().misses, before.misses);
+
+    cache.Register(kCue);
+    cache.Register(kCue);
+    EXPECT_EQ(cache.Lookup(kCue, index, 16000, fill_id), nullptr);
+    ASSERT_NE(fill_id, 0u);
+    cache.Append(fill_id, 0, frame);
+    cache.Append(fill_id, 1, frame);
+
+    auto pcm = cache.Lookup(kCue, index, 16000, fill_id);
+    ASSERT_NE(pcm, nullptr);
+    EXPECT_EQ(pcm->size, 2 * frame.size());
+    auto after = cache.GetStatistics();
+    EXPECT_EQ(after.sounds, before.sounds + 1);
+    EXPECT_EQ(after.hits, before.hits + 1);
+
+    // The same bytes at another address are another sound
+    std::string copy(kCue);
+    EXPECT_EQ(cache.Lookup(copy, index, 16000, fill_id), nullptr);
+    EXPECT_EQ(fill_id, 0u);
+}
+
+TEST(SoundPcmCache, AnAbortedCaptureFreesTheSlot) {
+    static const char kFirst[] = "first cue";
+    static const char kSecond[] = "second cue";
+    auto &cache = SoundPcmCache::GetInstance();
+    cache.Register(kFirst);
+    cache.Register(kSecond);
+    auto index = Index(3);
+    std::vector<int16_t> frame(960, 3);
+
+    uint32_t first = 0, second = 0;
+    cache.Lookup(kFirst, index, 16000, first);
+    ASSERT_NE(first, 0u);
+    cache.Append(first, 0, frame);
+    // Interrupted after one frame: only one capture at a time, the second sound waits
+    cache.Lookup(kSecond, index, 16000, second);
+    EXPECT_EQ(second, 0u);
+    cache.AbortFill(first);
+
+    cache.Lookup(kSecond, index, 16000, second);
+    ASSERT_NE(second, 0u);
+    // A late abort of the first capture leaves the second one alone
+    cache.AbortFill(first);
+    for (uint32_t i = 0; i < 3; i++) {
+        cache.Append(second, i, frame);
+    }
+    EXPECT_NE(cache.Lookup(kSecond, index, 16000, second), nullptr);
+    // The interrupted sound is captured again on its next play
+    cache.Lookup(kFirst, index, 16000, first);
+    EXPECT_NE(first, 0u);
+    cache.AbortFill();
+}
+
+TEST(SoundPcmCache, AStalledCaptureTimesOut) {
+    static const char kStalled[] = "stalled cue";
+    static const char kNext[] = "next cue";
+    auto &cache = SoundPcmCache::GetInstance();
+    cache.Register(kStalled);
+    cache.Register(kNext);
+    auto index = Index(2);
+    host_clock_set_manual(true);
+
+    uint32_t stalled = 0, next = 0;
+    cache.Lookup(kStalled, index, 16000, stalled);
+    ASSERT_NE(stalled, 0u);
+    // Frame 1 never reaches Append and nobody calls AbortFill
+    cache.Append(stalled, 0, std::vector<int16_t>(960, 1));
+    host_clock_advance_us((2 * 60 + SOUND_PCM_CACHE_FILL_SLACK_MS - 1) * 1000);
+    cache.Lookup(kNext, index, 16000, next);
+    EXPECT_EQ(next, 0u);
+    host_clock_advance_us(1000);
+    cache.Lookup(kNext, index, 16000, next);
+    EXPECT_NE(next, 0u);
+    // The stalled capture is gone, its late frames are ignored
+    cache.Append(stalled, 1, std::vector<int16_t>(960, 1));
+    EXPECT_EQ(cache.Lookup(kStalled, index, 16000, stalled), nullptr);
+    cache.AbortFill();
+    host_clock_set_manual(false);
+}
@@ -0,0 +1,153 @@
+/*
+ * UplinkDtx on a 20ms frame clock: hangover after speech, keepalive DTX packets, the preroll resent
+ * at speech onset with the capture time of every frame, and the count of suppressed frames.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "uplink_dtx.h"
+
+namespace {
+
+const int kFrameMs = 20;
+
+class UplinkDtxTest : public testing::Test {
+  protected:
+    void SetUp() override { dtx_.SetEnabled(true); }
+
+    /* Next frame, its samples are its index so the preroll can be told apart */
+    UplinkDtxDecision Frame(bool voice) {
+        std::vector<int16_t> pcm(16 * kFrameMs, (int16_t)frame_);
+        auto decision = dtx_.Process(pcm, Now(), voice, Now());
+        frame_++;
+        return decision;
+    }
+
+    int64_t Now() const { return (int64_t)frame_ * kFrameMs * 1000; }
+
+    UplinkDtx dtx_;
+    // Not at 0, the first keepalive is due at once
+    int frame_ = 1000;
+};
+
+} // namespace
+
+TEST_F(UplinkDtxTest, SendsEverythingWhenDisabled) {
+    dtx_.SetEnabled(false);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(Frame(false), kUplinkDtxSend);
+    }
+    EXPECT_EQ(dtx_.suppressed_count(), 0u);
+}
+
+TEST_F(UplinkDtxTest, KeepsSendingThroughTheHangover) {
+    EXPECT_EQ(Frame(true), kUplinkDtxSend);
+    int64_t speech_us = Now() - kFrameMs * 1000;
+    int sent = 0;
+    while (Frame(false) == kUplinkDtxSend) {
+        sent++;
+    }
+    EXPECT_EQ(sent, UPLINK_DTX_HANGOVER_MS / kFrameMs - 1);
+    EXPECT_GE(Now() - kFrameMs * 1000 - speech_us, UPLINK_DTX_HANGOVER_MS * 1000);
+}
+
+TEST_F(UplinkDtxTest, SendsAKeepaliveEveryInterval) {
+    int keepalives = 0, suppressed = 0;
+    // The first frame is inside the hangover of the enable
+    Frame(true);
+    for (int i = 0; i < UPLINK_DTX_HANGOVER_MS / kFrameMs + 2000 / kFrameMs; i++) {
+        switch (Frame(false)) {
+        case kUplinkDtxKeepalive:
+            keepalives++;
+            break;
+        case kUplinkDtxSuppress:
+            suppressed++;
+            break;
+        default:
+            break;
+        }
+    }
+    EXPECT_EQ(keepalives, 2000 / UPLINK_DTX_KEEPALIVE_MS + 1);
+    EXPECT_EQ(dtx_.suppressed_count(), (uint32_t)(keepalives + suppressed));
+    EXPECT_EQ(dtx_.suppressed_count(), (uint32_t)(2000 / kFrameMs + 1));
+}
+
+TEST_F(UplinkDtxTest, ResendsTheLatestSilenceWithItsCaptureTime) {
+    Frame(true);
+    while (Frame(false) == kUplinkDtxSend) {
+    }
+    for (int i = 0; i < 20; i++) {
+        Frame(false);
+    }
+    int onset = frame_;
+    ASSERT_EQ(Frame(true), kUplinkDtxOnset);
+
+    std::vector<int16_t> pcm;
+    int64_t origin_us = 0;
+    std::vector<int> frames;
+    while (dtx_.PopPreroll(100, pcm, origin_us)) {
+        ASSERT_EQ(pcm.size(), 16u * kFrameMs);
+        EXPECT_EQ(origin_us, (int64_t)pcm[0] * kFrameMs * 1000);
+        frames.push_back(pcm[0]);
+    }
+    // The last UPLINK_DTX_PREROLL_MS before the onset, oldest first
+    std::vector<int> expected;
+    for (int i = onset - UPLINK_DTX_PREROLL_MS / kFrameMs; i < onset; i++) {
+        expected.push_back(i);
+    }
+    EXPECT_EQ(frames, expected);
+    EXPECT_EQ(Frame(true), kUplinkDtxSend);
+}
+
+TEST_F(UplinkDtxTest, ThePrerollIsCutToTheRoomGiven) {
+    Frame(true);
+    while (Frame(false) == kUplinkDtxSend) {
+    }
+    for (int i = 0; i < 20; i++) {
+        Frame(false);
+    }
+    int onset = frame_;
+    ASSERT_EQ(Frame(true), kUplinkDtxOnset);
+
+    std::vector<int16_t> pcm;
+    int64_t origin_us = 0;
+    std::vector<int> frames;
+    while (dtx_.PopPreroll(2, pcm, origin_us)) {
+        frames.push_back(pcm[0]);
+    }
+    // Only the newest frames, the older ones are dropped for good
+    EXPECT_EQ(frames, (std::vector<int>{onset - 2, onset - 1}));
+    EXPECT_FALSE(dtx_.PopPreroll(100, pcm, origin_us));
+}
+
+TEST_F(UplinkDtxTest, LongerFramesKeepThePrerollDuration) {
+    Frame(true);
+    while (Frame(false) == kUplinkDtxSend) {
+    }
+    for (int i = 0; i < 20; i++) {
+        std::vector<int16_t> pcm(16 * 60, (int16_t)i);
+        dtx_.Process(pcm, Now(), false, Now());
+        frame_ += 3;
+    }
+    std::vector<int16_t> pcm(16 * 60);
+    ASSERT_EQ(dtx_.Process(pcm, Now(), true, Now()), kUplinkDtxOnset);
+    int64_t origin_us = 0;
+    int count = 0;
+    while (dtx_.PopPreroll(100, pcm, origin_us)) {
+        count++;
+    }
+    EXPECT_EQ(count, UPLINK_DTX_PREROLL_MS / 60);
+}
+
+TEST_F(UplinkDtxTest, DisablingWhileSuppressedDropsThePreroll) {
+    Frame(true);
+    while (Frame(false) == kUplinkDtxSend) {
+    }
+    dtx_.SetEnabled(false);
+    EXPECT_EQ(Frame(false), kUplinkDtxSend);
+    std::vector<int16_t> pcm;
+    int64_t origin_us = 0;
+    EXPECT_FALSE(dtx_.PopPreroll(100, pcm, origin_us));
+}
@@ -0,0 +1,128 @@
+/*
+ * WakeWordPreroll: which frames of its ring a detection sends (the complete frames still in the
+ * ring, after the ones an earlier detection sent), their content across the wrap of the ring, and
+ * the wake word to first packet time.
+ *
+ * Frame n of the stored audio is a 100Hz tone whose amplitude marks n % 4, so the decoded packets
+ * tell which frames were sent and in which order, with the fake codec and with libopus.
+ */
+#include <gtest/gtest.h>
+
+#include <opus.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "wake_words/wake_word_preroll.h"
+
+namespace {
+
+const int kChunk = 480; // 30ms detection chunks
+
+int Amplitude(uint64_t frame) {
+    return 2000 * (frame % 4 + 1);
+}
+
+class WakeWordPrerollTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        int error = 0;
+        decoder_ = opus_decoder_create(16000, 1, &error);
+        ASSERT_NE(decoder_, nullptr);
+    }
+
+    void TearDown() override {
+        opus_decoder_destroy(decoder_);
+    }
+
+    /* Stores `samples` more samples of the marked frames, in detection chunks */
+    void Store(size_t samples) {
+        std::vector<int16_t> chunk;
+        while (samples > 0) {
+            chunk.clear();
+            for (size_t i = 0; i < kChunk && i < samples; i++, stored_++) {
+                uint64_t frame = stored_ / WAKE_WORD_PREROLL_FRAME_SAMPLES;
+                chunk.push_back((int16_t)(Amplitude(frame) * sin(2 * M_PI * 100 * stored_ / 16000)));
+            }
+            preroll_.Store(chunk.data(), chunk.size());
+            samples -= chunk.size();
+        }
+    }
+
+    /* Encode() and the amplitude mark (frame % 4) of every packet handed out */
+    std::vector<int> Detect() {
+        preroll_.Encode();
+        std::vector<int> marks;
+        std::vector<uint8_t> opus;
+        std::vector<int16_t> pcm(WAKE_WORD_PREROLL_FRAME_SAMPLES);
+        while (preroll_.GetOpus(opus)) {
+            int samples = opus_decode(decoder_, opus.data(), opus.size(), pcm.data(), pcm.size(), 0);
+            EXPECT_EQ(samples, WAKE_WORD_PREROLL_FRAME_SAMPLES);
+            // The second half of the frame, clear of the codec delay
+            int peak = 0;
+            for (int i = samples / 2; i < samples; i++) {
+                peak = std::max(peak, abs(pcm[i]));
+            }
+            marks.push_back((peak + 1000) / 2000 - 1);
+        }
+        host_task_join_all();
+        return marks;
+    }
+
+    static std::vector<int> Marks(uint64_t first, uint64_t last) {
+        std::vector<int> marks;
+        for (uint64_t frame = first; frame < last; frame++) {
+            marks.push_back(frame % 4);
+        }
+        return marks;
+    }
+
+    WakeWordPreroll preroll_;
+    OpusDecoder *decoder_ = nullptr;
+    uint64_t stored_ = 0;
+};
+
+} // namespace
+
+TEST_F(WakeWordPrerollTest, SendsEveryCompleteFrameBeforeTheRingFills) {
+    Store(5 * WAKE_WORD_PREROLL_FRAME_SAMPLES + kChunk);
+    EXPECT_EQ(Detect(), Marks(0, 5));
+}
+
+TEST_F(WakeWordPrerollTest, SendsTheWholeRingAfterItWrapped) {
+    Store(50 * WAKE_WORD_PREROLL_FRAME_SAMPLES);
+    // The oldest frame is the one the ring holds in full
+    EXPECT_EQ(Detect(), Marks(50 - WAKE_WORD_PREROLL_FRAMES, 50));
+}
+
+TEST_F(WakeWordPrerollTest, APartialFrameHasOverwrittenTheOldest) {
+    Store(50 * WAKE_WORD_PREROLL_FRAME_SAMPLES + kChunk);
+    EXPECT_EQ(Detect(), Marks(51 - WAKE_WORD_PREROLL_FRAMES, 50));
+}
+
+TEST_F(WakeWordPrerollTest, ALaterDetectionStartsAfterTheFramesAlreadySent) {
+    Store(10 * WAKE_WORD_PREROLL_FRAME_SAMPLES);
+    EXPECT_EQ(Detect().size(), 10u);
+    // Nothing new
+    EXPECT_TRUE(Detect().empty());
+
+    Store(3 * WAKE_WORD_PREROLL_FRAME_SAMPLES);
+    EXPECT_EQ(Detect(), Marks(10, 13));
+
+    // Across the wrap the ring still limits what is sent
+    Store(40 * WAKE_WORD_PREROLL_FRAME_SAMPLES);
+    EXPECT_EQ(Detect(), Marks(53 - WAKE_WORD_PREROLL_FRAMES, 53));
+}
+
+TEST_F(WakeWordPrerollTest, MeasuresWakeToFirstPacket) {
+    EXPECT_EQ(preroll_.wake_to_first_packet_us(), -1);
+    Store(WAKE_WORD_PREROLL_FRAMES * WAKE_WORD_PREROLL_FRAME_SAMPLES);
+    EXPECT_EQ(Detect().size(), (size_t)WAKE_WORD_PREROLL_FRAMES);
+    int64_t elapsed_us = preroll_.wake_to_first_packet_us();
+    EXPECT_GE(elapsed_us, 0);
+    EXPECT_LT(elapsed_us, 1000000);
+    RecordProperty("wake_to_first_packet_us", (int)elapsed_us);
+    printf("wake word to first packet: %.1f ms\n", elapsed_us / 1000.0);
+}